@@ -0,0 +1,43 @@
+/*	CMU Cascade Neural Network Simulator (CNNS)
+	Benchmark program
+
+	The simulator program (see main.c) with the random number generator
+	seeded from the command line instead of the clock, so that a run
+	trains the same way every time:
+
+	  bench <seed> [script ...] < commands
+
+	'bench.sh' builds this file against the current library and the
+	globals build's, and times the two on the same scripts and seeds.
+*/
+
+#include <stdlib.h>
+
+#include "toolkit.h"
+#include "cascade.h"
+
+/*	External Global Variable Declarations	*/
+
+extern boolean interact;
+
+
+void main ( int argc, char *argv[] )
+{
+  train_parm_t *parms;
+  int          i;
+
+  if  ( argc < 2 )  {
+    fprintf( stderr, "Usage: %s <seed> [script ...]\n", argv[0] );
+    exit( 1 );
+  }
+
+  parms    = cascade_init( );    /*  Build and initialize a parm table  */
+  srandom( atol( argv[1] ) );    /*  Then reseed it from our argument   */
+  interact = FALSE;
+  set_parmtable( parms );
+
+  for  ( i = 2 ; i < argc ; i++ )
+    load_script( argv[i], NULL );
+
+  cli( 0 );    /*  No context; the globals build takes a boolean here  */
+}
@@ -0,0 +1,161 @@
+#!/bin/bash
+#
+#	CMU Cascade Neural Network Simulator (CNNS)
+#	Training benchmark
+#
+#	Times single-threaded training with the build from before training
+#	kept its state in a context (the globals build) and with the tree
+#	as it is now, on the same inputs.  Both run the scripts through
+#	'bench.c', which seeds the random number generator with BENCH_SEED
+#	instead of the clock, so they train from the same draws and do the
+#	same work.  The data is generated here:
+#
+#	  checker  3 continuous inputs, 3 classes; two trials of up to 8
+#	           hidden units.
+#	  hc       an input of 1000 enumerated values and a continuous one,
+#	           14 outputs; one trial with 2 hidden units.  Its cost is
+#	           in the candidates' inner loops over the units.
+#	  hc2      hc, trained with Cascade-2, whose outputs would train
+#	           to the epoch limit; 'outputEpochs 200'.
+#
+#	Each case is run BENCH_RUNS times (3) on each build, alternating
+#	between them, and the user seconds of every run are reported with
+#	their mean.  The epochs, candidate scores and errors of the two
+#	builds are compared, to show that they trained alike.
+#
+#	  BENCH_BASE    Revision of the globals build (3864ec8^)
+#	  BENCH_RUNS    Runs of each case on each build
+#	  BENCH_SEED    Seed of the random number generator (12345)
+#	  BENCH_CFLAGS  MACHDEP_CFLAGS of both builds (-O2 -fcommon)
+#	  BENCH_DIR     Where the builds and data go (a temporary directory)
+#
+#	Run from this directory, or as 'make bench'.
+
+BASE=${BENCH_BASE:-3864ec8^}
+RUNS=${BENCH_RUNS:-3}
+SEED=${BENCH_SEED:-12345}
+FLAGS=${BENCH_CFLAGS:--O2 -fcommon}
+DIR=${BENCH_DIR:-`mktemp -d /tmp/cascade-bench.XXXXXX`}
+ROOT=`git rev-parse --show-toplevel` || exit 1
+
+#  Build a tree in $DIR/$1, whose sources are already in $DIR/$1/src
+build ()  {
+  mkdir -p $DIR/$1/lib $DIR/$1/include
+  for lib in toolkit parse ; do
+    ( cd $DIR/$1/src/$lib &&
+      make INSTALL_DIR=$DIR/$1 MACHDEP_CFLAGS="$FLAGS" install ) \
+      > $DIR/$1/build.log 2>&1 || return 1
+  done
+  ( cd $DIR/$1/src/cascade &&
+    make INSTALL_DIR=$DIR/$1 MACHDEP_CFLAGS="$FLAGS" libcascade.a ) \
+    >> $DIR/$1/build.log 2>&1 || return 1
+  cc $FLAGS -I$DIR/$1/include -I$DIR/$1/src/cascade -o $DIR/$1/bench \
+    $ROOT/src/cascade/bench.c -L$DIR/$1/src/cascade -lcascade \
+    -L$DIR/$1/lib -lparse -ltoolkit -lm -lpthread \
+    >> $DIR/$1/build.log 2>&1
+}
+
+echo "Building the globals build ($BASE) and the current tree in $DIR"
+mkdir -p $DIR/base $DIR/head
+( cd $ROOT && git archive $BASE src ) | tar -x -C $DIR/base || exit 1
+cp -r $ROOT/src $DIR/head
+for b in base head ; do
+  if  ! build $b ; then
+    echo "Build of '$b' failed, see $DIR/$b/build.log"
+    exit 1
+  fi
+done
+
+#  The data
+awk 'BEGIN { srand( 3 );
+  print ";Checker\n\n$SETUP\nNseries: 6;\nseries[1..3]: cont;";
+  print "series[4..6]: binary;\n";
+  print "train: for i = t0 to t1";
+  print "  series[1,i],series[2,i],series[3,i] => series[4,i],series[5,i],series[6,i];";
+  print "test: for i = t1 to t2";
+  print "  series[1,i],series[2,i],series[3,i] => series[4,i],series[5,i],series[6,i];\n";
+  print "$DATA\n[t0]";
+  for  ( k = 0 ; k < 6000 ; k++ )  {
+    if  ( k == 3000 )  print "[t1]";
+    x = 2*rand()-1;  y = 2*rand()-1;  z = 2*rand()-1;
+    c = int( sin( 4*x ) + sin( 4*y ) + z + 3 ) % 3;
+    printf ( "%.3f, %.3f, %.3f, %s, %s, %s;\n", x, y, z,
+	     (c == 0) ? "+" : "-", (c == 1) ? "+" : "-", (c == 2) ? "+" : "-" );
+  }
+  print "[t2]" }' > $DIR/checker.data
+
+awk 'BEGIN { srand( 5 );
+  printf ( ";High cardinality\n\n$SETUP\nNseries: 4;\nseries[1]: enum { v0" );
+  for  ( k = 1 ; k < 1000 ; k++ )  printf ( ", v%d", k );
+  printf ( " };\nseries[2]: cont;\nseries[3]: binenum { o0" );
+  for  ( k = 1 ; k < 12 ; k++ )  printf ( ", o%d", k );
+  printf ( " };\nseries[4]: enum { p0" );
+  for  ( k = 1 ; k < 10 ; k++ )  printf ( ", p%d", k );
+  print " };\n";
+  print "train: for i = t0 to t1";
+  print "  series[1,i],series[2,i] => series[3,i],series[4,i];";
+  print "test: for i = t1 to t2";
+  print "  series[1,i],series[2,i] => series[3,i],series[4,i];\n";
+  print "$DATA\n[t0]";
+  for  ( k = 0 ; k < 5000 ; k++ )  {
+    if  ( k == 4000 )  print "[t1]";
+    v = int( 1000*rand() );  x = 2*rand()-1;
+    printf ( "v%d, %.3f, o%d, p%d;\n", v, x, (v + (x > 0)) % 12,
+	     (v % 7 + int( 5*(x+1) )) % 10 );
+  }
+  print "[t2]" }' > $DIR/hc.data
+
+cat > $DIR/checker.scr <<EOF
+interact false
+validate false
+Nthreads 1
+maxNewUnits 8
+train ck1 $DIR/checker.data
+train ck2 $DIR/checker.data
+quit true
+EOF
+
+cat > $DIR/hc.scr <<EOF
+interact false
+validate false
+Nthreads 1
+maxNewUnits 2
+train hc $DIR/hc.data
+quit true
+EOF
+
+sed 's/^train hc /algorithm cascade2\
+outputEpochs 200\
+train hc2 /' $DIR/hc.scr > $DIR/hc2.scr
+
+#  The lines of a run's output that do not depend on its timing.  The
+# current tree sums the test error in fixed chunks of points, so the
+# last digit of the test set's squared differences may differ.
+results ()  {
+  grep "Epoch\|Score\|Hidden units\|Sum sq\|Error bits\|Error count" $1 |
+    sed -e 's/Average epoch time.*//' -e 's/Sum sq diffs: [0-9.]*//'
+}
+
+#  Time the runs, in $DIR so that their logs go there
+cd $DIR
+TIMEFORMAT=%U
+for c in checker hc hc2 ; do
+  for (( r = 1 ; r <= RUNS ; r++ )) ; do
+    for b in base head ; do
+      { time $DIR/$b/bench $SEED < $DIR/$c.scr \
+	  > $DIR/$c.$b.out 2>&1 ; } 2>> $DIR/$c.$b.times
+    done
+  done
+
+  echo
+  echo "$c:"
+  for b in base head ; do
+    awk -v b=$b '{ t += $1; printf ( "%s%s", (NR > 1) ? " " : "", $1 ) }
+      END { printf ( "   mean %.2f  (%s)\n", t/NR, b ) }' $DIR/$c.$b.times
+  done
+  if  cmp -s <(results $DIR/$c.base.out) <(results $DIR/$c.head.out) ; then
+    echo "  Both builds trained alike: the same epochs, units and errors."
+  else
+    echo "  The builds trained differently; see $DIR/$c.*.out"
+  fi
+done
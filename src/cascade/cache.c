@@ -10,15 +10,13 @@
 */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include "toolkit.h"
 #include "cascade.h"
 
-#ifdef CONNX
-extern int connx;
-#endif
-
 /*	BUILD CACHE -  Allocate memory for the cache.  If not enough memory is
-	available, deallocate the partial cache and return gracefully.
+	available, deallocate the partial cache and return gracefully.  If
+	'errCache' is NULL, only the value cache is built.
 */
 
 boolean build_cache  ( int maxUnits, int Noutputs, int Npts,
@@ -26,8 +24,11 @@ boolean build_cache  ( int maxUnits, int Noutputs, int Npts,
 {
   int i;
   
-  if  ( (((*valCache) = (float **)malloc(Npts*sizeof( float * ))) == NULL) ||
-        (((*errCache) = (float **)malloc(Npts*sizeof( float * ))) == NULL) )  {
+  if  ( errCache != NULL )
+    *errCache = NULL;
+  if  ( (((*valCache) = (float **)calloc(Npts, sizeof( float * ))) == NULL) ||
+        ((errCache != NULL) &&
+	 (((*errCache) = (float **)calloc(Npts, sizeof( float * ))) == NULL)) ) {
     free_cache( valCache, errCache, Npts );
     printf  ("ERROR: Insufficient memory for cache, shutting cache down.\n");
     return FALSE;
@@ -35,7 +36,8 @@ boolean build_cache  ( int maxUnits, int Noutputs, int Npts,
 
   for  ( i = 0 ; i < Npts ; i++ )
     if  ((((*valCache)[i] =(float *)malloc(maxUnits*sizeof(float))) == NULL) ||
-	 (((*errCache)[i] =(float *)malloc(Noutputs*sizeof(float))) == NULL)) {
+	 ((errCache != NULL) &&
+	  (((*errCache)[i] =(float *)malloc(Noutputs*sizeof(float))) == NULL))) {
       free_cache( valCache, errCache, Npts );
       printf  ("ERROR: Insufficient memory for cache, shutting cache down.\n");
       return FALSE;
@@ -45,7 +47,8 @@ boolean build_cache  ( int maxUnits, int Noutputs, int Npts,
 }
 
 
-/*	FREE CACHE -  Deallocate the memory associated with a cache.
+/*	FREE CACHE -  Deallocate the memory associated with a cache.  Either
+	cache may be missing.
 */
 
 void free_cache  ( float ***valCache, float ***errCache, int Npts )
@@ -53,19 +56,21 @@ void free_cache  ( float ***valCache, float ***errCache, int Npts )
   int i;
 
   for  ( i = 0 ; i < Npts ; i++ )  {
-    if  ( (*valCache)[i] != NULL )
+    if  ( (*valCache != NULL) && ((*valCache)[i] != NULL) )
       free( (*valCache)[i] );
-    if  ( (*errCache)[i] != NULL )
+    if  ( (errCache != NULL) && (*errCache != NULL) &&
+	  ((*errCache)[i] != NULL) )
       free( (*errCache)[i] );
   }
 
   if  ( *valCache != NULL )
     free( *valCache );
-  if  ( *errCache != NULL )
-    free( *errCache );
-
   *valCache = NULL;
-  *errCache = NULL;
+  if  ( errCache != NULL )  {
+    if  ( *errCache != NULL )
+      free( *errCache );
+    *errCache = NULL;
+  }
 }
 
 
@@ -87,11 +92,11 @@ void compute_cache  ( int Ninputs, data_set_t *dSet, float **valCache )
 
 /*	RECOMPUTE CACHE -  Recompute the values of a cache for a new unit.
 	This function should be called every time a unit is added to the
-	network.
+	network.  Returns the number of connection crossings made.
 */
 
-void recompute_cache  ( int unitNum, net_t *net, data_set_t *dSet, 
-		        float **valCache )
+int recompute_cache  ( int unitNum, net_t *net, data_set_t *dSet, 
+		       float **valCache )
 {
   float sum;
   int   i,j;
@@ -105,11 +110,37 @@ void recompute_cache  ( int unitNum, net_t *net, data_set_t *dSet,
       sum += ((i>0)?valCache[i-1][unitNum]:0.0) * 
 	      net->weights[unitNum][unitNum];
 
-    valCache[i][unitNum] = activation( net->unitTypes[unitNum], sum );
-
-#ifdef CONNX
-    connx += unitNum + (net->recurrent);
-#endif
+    valCache[i][unitNum] = activation( net, net->unitTypes[unitNum], sum );
   }
+
+  return dSet->Npts * (unitNum + net->recurrent);
 }
 
+
+
+/*	EXTEND CACHE -  Bring the value cache of a data set up to date with
+	the network, computing only the units that have been added since the
+	last call.  'Ncached' holds the number of units already in the cache,
+	and should start at zero.  The cached values of a unit never change
+	once it is installed, so each call costs one pass over the data per
+	new unit instead of a forward pass through the whole network.
+	Returns the number of connection crossings made.
+*/
+
+int extend_cache  ( net_t *net, data_set_t *dSet, float **valCache,
+		    int *Ncached )
+{
+  int connx = 0;
+
+  if  ( *Ncached > net->Nunits )
+    *Ncached = net->Nunits;
+  if  ( *Ncached == 0 )  {
+    compute_cache( net->Ninputs, dSet, valCache );
+    *Ncached = net->Ninputs + 1;
+  }
+
+  for  ( ; *Ncached < net->Nunits ; (*Ncached)++ )
+    connx += recompute_cache( *Ncached, net, dSet, valCache );
+
+  return connx;
+}
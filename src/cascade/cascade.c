@@ -4,18 +4,15 @@
 	 Matt White  (mwhite+@cmu.edu)
 	 May 25, 1995
 
-	 This file contains the core of the Cascade Neural Network Simulator.
-	 Program setup takes place here and then control is dispatched to the
-	 Command Line Interface in file 'interface.c'.  Also contained within
-	 this file are training routines common to both Cascade Correlation and
-	 Cascade-2.
+	 This file contains the core of the Cascade Neural Network Simulator:
+	 its global state, and the training routines common to both Cascade
+	 Correlation and Cascade-2.  The program itself starts in 'main.c'.
 */
 
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
-#include <signal.h>
 #include <setjmp.h>
 
 #include "toolkit.h"
@@ -25,59 +22,12 @@
 
 /*  Global Data  */
 
-net_t        *cNet,         /*  Current network being trained  */
-             *nets;
+net_t        *nets;
 df_t         *dFiles;
-train_parm_t *cParms;       /*  Current network training parameters  */
-train_data_t *cTData;       /*  Training data on current network  */
-data_file_t  *cDFile;       /*  Current data file being used  */
-data_set_t   *cDSet;        /*  Current data set being used for training  */
-error_data_t *cError;       /*  Error structure for the network  */
-
-int          Ninputs,       /*  Number of inputs in the network  */
-             Noutputs,      /*  Number of outputs  */
-             Ncand,         /*  Number of candidate units  */
-             NtrainOutVals; /*  Number of outputs * Number of training pts  */
-#ifdef CONNX
-int          connx;         /*  The number of connection crossings made  */
-#endif
-float        sigMax,        /*  Maximum value for a VARSIGMOID unit  */
-             sigMin;        /*  Minimum value for a VARSIGMOID unit  */
-boolean      recurrent,     /*  Whether the current network is recurrent  */
-             interruptPending,  /*  Is the user waiting for attention  */
+registry_t   *models;       /*  Networks registered by name, if any  */
+train_parm_t *cParms;       /*  Training parameters of the command line  */
+boolean      interruptPending,  /*  Is the user waiting for attention  */
              interact;      /*  If TRUE, interact with user, else don't  */
-jmp_buf      abort_trap;    /*  This jump point lets us kill a run in  */
-                            /* progress  */ 
-
-
-void main ( int argc, char *argv[] )
-{
-  train_parm_t *parms;
-  time_t       t;
-  int          i;
-
-  display_banner( );             /*  Welcome user and then do some  */
-                                 /* initializations.                */
-  interruptPending = FALSE;
-  interact         = TRUE;
-  signal( SIGINT, trap_ctrl_c ); /*  Trap C-c so we can break out of a run  */
-  time( &t );
-  srandom( t );
-
-  parms = build_parm( );         /*  Build and initialize a parm table  */
-  set_parmtable( parms );
-  cParms = parms;
-
-
-  /*  Process command line arguments  */
-
-  for  ( i = 1 ; i < argc ; i++ )  
-    load_script( argv[i], NULL );
-
-  /*  Invoke command interpreter  */
-
-  cli( FALSE );
-}
 
 
 /*	TRAIN NET -  Train the network passed (net) on the data file 
@@ -86,14 +36,19 @@ void main ( int argc, char *argv[] )
 	number to the user.
 
 	Make sure that the network is built and that the data is loaded before
-	calling this function or bad things may happen.
+	calling this function or bad things may happen.  Everything the run
+	needs is kept in a training context of its own, so several networks
+	may be trained at once on threads of their own.  They may share a data
+	file, which is only read, but each needs its own parameter table.
 */
 
 trial_result_t  train_net  ( net_t *net, train_parm_t *parms, 
 			     data_file_t *dFile, int trialNum )
 {
+  train_ctx_t    tc;		/*  State of the run for the inner loops  */
   train_data_t   *tData;	/*  Training data (slope, deltas, etc. )  */
   error_data_t   *error;	/*  Error information on net's performance  */
+  data_set_t     *testSet;	/*  Data the net is tested on at the end  */
   trial_result_t result,	/*  The results from this trial  */
                  testRes;	/*  Results from the net's test epoch  */
   status_t       status = TRAINING,	/*  Training status  */
@@ -101,71 +56,120 @@ trial_result_t  train_net  ( net_t *net, train_parm_t *parms,
   int            startEpochs,	/*  The age of the network at start  */
                  outVals,	/*  The number of output values in either  */
 	                        /* the training or the test set  */
-                 valCLeft,	/*  Validation cycles remaining until  */
+                 valCLeft = 0,	/*  Validation cycles remaining until  */
                                 /* stagnation  */
                  valBUnits,	/*  Number of units at peak performance  */
                  i,j;	        /*  Loop indices  */
   time_t         startTime,	/*  Time training began  */
                  endTime;	/*  Time training ended  */
-  float          valBScore,	/*  Score at peak validation performance  */
-                 **valBWeights; /*  Output weights at peak performance  */
+  float          valBScore = 0.0,	/*  Score at peak validation  */
+                                	/* performance  */
+                 **valBWeights = NULL,	/*  Output weights at peak  */
+                                	/* performance  */
+                 **testCache;	/*  Cached unit values of the test data  */
   boolean        init = TRUE;   /*  Initialize the validation function?  */
+  volatile boolean valPending = FALSE;	/*  Is a validation thread  */
+                                	/* running?  */
+  val_job_t      valJob;	/*  Validation epoch run during candidate  */
+                                /* training  */
 
 
-  /*  Initialize for training  */
+  /*  Initialize for training.  Packed and quantized copies of the net, */
+  /* and its cached query results, would go stale.                      */
 
+  free_packed( &(net->packed) );
+  free_quant( &(net->quant) );
+  free_memo( &(net->memo) );
   tData = build_train_data ( net, parms, dFile->train->Npts );
   error = build_error_data ( net );
-  set_globals ( net, parms, tData, dFile, error );
+  init_train_ctx ( &tc, net, parms, tData, dFile, error );
   startEpochs = net->epochsTrained;
-#ifdef CONNX
-  connx       = 0;
-#endif
   time( &startTime );
 
-  display_begin_trial  ( trialNum, startTime );
+  display_begin_trial  ( &tc, trialNum, startTime );
 
   if  ( parms->useCache )
-    compute_cache( Ninputs, dFile->train, tData->valCache );
+    compute_cache( net->Ninputs, dFile->train, tData->valCache );
+  if  ( parms->useCache && parms->validate && (dFile->validate != NULL) )  {
+    tData->vSetPts = dFile->validate->Npts;
+    build_cache( net->Nunits + net->maxNewUnits, net->Noutputs,
+		 tData->vSetPts, &(tData->vSetCache), NULL );
+  }
 
 
   /*  Setjmp is to mark our position in case the user aborts the run  */
-  if  ( setjmp( abort_trap ) == 0 )  {
+  if  ( setjmp( tc.abortTrap ) == 0 )  {
     while ( net->maxNewUnits > 0 )  {
 
       /*  Train outputs  */
-      status = train_outputs( );
-      display_trainout_results  ( net, error, status, parms->errorMeasure );
+      status = train_outputs( &tc );
+      display_trainout_results  ( &tc, status );
+
+      /*  In a sweep, give up on a run that has fallen behind  */
+      if  ( (parms->race != NULL) &&
+	    race_behind( parms->race, net->Nunits - net->Ninputs-1,
+			 error->sumSqDiffs ) )
+	break;
 
       /*  Validate and check status  */
       if  ( status == WIN )
 	break;
+      /*  With the validation cache, the validation epoch runs while the  */
+      /* candidates train                                                  */
+      valPending = FALSE;
       if  ( parms->validate )  {
-	valStatus = validation_epoch( &valBScore, &valBWeights, &valCLeft,
-				     &valBUnits, init );
-	init = FALSE;
-	if  ( valStatus != TRAINING )
-	  break;
+	valPending = validation_start( &tc, &valJob, valBScore, valCLeft,
+				       init );
+	if  ( !valPending )  {
+	  valStatus = validation_epoch( &tc, &valBScore, &valBWeights,
+					&valCLeft, &valBUnits, init );
+	  init = FALSE;
+	  if  ( valStatus != TRAINING )
+	    break;
+	}
       }
-      
+
 
       /*  Initialize the candidates and train them either with cascor or  */
       /* cascade-2, as specified by the user                              */
-      init_cand( tData, Ncand, Noutputs, net->Nunits, recurrent,
-		parms->weightRange, parms->candType );
-      if  (cParms->algorithm == CASCOR)
-	status = cascor_train_cand( );
+      init_cand( tData, parms->Ncand, net->Noutputs, net->Nunits,
+		net->recurrent, parms->weightRange, parms->candType );
+      if  ( parms->candAdapt )
+	schedule_cand( tData, parms );
+      if  ( parms->candInit == RESIDUAL_INIT )
+	seed_cand( tData, net, parms, dFile->train->Npts );
+      if  (parms->algorithm == CASCOR)
+	status = cascor_train_cand( &tc );
       else
-	status = c2_train_cand( );
-      install_cand( tData->candBest, (cParms->algorithm == CASCADE2) );
+	status = c2_train_cand( &tc );
+      if  ( valPending )  {
+	valPending = FALSE;
+	valStatus  = validation_finish( &tc, &valJob, &valBScore, &valBWeights,
+				        &valCLeft, &valBUnits, init );
+	init = FALSE;
+	if  ( valStatus != TRAINING )
+	  break;
+      }
+      if  ( tData->candLM )
+	lm_restore_ci_weights( &tc );
+      if  ( parms->candAdapt )
+	reward_cand( tData );
+      install_cand( &tc, tData->candBest, (parms->algorithm == CASCADE2) );
       
-      display_traincand_results  ( net, tData, status );
+      display_traincand_results  ( &tc, status );
     }
 
     /*  If we ran out of new units, train the outputs from the last unit  */
     /* added.  Otherwise these output weights will perform badly  */
-    if ( (status != WIN) && (valStatus == TRAINING) )
-      status = train_outputs( );
+    if ( (status != WIN) && (valStatus == TRAINING) &&
+	 ((parms->race == NULL) || !parms->race->lost) )
+      status = train_outputs( &tc );
+  }
+
+  /*  A validation thread may still be running if the run was aborted  */
+  if  ( valPending )  {
+    pthread_join( valJob.thread, NULL );
+    atomic_store( &(tc.candCancel), FALSE );
   }
   time( &endTime );
 
@@ -173,19 +177,26 @@ trial_result_t  train_net  ( net_t *net, train_parm_t *parms,
   result.Nepochs    = net->epochsTrained - startEpochs;
   result.time       = (int)(endTime - startTime);
   result.Nunits     = net->Nunits;
-#ifdef CONNX
-  result.connx      = connx;
-#endif
-  if  ( cParms->test )  {
-    if  ( dFile->test == NULL )
-      dFile->test = dFile->train;
-    testRes = test_net( net, dFile->test );
+  result.connx      = tc.connx;
+  if  ( parms->test )  {
+    testSet = ( dFile->test != NULL ) ? dFile->test : dFile->train;
+
+    /*  A test on the training or validation data can use their caches  */
+    testCache = NULL;
+    if  ( parms->useCache && (testSet == dFile->train) )
+      testCache = tData->valCache;
+    else if  ( (tData->vSetCache != NULL) && (testSet == dFile->validate) )  {
+      extend_cache( net, dFile->validate, tData->vSetCache,
+		    &(tData->vSetUnits) );
+      testCache = tData->vSetCache;
+    }
+    testRes = test_net( net, parms, testSet, testCache );
     result.bits       = testRes.bits;
     result.error_count= testRes.error_count;
     result.index      = testRes.index;
     result.sumSqDiffs = testRes.sumSqDiffs;
     result.sumSqError = testRes.sumSqError;
-    outVals           = (dFile->test->Npts) * (net->Noutputs);
+    outVals           = (testSet->Npts) * (net->Noutputs);
   } else {
     result.bits       = error->bits;
     result.index      = error->index;
@@ -206,8 +217,10 @@ trial_result_t  train_net  ( net_t *net, train_parm_t *parms,
   display_trial_results  ( result, trialNum, parms->test, parms->errorMeasure,
 			   net->Ninputs, endTime );
 
-  /*  Free memory allocated for training  */
-  if  ( parms->validate )  {
+  /*  Free memory allocated for training.  The unit values may still point  */
+  /* into the cache, so return them to the network's own vector.            */
+  net->values = net->tempValues;
+  if  ( valBWeights != NULL )  {
     for  ( i = 0 ; i < net->Noutputs ; i++ )
       free( valBWeights[i] );
     free( valBWeights );
@@ -220,74 +233,299 @@ trial_result_t  train_net  ( net_t *net, train_parm_t *parms,
 
 
 /*	TEST NET -  Test the network on the data set provided.  The results of
-	the test are returned in a trial result structure.  This function has
-	some reliance on the cParms structure.
+	the test are returned in a trial result structure.  The network is
+	evaluated as 'parms' gives.  If 'valCache' is given, it must hold the
+	values of every unit in the network for each point of the data set,
+	and only the outputs are computed.
 */
 
-trial_result_t  test_net    ( net_t *net, data_set_t *dSet )
+trial_result_t  test_net    ( net_t *net, train_parm_t *parms,
+			      data_set_t *dSet, float **valCache )
 {
-  error_data_t   *err,		/*  Temporary error information  */
-                 *temp;		/*  Pointer to old error information  */
-  net_t          *tempNet;	/*  Pointer to old network  */
+  error_data_t   *err;		/*  Error information for the test  */
   trial_result_t result;	/*  Results of testing  */
+  int            error_count;
+
+  /*  Compute an epoch on the test data  */
+  err         = build_error_data( net );
+  error_count = 0;
+  init_error( err, net->Noutputs );
+  eval_net( net, parms, dSet, valCache, NULL, err, &error_count );
+
+  /*  Store results  */
+  result.bits       = err->bits;
+  result.index      = ERROR_INDEX( err->sumSqDiffs, dSet->stdDev, 
+				   (dSet->Npts)*net->Noutputs );
+  result.sumSqDiffs = err->sumSqDiffs;
+  result.sumSqError = err->sumSqError;
+  result.error_count = error_count;
+  free_error_data( &err );
+
+  return result;
+}
+
+
+/*	EVAL NET -  Feed every point of a data set through the network.  The
+	points are split over several threads (see 'num_threads'), each
+	with its own inference context.  A recurrent network carries its unit
+	values from point to point, so its data is only split where a
+	sequence is reset.
+
+	The points are taken in chunks of EVAL_MIN_PTS, a chunk of a
+	recurrent network running on to the next reset, and each thread is
+	given whole chunks.  The error on each chunk is added up by itself,
+	in point order, and the chunks' errors are added together in order,
+	so the error is the same however many threads there are.
+
+	Without a cache the points are fed through the network's packed
+	copy (see packed.c).  If the network has none, one is built for this
+	call only, so the network may still be in training.  While the
+	'quantized' parameter is set, a network with a quantized copy (see
+	quant.c) is evaluated with that instead.
+
+	If 'valCache' is given, only the outputs are computed from it.  If
+	'outputs' is given, the outputs of each point are stored in it.  If
+	'err' is given, the error on each point is added to it, and points
+	whose class is wrong are counted in 'errorCount'.
+*/
+
+void  eval_net  ( net_t *net, train_parm_t *parms, data_set_t *dSet,
+		  float **valCache, float **outputs, error_data_t *err,
+		  int *errorCount )
+{
+  eval_job_t   *jobs;		/*  Share of the points for each thread  */
+  packed_net_t *packed = NULL;	/*  Packed copy built for this call  */
+  error_data_t **chunks = NULL;	/*  Error on each chunk of points  */
+  int          Nthreads,	/*  Number of threads to use  */
+               Nchunks,		/*  Number of chunks of points  */
+               first,		/*  First chunk of the next share  */
+               last,		/*  One past the last chunk of the share  */
+               c, i, t;		/*  Indexing variables  */
+  char         *fn = "Evaluate Network";
+
+  Nthreads = num_threads( parms, dSet->Npts, EVAL_MIN_PTS );
+  Nchunks  = ( dSet->Npts + EVAL_MIN_PTS-1 ) / EVAL_MIN_PTS;
+  jobs     = (eval_job_t *)alloc_mem( Nthreads, sizeof( eval_job_t ), fn );
+  if  ( (valCache == NULL) && (net->packed == NULL) )
+    packed = pack_net( net );
+  if  ( (err != NULL) && (Nchunks > 0) )  {
+    chunks = (error_data_t **)alloc_mem( Nchunks, sizeof( error_data_t * ),
+					 fn );
+    for  ( c = 0 ; c < Nchunks ; c++ )  {
+      chunks[c] = build_error_data( net );
+      init_error( chunks[c], net->Noutputs );
+    }
+  }
+
+  /*  Share out the chunks and start the threads.  The first share is  */
+  /* left for this thread.                                            */
+  first = 0;
+  for  ( t = 0 ; t < Nthreads ; t++ )  {
+    last = ( Nchunks * (t+1) ) / Nthreads;
+
+    jobs[t].net        = net;
+    jobs[t].dSet       = dSet;
+    jobs[t].valCache   = valCache;
+    jobs[t].outputs    = outputs;
+    jobs[t].offset     = parms->outPrimeOffset;
+    jobs[t].first      = first;
+    jobs[t].start      = eval_chunk( net, dSet, valCache, first );
+    jobs[t].end        = eval_chunk( net, dSet, valCache, last );
+    jobs[t].errorCount = 0;
+    jobs[t].chunks     = chunks;
+    jobs[t].outValues  = (float *)alloc_mem( PACK_BATCH * net->Noutputs,
+					     sizeof(float), fn );
+    jobs[t].ctx        = NULL;
+    if  ( valCache == NULL )  {
+      jobs[t].ctx = build_infer_ctx( (packed != NULL) ? packed : net->packed );
+      if  ( parms->quantized && (net->quant != NULL) )
+	quant_infer_ctx( jobs[t].ctx, net->quant );
+    }
+    first = last;
+
+    jobs[t].threaded = ( (t > 0) &&
+			 (pthread_create( &(jobs[t].thread), NULL, eval_thread,
+					  (void *)(jobs+t) ) == 0) );
+  }
+
+  /*  Do the shares no thread was started for  */
+  for  ( t = 0 ; t < Nthreads ; t++ )  {
+    if  ( jobs[t].threaded )
+      pthread_join( jobs[t].thread, NULL );
+    else
+      eval_thread( (void *)(jobs+t) );
+
+    if  ( err != NULL )
+      *errorCount += jobs[t].errorCount;
+    free_mem( jobs[t].outValues );
+    free_infer_ctx( &(jobs[t].ctx) );
+  }
+
+  /*  Then merge the errors of the chunks in order  */
+  if  ( chunks != NULL )  {
+    for  ( c = 0 ; c < Nchunks ; c++ )  {
+      err->bits       += chunks[c]->bits;
+      err->sumSqDiffs += chunks[c]->sumSqDiffs;
+      err->sumSqError += chunks[c]->sumSqError;
+      for  ( i = 0 ; i < net->Noutputs ; i++ )
+	err->sumErr[i] += chunks[c]->sumErr[i];
+      free_error_data( &(chunks[c]) );
+    }
+    free_mem( chunks );
+  }
+  free_mem( jobs );
+  free_packed( &packed );
+}
+
+
+/*	EVAL CHUNK -  Return the first point of chunk 'c' of a data set for
+	'eval_net', or the number of points if there is no such chunk.  A
+	chunk starts every EVAL_MIN_PTS points, or at the first reset from
+	there if a recurrent network is evaluated without a cache.
+*/
+
+int  eval_chunk  ( net_t *net, data_set_t *dSet, float **valCache, int c )
+{
+  int p = c * EVAL_MIN_PTS;
+
+  if  ( (c == 0) || (p >= dSet->Npts) )
+    return ( p < dSet->Npts ) ? p : dSet->Npts;
+  if  ( net->recurrent && (valCache == NULL) )
+    while  ( (p < dSet->Npts) && !dSet->data[p].reset )
+      p++;
+
+  return p;
+}
+
+
+/*	EVAL THREAD -  Evaluate one share of a data set for 'eval_net'.
+	Only the job is used.  Without a cache, the points are fed through
+	the thread's inference context PACK_BATCH at a time.  The error on
+	each point is added to that of its chunk.
+*/
+
+void  *eval_thread  ( void *arg )
+{
+  eval_job_t *job = (eval_job_t *)arg;
+  net_t      *net = job->net;
+  float      *inputs[PACK_BATCH],
+             *outputs[PACK_BATCH];
+  boolean    resets[PACK_BATCH];
+  int        c    = job->first,
+             next = eval_chunk( net, job->dSet, job->valCache, c+1 ),
+             B, i, j;
+
+  for  ( i = job->start ; i < job->end ; i += B )  {
+    B = job->end - i;
+    if  ( B > PACK_BATCH )
+      B = PACK_BATCH;
+    for  ( j = 0 ; j < B ; j++ )  {
+      inputs[j]  = job->dSet->data[i+j].inputs;
+      resets[j]  = job->dSet->data[i+j].reset;
+      outputs[j] = ( job->outputs != NULL ) ? job->outputs[i+j] :
+	                                      job->outValues + j*net->Noutputs;
+    }
+
+    if  ( job->ctx != NULL )
+      infer_batch( job->ctx, inputs, resets, B, outputs );
+    else
+      for  ( j = 0 ; j < B ; j++ )
+	output_values( net, job->valCache[i+j], outputs[j] );
+
+    if  ( job->chunks != NULL )
+      for  ( j = 0 ; j < B ; j++ )  {
+	while  ( i+j >= next )
+	  next = eval_chunk( net, job->dSet, job->valCache, (++c)+1 );
+	score_point( net, outputs[j], job->dSet, i+j, job->chunks[c], 0.4999,
+		     job->offset, &(job->errorCount) );
+      }
+  }
+
+  return NULL;
+}
+
+
+/*  ADAPT NET -  Stream the points of a data set through the network, adapting
+    the output weights after each point with recursive least squares.  Each
+    point is scored before it is learned, so the results returned measure how
+    well the network tracked the data.  The adaptation state is built on
+    the first call, or rebuilt if units have been added since.
+*/
+
+trial_result_t  adapt_net   ( net_t *net, train_parm_t *parms,
+			      data_set_t *dSet )
+{
+  train_ctx_t    tc;		/*  Context for the training routines  */
+  error_data_t   *err;		/*  Error information on the adaptation  */
+  trial_result_t result;	/*  Results of adaptation  */
   int            i;		/*  Indexing variable  */
   int            error_count;
 
-  /*  Save pointers to old information  */
-  err     = build_error_data( net );
-  temp    = cError;
-  cError  = err;
-  tempNet = cNet;
-  cNet    = net;
+  /*  Build the adaptation state if necessary.  Packed and quantized     */
+  /* copies of the net, and its cached query results, would go stale.    */
+  free_packed( &(net->packed) );
+  free_quant( &(net->quant) );
+  free_memo( &(net->memo) );
+  if  ( (net->rls != NULL) && (net->rls->Nunits != net->Nunits) )
+    free_rls( &(net->rls) );
+  if  ( net->rls == NULL )
+    net->rls = build_rls( net->Nunits, parms->rlsDelta );
+
+  err = build_error_data( net );
+  init_train_ctx( &tc, net, parms, NULL, NULL, err );
+  tc.dSet = dSet;
 
   error_count = 0;
+  net->values = net->tempValues;
 
-  /*  Compute an epoch on the test data  */
-  init_error( cError, net->Noutputs );
+  /*  Score and then learn each point in turn  */
+  init_error( err, net->Noutputs );
   for  ( i = 0 ; i < dSet->Npts ; i++ )  {
-    forward_pass( dSet->data[i].inputs, cDSet->data[i].reset );
-    compute_error( dSet->data[i].outputs, TRUE, FALSE, TRUE, 0.4999 );
-    compute_normal_error( dSet->data[i].outputs, &error_count);
+    forward_pass( &tc, dSet->data[i].inputs, dSet->data[i].reset );
+    compute_error( &tc, &(dSet->data[i]), TRUE, FALSE, TRUE, 0.4999 );
+    compute_normal_error( &tc, &(dSet->data[i]), &error_count);
+    rls_update( &tc, &(dSet->data[i]) );
   }
 
-  /*  Store results and return global pointers to their old values  */
-  result.bits       = cError->bits;
-  result.index      = ERROR_INDEX( cError->sumSqDiffs, dSet->stdDev, 
-				   (dSet->Npts)*Noutputs );
-  result.sumSqDiffs = cError->sumSqDiffs;
-  result.sumSqError = cError->sumSqError;
+  /*  Store results  */
+  result.bits       = err->bits;
+  result.index      = ERROR_INDEX( err->sumSqDiffs, dSet->stdDev, 
+				   (dSet->Npts)*net->Noutputs );
+  result.sumSqDiffs = err->sumSqDiffs;
+  result.sumSqError = err->sumSqError;
   result.error_count = error_count;
-  cError            = temp;
   free_error_data( &err );
-  cNet              = tempNet;
 
   return result;
 }
 
 
-/*  SET GLOBALS -  Sets global variables to represent the network being
-    trained.  Global variables are used for the inner training loops because
-    parameter passing is too time consuming.
+/*  INIT TRAIN CTX -  Set up a training context for a network.  The inner
+    training loops take what they need from the context rather than from
+    arguments, since parameter passing is too time consuming.  'tData' and
+    'dFile' may be NULL for a context that only feeds the network forward
+    and adapts its outputs.
 */
 
-void set_globals  ( net_t *net, train_parm_t *parms, train_data_t *tData,
-		    data_file_t *dFile, error_data_t *error )
+void init_train_ctx  ( train_ctx_t *tc, net_t *net, train_parm_t *parms,
+		       train_data_t *tData, data_file_t *dFile,
+		       error_data_t *error )
 {
-  cNet   = net;
-  cParms = parms;
-  cTData = tData;
-  cDFile = dFile;
-  cDSet  = dFile->train;
-  cError = error;
-
-  Ninputs       = net->Ninputs;
-  Noutputs      = net->Noutputs;
-  Ncand         = parms->Ncand;
-  NtrainOutVals = net->Noutputs * dFile->train->Npts;
-  recurrent     = net->recurrent;
-
-  sigMax        = net->sigmoidMax;
-  sigMin        = net->sigmoidMin;
+  tc->net   = net;
+  tc->parms = parms;
+  tc->tData = tData;
+  tc->dFile = dFile;
+  tc->dSet  = ( dFile != NULL ) ? dFile->train : NULL;
+  tc->error = error;
+
+  tc->Ninputs       = net->Ninputs;
+  tc->Noutputs      = net->Noutputs;
+  tc->Ncand         = parms->Ncand;
+  tc->NtrainOutVals = ( dFile != NULL ) ?
+                      net->Noutputs * dFile->train->Npts : 0;
+  tc->recurrent     = net->recurrent;
+  tc->connx         = 0;
+  atomic_init( &(tc->candCancel), FALSE );
 }
 
 
@@ -297,41 +535,44 @@ void set_globals  ( net_t *net, train_parm_t *parms, train_data_t *tData,
     and patience.
 */
 
-status_t train_outputs  ( void )
+status_t train_outputs  ( train_ctx_t *tc )
 {
-  int   quitEpoch = 0,	/*  Epoch to quit training due to stagnation  */
-        i;		/*  Indexing variable  */
-  float lastError;	/*  This is the error number to beat  */
+  net_t        *net   = tc->net;
+  error_data_t *err   = tc->error;
+  train_parm_t *parms = tc->parms;
+  int          quitEpoch = 0,	/*  Epoch to quit training on stagnation  */
+               i;		/*  Indexing variable  */
+  float        lastError;	/*  This is the error number to beat  */
 
-  for  ( i = 0 ; i < cParms->outputParm.epochs ; i++ )  {
+  for  ( i = 0 ; i < parms->outputParm.epochs ; i++ )  {
 
     /*  Compute an epoch on the training data  */
-    init_error( cError, Noutputs );
-    output_epoch( );
+    init_error( err, tc->Noutputs );
+    output_epoch( tc );
 
-    if  ( interruptPending ) handle_interrupt( cTData, cDSet->Npts );
+    if  ( interruptPending ) handle_interrupt( tc );
 
     /*  Check for WIN  */
-    if ( (cParms->errorMeasure == BITS) && (cError->bits == 0) )
+    if ( (parms->errorMeasure == BITS) && (err->bits == 0) )
       return WIN;
-    else  if (cParms->errorMeasure == INDEX)  {
-      cError->index = ERROR_INDEX( cError->sumSqDiffs, cDSet->stdDev, 
-				   NtrainOutVals );
-      if  ( cError->index <= cParms->indexThreshold )
+    else  if (parms->errorMeasure == INDEX)  {
+      err->index = ERROR_INDEX( err->sumSqDiffs, tc->dSet->stdDev, 
+				   tc->NtrainOutVals );
+      if  ( err->index <= parms->indexThreshold )
 	return WIN;
     }
 
-    adjust_weights( );
-    cNet->epochsTrained++;
+    adjust_weights( tc );
+    net->epochsTrained++;
 
     /*  Check for STAGNATION/Improvement  */
     if  ( i == 0 )
-      lastError = cError->sumSqDiffs;
-    else if  ( fabs( cError->sumSqDiffs - lastError ) >
-	       ( lastError * cParms->outputParm.changeThreshold ) )  {
-      lastError = cError->sumSqDiffs;
-      quitEpoch = cNet->epochsTrained + cParms->outputParm.patience;
-    } else if  ( cNet->epochsTrained == quitEpoch )
+      lastError = err->sumSqDiffs;
+    else if  ( fabs( err->sumSqDiffs - lastError ) >
+	       ( lastError * parms->outputParm.changeThreshold ) )  {
+      lastError = err->sumSqDiffs;
+      quitEpoch = net->epochsTrained + parms->outputParm.patience;
+    } else if  ( net->epochsTrained == quitEpoch )
       return STAGNANT;
   }
 
@@ -343,19 +584,21 @@ status_t train_outputs  ( void )
     error from the outputs.
 */
 
-void output_epoch  ( void )
+void output_epoch  ( train_ctx_t *tc )
 {
-  int i;
+  data_set_t   *dSet  = tc->dSet;
+  train_parm_t *parms = tc->parms;
+  int          i;
 
-  for  ( i = 0 ; i < cDSet->Npts ; i++ )  {
-    if  ( cParms->useCache )  {
-      cNet->values   = cTData->valCache[i];
-      cError->errors = cTData->errCache[i];
-      compute_outputs( );
+  for  ( i = 0 ; i < dSet->Npts ; i++ )  {
+    if  ( parms->useCache )  {
+      tc->net->values   = tc->tData->valCache[i];
+      tc->error->errors = tc->tData->errCache[i];
+      compute_outputs( tc );
     }  else 
-      forward_pass( cDSet->data[i].inputs, cDSet->data[i].reset );
-    compute_error( cDSet->data[i].outputs, TRUE, TRUE, 
-		   (cParms->algorithm == CASCOR), cParms->scoreThreshold );
+      forward_pass( tc, dSet->data[i].inputs, dSet->data[i].reset );
+    compute_error( tc, &(dSet->data[i]), TRUE, TRUE, 
+		   (parms->algorithm == CASCOR), parms->scoreThreshold );
   }
 }
 
@@ -373,83 +616,212 @@ void output_epoch  ( void )
 	passed since 'bestScore' was set.
 */
 
-status_t validation_epoch  ( float *bestScore, float ***bestWeights, 
-	  		    int *cyclesLeft, int *bestUnits, boolean init )
+status_t validation_epoch  ( train_ctx_t *tc, float *bestScore,
+			     float ***bestWeights, int *cyclesLeft,
+			     int *bestUnits, boolean init )
 {
+  net_t          *net   = tc->net;
+  train_data_t   *tData = tc->tData;
+  data_set_t     *vSet  = tc->dFile->validate;
   trial_result_t valRes;	/*  Result value to return  */
-  int            maxUnits,	/*  Maximum number of units in the network  */
-                 i,j;		/*  Indexing variables  */
-  char           *fn = "Validation Epoch";
+  int            i;
 
   /*  Select the validation data and run a test epoch on it  */
-  if  ( cDFile->validate == NULL )  {
+  if  ( vSet == NULL )  {
     printf ("No validation data.  Validation aborted.\n");
-    cParms->validate = FALSE;
+    tc->parms->validate = FALSE;
     return TRAINING;
   }
-  valRes = test_net( cNet, cDFile->validate );
+  if  ( tData->vSetCache != NULL )
+    tc->connx += extend_cache( net, vSet, tData->vSetCache,
+			       &(tData->vSetUnits) );
+  valRes = test_net( net, tc->parms, vSet, tData->vSetCache );
+#ifdef CONNX
+  tc->connx += vSet->Npts * net->Noutputs * (net->Nunits + net->recurrent);
+  if  ( tData->vSetCache == NULL )
+    for  ( i = net->Ninputs+1 ; i < net->Nunits ; i++ )
+      tc->connx += vSet->Npts * (i + net->recurrent);
+#endif
+
+  return validation_judge( tc, valRes, bestScore, bestWeights, cyclesLeft,
+			   bestUnits, init );
+}
+
+
+/*	VALIDATION JUDGE -  Compare the results of a validation epoch with the
+	best to date and decide whether training should continue.  The
+	arguments and return value are those of 'validation_epoch'.
+*/
+
+status_t validation_judge  ( train_ctx_t *tc, trial_result_t valRes,
+			     float *bestScore, float ***bestWeights,
+			     int *cyclesLeft, int *bestUnits, boolean init )
+{
+  net_t        *net   = tc->net;
+  train_parm_t *parms = tc->parms;
+  int          maxUnits,	/*  Maximum number of units in the network  */
+               i,j;		/*  Indexing variables  */
+  char         *fn = "Validation Epoch";
 
   /*  If this is the first validation epoch this run, init the data structs  */
   if  ( init )  {
-    maxUnits = cNet->Nunits+cNet->maxNewUnits;
-    *bestWeights = (float **)alloc_mem( cNet->Noutputs,sizeof( float * ),fn );
-    for  ( i = 0 ; i < cNet->Noutputs ; i++ )
+    maxUnits = net->Nunits+net->maxNewUnits;
+    *bestWeights = (float **)alloc_mem( net->Noutputs,sizeof( float * ),fn );
+    for  ( i = 0 ; i < net->Noutputs ; i++ )
       (*bestWeights)[i] = (float *)alloc_mem( maxUnits, sizeof(float), fn );
-    init = FALSE;
   }
 
   /*  Compare this result with the previous best and get the weights if this */
   /* epoch had better results  */
   if  ( (valRes.sumSqError < *bestScore) || init )  {
     *bestScore  = valRes.sumSqError;
-    *cyclesLeft = cParms->validationPatience;
-    *bestUnits  = cNet->Nunits;
-    for  ( i = 0 ; i < cNet->Noutputs ; i++ )
-      for  ( j = 0 ; j < cNet->Nunits ; j++ )
-	(*bestWeights)[i][j] = cNet->outWeights[i][j];
-    display_validate_results( valRes, cParms->errorMeasure, *bestScore,
-			      *cyclesLeft );
+    *cyclesLeft = parms->validationPatience;
+    *bestUnits  = net->Nunits;
+    for  ( i = 0 ; i < net->Noutputs ; i++ )
+      for  ( j = 0 ; j < net->Nunits ; j++ )
+	(*bestWeights)[i][j] = net->outWeights[i][j];
+    display_validate_results( tc, valRes, *bestScore, *cyclesLeft );
     return TRAINING;
   } else if  ( *cyclesLeft > 0 )  {
     (*cyclesLeft)--;
-    display_validate_results( valRes, cParms->errorMeasure, *bestScore,
-			      *cyclesLeft );
+    display_validate_results( tc, valRes, *bestScore, *cyclesLeft );
     return TRAINING;
   }
 
   /*  Since we stagnated, restore network to its peak performance  */
-  cNet->Nunits  = *bestUnits;
-  for  ( i = 0 ; i < cNet->Noutputs ; i++ )
-    for  ( j = 0 ; j < cNet->Nunits ; j++ )
-      cNet->outWeights[i][j] = (*bestWeights)[i][j];
-  display_validate_results( valRes, cParms->errorMeasure, *bestScore,
-			    *cyclesLeft );
+  net->Nunits  = *bestUnits;
+  for  ( i = 0 ; i < net->Noutputs ; i++ )
+    for  ( j = 0 ; j < net->Nunits ; j++ )
+      net->outWeights[i][j] = (*bestWeights)[i][j];
+  display_validate_results( tc, valRes, *bestScore, *cyclesLeft );
   return STAGNANT;
 }
 
 
+/*	VALIDATION START -  Begin a validation epoch on a thread of its own,
+	to run while the next pool of candidates trains.  Only the outputs
+	are computed, so the validation cache must be in use.  The current
+	best score and cycles left let the thread tell as soon as it is done
+	whether validation has stagnated, in which case it cancels candidate
+	training.  Returns FALSE if the epoch was not started, in which case
+	'validation_epoch' should be called instead.
+*/
+
+boolean validation_start  ( train_ctx_t *tc, val_job_t *job, float bestScore,
+			    int cyclesLeft, boolean init )
+{
+  train_data_t *tData = tc->tData;
+
+  if  ( (tc->dFile->validate == NULL) || (tData->vSetCache == NULL) )
+    return FALSE;
+
+  tc->connx += extend_cache( tc->net, tc->dFile->validate, tData->vSetCache,
+			     &(tData->vSetUnits) );
+
+  job->net        = tc->net;
+  job->dSet       = tc->dFile->validate;
+  job->valCache   = tData->vSetCache;
+  job->offset     = tc->parms->outPrimeOffset;
+  job->bestScore  = bestScore;
+  job->cyclesLeft = cyclesLeft;
+  job->init       = init;
+  job->connx      = 0;
+  job->cancel     = &(tc->candCancel);
+  atomic_store( &(tc->candCancel), FALSE );
+
+  return ( pthread_create( &(job->thread), NULL, validation_thread, 
+			   (void *)job ) == 0 );
+}
+
+
+/*	VALIDATION THREAD -  Run a validation epoch from the cached unit
+	values, as 'test_net' would.  Only the job is used, so this runs
+	alongside candidate training.
+*/
+
+void *validation_thread  ( void *arg )
+{
+  val_job_t    *job = (val_job_t *)arg;
+  net_t        *net = job->net;
+  error_data_t *err;
+  float        *outValues;
+  int          error_count = 0,
+               i;
+
+  err       = build_error_data( net );
+  outValues = (float *)alloc_mem( net->Noutputs, sizeof( float ),
+				  "Validation Thread" );
+
+  init_error( err, net->Noutputs );
+  for  ( i = 0 ; i < job->dSet->Npts ; i++ )  {
+    output_values( net, job->valCache[i], outValues );
+    score_point( net, outValues, job->dSet, i, err, 0.4999, job->offset,
+		 &error_count );
+  }
+  job->connx = job->dSet->Npts * net->Noutputs * (net->Nunits+net->recurrent);
+
+  job->result.bits        = err->bits;
+  job->result.index       = ERROR_INDEX( err->sumSqDiffs, job->dSet->stdDev,
+					 (job->dSet->Npts)*net->Noutputs );
+  job->result.sumSqDiffs  = err->sumSqDiffs;
+  job->result.sumSqError  = err->sumSqError;
+  job->result.error_count = error_count;
+
+  /*  No candidate will be installed if validation has stagnated  */
+  if  ( !job->init && !(err->sumSqError < job->bestScore) &&
+	(job->cyclesLeft <= 0) )
+    atomic_store( job->cancel, TRUE );
+
+  free_mem( outValues );
+  free_error_data( &err );
+
+  return NULL;
+}
+
+
+/*	VALIDATION FINISH -  Wait for a validation epoch started by
+	'validation_start' and judge its results.  The arguments and return
+	value are those of 'validation_epoch'.
+*/
+
+status_t validation_finish  ( train_ctx_t *tc, val_job_t *job,
+			      float *bestScore, float ***bestWeights,
+			      int *cyclesLeft, int *bestUnits, boolean init )
+{
+  pthread_join( job->thread, NULL );
+  atomic_store( &(tc->candCancel), FALSE );
+#ifdef CONNX
+  tc->connx += job->connx;
+#endif
+
+  return validation_judge( tc, job->result, bestScore, bestWeights,
+			   cyclesLeft, bestUnits, init );
+}
+
+
 /*  ADJUST WEIGHTS -  Adjust all the weights from the outputs to the units in
     the network according to a quickprop update, based upon the error data
     collected in the output epoch.
 */
 
-void adjust_weights  ( void )
+void adjust_weights  ( train_ctx_t *tc )
 {
-  float *ow,  /*  Output weights  */
-        *od,  /*  Output deltas   */
-        *os,  /*  Output slopes   */
-        *op;  /*  Output previous slopes  */
-  int   i,j;
-
-  for  ( i = 0 ; i < Noutputs ; i++ )  {
-    ow = cNet->outWeights[i];
-    od = cTData->output.deltas[i];
-    os = cTData->output.slopes[i];
-    op = cTData->output.pSlopes[i];
-    for  ( j = 0 ; j < cNet->Nunits ; j++ )
-      quickprop( ow+j, od+j, os+j, op+j, cTData->outScaledEps, 
-		 cParms->outputUpdate.decay, cParms->outputUpdate.mu,
-		 cTData->output.shrinkFactor );
+  train_data_t *tData = tc->tData;
+  float        *ow,  /*  Output weights  */
+               *od,  /*  Output deltas   */
+               *os,  /*  Output slopes   */
+               *op;  /*  Output previous slopes  */
+  int          i,j;
+
+  for  ( i = 0 ; i < tc->Noutputs ; i++ )  {
+    ow = tc->net->outWeights[i];
+    od = tData->output.deltas[i];
+    os = tData->output.slopes[i];
+    op = tData->output.pSlopes[i];
+    for  ( j = 0 ; j < tc->net->Nunits ; j++ )
+      quickprop( ow+j, od+j, os+j, op+j, tData->outScaledEps, 
+		 tc->parms->outputUpdate.decay, tc->parms->outputUpdate.mu,
+		 tData->output.shrinkFactor );
   }
 }
 
@@ -457,30 +829,48 @@ void adjust_weights  ( void )
 /*  ADJUST CI WEIGHTS -  Adjust the weights to the inputs of the candidates.
     The epsilon value is scaled by the number of points in the data set and
     the number of units in the network.  Otherwise, this is the same as the
-    adjust weights function above.
+    adjust weights function above.  Candidates with a small fan-in are
+    handed to the Levenberg-Marquardt code in 'lm.c' instead.  In an
+    adaptive pool each candidate has its own epsilon and mu.
 */
 
-void  adjust_ci_weights  ( void )
+void  adjust_ci_weights  ( train_ctx_t *tc )
 {
-  float scaledEpsilon,
-        *cw,
-        *cd,
-        *cs,
-        *cp;
-  int   i,j;
-
-  scaledEpsilon = cParms->candInUpdate.epsilon / 
-                  (float)(cDSet->Npts * cNet->Nunits);
-
-  for  ( i = 0 ; i < Ncand ; i++ )  {
-    cw = cTData->candIn.weights[i];
-    cd = cTData->candIn.deltas[i];
-    cs = cTData->candIn.slopes[i];
-    cp = cTData->candIn.pSlopes[i];
-    for  ( j = 0 ; j < cNet->Nunits + recurrent; j++ )
-      quickprop( cw+j, cd+j, cs+j, cp+j, scaledEpsilon, 
-		 cParms->candInUpdate.decay, cParms->candInUpdate.mu,
-		 cTData->candIn.shrinkFactor );
+  train_data_t *tData = tc->tData;
+  train_parm_t *parms = tc->parms;
+  float        scaledEpsilon,
+               epsilon,
+               mu,
+               shrink,
+               *cw,
+               *cd,
+               *cs,
+               *cp;
+  int          i,j;
+
+  if  ( tData->candLM )  {
+    lm_adjust_ci_weights( tc );
+    return;
+  }
+
+  scaledEpsilon = 1.0 / (float)(tc->dSet->Npts * tc->net->Nunits);
+  epsilon       = parms->candInUpdate.epsilon * scaledEpsilon;
+  mu            = parms->candInUpdate.mu;
+  shrink        = tData->candIn.shrinkFactor;
+
+  for  ( i = 0 ; i < tc->Ncand ; i++ )  {
+    cw = tData->candIn.weights[i];
+    cd = tData->candIn.deltas[i];
+    cs = tData->candIn.slopes[i];
+    cp = tData->candIn.pSlopes[i];
+    if  ( tData->Narms > 0 )  {
+      epsilon = tData->candEpsilon[i] * scaledEpsilon;
+      mu      = tData->candMu[i];
+      shrink  = tData->candShrink[i];
+    }
+    for  ( j = 0 ; j < tc->net->Nunits + tc->recurrent; j++ )
+      quickprop( cw+j, cd+j, cs+j, cp+j, epsilon, 
+		 parms->candInUpdate.decay, mu, shrink );
   }
 }
 
@@ -489,27 +879,32 @@ void  adjust_ci_weights  ( void )
     the candidate's output weights.  This function is used by Cascade-2 only.
 */
 
-void  adjust_co_weights  ( void )
+void  adjust_co_weights  ( train_ctx_t *tc )
 {
-  float scaledEpsilon,
-        *cw,
-        *cd,
-        *cs,
-        *cp;
-  int   i,j;
-
-  scaledEpsilon = cParms->candOutUpdate.epsilon  / 
-                  (float)(cDSet->Npts * cNet->Nunits);
-
-  for  ( i = 0 ; i < Ncand ; i++ )  {
-    cw = cTData->candOut.weights[i];
-    cd = cTData->candOut.deltas[i];
-    cs = cTData->candOut.slopes[i];
-    cp = cTData->candOut.pSlopes[i];
-    for  ( j = 0 ; j < Noutputs ; j++ )
+  train_data_t *tData = tc->tData;
+  train_parm_t *parms = tc->parms;
+  float        scaledEpsilon,
+               *cw,
+               *cd,
+               *cs,
+               *cp;
+  int          i,j;
+
+  if  ( tData->candLM )  /*  Already stepped with the input weights  */
+    return;
+
+  scaledEpsilon = parms->candOutUpdate.epsilon  / 
+                  (float)(tc->dSet->Npts * tc->net->Nunits);
+
+  for  ( i = 0 ; i < tc->Ncand ; i++ )  {
+    cw = tData->candOut.weights[i];
+    cd = tData->candOut.deltas[i];
+    cs = tData->candOut.slopes[i];
+    cp = tData->candOut.pSlopes[i];
+    for  ( j = 0 ; j < tc->Noutputs ; j++ )
       quickprop( cw+j, cd+j, cs+j, cp+j, scaledEpsilon, 
-		 cParms->candOutUpdate.decay, cParms->candOutUpdate.mu,
-		 cTData->candOut.shrinkFactor );
+		 parms->candOutUpdate.decay, parms->candOutUpdate.mu,
+		 tData->candOut.shrinkFactor );
   }
 }
 
@@ -520,40 +915,43 @@ void  adjust_co_weights  ( void )
     Otherwise an approximation based on the unit's correlation value is used.
 */
 
-void install_cand  ( int candNum, boolean useOutWeights )
+void install_cand  ( train_ctx_t *tc, int candNum, boolean useOutWeights )
 {
-  float *newWeights,
-        *candWeights,
-        weightModifier;
-  int   i;
+  net_t        *net   = tc->net;
+  train_data_t *tData = tc->tData;
+  float        *newWeights,
+               *candWeights,
+               weightModifier;
+  int          i;
 
   /*  Copy the new unit's inputs to the network  */
-  newWeights  = cNet->weights[cNet->Nunits];
-  candWeights = cTData->candIn.weights[candNum];
-  for  ( i = 0 ; i < (cNet->Nunits+recurrent) ; i++ )
+  newWeights  = net->weights[net->Nunits];
+  candWeights = tData->candIn.weights[candNum];
+  for  ( i = 0 ; i < (net->Nunits+tc->recurrent) ; i++ )
     newWeights[i] = candWeights[i];
 
   /*  Either copy the output weights over or approximate them  */
   if  ( useOutWeights )
-    for  ( i = 0 ; i < Noutputs ; i++ )
-      cNet->outWeights[i][cNet->Nunits] = -cTData->candOut.weights[candNum][i];
+    for  ( i = 0 ; i < tc->Noutputs ; i++ )
+      net->outWeights[i][net->Nunits] = -tData->candOut.weights[candNum][i];
   else  {
-    if  ( cParms->errorMeasure == BITS )
+    if  ( tc->parms->errorMeasure == BITS )
       weightModifier = 1.0;
     else
-      weightModifier = 1.0 / cNet->Nunits;
-    for  ( i = 0 ; i < Noutputs ; i++ )
-      cNet->outWeights[i][cNet->Nunits] = -cTData->candPrevCorr[candNum][i] *
+      weightModifier = 1.0 / net->Nunits;
+    for  ( i = 0 ; i < tc->Noutputs ; i++ )
+      net->outWeights[i][net->Nunits] = -tData->candPrevCorr[candNum][i] *
 	                                  weightModifier;
   }
 
-  cNet->unitTypes[cNet->Nunits] = cTData->candTypes[candNum];
+  net->unitTypes[net->Nunits] = tData->candTypes[candNum];
 
   /*  Compute the new cache values and then increment/decrement the  */
   /* appropriate counters  */
-  if  ( cParms->useCache )
-    recompute_cache( cNet->Nunits, cNet, cDSet, cTData->valCache );
-  cNet->Nunits++;
-  cNet->NhiddenUnits++;
-  cNet->maxNewUnits--;
+  if  ( tc->parms->useCache )
+    tc->connx += recompute_cache( net->Nunits, net, tc->dSet,
+				  tData->valCache );
+  net->Nunits++;
+  net->NhiddenUnits++;
+  net->maxNewUnits--;
 }
@@ -36,6 +36,11 @@
 
 #include <time.h>
 #include <stdio.h>
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdatomic.h>
+#include <sys/types.h>
+#include <sys/stat.h>
 
 #include "toolkit.h"
 #include "parse.h"
@@ -63,9 +68,53 @@
 #define DEF_SIGMAX 0.5                     /*  Set some defaults  */
 #define DEF_SIGMIN -0.5
 #define BIAS       1.0
+#define LM_LAMBDA  1.0e-4                  /*  Initial Levenberg-Marquardt  */
+                                           /* damping factor               */
+#define EVAL_MIN_PTS 256                   /*  Fewest points worth a thread */
+                                           /* of their own                 */
+#define PACK_BATCH 64                      /*  Points evaluated together by */
+                                           /* a packed network             */
+#define PACK_ALIGN 32                      /*  Alignment in bytes of packed */
+                                           /* weight rows                  */
+#define PACK_SPARSE 0.5                    /*  Packed rows with fewer       */
+                                           /* nonzero weights than this    */
+                                           /* share are evaluated sparsely */
+#define QUANT_TABLE 2048                   /*  Entries in a quantized       */
+                                           /* activation table             */
+#define QUANT_STEPS 64                     /*  Table entries per unit of    */
+                                           /* summed input                 */
+#define PRED_BLOCK 65536                   /*  Points formatted per pass    */
+                                           /* of a batch prediction        */
+#define PRED_MAGIC 0x44455250              /*  Starts a binary prediction   */
+                                           /* file ("PRED" little-endian)  */
+#define PRED_FLOAT_MAX 20                  /*  Longest formatted value,     */
+                                           /* with its comma               */
+#define SERVE_CLIENTS 1024                 /*  Most clients of a server     */
+#define SERVE_BATCH 256                    /*  Most queries answered per    */
+                                           /* pass of a server             */
+#define SERVE_MIN_BATCH 8                  /*  Fewest queries to one net    */
+                                           /* worth a batched pass         */
+#define SERVE_BUFSIZE 65536                /*  Input buffered per client    */
+#define SERVE_POLL_MS 500                  /*  Longest a server waits       */
+                                           /* before checking for Ctrl-C   */
+#define SERVE_FRAME 0x01                   /*  Starts a binary query frame  */
+#define SERVE_FRAME_NETS 256               /*  Networks a frame can name    */
+#define SERVE_SESSIONS 65536               /*  Most sessions open on each   */
+                                           /* network served               */
+#define SESSION_BUCKETS 1024               /*  Initial buckets of a table   */
+                                           /* of sessions, a power of 2    */
+#define REGISTRY_BUCKETS 64                /*  Initial buckets of the       */
+                                           /* registry, a power of 2       */
 
 /*  Macro to determine error index  */
-#define ERROR_INDEX( SSDiff, sDev, num )  ( sqrt( SSDiff / num ) / sDev )
+#define ERROR_INDEX( SSDiff, sDev, num )  ( sqrt( (SSDiff) / (num) ) / (sDev) )
+
+/*  Macro to fetch the goal of output 'i' for a point of data set 'set'.
+    Points whose targets are stored as a class index have no output vector,
+    so the goal is rebuilt from the binary values of the data set.  */
+#define GOAL( set, pt, i )  ( ((pt)->outputs != NULL) ? (pt)->outputs[i] :  \
+			      ((pt)->target == (i)) ? (set)->binPos :       \
+			      (set)->binNeg )
 
 /*  Node types  */
 typedef enum {
@@ -75,7 +124,8 @@ typedef enum {
   ASIGMOID,
   VARSIGMOID,
   GAUSSIAN,
-  LINEAR
+  LINEAR,
+  SOFTMAX
   } node_t;
 
 /*  Training algorithms  */
@@ -90,6 +140,21 @@ typedef enum {
   BITS
   } error_t;
 
+/*  Candidate weight initialization  */
+typedef enum {
+  RANDOM_INIT,
+  RESIDUAL_INIT
+  } cinit_t;
+
+/*  Formats of batch prediction files  */
+typedef enum {
+  RAW_FORMAT,
+  TOKEN_FORMAT,
+  BOTH_FORMAT,
+  BINARY_FORMAT,
+  CLASS_FORMAT
+  } pformat_t;
+
 /*  Training statuses  */
 typedef enum {
   TRAINING,
@@ -113,6 +178,161 @@ typedef struct {
 } error_data_t;
 
 
+/*  RLS_DATA_T
+    State for the online recursive least squares adaptation of the output
+    weights.  The state is built the first time a network is adapted and is
+    discarded whenever the number of units in the network changes.          */
+typedef struct {
+  int   Nunits;        /*  Number of units the state was built for  */
+  float *Px,           /*  Product of P and the current unit values  */
+        *gain,         /*  RLS gain vector  */
+        **P;           /*  Inverse correlation matrix of the unit values  */
+} rls_data_t;
+
+
+/*  PACKED_NET_T
+    A copy of a network compiled for inference (see packed.c).  The hidden
+    weights are packed into one aligned buffer, each unit's row padded to a
+    multiple of PACK_ALIGN bytes, followed by the output weights as a dense
+    matrix.  Mostly zero rows also list their nonzero weights.  The copy is
+    not updated when the network changes.                                  */
+typedef struct {
+  int     Ninputs,     /*  Number of inputs  */
+          Nunits,      /*  Number of units, including inputs and bias  */
+          Noutputs,    /*  Number of outputs  */
+          outStride,   /*  Floats from one output's weights to the next  */
+          *rowStart,   /*  Offset of each hidden unit's weights  */
+          *nzStart,    /*  Offset in 'nzIndex' of each row's list, by     */
+                       /* unit and then by output (see 'packed_row')     */
+          *nzCount,    /*  Nonzero weights in each row, or -1 if dense  */
+          *nzIndex;    /*  Units the nonzero weights of each row come from */
+  boolean recurrent,   /*  Is the network recurrent?  */
+          softmax,     /*  Are any of the outputs SOFTMAX?  */
+          earlyExit;   /*  Can a point's class be decided early?  */
+  float   sigMax,      /*  Range of a VARSIGMOID unit  */
+          sigMin,
+          *weights,    /*  Packed hidden unit weights  */
+          *outWeights, /*  Output weights, 'outStride' floats per output  */
+          *remaining;  /*  Most the hidden units from each one on can add */
+                       /* to each output, Nunits+1 per output, or NULL    */
+  node_t  *unitTypes,  /*  Types of the hidden units  */
+          *outputTypes;/*  Types of the outputs  */
+  void    *block;      /*  Allocation holding the weights  */
+} packed_net_t;
+
+
+/*  QUANT_NET_T
+    An 8 bit copy of a network for inference (see quant.c).  Unit values
+    are signed bytes times a scale per unit, and each row of weights is
+    signed bytes times a scale per row, laid out as in a packed network.
+    The copy is not updated when the network changes.                     */
+typedef struct {
+  int         Ninputs,      /*  Number of inputs  */
+              Nunits,       /*  Number of units, including inputs and bias */
+              Noutputs,     /*  Number of outputs  */
+              outStride,    /*  Bytes from one output's weights to the next */
+              *rowStart;    /*  Offset of each hidden unit's weights  */
+  boolean     recurrent,    /*  Is the network recurrent?  */
+              softmax;      /*  Are any of the outputs SOFTMAX?  */
+  float       sigMax,       /*  Range of a VARSIGMOID unit  */
+              sigMin,
+              *unitScale,   /*  Value of one step of each unit  */
+              *rowScale,    /*  Scale of each hidden unit's weights  */
+              *outScale,    /*  Scale of each output's weights  */
+              *selfWeights; /*  Recurrent self weights, kept as floats  */
+  signed char *weights,     /*  Quantized hidden unit weights  */
+              *outWeights,  /*  Quantized output weights  */
+              *tables,      /*  Activation tables, QUANT_TABLE per type  */
+              *table[SOFTMAX+1];  /*  Table of each unit type, or NULL if */
+                            /* the type is scaled rather than looked up  */
+  node_t      *unitTypes,   /*  Types of the units  */
+              *outputTypes; /*  Types of the outputs  */
+  void        *block;       /*  Allocation holding the weights  */
+} quant_net_t;
+
+
+/*  INFER_CTX_T
+    The state of one caller evaluating points with a packed network.  The
+    network itself is only read, so it may be shared by any number of
+    contexts, each used by one thread at a time.  A context given a
+    quantized copy of the network evaluates its points with that instead. */
+typedef struct {
+  packed_net_t *model;       /*  The network evaluated  */
+  quant_net_t  *quant;       /*  Quantized copy used instead, or NULL        */
+  float        *values,      /*  Unit values of the last point, which are    */
+                             /* the recurrent state                          */
+               *outValues,   /*  Outputs of the last single point            */
+               *outMags,     /*  Magnitudes summed into each output          */
+               *work;        /*  Unit values of a batch                      */
+  signed char  *qwork;       /*  Quantized unit values of a batch            */
+  void         *workBlock,   /*  Allocation holding 'work'                   */
+               *qworkBlock;  /*  Allocation holding 'qwork'                  */
+} infer_ctx_t;
+
+
+/*  SESSION_T
+    One sequence fed through a network a time step at a time (see
+    session.c).  A session holds only the unit values of its last step,
+    so any number of sessions may share one packed network.               */
+typedef struct session_type {
+  char                *id;      /*  Name the session is found by  */
+  unsigned long       hash;     /*  Hash of the name  */
+  float               *values;  /*  Unit values of the last step, which are */
+                                /* the recurrent state                     */
+  int                 Nsteps,   /*  Steps taken  */
+                      row;      /*  Row of the step being batched, or -1  */
+  struct session_type *next;    /*  Next session in the same bucket  */
+} session_t;
+
+
+/*  SESSION_TABLE_T
+    The sessions open on one packed network, hashed by name.              */
+typedef struct {
+  packed_net_t *model;       /*  The network stepped  */
+  int          Nsessions,    /*  Sessions open  */
+               Nbuckets;     /*  Buckets in the table, a power of 2  */
+  session_t    **buckets;    /*  Chains of sessions  */
+} session_table_t;
+
+
+/*  MEMO_ENTRY_T
+    The outputs a network gave for one input vector, kept in a result cache
+    (see memo.c).                                                          */
+typedef struct memo_entry_type {
+  unsigned long          hash;     /*  Hash of the inputs  */
+  float                  *inputs,  /*  The inputs  */
+                         *outputs; /*  The outputs given for them  */
+  char                   *text;    /*  The outputs decoded into tokens  */
+  int                    textLen;  /*  Length of 'text', or -1 until filled  */
+  struct memo_entry_type *next,    /*  Next entry in the same bucket  */
+                         *newer,   /*  Entries used just after and just  */
+                         *older;   /* before this one                  */
+} memo_entry_t;
+
+
+/*  MEMO_T
+    A cache of the results a network gave for the inputs it was queried
+    with, hashed by input vector, dropping the least recently used result
+    when full.                                                             */
+typedef struct {
+  int          Ninputs,      /*  Number of inputs  */
+               Noutputs,     /*  Number of outputs  */
+               Nentries,     /*  Entries in use  */
+               maxEntries,   /*  Most entries kept  */
+               Nbuckets,     /*  Buckets in the table, a power of 2  */
+               textWidth;    /*  Most characters of an entry's tokens  */
+  long         hits,         /*  Lookups answered from the cache  */
+               misses;       /*  Lookups that were not  */
+  boolean      quantized;    /*  Were the outputs from the quantized copy?  */
+  memo_entry_t **buckets,    /*  Chains of entries  */
+               *entries,     /*  All the entries  */
+               *newest,      /*  Most recently used entry  */
+               *oldest;      /*  Least recently used entry  */
+  float        *block;       /*  Inputs and outputs of every entry  */
+  char         *texts;       /*  Tokens of every entry  */
+} memo_t;
+
+
 /*  LAYER_INFO_T
     Contains training data for a single layer of the network.  Instances are
     constructed for the output, candidate input and candidate output layers. */
@@ -125,6 +345,19 @@ typedef struct {
 } layer_info_t;
 
 
+/*  POOL_ARM_T
+    One configuration that slots in an adaptive candidate pool may be given:
+    an activation type and the candidate input update parameters.  Arms
+    whose candidates win are given more of the pool in later cycles.      */
+typedef struct {
+  node_t type;         /*  Activation type of the candidates                */
+  float  epsScale,     /*  Multiplier of the candidate input epsilon        */
+         muScale,      /*  Multiplier of the candidate input mu             */
+         credit;       /*  Decaying count of the cycles this arm has won    */
+  int    Nwins;        /*  Number of cycles this arm has won                */
+} pool_arm_t;
+
+
 /*  TRAIN_DATA_T
     Transient network data.  This information is used for training the network
     but is not otherwise necessary for prediction.  This structure is
@@ -145,7 +378,38 @@ typedef struct {
                **valCache,      /*  Cached activation values.  Speeds up     */
                                 /* training considerably                     */
                **errCache;      /*  Cached error values.                     */
+  int          vSetPts,         /*  The number of points in the validation   */
+                                /* cache                                     */
+               vSetUnits;       /*  The units in the validation cache        */
+  float        **vSetCache;     /*  Cached activation values of the          */
+                                /* validation set                            */
+  int          seedSize,        /*  Units the seeding state was built for    */
+               gramUnits;       /*  Seed.  Units summed into the Gram matrix */
+  float        **candGram,      /*  Seed.  Gram matrix of the cached values  */
+               **candFactor,    /*  Seed.  Cholesky factor of the Gram       */
+               **candSeedDir;   /*  Seed.  Least-squares direction of each   */
+                                /* output's residual in unit value space     */
+  int          lmUnits;         /*  Fan-in the LM state was built for        */
+  boolean      candLM;          /*  Are the candidate inputs trained by the  */
+                                /* Levenberg-Marquardt method this cycle?    */
+  float        *candLambda,     /*  LM.  Damping factor of each candidate    */
+               *candLMScore,    /*  LM.  Score at the accepted weights       */
+               *candResSq,      /*  LM.  Sum of the squares of the signed    */
+                                /* residual each cascor candidate follows    */
+               *candJacob,      /*  LM.  Derivative of a candidate's value   */
+                                /* with respect to its input weights         */
+               **candLMWeights, /*  LM.  The accepted input weights          */
+               **candLMSlopes,  /*  LM.  The slopes at the accepted weights  */
+               ***candHess,     /*  LM.  Gauss-Newton approximation of the   */
+                                /* Hessian of each candidate's error         */
+               ***candLMHess;   /*  LM.  The Hessian at the accepted weights */
   node_t       *candTypes;      /*  The activation types of each candidate   */
+  int          Narms,           /*  Adapt.  Number of pool configurations    */
+               *candArm;        /*  Adapt.  The arm of each candidate        */
+  float        *candEpsilon,    /*  Adapt.  Input epsilon of each candidate  */
+               *candMu,         /*  Adapt.  Input mu of each candidate       */
+               *candShrink;     /*  Adapt.  Shrink factor of each candidate  */
+  pool_arm_t   *arms;           /*  Adapt.  The pool configurations          */
   layer_info_t candIn,          /*  Training information on the inputs to    */
                                 /* the candidates                            */
                candOut,         /*  Training information on the outputs from */
@@ -185,6 +449,22 @@ typedef struct {
 } cycle_parms_t;
 
 
+/*  RACE_T
+    A trial of a sweep racing the other configurations' runs of the same
+    trial (see sweep.c).  'best' is shared by the runs of the trial, and
+    holds the least error any of them had with each number of hidden
+    units, or a negative value where none has been seen.                  */
+typedef struct {
+  pthread_mutex_t *lock;     /*  Guards 'best'                               */
+  float          *best,      /*  Least error with each number of hidden      */
+                             /* units                                        */
+                 margin;     /*  Share by which a run may fall behind        */
+  int            maxUnits,   /*  Most hidden units 'best' has room for       */
+                 warmup;     /*  Hidden units added before a run may lose    */
+  boolean        lost;       /*  Was the run stopped for falling behind?     */
+} race_t;
+
+
 /*  TRAIN_PARM_T
     This is the main structure used to contain training parameters.  All that
     is necessary for network training is contained herein.                   */
@@ -194,8 +474,21 @@ typedef struct  {
                  validationPatience, /*  The number of training cycles to    */
                                      /* perform without improvement in       */
                                      /* cross-validation generalization      */
-                 Ncand;              /*  Number of candidates in the         */
+                 Ncand,              /*  Number of candidates in the         */
                                      /* training pool                        */
+                 candLMUnits,        /*  Train the candidate inputs with     */
+                                     /* Levenberg-Marquardt while their      */
+                                     /* fan-in is below this number          */
+                 memoEntries,        /*  Most query results cached for each  */
+                                     /* network (0 = no cache)               */
+                 maxResident,        /*  Most registered networks kept in    */
+                                     /* memory at once (0 = no limit)        */
+                 Nthreads,           /*  Most threads to evaluate data sets  */
+                                     /* with (0 = one per processor)         */
+                 trialThreads,       /*  Most trials of a run trained at     */
+                                     /* once (0 = one per processor)         */
+                 trialSeed;          /*  Seed of the random streams of a     */
+                                     /* run's trials (0 = a new one per run) */
   float          outPrimeOffset,     /*  Amount to offset the error prime    */
                                      /* when training outputs.  See [1]      */
                                      /* for details of why this helps        */
@@ -206,15 +499,38 @@ typedef struct  {
                  scoreThreshold,     /*  The maximum fractional variance of  */
                                      /* a unit from its goal to be           */
                                      /* considered correct                   */
+                 pruneThreshold,     /*  Most pruning may raise the held out */
+                                     /* error, in the error measure's units  */
                  sigMax,             /*  Maximum value of VARSIGMOID units   */
-                 sigMin;             /*  Minimum value of VARSIGMOID units   */
+                 sigMin,             /*  Minimum value of VARSIGMOID units   */
+                 rlsForget,          /*  Forgetting factor used when the     */
+                                     /* outputs are adapted online           */
+                 rlsDelta;           /*  Initial diagonal of the RLS inverse */
+                                     /* correlation matrix                   */
   boolean        overshootOK,        /*  Ok to overshoot the desired goal?   */
                  useCache,           /*  Is value and error cache in use?    */
                  test,               /*  Test the network after training?    */
                  validate,           /*  Cross-validate the network during   */
                                      /* training?                            */
-                 recurrent;          /*  Train a recurrent network?          */
+                 recurrent,          /*  Train a recurrent network?          */
+                 softmax,            /*  Sync enumerated outputs to a        */
+                                     /* softmax group with cross-entropy     */
+                                     /* error?                               */
+                 classTargets,       /*  Store the targets of loaded data    */
+                                     /* files as class indices?              */
+                 candAdapt,          /*  Mix candidate types and step sizes  */
+                                     /* in the pool, favoring winners?       */
+                 quantized,          /*  Infer with quantized copies of      */
+                                     /* networks where they exist?           */
+                 pruneRefit,         /*  Refit the output weights after      */
+                                     /* pruning?                             */
+                 keepTrials,         /*  Keep the network of every trial of  */
+                                     /* a run and test them as an ensemble? */
+                 ensembleVote;       /*  Have ensembles vote by class rather */
+                                     /* than average their outputs?          */
   node_t         candType;           /*  Type of candidate to comprise pool  */
+  cinit_t        candInit;           /*  How candidate weights are chosen    */
+  pformat_t      predictFormat;      /*  Format of batch prediction files    */
   algo_t         algorithm;          /*  Network architecture to use         */
   error_t        errorMeasure;       /*  Measure that determines success     */
   update_parms_t candInUpdate,       /*  Parameters for candidates inputs    */
@@ -222,6 +538,8 @@ typedef struct  {
                  outputUpdate;       /*  Parameters for network outputs      */
   cycle_parms_t  candidateParm,      /*  Candidate phase parameters          */
                  outputParm;         /*  Output phase parameters             */
+  race_t         *race;              /*  Race the run is in, if it is part   */
+                                     /* of a sweep (not in the parm table)   */
 }  train_parm_t;
 
 
@@ -257,6 +575,13 @@ typedef struct net_type {
                   *outputMap;     /*  Maps from raw outputs to tokens        */
   node_t          *unitTypes,     /*  Types for the interior units           */
                   *outputTypes;   /*  Types of the outputs                   */
+  rls_data_t      *rls;           /*  Online adaptation state.  NULL until   */
+                                  /* the network is first adapted          */
+  packed_net_t    *packed;        /*  Packed copy shared by inference        */
+                                  /* contexts.  Only set while the net is  */
+                                  /* not being trained                     */
+  quant_net_t     *quant;         /*  Quantized copy, made by 'quantize'     */
+  memo_t          *memo;          /*  Results of recent queries, or NULL     */
   struct net_type *next;
 } net_t;
 
@@ -270,6 +595,40 @@ typedef struct df_type {
 } df_t;
 
 
+/*  MODEL_T
+    A network registered by name with the file it is kept in (see
+    registry.c).  The network is only in memory while 'net' is set.      */
+typedef struct model_type {
+  char              *name,     /*  Name the network is looked up by  */
+                    *filename; /*  File the network is loaded from  */
+  net_t             *net;      /*  The network, or NULL if not resident  */
+  time_t            mtime;     /*  Modification time of the file loaded  */
+  off_t             size;      /*  Size of the file loaded  */
+  ino_t             inode;     /*  Inode of the file loaded  */
+  dev_t             device;    /*  Device of the file loaded  */
+  unsigned long     hash;      /*  Hash of the name  */
+  struct model_type *next,     /*  Next model in the same bucket  */
+                    *newer,    /*  Resident models used just after and  */
+                    *older;    /* just before this one                */
+} model_t;
+
+
+/*  REGISTRY_T
+    The registered networks, hashed by name, with those in memory kept in
+    order of use so the least recently used can be dropped.               */
+typedef struct {
+  int          Nmodels,      /*  Models registered  */
+               Nresident,    /*  Models in memory  */
+               Nbuckets,     /*  Buckets in the table, a power of 2  */
+               loads,        /*  Times a model was loaded  */
+               reloads,      /*  Times a changed file was loaded again  */
+               evictions;    /*  Times a model was dropped from memory  */
+  model_t      **buckets,    /*  Chains of models  */
+               *newest,      /*  Most recently used resident model  */
+               *oldest;      /*  Least recently used resident model  */
+} registry_t;
+
+
 /*  PARM_VAR_T
     These are enumerations of the various types of data stored in the table
     located in 'interface.c'.  These enumerations help the data be interpreted
@@ -280,6 +639,8 @@ typedef enum { INT,      /*  Integer value                                   */
 	       NODE,     /*  Node type (i.e. Sigmoid, Gaussian, etc.)        */
 	       ALGO,     /*  Algorithm type (Cascor/Cascade-2)               */
 	       ERR,      /*  Error type (Bits/Index)                         */
+	       CINIT,    /*  Candidate initialization (Random/Residual)      */
+	       PFMT,     /*  Prediction file format (Raw/Tokens/Both/Binary) */
 	       FUNC      /*  A function's address                            */
 	     } parm_var_t;
 
@@ -313,51 +674,350 @@ typedef struct {
 } trial_result_t;
 
 
+/*  ENSEMBLE_T
+    Networks trained on the same data, evaluated together (see ensemble.c).
+    The bias and input weights of every member's hidden units and outputs
+    are gathered into one matrix, so that the part of their sums that
+    depends only on the inputs is computed in one pass over a batch.      */
+typedef struct {
+  int            Nmembers,     /*  Number of networks in the ensemble        */
+                 Ninputs,      /*  Inputs of every member                    */
+                 Noutputs,     /*  Outputs of every member                   */
+                 Nrows,        /*  Hidden units and outputs of all members   */
+                 maxUnits,     /*  Most units of any member                  */
+                 inStride,     /*  Floats per row of 'inWeights'             */
+                 *firstRow;    /*  Row of each member's first hidden unit    */
+  boolean        vote;         /*  Do members vote by class rather than      */
+                               /* have their outputs averaged?              */
+  float          hardPos,      /*  Output values a vote counts as, for the   */
+                 hardNeg,      /* class voted for and the others            */
+                 *inWeights,   /*  Bias and input weights of every row       */
+                 *inSums,      /*  Input part of the sum of every row, over  */
+                               /* a batch                                   */
+                 *work,        /*  Unit values of a batch, one member at a   */
+                               /* time                                      */
+                 *outValues;   /*  One member's outputs over a batch         */
+  packed_net_t   **members;    /*  Packed copy of each member                */
+  void           *block,       /*  Allocation holding 'inWeights'            */
+                 *sumBlock,    /*  Allocation holding 'inSums'               */
+                 *workBlock;   /*  Allocation holding 'work'                 */
+} ensemble_t;
+
+
+/*  EVAL_JOB_T
+    A share of the chunks of a data set evaluated on a thread of its own.
+    Each thread has its own inference context and outputs, and adds the
+    error on each point to the statistics of its chunk.                    */
+typedef struct {
+  pthread_t    thread;       /*  The thread evaluating the points            */
+  net_t        *net;         /*  Network being evaluated                     */
+  data_set_t   *dSet;        /*  Data set being evaluated                    */
+  float        **valCache,   /*  Cached unit values of the data set, if any  */
+               **outputs,    /*  Where to store the outputs of each point,   */
+                             /* if anywhere                                  */
+               *outValues;   /*  The thread's output values, PACK_BATCH      */
+                             /* points' worth                                */
+  infer_ctx_t  *ctx;         /*  The thread's context on a packed copy of    */
+                             /* the network, if no cache is used             */
+  error_data_t **chunks;     /*  Error statistics of every chunk, if scored  */
+  float        offset;       /*  Sigmoid prime offset of the outputs         */
+  int          first,        /*  First chunk of the share                    */
+               start,        /*  First point of the share                    */
+               end,          /*  One past the last point of the share        */
+               errorCount;   /*  Points whose class was wrong                */
+  boolean      threaded;     /*  Is the share on a thread of its own?        */
+} eval_job_t;
+
+
+/*  TRIAL_POOL_T
+    The trials of a run, shared out among threads.  Each thread takes the
+    next trial not yet started and trains it on a network of its own with
+    a copy of the run's parameters.  The results are stored by trial, to
+    be added up in order once every trial is done.                        */
+typedef struct {
+  pthread_mutex_t lock;      /*  Guards 'next'                               */
+  data_file_t    *dFile;     /*  Data every trial trains on, only read       */
+  train_parm_t   *parms;     /*  Parameters of the run                       */
+  net_t          **kept;     /*  Network of each trial, if they are kept     */
+  trial_result_t *results;   /*  Result of each trial                        */
+  long           seed;       /*  Seed of the first trial's random stream     */
+  int            Ntrials,    /*  Trials in the run                           */
+                 next;       /*  Next trial to start                         */
+} trial_pool_t;
+
+
+/*  SWEEP_AXIS_T
+    A parameter varied by a sweep, with the values it is tried at: either
+    a list of them, or a range they are drawn from.                        */
+typedef struct {
+  parm_t       parm;         /*  Entry of the parameter in the parm table    */
+  long         offset;       /*  Where the parameter is in a parameter table */
+  char         **values;     /*  Values listed, if not a range               */
+  int          Nvalues;      /*  Number of values listed                     */
+  float        low,          /*  Range the values are drawn from, if they    */
+               high;         /* are not listed                               */
+  boolean      logScale;     /*  Draw evenly in the log of the range?        */
+} sweep_axis_t;
+
+
+/*  SWEEP_CONFIG_T
+    A configuration of the parameters tried by a sweep, with the sums of
+    the results of the trials it has finished.                             */
+typedef struct {
+  train_parm_t   parms;      /*  Parameters of the configuration             */
+  char           **values;   /*  Value of each axis, as given                */
+  trial_result_t total;      /*  Sums of the results of its trials           */
+  int            Ntrials;    /*  Trials finished                             */
+  float          score;      /*  Average error, for ranking                  */
+  boolean        lost;       /*  Was it stopped for falling behind?          */
+} sweep_config_t;
+
+
+/*  SWEEP_T
+    A sweep of configurations, whose trials are shared out among threads.
+    Trial 't' of configuration 'c' is job 't * Nconfigs + c', so every
+    configuration's first trial starts before any second one.  Each trial
+    keeps the least error any configuration had with each number of
+    hidden units, for the runs of that trial to race.                     */
+typedef struct {
+  pthread_mutex_t lock;      /*  Guards 'next', 'best' and the results       */
+  data_file_t    *dFile;     /*  Data every trial trains on, only read       */
+  sweep_axis_t   *axes;      /*  Parameters varied                           */
+  sweep_config_t *configs;   /*  Configurations tried                        */
+  float          **best,     /*  Least error of each trial by hidden units   */
+                 margin;     /*  Share by which a run may fall behind        */
+  char           *output;    /*  File the ranked table is written to         */
+  long           seed;       /*  Seed of the first trial's random stream     */
+  int            Naxes,      /*  Number of parameters varied                 */
+                 Nconfigs,   /*  Number of configurations                    */
+                 Nsamples,   /*  Configurations to draw, 0 for every one     */
+                 Ntrials,    /*  Trials of each configuration                */
+                 maxUnits,   /*  Most hidden units of any configuration      */
+                 warmup,     /*  Hidden units added before a run may lose    */
+                 next;       /*  Next job to start                           */
+} sweep_t;
+
+
+/*  PRED_JOB_T
+    A share of a block of points whose predictions are formatted on a
+    thread of its own.  Each thread formats into a buffer of its own, and
+    the buffers are written out in order.                                  */
+typedef struct {
+  pthread_t    thread;       /*  The thread formatting the points            */
+  net_t        *net;         /*  Network that made the predictions           */
+  float        **outputs,    /*  Outputs of every point                      */
+               range;        /*  Tolerance when decoding tokens              */
+  pformat_t    format;       /*  Format to write                             */
+  char         *buf;         /*  The thread's text                           */
+  int          start,        /*  First point of the share                    */
+               end,          /*  One past the last point of the share        */
+               len;          /*  Characters in 'buf'                         */
+  boolean      threaded;     /*  Is the share on a thread of its own?        */
+} pred_job_t;
+
+
+/*  SERVE_FRAME_T
+    Header of a binary query frame, which is followed by 'Nvals' inputs as
+    floats in the machine's own byte order.  The reply has the same header
+    followed by the outputs, or 'Nvals' 0 if the query failed.             */
+typedef struct {
+  unsigned char  tag;        /*  SERVE_FRAME                                 */
+  unsigned char  net;        /*  Index of the network queried                */
+  unsigned short Nvals;      /*  Floats following the header                 */
+} serve_frame_t;
+
+
+/*  SERVE_NET_T
+    A network answering queries for a server, with the queries batched for
+    it in the current pass.                                               */
+typedef struct {
+  net_t        *net;         /*  The network                                 */
+  infer_ctx_t  *ctx;         /*  Context on the network's packed copy        */
+  float        **inputs,     /*  Inputs of the queries batched               */
+               **outputs,    /*  Outputs of the queries batched              */
+               *block;       /*  Allocation holding the inputs and outputs   */
+  boolean      *resets;      /*  Does each query start a sequence?           */
+  char         **tokens;     /*  Tokens of a tokenized query                 */
+  session_table_t *sessions; /*  Sessions open on the network                */
+  session_t    **stepped,    /*  Session each query steps, or NULL           */
+               *ended;       /*  Sessions ended in this pass, freed after it */
+  float        **states,     /*  Recurrent state of each query batched       */
+               *loose;       /*  State of the queries in no session          */
+  int          Nseries,      /*  Input series, for tokenized queries         */
+               tokenWidth,   /*  Longest tokenized reply                     */
+               Nqueued,      /*  Queries batched                             */
+               Nstepped;     /*  Queries batched that step a session         */
+} serve_net_t;
+
+
+/*  SERVE_CLIENT_T
+    A connection to a server.  Input is buffered until whole queries have
+    arrived, and replies until the socket takes them.                     */
+typedef struct {
+  int          fd,           /*  The client's socket                         */
+               slot,         /*  Index in the server's list of clients       */
+               inLen,        /*  Bytes in 'in'                               */
+               outLen,       /*  Bytes in 'out'                              */
+               outSize;      /*  Bytes allocated for 'out'                   */
+  char         *in,          /*  Input not yet answered                      */
+               *out;         /*  Replies not yet written                     */
+  boolean      backlog,      /*  Are whole queries left in 'in'?             */
+               closing,      /*  Has the client hung up?                     */
+               polling;      /*  Is the socket watched for room to write?    */
+} serve_client_t;
+
+
+/*  SERVE_REQ_T
+    A query read in the current pass of a server, in the order of arrival.
+    Its inputs and outputs are a row of its network's batch.              */
+typedef struct {
+  serve_client_t *client;    /*  Client to reply to                          */
+  int            net,        /*  Index of the network queried                */
+                 row;        /*  Row of the query in the network's batch, or */
+                             /* -1 for a query answered 'OK'                 */
+  pformat_t      format;     /*  Reply with raw outputs, tokens or a frame   */
+  memo_entry_t   *hit;       /*  Cached result answering the query, or NULL  */
+  char           *error;     /*  Why the query failed, or NULL               */
+} serve_req_t;
+
+
+/*  SERVER_T
+    A query server: networks answering queries from clients on a local
+    socket.  The queries of each pass are batched by network.            */
+typedef struct {
+  int            fd,         /*  The listening socket                        */
+                 Nnets,      /*  Networks served                             */
+                 Nclients,   /*  Clients connected                           */
+                 Nreqs,      /*  Queries read in the current pass            */
+                 Nbacklog,   /*  Clients with whole queries left over        */
+                 Nclosing,   /*  Clients that have hung up                   */
+                 Nqueries,   /*  Queries answered                            */
+                 Npasses;    /*  Passes that answered queries                */
+  char           *path;      /*  Address of the listening socket             */
+  poller_t       *poller;    /*  Watches the sockets                         */
+  serve_net_t    *nets;      /*  The networks                                */
+  serve_client_t **clients;  /*  The clients                                 */
+  serve_req_t    *reqs;      /*  Queries read in the current pass            */
+} server_t;
+
+
+/*  VAL_JOB_T
+    A validation epoch run on a thread of its own while the next candidate
+    pool trains.  The network's output weights do not change during
+    candidate training, so the thread can read them as they stand.        */
+typedef struct {
+  pthread_t      thread;     /*  The thread running the epoch                */
+  net_t          *net;       /*  Network being validated                     */
+  data_set_t     *dSet;      /*  The validation data                         */
+  float          **valCache, /*  Up to date unit values of the validation    */
+                             /* data                                         */
+                 bestScore,  /*  Best validation score before this epoch     */
+                 offset;     /*  Sigmoid prime offset of the outputs         */
+  int            cyclesLeft, /*  Validation cycles left before this epoch    */
+                 connx;      /*  Connection crossings made by the thread     */
+  boolean        init;       /*  Is this the first validation epoch?         */
+  atomic_int     *cancel;    /*  Set to stop candidate training              */
+  trial_result_t result;     /*  Results of the epoch                        */
+} val_job_t;
+
+
+/*  TRAIN_CTX_T
+    Everything a training run shares among its inner loops.  Each run has
+    a context of its own, handed to every training routine, so several
+    networks may train at once in one process.  The counts are copied out
+    of the network and parameters when the run starts.                     */
+typedef struct {
+  net_t            *net;     /*  Network being trained                       */
+  train_parm_t     *parms;   /*  Its training parameters                     */
+  train_data_t     *tData;   /*  Slopes, deltas, caches and candidates       */
+  data_file_t      *dFile;   /*  Data file being trained on                  */
+  data_set_t       *dSet;    /*  Data set being trained on                   */
+  error_data_t     *error;   /*  Error statistics of the current epoch       */
+  int              Ninputs,  /*  Number of inputs in the network             */
+                   Noutputs, /*  Number of outputs                           */
+                   Ncand,    /*  Number of candidate units                   */
+                   NtrainOutVals,  /*  Outputs * training points             */
+                   connx;    /*  Connection crossings made, if counted       */
+  boolean          recurrent;  /*  Is the network recurrent?                 */
+  atomic_int       candCancel; /*  Stop training the candidates, since none  */
+                               /* will be installed.  Set by the validation  */
+                               /* thread while the candidates train.         */
+  jmp_buf          abortTrap;  /*  Lets the user kill the run in progress    */
+} train_ctx_t;
+
+
 /*  cascade.c  */
 
 trial_result_t train_net          ( net_t *, train_parm_t *, data_file_t *,
 				    int );
-trial_result_t test_net           ( net_t *, data_set_t * );
-void           set_globals        ( net_t *, train_parm_t *, train_data_t *,
-				    data_file_t *, error_data_t * );
-status_t       train_outputs      ( void );
-void           output_epoch       ( void );
-status_t       validation_epoch   ( float *, float ***, int *, int *, 
+trial_result_t test_net           ( net_t *, train_parm_t *, data_set_t *,
+				    float ** );
+trial_result_t adapt_net          ( net_t *, train_parm_t *, data_set_t * );
+void           eval_net           ( net_t *, train_parm_t *, data_set_t *,
+				    float **, float **, error_data_t *,
+				    int * );
+int            eval_chunk         ( net_t *, data_set_t *, float **, int );
+void           *eval_thread       ( void * );
+void           init_train_ctx     ( train_ctx_t *, net_t *, train_parm_t *,
+				    train_data_t *, data_file_t *,
+				    error_data_t * );
+status_t       train_outputs      ( train_ctx_t * );
+void           output_epoch       ( train_ctx_t * );
+status_t       validation_epoch   ( train_ctx_t *, float *, float ***, int *,
+				    int *, boolean );
+status_t       validation_judge   ( train_ctx_t *, trial_result_t, float *,
+				    float ***, int *, int *, boolean );
+boolean        validation_start   ( train_ctx_t *, val_job_t *, float, int,
 				    boolean );
-void           adjust_weights     ( void );
-void           adjust_ci_weights  ( void );
-void           adjust_co_weights  ( void );
-void           install_cand       ( int, boolean );
+void           *validation_thread ( void * );
+status_t       validation_finish  ( train_ctx_t *, val_job_t *, float *,
+				    float ***, int *, int *, boolean );
+void           adjust_weights     ( train_ctx_t * );
+void           adjust_ci_weights  ( train_ctx_t * );
+void           adjust_co_weights  ( train_ctx_t * );
+void           install_cand       ( train_ctx_t *, int, boolean );
 
 /*  cascor.c  */
 
-status_t     cascor_train_cand           ( void );
-void         cascor_correlation_epoch    ( void );
-void         cascor_compute_correlations ( boolean );
-void         cascor_cand_epoch           ( void );
-void         cascor_compute_slopes       ( boolean );
-void         cascor_adjust_correlations  ( void );
+status_t     cascor_train_cand           ( train_ctx_t * );
+void         cascor_correlation_epoch    ( train_ctx_t * );
+void         cascor_compute_correlations ( train_ctx_t *, boolean );
+void         cascor_cand_epoch           ( train_ctx_t * );
+void         cascor_compute_slopes       ( train_ctx_t *, boolean );
+void         cascor_adjust_correlations  ( train_ctx_t * );
 
 /*  cascade2.c  */
 
-status_t     c2_train_cand               ( void );
-void         c2_cand_epoch               ( void );
-void         c2_compute_slopes           ( float *, boolean );
-void         c2_find_best_cand           ( void );
+status_t     c2_train_cand               ( train_ctx_t * );
+void         c2_cand_epoch               ( train_ctx_t * );
+void         c2_compute_slopes           ( train_ctx_t *, dv_t *, boolean );
+void         c2_find_best_cand           ( train_ctx_t * );
 
 /*  util.c  */
 
-void         forward_pass       ( float *, boolean );
-void         compute_outputs    ( void );
-void         compute_error      ( float *, boolean, boolean, boolean, float );
-void         compute_normal_error      ( float *, int * );
+void         forward_pass       ( train_ctx_t *, float *, boolean );
+void         net_forward        ( net_t *, float *, boolean, float * );
+void         compute_outputs    ( train_ctx_t * );
+void         output_values      ( net_t *, float *, float * );
+void         softmax_outputs    ( float *, node_t *, int );
+void         compute_error      ( train_ctx_t *, dv_t *, boolean, boolean,
+				  boolean, float );
+void         compute_normal_error      ( train_ctx_t *, dv_t *, int * );
+void         score_point        ( net_t *, float *, data_set_t *, int,
+				  error_data_t *, float, float, int * );
+int          class_of           ( float *, int );
+void         rls_update         ( train_ctx_t *, dv_t * );
 void         quickprop          ( float *, float *, float *, float *,
 			          float, float, float, float );
-float        activation         ( node_t, float );
-float        activation_prime   ( node_t, float, float );
-float        output_prime       ( node_t, float );
+float        activation         ( net_t *, node_t, float );
+float        activation_prime   ( net_t *, node_t, float, float );
+float        output_prime       ( net_t *, node_t, float, float );
 float        random_weight      ( float );
-void         sync               ( net_t *, data_file_t * );
+void         make_stream_key    ( void );
+void         seed_random        ( unsigned short *, long );
+long         thread_random      ( void );
+int          num_threads        ( train_parm_t *, int, int );
+void         sync               ( net_t *, train_parm_t *, data_file_t * );
 
 net_t        *select_net        ( char * );
 void         add_net            ( net_t * );
@@ -369,43 +1029,196 @@ char         *ntoa              ( node_t );
 char         *altoa             ( algo_t );
 char         *etoa              ( error_t );
 char         *stoa              ( status_t );
+char         *citoa             ( cinit_t );
+char         *pftoa             ( pformat_t );
 
 node_t       aton               ( char * );
 algo_t       atoal              ( char * );
 error_t      atoe               ( char * );
+cinit_t      atoci              ( char * );
+pformat_t    atopf              ( char * );
 
 /*  init.c  */
 
 net_t        *build_net         ( char *, int, int, int, float, float, float,
 				  boolean );
 void         realloc_net        ( net_t *, int );
+void         free_net           ( net_t ** );
 void         init_net           ( net_t *, float );
 train_parm_t *build_parm        ( void );
 train_data_t *build_train_data  ( net_t *, train_parm_t *, int );
 void         free_train_data    ( train_data_t **, net_t *, train_parm_t * );
 void         init_cand          ( train_data_t *, int, int, int, boolean,
 				  float, node_t );
+void         seed_cand          ( train_data_t *, net_t *, train_parm_t *,
+				  int );
+void         schedule_cand      ( train_data_t *, train_parm_t * );
+void         reward_cand        ( train_data_t * );
 error_data_t *build_error_data  ( net_t * );
 void         free_error_data    ( error_data_t ** );
 void         init_error         ( error_data_t *, int );
+rls_data_t   *build_rls         ( int, float );
+void         free_rls           ( rls_data_t ** );
+
+/*  lm.c  */
+
+void         lm_accumulate      ( float **, float *, int, float );
+void         lm_accumulate_c2   ( train_ctx_t *, float **, float *, int,
+				  float, float, float *, float * );
+void         lm_adjust_ci_weights  ( train_ctx_t * );
+void         lm_restore_ci_weights ( train_ctx_t * );
+boolean      lm_solve           ( float **, float *, int );
+boolean      lm_factor          ( float **, int );
+void         lm_backsolve       ( float **, float *, int );
+
+/*  packed.c  */
+
+packed_net_t *pack_net          ( net_t * );
+void         free_packed        ( packed_net_t ** );
+float        *packed_row        ( packed_net_t *, int, int * );
+float        *pack_alloc        ( int, void **, char * );
+void         packed_forward     ( packed_net_t *, float **, boolean *, int,
+				  float *, float **, float *, float ** );
+float        packed_activation  ( packed_net_t *, node_t, float );
+float        packed_bound       ( packed_net_t *, node_t );
+void         packed_point       ( packed_net_t *, float *, boolean, float *,
+				  float * );
+float        packed_dot         ( packed_net_t *, int, float * );
+int          packed_class       ( packed_net_t *, float *, boolean, float *,
+				  float *, float *, int * );
+infer_ctx_t  *build_infer_ctx   ( packed_net_t * );
+void         free_infer_ctx     ( infer_ctx_t ** );
+void         reset_infer_ctx    ( infer_ctx_t * );
+float        *infer_point       ( infer_ctx_t *, float *, boolean );
+int          infer_class        ( infer_ctx_t *, float *, boolean, int * );
+void         infer_batch        ( infer_ctx_t *, float **, boolean *, int,
+				  float ** );
+void         infer_sessions     ( infer_ctx_t *, float **, boolean *, float **,
+				  int, float ** );
+
+/*  quant.c  */
+
+quant_net_t  *quantize_net      ( net_t *, data_set_t * );
+float        quantize_row       ( float *, int, signed char * );
+signed char  quant_byte         ( float );
+void         free_quant         ( quant_net_t ** );
+int          quant_bytes        ( quant_net_t * );
+float        quant_activation   ( quant_net_t *, node_t, float );
+signed char  quant_unit         ( quant_net_t *, int, float );
+void         quant_forward      ( quant_net_t *, float **, boolean *, int,
+				  float *, signed char *, float ** );
+void         quant_point        ( quant_net_t *, float *, boolean, float *,
+				  signed char *, float * );
+void         quant_infer_ctx    ( infer_ctx_t *, quant_net_t * );
+void         quantize           ( char *, char * );
+
+/*  prune.c  */
+
+void         prune              ( char *, char * );
+float        prune_error        ( net_t *, data_set_t * );
+float        *prune_scales      ( net_t *, data_set_t * );
+float        prune_saliency     ( net_t *, int, float * );
+void         prune_units        ( net_t *, data_set_t *, float, float * );
+void         prune_weights      ( net_t *, data_set_t *, float, float * );
+boolean      prune_refit        ( net_t *, data_set_t *, data_set_t * );
+int          prune_compact      ( net_t * );
+void         prune_unit         ( net_t *, int );
+int          prune_count        ( net_t * );
+
+/*  memo.c  */
+
+memo_t       *build_memo        ( net_t *, int );
+void         free_memo          ( memo_t ** );
+void         memo_net           ( net_t * );
+unsigned long memo_hash         ( float *, int );
+memo_entry_t *memo_find         ( memo_t *, float * );
+memo_entry_t *memo_insert       ( memo_t *, float *, float * );
+void         memo_link          ( memo_t *, memo_entry_t * );
+void         memo_unlink        ( memo_t *, memo_entry_t * );
+float        *memo_point        ( memo_t *, infer_ctx_t *, float * );
+
+/*  registry.c  */
+
+void         register_net       ( char *, char * );
+registry_t   *build_registry    ( void );
+unsigned long model_hash        ( char * );
+model_t      *find_model        ( registry_t *, char * );
+model_t      *add_model         ( registry_t *, char *, char * );
+net_t        *use_model         ( registry_t *, model_t * );
+net_t        *map_net           ( char *, struct stat * );
+void         evict_model        ( registry_t *, model_t * );
+void         drop_model         ( registry_t *, net_t * );
+void         model_link         ( registry_t *, model_t * );
+void         model_unlink       ( registry_t *, model_t * );
+void         list_models        ( registry_t * );
+
+/*  libcascade.c  */
+
+train_parm_t *cascade_init      ( void );
+data_set_t   *matrix_set        ( char *, float *, float *, int, int, int );
+void         free_matrix_set    ( data_set_t ** );
+data_file_t  *matrix_file       ( char *, int, int, out_t *, data_set_t *,
+				  data_set_t *, data_set_t * );
+void         free_matrix_file   ( data_file_t ** );
+net_t        *cascade_net       ( char *, train_parm_t *, data_file_t * );
+trial_result_t cascade_train    ( net_t *, train_parm_t *, data_file_t * );
+trial_result_t cascade_test     ( net_t *, train_parm_t *, data_set_t * );
+infer_ctx_t  *cascade_context   ( net_t *, train_parm_t * );
+void         cascade_infer      ( infer_ctx_t *, float *, int, float * );
+net_t        *cascade_load      ( char * );
+boolean      cascade_save       ( net_t *, char * );
+
+/*  ensemble.c  */
+
+ensemble_t   *build_ensemble    ( net_t **, int, boolean, float, float );
+void         free_ensemble      ( ensemble_t ** );
+void         ensemble_forward   ( ensemble_t *, float **, int, float ** );
+trial_result_t test_ensemble    ( ensemble_t *, train_parm_t *,
+				  data_set_t * );
+
+/*  sweep.c  */
+
+void         sweep              ( char *, char * );
+boolean      read_sweep         ( sweep_t *, char * );
+boolean      make_configs       ( sweep_t * );
+void         *sweep_thread      ( void * );
+boolean      race_behind        ( race_t *, int, float );
+int          compare_configs    ( const void *, const void * );
+void         write_sweep        ( sweep_t *, FILE * );
+void         free_sweep         ( sweep_t * );
+
+/*  session.c  */
+
+session_table_t *build_sessions ( packed_net_t * );
+void         free_sessions      ( session_table_t ** );
+unsigned long session_hash      ( char * );
+session_t    *find_session      ( session_table_t *, char * );
+session_t    *open_session      ( session_table_t *, char * );
+session_t    *end_session       ( session_table_t *, char * );
+void         free_session       ( session_t ** );
+void         grow_sessions      ( session_table_t * );
+void         session_step       ( session_table_t *, session_t *, float *,
+				  float * );
 
 /*  cache.c  */
 
 boolean      build_cache        ( int, int, int, float ***, float *** );
 void         free_cache         ( float ***, float ***, int );
 void         compute_cache      ( int, data_set_t *, float ** );
-void         recompute_cache    ( int, net_t *, data_set_t *, float ** );
+int          recompute_cache    ( int, net_t *, data_set_t *, float ** );
+int          extend_cache       ( net_t *, data_set_t *, float **, int * );
 
 /*  interface.c  */
 
-void         cli                ( boolean );
-boolean      process_command    ( boolean, char *, char *, char * );
+void         cli                ( train_ctx_t * );
+boolean      process_command    ( train_ctx_t *, char *, char *, char * );
 int          find_key           ( char * );
 void         display_parm       ( parm_t );
 void         set_parm           ( boolean, parm_t, char *, char * );
 void         set_parmtable      ( train_parm_t * );
 
 void         train              ( char *, char * );
+void         adapt              ( char *, char * );
 void         test               ( char *, char * );
 void         predict            ( char *, char * );
 void         quit               ( char *, char * );
@@ -413,6 +1226,7 @@ void         list_parms         ( char *, char * );
 void         list_data          ( char *, char * );
 void         list_nets          ( char *, char * );
 void         run_trials         ( char *, char * );
+void         *trial_thread      ( void * );
 void         load_script        ( char *, char * );
 void         save_script        ( char *, char * );
 void         save_net           ( char *, char * );
@@ -426,29 +1240,79 @@ void         load_data          ( char *, char * );
 void         sync_net           ( char *, char * );
 
 void         print_cvrt         ( cvrt_t * );
+void         write_net          ( net_t *, FILE * );
+net_t        *read_net          ( FILE * );
 cvrt_t       read_map           ( FILE *, char * );
 
 void         trap_ctrl_c        ( int );
-void         handle_interrupt   ( train_data_t *, int );
+void         handle_interrupt   ( train_ctx_t * );
 
 /* display.c */
 
 void         display_banner            ( void );
-void         display_begin_trial       ( int, time_t );
-void         display_trainout_results  ( net_t *, error_data_t *, 
-					 status_t, error_t );
-void         display_validate_results  ( trial_result_t, error_t, float, int );
-void         display_traincand_results ( net_t *, train_data_t *, status_t ); 
+void         display_begin_trial       ( train_ctx_t *, int, time_t );
+void         display_trainout_results  ( train_ctx_t *, status_t );
+void         display_validate_results  ( train_ctx_t *, trial_result_t, float,
+					 int );
+void         display_traincand_results ( train_ctx_t *, status_t );
 void         display_trial_results     ( trial_result_t, int, boolean, 
 					 error_t, int, time_t );
 void         display_run_results       ( trial_result_t, int, error_t );
 void         display_test_results      ( trial_result_t );
+void         display_adapt_results     ( trial_result_t, int, float );
+void         display_quant_results     ( trial_result_t, trial_result_t,
+					 net_t *, int );
+void         display_prune_results     ( trial_result_t, trial_result_t,
+					 int, int, int, int );
+void         display_memo_results      ( net_t * );
+void         display_ensemble_results  ( trial_result_t, trial_result_t,
+					 int, boolean, int );
 
 /* query.c */
 
 void         query_net                 ( char *, char * );
-void         raw_input                 ( char * );
-void         token_input               ( char * );
+void         raw_input                 ( net_t *, infer_ctx_t *, char * );
+void         token_input               ( net_t *, infer_ctx_t *, char * );
+
+/* predict.c */
+
+void         predict_file              ( char *, char * );
+float        predict_classes           ( net_t *, data_set_t *, FILE * );
+void         *format_thread            ( void * );
+char         *put_float                ( char *, float );
+char         *put_tokens               ( char *, net_t *, float *, float );
+int          token_width               ( net_t * );
+
+/* export.c */
+
+void         export_c                  ( char *, char * );
+void         export_forward            ( FILE *, net_t *, char *, char * );
+void         export_sum                ( FILE *, float *, int );
+void         export_activation         ( FILE *, node_t, char * );
+void         export_maps               ( FILE *, net_t *, char * );
+int          export_map                ( FILE *, cvrt_t *, int, char *,
+					 char * );
+void         export_test               ( FILE *, net_t *, char *, char * );
+void         export_string             ( FILE *, char * );
+char         *ftoc                     ( char *, float );
+
+/* server.c */
+
+void         serve                     ( char *, char * );
+server_t     *build_server             ( char *, net_t **, int );
+void         free_server               ( server_t ** );
+void         serve_pass                ( server_t *, int );
+void         serve_accept              ( server_t * );
+void         serve_read                ( server_t *, serve_client_t * );
+void         serve_parse               ( server_t *, serve_client_t * );
+int          serve_line                ( server_t *, serve_req_t *, char *, int );
+int          serve_frame               ( server_t *, serve_req_t *, char *, int );
+void         serve_eval                ( server_t * );
+void         serve_steps               ( serve_net_t *, int, int );
+void         serve_reply               ( server_t *, serve_req_t * );
+void         serve_memo                ( server_t * );
+void         serve_flush               ( server_t *, serve_client_t * );
+void         serve_drop                ( server_t *, serve_client_t * );
 
 #endif
 
@@ -17,56 +17,50 @@
 
 /*	External Global Variable Declarations	*/
 
-extern net_t        *cNet;
-extern train_parm_t *cParms;
-extern train_data_t *cTData;
-extern data_set_t   *cDSet;
-extern error_data_t *cError;
-
-extern int          Noutputs,
-	            Ncand;
-extern boolean      recurrent,
-	            interruptPending;
-
-#ifdef CONNX
-extern int          connx;
-#endif
+extern boolean      interruptPending;
 
 
 /*	C2 TRAIN CAND -  Train a new pool of candidates.  Training continues
 	until either the maximum number of training epochs for a candidate pool
 	has been reached (TIMEOUT), or a specific number of epochs pass without
-	noticeable improvement (STAGNANT).  The results of training are
-	returned as the function's return value.
+	noticeable improvement (STAGNANT), or a validation epoch running
+	alongside finds that training is over (also STAGNANT).  The results
+	of training are returned as the function's return value.
 */
 
-status_t  c2_train_cand  ( void )
+status_t  c2_train_cand  ( train_ctx_t *tc )
 {
-  int   quitEpoch = 0,
-        i;
-  float backslide = -1.0e20,
-        target    = 0.0;
+  net_t        *net   = tc->net;
+  train_data_t *tData = tc->tData;
+  train_parm_t *parms = tc->parms;
+  int          quitEpoch = 0,
+               i;
+  float        backslide = -1.0e20,
+               target    = 0.0;
 
-  for  ( i = 0 ; i < cParms->candidateParm.epochs ; i++ )  {
-    c2_cand_epoch( );      /*  Train the cands for an epoch  */
+  for  ( i = 0 ; i < parms->candidateParm.epochs ; i++ )  {
+    c2_cand_epoch( tc );      /*  Train the cands for an epoch  */
 
-    adjust_ci_weights( );  /*  Adjust all the weights and find a favorite  */
-    adjust_co_weights( );  /* unit.  */
-    c2_find_best_cand( );
+    adjust_ci_weights( tc );  /*  Adjust all the weights and find a  */
+    adjust_co_weights( tc );  /* favorite unit.  */
+    c2_find_best_cand( tc );
 
-    cNet->epochsTrained++;
+    net->epochsTrained++;
 
-    if  ( interruptPending ) handle_interrupt( cTData, cDSet->Npts );
+    if  ( interruptPending ) handle_interrupt( tc );
+
+    if  ( atomic_load( &(tc->candCancel) ) )  /*  Validation has stagnated  */
+      return STAGNANT;
 
     /*  Check for stagnation  */
-    if  ( (cTData->candBestScore > target) || 
-	  (cTData->candBestScore < backslide) )  {
-      target    = cTData->candBestScore * 
-	          (cParms->candidateParm.changeThreshold+1);
-      backslide = cTData->candBestScore *
-	          (1-cParms->candidateParm.changeThreshold);
-      quitEpoch = cNet->epochsTrained + cParms->candidateParm.patience;
-    } else if  ( cNet->epochsTrained == quitEpoch )  {
+    if  ( (tData->candBestScore > target) || 
+	  (tData->candBestScore < backslide) )  {
+      target    = tData->candBestScore * 
+	          (parms->candidateParm.changeThreshold+1);
+      backslide = tData->candBestScore *
+	          (1-parms->candidateParm.changeThreshold);
+      quitEpoch = net->epochsTrained + parms->candidateParm.patience;
+    } else if  ( net->epochsTrained == quitEpoch )  {
       return STAGNANT;
     }
   }
@@ -81,31 +75,33 @@ status_t  c2_train_cand  ( void )
 	slopes and scores of each of the candidates.
 */
 
-void  c2_cand_epoch  ( void )
+void  c2_cand_epoch  ( train_ctx_t *tc )
 {
-  int i,j;
+  train_data_t *tData = tc->tData;
+  data_set_t   *dSet  = tc->dSet;
+  int          i,j;
 
   /*  Initialize for the epoch  */
-  for  ( i = 0 ; i < Ncand ; i++ )  {
-    cTData->candScores[i] = cError->sumSqDiffs;
-    if  ( recurrent )  {
-      cTData->candPrevValues[i] = 0.0;
-      for  ( j = 0 ; j < cNet->Nunits+1 ; j++ )
-	cTData->candDVdW[i][j] = 0.0;
+  for  ( i = 0 ; i < tc->Ncand ; i++ )  {
+    tData->candScores[i] = tc->error->sumSqDiffs;
+    if  ( tc->recurrent )  {
+      tData->candPrevValues[i] = 0.0;
+      for  ( j = 0 ; j < tc->net->Nunits+1 ; j++ )
+	tData->candDVdW[i][j] = 0.0;
     }
   }
 
   /*  Compute the epoch  */
-  for  ( i = 0 ; i < cDSet->Npts ; i++ )  {
-    if  ( cParms->useCache )  {
-      cNet->values   = cTData->valCache[i];
-      cError->errors = cTData->errCache[i];
+  for  ( i = 0 ; i < dSet->Npts ; i++ )  {
+    if  ( tc->parms->useCache )  {
+      tc->net->values   = tData->valCache[i];
+      tc->error->errors = tData->errCache[i];
     } else {
-      forward_pass( cDSet->data[i].inputs, cDSet->data[i].reset );
-      compute_error( cDSet->data[i].outputs, FALSE, FALSE, FALSE,
-	             cParms->scoreThreshold );
+      forward_pass( tc, dSet->data[i].inputs, dSet->data[i].reset );
+      compute_error( tc, &(dSet->data[i]), FALSE, FALSE, FALSE,
+	             tc->parms->scoreThreshold );
     }
-    c2_compute_slopes( cDSet->data[i].outputs, cDSet->data[i].reset );
+    c2_compute_slopes( tc, &(dSet->data[i]), dSet->data[i].reset );
   }
 }
 
@@ -121,83 +117,121 @@ void  c2_cand_epoch  ( void )
 	version.
 */
 
-void  c2_compute_slopes  ( float *goal, boolean reset )
+void  c2_compute_slopes  ( train_ctx_t *tc, dv_t *point, boolean reset )
 {
-  float sum,          /*  The unit's sum input  */
-        dsum,         /*  dVdW calculated for a point  */
-        dif,          /*  Difference between the unit's value and target  */
-        value,        /*  Computed activation for a unit  */
-        actPrime,     /*  Computed activation prime for a unit  */
-        errSum,       /*  The sum of the error prime collected over weights  */
-        weight,       /*  The weight in question  */
-        *cIWeights,   /*  Current In Weights  */
-        *cISlopes,    /*  Current In Slopes  */
-        *cOWeights,   /*  Current Out Weights  */
-        *cOSlopes,    /*  Current Out Slopes  */
-        goalDir,      /*  The direction the goal lies in  */
-        difDir;       /*  The direction our difference with the goal lies in */
-  int   i, j;
+  net_t        *net   = tc->net;
+  train_data_t *tData = tc->tData;
+  data_set_t   *dSet  = tc->dSet;
+  float        *values = net->values,       /*  Locals, so the loops  */
+               *errors = tc->error->errors, /* need not reload them   */
+               sum,       /*  The unit's sum input  */
+               dsum,      /*  dVdW calculated for a point  */
+               dif,       /*  Difference between the unit's value and  */
+                          /* target  */
+               value,     /*  Computed activation for a unit  */
+               actPrime,  /*  Computed activation prime for a unit  */
+               errSum,    /*  The sum of the error prime collected over  */
+                          /* weights  */
+               weight,    /*  The weight in question  */
+               *cIWeights,/*  Current In Weights  */
+               *cISlopes, /*  Current In Slopes  */
+               *cOWeights,/*  Current Out Weights  */
+               *cOSlopes, /*  Current Out Slopes  */
+               goalDir,   /*  The direction the goal lies in  */
+               difDir;    /*  The direction our difference with the goal  */
+                          /* lies in  */
+  int          Nunits      = net->Nunits,
+               Noutputs    = tc->Noutputs,
+               Ncand       = tc->Ncand,
+               recurrent   = tc->recurrent,
+               overshootOK = tc->parms->overshootOK,
+               i, j;
+#ifdef CONNX
+  int          connx       = 0;
+#endif
 
   for  ( i = 0 ; i < Ncand ; i++ )  {
     sum       = 0.0;                        /*  Initialize local variables  */
     errSum    = 0.0;
-    cOWeights = cTData->candOut.weights[i];
-    cOSlopes  = cTData->candOut.slopes[i];
-    cIWeights = cTData->candIn.weights[i];
-    cISlopes  = cTData->candIn.slopes[i];
+    cOWeights = tData->candOut.weights[i];
+    cOSlopes  = tData->candOut.slopes[i];
+    cIWeights = tData->candIn.weights[i];
+    cISlopes  = tData->candIn.slopes[i];
 
     /*  Compute the value of the unit  */
-    for  ( j = 0 ; j < cNet->Nunits ; j++ )
-      sum += cNet->values[j] * cIWeights[j];
+    for  ( j = 0 ; j < Nunits ; j++ )
+      sum += values[j] * cIWeights[j];
     if  ( recurrent && !reset )
-      sum += cTData->candPrevValues[i] * cIWeights[cNet->Nunits];
+      sum += tData->candPrevValues[i] * cIWeights[Nunits];
 #ifdef CONNX
-    connx += cNet->Nunits+recurrent;
+    connx += Nunits+recurrent;
 #endif
-    value    = activation( cTData->candTypes[i], sum );
-    actPrime = activation_prime( cTData->candTypes[i], value, sum);
+    value    = activation( net, tData->candTypes[i], sum );
+    actPrime = activation_prime( net, tData->candTypes[i], value, sum);
 
     /*  Compute the slopes for the outgoing weights  */
     for  ( j = 0 ; j < Noutputs ; j++ )  {
       weight  = cOWeights[j];
-      dif     = ( weight * value ) - cError->errors[j];
-      goalDir = ( goal[j] < 0.0 ) ? -1.0 : 1.0;
+      dif     = ( weight * value ) - errors[j];
+      goalDir = ( GOAL( dSet, point, j ) < 0.0 ) ? -1.0 : 1.0;
       difDir  = ( dif > 0.0 ) ? -1.0 : 1.0;
 
-      if  ( !( cParms->overshootOK && (goalDir == difDir) ) )  {
-	cTData->candScores[i] -= dif * dif;
+      if  ( !( overshootOK && (goalDir == difDir) ) )  {
+	tData->candScores[i] -= dif * dif;
 	cOSlopes[j]           += dif * value;
 	errSum                += dif * weight;
       }
+      if  ( tData->candLM )
+	tData->candJacob[Nunits+recurrent+j] =
+	  ( overshootOK && (goalDir == difDir) ) ? 0.0 : 1.0;
     }
     errSum *= actPrime;
 
     /*  First approximation of the slopes coming into the unit  */
-    for  ( j = 0 ; j < cNet->Nunits ; j++ )
-      cISlopes[j] += errSum * cNet->values[j];
+    for  ( j = 0 ; j < Nunits ; j++ )
+      cISlopes[j] += errSum * values[j];
 
     /*  Compute the influences of the recurrent connection  */
     if  ( recurrent )  {
-      for ( j = 0 ; j < cNet->Nunits ; j++ )  {
+      for ( j = 0 ; j < Nunits ; j++ )  {
 	if  ( reset )
-	  cTData->candDVdW[i][j] = 0.0;
-	dsum = actPrime * (cNet->values[j] + 
-			   (cIWeights[cNet->Nunits] * cTData->candDVdW[i][j]));
+	  tData->candDVdW[i][j] = 0.0;
+	dsum = actPrime * (values[j] + 
+			   (cIWeights[Nunits] * tData->candDVdW[i][j]));
 	cISlopes[j] += errSum * dsum;
-	cTData->candDVdW[i][j] = dsum;
+	tData->candDVdW[i][j] = dsum;
       }
 
       if  ( !reset )  {
-	dsum = actPrime * (cTData->candPrevValues[i] + 
-			   (cIWeights[cNet->Nunits] * 
-			    cTData->candDVdW[i][cNet->Nunits]));
-	cISlopes[cNet->Nunits] += errSum * dsum;
-	cTData->candDVdW[i][cNet->Nunits] = dsum;
+	dsum = actPrime * (tData->candPrevValues[i] + 
+			   (cIWeights[Nunits] * 
+			    tData->candDVdW[i][Nunits]));
+	cISlopes[Nunits] += errSum * dsum;
+	tData->candDVdW[i][Nunits] = dsum;
       }
       
-      cTData->candPrevValues[i] = value;
+      tData->candPrevValues[i] = value;
+
+      if  ( tData->candLM )  {
+	for  ( j = 0 ; j < Nunits ; j++ )
+	  tData->candJacob[j] = tData->candDVdW[i][j];
+	tData->candJacob[Nunits] = (reset) ? 0.0 :
+	                           tData->candDVdW[i][Nunits];
+      }
     }
+
+    /*  Levenberg-Marquardt trains the input and output weights together  */
+    if  ( tData->candLM )
+      lm_accumulate_c2( tc, tData->candHess[i], 
+			(recurrent) ? tData->candJacob : values,
+			Nunits+recurrent,
+			(recurrent) ? 1.0 : actPrime,
+			value, cOWeights,
+			tData->candJacob+Nunits+recurrent );
   }
+#ifdef CONNX
+  tc->connx += connx;
+#endif
 }
 
 
@@ -205,16 +239,17 @@ void  c2_compute_slopes  ( float *goal, boolean reset )
 	candidate with the best score.
 */
 
-void  c2_find_best_cand  ( void )
+void  c2_find_best_cand  ( train_ctx_t *tc )
 {
-  int i;
+  train_data_t *tData = tc->tData;
+  int          i;
 
-  cTData->candBestScore = cTData->candScores[0];
-  cTData->candBest      = 0;
+  tData->candBestScore = tData->candScores[0];
+  tData->candBest      = 0;
 
-  for  ( i = 1 ; i < Ncand ; i++ )
-    if  ( cTData->candScores[i] > cTData->candBestScore )  {
-      cTData->candBestScore = cTData->candScores[i];
-      cTData->candBest      = i;
+  for  ( i = 1 ; i < tc->Ncand ; i++ )
+    if  ( tData->candScores[i] > tData->candBestScore )  {
+      tData->candBestScore = tData->candScores[i];
+      tData->candBest      = i;
     }
 }
@@ -36,56 +36,56 @@
 
 /*	External Global Variable Declarations	*/
 
-extern net_t        *cNet;
-extern train_parm_t *cParms;
-extern train_data_t *cTData;
-extern data_set_t   *cDSet;
-extern error_data_t *cError;
-
-extern int          Noutputs,
-	            Ncand;
-extern boolean      recurrent,
-	            interruptPending;
-
-#ifdef CONNX
-extern int          connx;
-#endif
+extern boolean      interruptPending;
 
 /*	CASCOR TRAIN CAND -  Train a pool of candidate units using the
 	Cascade-Correlation algorithm.  Returns a value of TIMEOUT if 
-	'cParms->candidateParm.epochs' epochs elapse while the candidates are
+	'candidateParm.epochs' epochs elapse while the candidates are
 	still improving significantly (users should try to avoid this 
 	condition).  Otherwise, returns a value of STAGNANT whenever
-	'cParms->candidateParm.patience' epochs elapse without improvement in
-	the candidates.
+	'candidateParm.patience' epochs elapse without improvement in
+	the candidates, or as soon as a validation epoch running alongside
+	finds that training is over.
 */
 
-status_t cascor_train_cand  ( void )
+status_t cascor_train_cand  ( train_ctx_t *tc )
 {
-  float lastScore = 0.0;
-  int   quitEpoch = 0,
-        i,j,k;
-
-  for  ( i = 0 ; i < Noutputs ; i++ )
-    cError->sumErr[i] /= cDSet->Npts;
-  cascor_correlation_epoch( );
-  for  ( i = 1 ; i < cParms->candidateParm.epochs ; i++ )  {
-    cascor_cand_epoch( );
-    adjust_ci_weights( );
+  net_t        *net   = tc->net;
+  train_data_t *tData = tc->tData;
+  train_parm_t *parms = tc->parms;
+  float        lastScore = 0.0;
+  int          quitEpoch = 0,
+               i,j,k;
+
+  for  ( i = 0 ; i < tc->Noutputs ; i++ )
+    tc->error->sumErr[i] /= tc->dSet->Npts;
+  cascor_correlation_epoch( tc );
+  for  ( i = 1 ; i < parms->candidateParm.epochs ; i++ )  {
+    cascor_cand_epoch( tc );
+
+    /*  Levenberg-Marquardt needs the score of the weights it just tried  */
+    if  ( tData->candLM )  {
+      cascor_adjust_correlations( tc );
+      adjust_ci_weights( tc );
+    }  else  {
+      adjust_ci_weights( tc );
+      cascor_adjust_correlations( tc );
+    }
 
-    cascor_adjust_correlations( );
+    if  ( interruptPending ) handle_interrupt( tc );
 
-    if  ( interruptPending ) handle_interrupt( cTData, cDSet->Npts );
+    net->epochsTrained++;
 
-    cNet->epochsTrained++;
+    if  ( atomic_load( &(tc->candCancel) ) )  /*  Validation has stagnated  */
+      return STAGNANT;
 
     if  ( i == 1 )
-      lastScore = cTData->candBestScore;
-    else if  ( fabs( cTData->candBestScore - lastScore ) >
-               ( lastScore * cParms->candidateParm.changeThreshold ) )  {
-      quitEpoch = cNet->epochsTrained + cParms->candidateParm.patience;
-      lastScore = cTData->candBestScore;
-    } else if  ( cNet->epochsTrained == quitEpoch )
+      lastScore = tData->candBestScore;
+    else if  ( fabs( tData->candBestScore - lastScore ) >
+               ( lastScore * parms->candidateParm.changeThreshold ) )  {
+      quitEpoch = net->epochsTrained + parms->candidateParm.patience;
+      lastScore = tData->candBestScore;
+    } else if  ( net->epochsTrained == quitEpoch )
       return STAGNANT;
   }
 
@@ -100,24 +100,25 @@ status_t cascor_train_cand  ( void )
 	information, see the notes at the top of this file.
 */
 
-void cascor_correlation_epoch  ( void )
+void cascor_correlation_epoch  ( train_ctx_t *tc )
 {
-  int i;
+  data_set_t *dSet = tc->dSet;
+  int        i;
 
-  for  ( i = 0 ; i < cDSet->Npts ; i++ )  {
-    if  ( cParms->useCache )  {
-      cNet->values   = cTData->valCache[i];
-      cError->errors = cTData->errCache[i];
+  for  ( i = 0 ; i < dSet->Npts ; i++ )  {
+    if  ( tc->parms->useCache )  {
+      tc->net->values   = tc->tData->valCache[i];
+      tc->error->errors = tc->tData->errCache[i];
     } else {
-      forward_pass  ( cDSet->data[i].inputs, cDSet->data[i].reset );
-      compute_error ( cDSet->data[i].outputs, FALSE, FALSE, TRUE, 
-                      cParms->scoreThreshold );
+      forward_pass  ( tc, dSet->data[i].inputs, dSet->data[i].reset );
+      compute_error ( tc, &(dSet->data[i]), FALSE, FALSE, TRUE, 
+                      tc->parms->scoreThreshold );
     }
-    cascor_compute_correlations( cDSet->data[i].reset );
+    cascor_compute_correlations( tc, dSet->data[i].reset );
   }
 
-  cascor_adjust_correlations( );
-  cNet->epochsTrained++;
+  cascor_adjust_correlations( tc );
+  tc->net->epochsTrained++;
 }
 
 
@@ -127,36 +128,51 @@ void cascor_correlation_epoch  ( void )
 	the rest of the network have already been computed elsewhere.
 */
 
-void cascor_compute_correlations  ( boolean reset )
+void cascor_compute_correlations  ( train_ctx_t *tc, boolean reset )
 {
-  float sum,
-        val,
-        *cWeights,
-        *cCorr;
-  int   i, j;
+  net_t        *net      = tc->net;
+  train_data_t *tData    = tc->tData;
+  float        *values   = net->values,        /*  Locals, so the loops  */
+               *errors   = tc->error->errors,  /* need not reload them   */
+               sum,
+               val,
+               *cWeights,
+               *cCorr;
+  int          Nunits    = net->Nunits,
+               Noutputs  = tc->Noutputs,
+               Ncand     = tc->Ncand,
+               recurrent = tc->recurrent,
+               i, j;
+#ifdef CONNX
+  int          connx     = 0;
+#endif
 
   for  ( i = 0 ; i < Ncand ; i++ )  {
     sum        = 0.0;
-    cWeights   = cTData->candIn.weights[i];
-    cCorr      = cTData->candCorr[i];
+    cWeights   = tData->candIn.weights[i];
+    cCorr      = tData->candCorr[i];
 
-    for  ( j = 0 ; j < cNet->Nunits ; j++ )
-      sum += cWeights[j] * cNet->values[j];
+    for  ( j = 0 ; j < Nunits ; j++ )
+      sum += cWeights[j] * values[j];
 
     if  ( recurrent && !reset )
-      sum += cWeights[cNet->Nunits] * cTData->candPrevValues[i];
+      sum += cWeights[Nunits] * tData->candPrevValues[i];
 
 #ifdef CONNX
-    connx += cNet->Nunits+recurrent;
+    connx += Nunits+recurrent;
 #endif
 
-    val                    =  activation( cTData->candTypes[i], sum );
-    cTData->candValues[i]  =  val;
-    cTData->candSumVals[i] += val;
+    val                    =  activation( net, tData->candTypes[i],
+					      sum );
+    tData->candValues[i]  =  val;
+    tData->candSumVals[i] += val;
 
     for  ( j = 0 ; j < Noutputs ; j++ )
-      cCorr[j] += val * cError->errors[j];
+      cCorr[j] += val * errors[j];
   }
+#ifdef CONNX
+  tc->connx += connx;
+#endif
 }
 
 
@@ -166,20 +182,21 @@ void cascor_compute_correlations  ( boolean reset )
 	slopes and correlation values of each of the candidates.
 */
 
-void cascor_cand_epoch  ( void )
+void cascor_cand_epoch  ( train_ctx_t *tc )
 {
-  int i;
+  data_set_t *dSet = tc->dSet;
+  int        i;
 
-  for  ( i = 0 ; i < cDSet->Npts ; i++ )  {
-    if  ( cParms->useCache )  {
-      cNet->values   = cTData->valCache[i];
-      cError->errors = cTData->errCache[i];
+  for  ( i = 0 ; i < dSet->Npts ; i++ )  {
+    if  ( tc->parms->useCache )  {
+      tc->net->values   = tc->tData->valCache[i];
+      tc->error->errors = tc->tData->errCache[i];
     } else {
-      forward_pass( cDSet->data[i].inputs, cDSet->data[i].reset );
-      compute_error( cDSet->data[i].outputs, FALSE, FALSE, TRUE,
-	             cParms->scoreThreshold );
+      forward_pass( tc, dSet->data[i].inputs, dSet->data[i].reset );
+      compute_error( tc, &(dSet->data[i]), FALSE, FALSE, TRUE,
+	             tc->parms->scoreThreshold );
     }
-    cascor_compute_slopes( cDSet->data[i].reset );
+    cascor_compute_slopes( tc, dSet->data[i].reset );
   }
 }
 
@@ -195,77 +212,120 @@ void cascor_cand_epoch  ( void )
 	at 'neural-bench@cs.cmu.edu', so that I can modify the release version.
 */
 
-void cascor_compute_slopes ( boolean reset )
+void cascor_compute_slopes ( train_ctx_t *tc, boolean reset )
 {
-  float sum,
-        change,
-        value,
-        actPrime,
-        error,
-        direction,
-        *cWeights,
-        *cCorr,
-        *cPCorr,
-        *cSlopes;
-  int   i,j;
+  net_t        *net   = tc->net;
+  train_data_t *tData = tc->tData;
+  error_data_t *err   = tc->error;
+  float        *values     = net->values,  /*  Locals, so the loops  */
+               *errors     = err->errors,  /* need not reload them   */
+               *sumErr     = err->sumErr,
+               sumSqError  = err->sumSqError,
+               sum,
+               change,
+               value,
+               actPrime,
+               error,
+               direction,
+               resid,
+               *cWeights,
+               *cCorr,
+               *cPCorr,
+               *cSlopes;
+  int          Nunits    = net->Nunits,
+               Noutputs  = tc->Noutputs,
+               Ncand     = tc->Ncand,
+               recurrent = tc->recurrent,
+               i,j;
+#ifdef CONNX
+  int          connx     = 0;
+#endif
 
   for  ( i = 0 ; i < Ncand ; i++ )  {
     sum      = 0.0;
     change   = 0.0;
-    cWeights = cTData->candIn.weights[i];
-    cSlopes  = cTData->candIn.slopes[i];
-    cCorr    = cTData->candCorr[i];
-    cPCorr   = cTData->candPrevCorr[i];
+    cWeights = tData->candIn.weights[i];
+    cSlopes  = tData->candIn.slopes[i];
+    cCorr    = tData->candCorr[i];
+    cPCorr   = tData->candPrevCorr[i];
 
     /*  Comput the unit's activation value  */
-    for  ( j = 0 ; j < cNet->Nunits ; j++ )
-      sum += cNet->values[j] * cWeights[j];
+    for  ( j = 0 ; j < Nunits ; j++ )
+      sum += values[j] * cWeights[j];
     if  ( recurrent && !reset )
-      sum += cWeights[cNet->Nunits] * cTData->candPrevValues[i];
+      sum += cWeights[Nunits] * tData->candPrevValues[i];
 #ifdef CONNX
-    connx += cNet->Nunits+recurrent;
+    connx += Nunits+recurrent;
 #endif
-    value           = activation( cTData->candTypes[i], sum );
-    actPrime        = activation_prime( cTData->candTypes[i], value, sum );
-    cTData->candSumVals[i] += value;
+    value           = activation( net, tData->candTypes[i], sum );
+    actPrime        = activation_prime( net, tData->candTypes[i], value,
+					sum );
+    tData->candSumVals[i] += value;
+
+    if  ( tData->candLM && !recurrent )  {
+      lm_accumulate( tData->candHess[i], values, Nunits,
+		     actPrime * actPrime / sumSqError );
+#ifdef CONNX
+      connx += Nunits * (Nunits+1) / 2;
+#endif
+    }
 
     if ( !recurrent )
-      actPrime        /= cError->sumSqError;
+      actPrime        /= sumSqError;
 
     /*  Compute correlations  */
+    resid = 0.0;
     for  ( j = 0 ; j < Noutputs ; j++ )  {
-      error          = cError->errors[j];
+      error          = errors[j];
       direction      = ( cPCorr[j] < 0.0 ) ? -1.0 : 1.0;
       change         -= direction * 
-	((recurrent) ? ((error-cError->sumErr[j])/cError->sumSqError) :
-		       actPrime * (error - cError->sumErr[j]));
+	((recurrent) ? ((error-sumErr[j])/sumSqError) :
+		       actPrime * (error - sumErr[j]));
       cCorr[j]       += error * value;
+      resid          += direction * (error - sumErr[j]);
     }
+    if  ( tData->candLM )
+      tData->candResSq[i] += resid * resid;
 
     /*  Compute slopes for recurrent networks  */
     if ( recurrent )  {
-      for  ( j = 0 ; j < cNet->Nunits ; j++ )  {
-	if  ( reset )  cTData->candDVdW[i][j] = 0.0;
-	sum          =  actPrime * (cNet->values[j] + 
-				    (cTData->candIn.weights[i][cNet->Nunits] * 
-				     cTData->candDVdW[i][j]));
+      for  ( j = 0 ; j < Nunits ; j++ )  {
+	if  ( reset )  tData->candDVdW[i][j] = 0.0;
+	sum          =  actPrime * (values[j] + 
+				    (tData->candIn.weights[i][Nunits] * 
+				     tData->candDVdW[i][j]));
 	cSlopes[j]   += change * sum;
-	cTData->candDVdW[i][j] =  sum;
+	tData->candDVdW[i][j] =  sum;
       }
       
       if  ( !reset )  {
-	sum          =  actPrime * (cTData->candPrevValues[i] + 
-			           (cTData->candIn.weights[i][cNet->Nunits] * 
-				     cTData->candDVdW[i][cNet->Nunits]));
-	cSlopes[cNet->Nunits]   += change * sum;
-	cTData->candDVdW[i][cNet->Nunits] =  sum;
+	sum          =  actPrime * (tData->candPrevValues[i] + 
+			           (tData->candIn.weights[i][Nunits] * 
+				     tData->candDVdW[i][Nunits]));
+	cSlopes[Nunits]   += change * sum;
+	tData->candDVdW[i][Nunits] =  sum;
+      }
+      tData->candPrevValues[i] = value;
+
+      if  ( tData->candLM )  {
+	for  ( j = 0 ; j < Nunits ; j++ )
+	  tData->candJacob[j] = tData->candDVdW[i][j];
+	tData->candJacob[Nunits] = (reset) ? 0.0 :
+	                           tData->candDVdW[i][Nunits];
+	lm_accumulate( tData->candHess[i], tData->candJacob,
+		       Nunits+1, 1.0 / sumSqError );
+#ifdef CONNX
+	connx += (Nunits+1) * (Nunits+2) / 2;
+#endif
       }
-      cTData->candPrevValues[i] = value;
     }  else  
       /*  Compute slopes for non-recurrent networks  */
-      for  ( j = 0 ; j < cNet->Nunits ; j++ )
-	cSlopes[j] += change * cNet->values[j];
+      for  ( j = 0 ; j < Nunits ; j++ )
+	cSlopes[j] += change * values[j];
   }
+#ifdef CONNX
+  tc->connx += connx;
+#endif
 }
 
 
@@ -275,39 +335,40 @@ void cascor_compute_slopes ( boolean reset )
 	round.  Note which unit has the best total score to date.
 */
 
-void cascor_adjust_correlations  ( void )
+void cascor_adjust_correlations  ( train_ctx_t *tc )
 {
-  float aveValue,
-        score,
-        correlation,
-        *cCorr,
-        *cPCorr;
-  int   i,j;
-
-  cTData->candBest      = 0;
-  cTData->candBestScore = 0.0;
-
-  for  ( i = 0 ; i < Ncand ; i++ )  {
-    aveValue = cTData->candSumVals[i] / cDSet->Npts;
+  train_data_t *tData = tc->tData;
+  float        aveValue,
+               score,
+               correlation,
+               *cCorr,
+               *cPCorr;
+  int          i,j;
+
+  tData->candBest      = 0;
+  tData->candBestScore = 0.0;
+
+  for  ( i = 0 ; i < tc->Ncand ; i++ )  {
+    aveValue = tData->candSumVals[i] / tc->dSet->Npts;
     score    = 0.0;
-    cCorr    = cTData->candCorr[i];
-    cPCorr   = cTData->candPrevCorr[i];
+    cCorr    = tData->candCorr[i];
+    cPCorr   = tData->candPrevCorr[i];
 
     /*  Adjust correlations  */
-    for  ( j = 0 ; j < Noutputs ; j++ )  {
-      correlation = ( cCorr[j] - aveValue * cError->sumErr[j] ) /
-	            cError->sumSqError;
+    for  ( j = 0 ; j < tc->Noutputs ; j++ )  {
+      correlation = ( cCorr[j] - aveValue * tc->error->sumErr[j] ) /
+	            tc->error->sumSqError;
       cPCorr[j]   = correlation;
       cCorr[j]    = 0.0;
       score       += fabs( correlation );
     }
 
     /*  Find the best unit of the bunch  */
-    cTData->candSumVals[i]  = 0.0;
-    cTData->candScores[i] = score;
-    if  ( score > cTData->candBestScore )  {
-      cTData->candBest      = i;
-      cTData->candBestScore = score;
+    tData->candSumVals[i]  = 0.0;
+    tData->candScores[i] = score;
+    if  ( score > tData->candBestScore )  {
+      tData->candBest      = i;
+      tData->candBestScore = score;
     }
   }
 }
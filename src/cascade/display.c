@@ -18,45 +18,46 @@
 #include "toolkit.h"
 
 
-#ifdef CONNX
-extern int connx;
-#endif
-
 #define LOG_PRINT(...) log_print(__FILE__, __LINE__, __VA_ARGS__ )
 
 
-FILE *fp ;
 static int SESSION_TRACKER; //Keeps track of session
-
-net_t        *cNet;
-data_file_t   *cDFile;
+static pthread_mutex_t logLock = PTHREAD_MUTEX_INITIALIZER; //Shared by runs
 
 char* print_time()
 {
     time_t t;
-    char *buf;
+    char *buf, now[32];
+    size_t len;
 
     time(&t);
-    buf = (char*)malloc(strlen(ctime(&t))+ 1);
+    ctime_r(&t, now);
+    len = strcspn(now, "\n");      /* ctime ends the date with a newline */
+    buf = (char*)malloc(len + 1);
 
-    snprintf(buf,strlen(ctime(&t)),"%s ", ctime(&t));
+    memcpy(buf, now, len);
+    buf[len] = '\0';
 
     return buf;
 }
 void log_print(char* filename, char *fmt,...)
 {
+    FILE            *fp;
     va_list         list;
     char            *p, *r;
     int             e;
     long long int   a;
     double          b;
 
+    pthread_mutex_lock(&logLock);
     if(SESSION_TRACKER > 0)
       fp = fopen (filename,"a+");
     else
       fp = fopen (filename,"w");
 
-    fprintf(fp,"%s ",print_time());
+    p = print_time();
+    fprintf(fp,"%s ",p);
+    free(p);
     va_start( list, fmt );
 
     for ( p = fmt ; *p ; ++p )
@@ -114,6 +115,7 @@ void log_print(char* filename, char *fmt,...)
     fputc( '\n', fp );
     SESSION_TRACKER++;
     fclose(fp);
+    pthread_mutex_unlock(&logLock);
 }
 
 /*  DISPLAY BANNER -  Prints out the program's welcome banner.
@@ -135,9 +137,12 @@ void display_banner  ( void )
 /*  DISPLAY BEGIN TRIAL -  Displays information about beginning a trial
 */
 
-void display_begin_trial  ( int trialNum, time_t startTime )
+void display_begin_trial  ( train_ctx_t *tc, int trialNum, time_t startTime )
 {
-  printf("\n\n %s Trial %d begun at %s\n", cNet->name, trialNum, ctime( &startTime ));
+  char when[32];
+
+  printf("\n\n %s Trial %d begun at %s\n", tc->net->name, trialNum,
+	 ctime_r( &startTime, when ));
   log_print("log.txt","floating number %f ", (double) 88.33);
 }
 
@@ -146,10 +151,12 @@ void display_begin_trial  ( int trialNum, time_t startTime )
     phase.
 */
 
-void display_trainout_results  ( net_t *net, error_data_t *err, 
-				 status_t stat, error_t measure )
+void display_trainout_results  ( train_ctx_t *tc, status_t stat )
 {
-  int i, j;
+  net_t        *net    = tc->net;
+  error_data_t *err    = tc->error;
+  error_t      measure = tc->parms->errorMeasure;
+  int          i, j;
   /*char logfilename[80];
   strcpy(logfilename, cNet->name);
   strcat(logfilename, "_train_log.txt");*/
@@ -157,7 +164,7 @@ void display_trainout_results  ( net_t *net, error_data_t *err,
   printf  ("\n  End Output Training Cycle (%s)\n", stoa( stat ) );
   printf  ("    Epoch: %d", net->epochsTrained);
 #ifdef CONNX
-  printf  ("\t\tConnection crossings: %d\n",connx );
+  printf  ("\t\tConnection crossings: %d\n", tc->connx );
 #else
   printf  ("\n");
 #endif
@@ -190,11 +197,14 @@ void display_trainout_results  ( net_t *net, error_data_t *err,
 /*  DISPLAY VALIDATE RESULTS -  Display the results from the validation epoch.
 */
 
-void display_validate_results  ( trial_result_t res, error_t measure,
+void display_validate_results  ( train_ctx_t *tc, trial_result_t res,
 				 float bestErr, int passesLeft)
 {
+  net_t       *net    = tc->net;
+  data_file_t *dFile  = tc->dFile;
+  error_t     measure = tc->parms->errorMeasure;
   char logfilename[80];
-  strcpy(logfilename, cNet->name);
+  strcpy(logfilename, net->name);
   strcat(logfilename, "_val_log.txt");
   printf  ("  Validation Epoch \n");
   if  ( measure == BITS )
@@ -208,29 +218,30 @@ void display_validate_results  ( trial_result_t res, error_t measure,
 	   res.sumSqError);
   printf  ("    Best sum sq error: %.3f\tPasses until stagnation: %d\n\n",
 	   bestErr, passesLeft);
-  float outVals           = (cDFile->validate->Npts) * (cNet->Noutputs);
+  float outVals           = (dFile->validate->Npts) * (net->Noutputs);
   double error_bits_per = (((float)(outVals-res.bits))/outVals)*100.0;
-  double error_count_per = (((float)(cDFile->validate->Npts-res.error_count))/cDFile->validate->Npts)*100.0;
+  double error_count_per = (((float)(dFile->validate->Npts-res.error_count))/dFile->validate->Npts)*100.0;
 
-  log_print(logfilename, "\t%d\t%d\t%f\t%f\t%l", cNet->epochsTrained, cNet->Nunits - 784 - 1,
-		    error_bits_per, error_count_per,connx);
+  log_print(logfilename, "\t%d\t%d\t%f\t%f\t%l", net->epochsTrained, net->Nunits - 784 - 1,
+		    error_bits_per, error_count_per, (long long)tc->connx);
 }
 
 
 /*  DISPLAY TRAINCAND RESULTS -  Display the results from candidate training.
 */
 
-void display_traincand_results ( net_t *net, train_data_t *tData, 
-				 status_t stat )
+void display_traincand_results ( train_ctx_t *tc, status_t stat )
 {
+  net_t        *net   = tc->net;
+  train_data_t *tData = tc->tData;
   int i = 0;
   char logfilename[80];
-  strcpy(logfilename, cNet->name);
+  strcpy(logfilename, net->name);
   strcat(logfilename, "_cand_score_log.txt");
   printf  ("  End Candidate Training Cycle (%s)\n", stoa( stat ));
   printf  ("    Epoch: %d", net->epochsTrained);
 #ifdef CONNX
-  printf  ("\t\tConnection crossings: %d\n", connx );
+  printf  ("\t\tConnection crossings: %d\n", tc->connx );
 #else
   printf  ("\n");
 #endif
@@ -238,6 +249,9 @@ void display_traincand_results ( net_t *net, train_data_t *tData,
   printf  ("    Adding unit: %d\tUnit type: %s\tScore: %8.3f\n",
 	   tData->candBest, ntoa( net->unitTypes[net->Nunits-1] ),
 	   tData->candBestScore);
+  if  ( tData->Narms > 0 )
+    printf  ("    Candidate epsilon: %.3f\tmu: %.3f\n",
+	     tData->candEpsilon[tData->candBest], tData->candMu[tData->candBest]);
 
   printf  ("    Unit %2d:  ", net->Nunits);
   log_print(logfilename, "\t%f", tData->candBestScore);
@@ -259,6 +273,8 @@ void display_traincand_results ( net_t *net, train_data_t *tData,
 void display_trial_results  ( trial_result_t res, int trialNum, boolean test, 
 			      error_t measure, int Ninputs, time_t endTime )
 {
+  char when[32];
+
   printf ("  End Trial Results\n");
   printf ("    Epochs: %d\tAverage epoch time: %.2f sec (%.2f epochs/sec)\n",
 	  res.Nepochs, ((float)res.time)/res.Nepochs, 
@@ -285,7 +301,7 @@ void display_trial_results  ( trial_result_t res, int trialNum, boolean test,
   else
     printf ("                      Error index: %.2f\n", res.index);
 
-  printf ("\nTrial %d ended at %s\n\n", trialNum, ctime( &endTime ) );
+  printf ("\nTrial %d ended at %s\n\n", trialNum, ctime_r( &endTime, when ) );
 }
 
 
@@ -334,3 +350,115 @@ void display_test_results  ( trial_result_t res )
 }
  
 
+
+/*  DISPLAY ADAPT RESULTS -  Display the results from online adaptation.  The
+    errors are those made on each point just before it was learned.
+*/
+
+void display_adapt_results  ( trial_result_t res, int Npts, float usecs )
+{
+  printf ("Adaptation Results\n");
+  printf ("  Points: %d\t\tTime per point: %.2f usec\n", Npts, usecs);
+  printf ("  Sum sq diffs: %.3f\tSum sq error: %.3f\n", res.sumSqDiffs,
+	  res.sumSqError);
+  printf ("  Error bits: %d\t\tPercent correct: %.2f\n",
+	    res.bits, res.perCorrect);
+  printf ("  Error count: %d\n", res.error_count);
+}
+
+
+
+/*  DISPLAY QUANT RESULTS -  Display the results of a network on test data
+    with its float weights and with its quantized copy, and the size of
+    the weights each way.
+*/
+
+void display_quant_results  ( trial_result_t floatRes, trial_result_t quantRes,
+			      net_t *net, int quantBytes )
+{
+  int floatBytes,
+      i;
+
+  floatBytes = net->Noutputs * net->Nunits;
+  for  ( i = net->Ninputs+1 ; i < net->Nunits ; i++ )
+    floatBytes += i + net->recurrent;
+  floatBytes *= sizeof( float );
+
+  printf ("Quantization Results\n");
+  printf ("  Weights: %d bytes as float, %d bytes quantized (%.1fx smaller)\n",
+	  floatBytes, quantBytes, (float)floatBytes / quantBytes);
+  printf ("  Error bits: %d float, %d quantized (%+d)\n", floatRes.bits,
+	  quantRes.bits, quantRes.bits - floatRes.bits);
+  printf ("  Percent correct: %.2f float, %.2f quantized (%+.2f)\n",
+	  floatRes.perCorrect, quantRes.perCorrect,
+	  quantRes.perCorrect - floatRes.perCorrect);
+  printf ("  Error index: %.4f float, %.4f quantized (%+.4f)\n",
+	  floatRes.index, quantRes.index, quantRes.index - floatRes.index);
+}
+
+
+/*  DISPLAY PRUNE RESULTS -  Display the size and error of a network before
+    and after pruning.
+*/
+
+void display_prune_results  ( trial_result_t before, trial_result_t after,
+			      int unitsBefore, int unitsAfter,
+			      int weightsBefore, int weightsAfter )
+{
+  printf ("Pruning Results\n");
+  printf ("  Hidden units: %d before, %d after\n", unitsBefore, unitsAfter);
+  printf ("  Nonzero weights: %d before, %d after (%.1fx fewer)\n",
+	  weightsBefore, weightsAfter, (float)weightsBefore / weightsAfter);
+  printf ("  Error bits: %d before, %d after (%+d)\n", before.bits,
+	  after.bits, after.bits - before.bits);
+  printf ("  Percent correct: %.2f before, %.2f after (%+.2f)\n",
+	  before.perCorrect, after.perCorrect,
+	  after.perCorrect - before.perCorrect);
+  printf ("  Error index: %.4f before, %.4f after (%+.4f)\n",
+	  before.index, after.index, after.index - before.index);
+}
+
+
+/*  DISPLAY MEMO RESULTS -  Display how often the cached query results of a
+    network answered its queries.  Nothing is shown for a network without
+    a cache.
+*/
+
+void display_memo_results  ( net_t *net )
+{
+  long lookups;
+
+  if  ( net->memo == NULL )
+    return;
+
+  lookups = net->memo->hits + net->memo->misses;
+  printf ("Result cache for '%s': %ld hits, %ld misses (%.1f%% hits), "
+	  "%d of %d entries used\n", net->name, net->memo->hits,
+	  net->memo->misses,
+	  ( lookups > 0 ) ? 100.0 * net->memo->hits / lookups : 0.0,
+	  net->memo->Nentries, net->memo->maxEntries);
+}
+
+
+/*  DISPLAY ENSEMBLE RESULTS -  Display the results of the networks of a run
+    tested as an ensemble, beside those of the average trial.  'run' holds
+    the results of the trials summed, as for DISPLAY RUN RESULTS.
+*/
+
+void display_ensemble_results  ( trial_result_t ens, trial_result_t run,
+				 int Ntrials, boolean vote, int Npts )
+{
+  printf ("Ensemble Results\n");
+  printf ("  %d networks, %s\n", Ntrials,
+	  ( vote ) ? "voting by class" : "outputs averaged");
+  printf ("  Sum sq diffs: %.3f (ave trial %.3f)\n", ens.sumSqDiffs,
+	  run.sumSqDiffs/Ntrials);
+  printf ("  Error bits: %d (ave trial %.1f)\n", ens.bits,
+	  ((float)run.bits)/Ntrials);
+  printf ("  Percent correct: %.2f (ave trial %.2f)\n", ens.perCorrect,
+	  run.perCorrect/Ntrials);
+  printf ("  Error index: %.4f (ave trial %.4f)\n", ens.index,
+	  run.index/Ntrials);
+  printf ("  Points misclassified: %d of %d\n", ens.error_count, Npts);
+  printf ("\n\n");
+}
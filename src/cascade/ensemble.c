@@ -0,0 +1,316 @@
+/*	CMU Cascade Neural Network Simulator (CNNS)
+	Ensemble inference code
+
+	These routines evaluate several networks trained on the same data as
+	one, either averaging their outputs or letting each vote for the
+	class of its largest output.  With 'keepTrials' set, 'runTrials'
+	keeps the network of every trial and reports how the ensemble of
+	them does against the average trial (see interface.c).
+
+	The members share everything that depends only on the inputs.  The
+	bias and input weights of every hidden unit and output of every
+	member are gathered into one matrix, which is run over a batch of
+	inputs in a single pass, much as 'packed_forward' runs one unit (see
+	packed.c).  Each member then only adds in the weights from its own
+	hidden units, starting from those sums.  A member gives the same
+	outputs this way as it would alone.
+
+	Only feed-forward networks with the same inputs and outputs can be
+	members.  An ensemble keeps its own packed copy of each member, and
+	scores with the output types of the first one's copy, so the
+	networks themselves may change or go away once it is built.
+*/
+
+#include <math.h>
+#include <string.h>
+
+#include "toolkit.h"
+#include "cascade.h"
+
+#define PACK_WIDTH ( PACK_ALIGN / sizeof( float ) )  /*  Floats per row   */
+                                                     /* alignment         */
+
+/*	BUILD ENSEMBLE -  Build an ensemble of 'N' networks.  If 'vote' is
+	set, each member votes for a class, and the outputs of the ensemble
+	for a point are the share of the votes each class got, scaled from
+	'hardNeg' (none) to 'hardPos' (all).  Otherwise the outputs are the
+	average of the members'.  Returns NULL if the networks cannot be
+	evaluated together.
+*/
+
+ensemble_t *build_ensemble  ( net_t **nets, int N, boolean vote,
+			      float hardPos, float hardNeg )
+{
+  ensemble_t   *temp;
+  packed_net_t *packed;
+  float        *row,
+               *src;
+  int          len,
+               r, i, j, m;
+  char         *fn = "Build Ensemble";
+
+  for  ( m = 0 ; m < N ; m++ )
+    if  ( nets[m]->recurrent )  {
+      fprintf ( stderr, "Recurrent network '%s' cannot be in an ensemble.\n",
+		nets[m]->name );
+      return NULL;
+    } else if  ( (nets[m]->Ninputs != nets[0]->Ninputs) ||
+		 (nets[m]->Noutputs != nets[0]->Noutputs) )  {
+      fprintf ( stderr, "Network '%s' does not match '%s' in its inputs or "
+		"outputs.\n", nets[m]->name, nets[0]->name );
+      return NULL;
+    }
+
+  temp = (ensemble_t *)alloc_mem( 1, sizeof( ensemble_t ), fn );
+  temp->Nmembers = N;
+  temp->Ninputs  = nets[0]->Ninputs;
+  temp->Noutputs = nets[0]->Noutputs;
+  temp->vote     = vote;
+  temp->hardPos  = hardPos;
+  temp->hardNeg  = hardNeg;
+  temp->inStride = ( (temp->Ninputs+1 + PACK_WIDTH-1) / PACK_WIDTH ) *
+                   PACK_WIDTH;
+
+  /*  Pack the members, giving each a run of rows: its hidden units,  */
+  /* then its outputs.                                                */
+  temp->members  = (packed_net_t **)alloc_mem( N, sizeof( packed_net_t * ),
+					       fn );
+  temp->firstRow = (int *)alloc_mem( N, sizeof( int ), fn );
+  temp->Nrows    = 0;
+  temp->maxUnits = 0;
+  for  ( m = 0 ; m < N ; m++ )  {
+    temp->members[m]  = pack_net( nets[m] );
+    temp->firstRow[m] = temp->Nrows;
+    temp->Nrows      += nets[m]->Nunits - nets[m]->Ninputs-1 + temp->Noutputs;
+    if  ( nets[m]->Nunits > temp->maxUnits )
+      temp->maxUnits = nets[m]->Nunits;
+  }
+
+  /*  Gather the bias and input weights of every row  */
+  temp->inWeights = pack_alloc( temp->Nrows * temp->inStride,
+				&(temp->block), fn );
+  for  ( m = 0 ; m < N ; m++ )  {
+    packed = temp->members[m];
+    r      = temp->firstRow[m];
+    for  ( i = packed->Ninputs+1 ; i < packed->Nunits + temp->Noutputs ;
+	   i++, r++ )  {
+      row = temp->inWeights + r * temp->inStride;
+      src = packed_row( packed, i, &len );
+      for  ( j = 0 ; j < temp->inStride ; j++ )
+	row[j] = ( j <= temp->Ninputs ) ? src[j] : 0.0;
+    }
+  }
+
+  temp->inSums    = pack_alloc( temp->Nrows * PACK_BATCH,
+				&(temp->sumBlock), fn );
+  temp->work      = pack_alloc( temp->maxUnits * PACK_BATCH,
+				&(temp->workBlock), fn );
+  temp->outValues = (float *)alloc_mem( PACK_BATCH * temp->Noutputs,
+					sizeof( float ), fn );
+
+  return temp;
+}
+
+
+/*	FREE ENSEMBLE -  Deallocate an ensemble.  The member networks are
+	left alone.
+*/
+
+void free_ensemble  ( ensemble_t **ens )
+{
+  int m;
+
+  if  ( *ens == NULL )
+    return;
+
+  for  ( m = 0 ; m < (*ens)->Nmembers ; m++ )
+    free_packed( &((*ens)->members[m]) );
+  (*ens)->members   = free_mem( (*ens)->members );
+  (*ens)->firstRow  = free_mem( (*ens)->firstRow );
+  (*ens)->block     = free_mem( (*ens)->block );
+  (*ens)->sumBlock  = free_mem( (*ens)->sumBlock );
+  (*ens)->workBlock = free_mem( (*ens)->workBlock );
+  (*ens)->outValues = free_mem( (*ens)->outValues );
+  *ens = free_mem( *ens );
+}
+
+
+/*	ENSEMBLE FORWARD -  Evaluate a batch of 'B' points, at most
+	PACK_BATCH, with an ensemble, storing the outputs of the ensemble
+	for each point in 'outputs'.  The batch is laid out as for
+	'packed_forward'.  An ensemble has a single set of scratch space, so
+	it is evaluated by one thread at a time.
+*/
+
+void ensemble_forward  ( ensemble_t *ens, float **inputs, int B,
+			 float **outputs )
+{
+  packed_net_t *packed;
+  float        sums[PACK_BATCH],
+               *row,
+               *src,
+               *dst,
+               *work = ens->work,
+               weight;
+  node_t       type;
+  int          *index,
+               first,        /*  First weight from a hidden unit  */
+               len, n, r, i, j, k, m, b;
+
+  /*  The bias and the inputs, shared by every member  */
+  for  ( b = 0 ; b < PACK_BATCH ; b++ )
+    work[b] = BIAS;
+  for  ( i = 1 ; i <= ens->Ninputs ; i++ )  {
+    dst = work + i*PACK_BATCH;
+    for  ( b = 0 ; b < B ; b++ )
+      dst[b] = inputs[b][i-1];
+    for  ( ; b < PACK_BATCH ; b++ )
+      dst[b] = 0.0;
+  }
+
+  /*  The input part of the sum of every row of every member  */
+  for  ( r = 0 ; r < ens->Nrows ; r++ )  {
+    row = ens->inWeights + r * ens->inStride;
+    dst = ens->inSums + r * PACK_BATCH;
+    for  ( b = 0 ; b < PACK_BATCH ; b++ )
+      dst[b] = 0.0;
+    for  ( j = 0 ; j <= ens->Ninputs ; j++ )  {
+      weight = row[j];
+      src    = work + j*PACK_BATCH;
+      for  ( b = 0 ; b < PACK_BATCH ; b++ )
+	dst[b] += weight * src[b];
+    }
+  }
+
+  for  ( b = 0 ; b < B ; b++ )
+    for  ( k = 0 ; k < ens->Noutputs ; k++ )
+      outputs[b][k] = 0.0;
+
+  /*  Each member adds the weights from its own hidden units.  The input  */
+  /* rows of 'work' are left alone, so the members take turns with the    */
+  /* rest of it.                                                          */
+  for  ( m = 0 ; m < ens->Nmembers ; m++ )  {
+    packed = ens->members[m];
+    r      = ens->firstRow[m];
+    for  ( i = packed->Ninputs+1 ; i < packed->Nunits + ens->Noutputs ;
+	   i++, r++ )  {
+      row = packed_row( packed, i, &len );
+      src = ens->inSums + r * PACK_BATCH;
+      for  ( b = 0 ; b < PACK_BATCH ; b++ )
+	sums[b] = src[b];
+
+      if  ( (n = packed->nzCount[i]) < 0 )
+	for  ( j = ens->Ninputs+1 ; j < len ; j++ )  {
+	  weight = row[j];
+	  src    = work + j*PACK_BATCH;
+	  for  ( b = 0 ; b < PACK_BATCH ; b++ )
+	    sums[b] += weight * src[b];
+	}
+      else  {
+	index = packed->nzIndex + packed->nzStart[i];
+	for  ( first = 0 ; (first < n) && (index[first] <= ens->Ninputs) ;
+	       first++ )
+	  ;
+	for  ( j = first ; j < n ; j++ )  {
+	  weight = row[index[j]];
+	  src    = work + index[j]*PACK_BATCH;
+	  for  ( b = 0 ; b < PACK_BATCH ; b++ )
+	    sums[b] += weight * src[b];
+	}
+      }
+
+      if  ( i < packed->Nunits )  {
+	type = packed->unitTypes[i];
+	dst  = work + i*PACK_BATCH;
+	for  ( b = 0 ; b < B ; b++ )
+	  dst[b] = packed_activation( packed, type, sums[b] );
+	for  ( ; b < PACK_BATCH ; b++ )
+	  dst[b] = 0.0;
+      }  else  {
+	k    = i - packed->Nunits;
+	type = packed->outputTypes[k];
+	for  ( b = 0 ; b < B ; b++ )
+	  ens->outValues[b*ens->Noutputs + k] =
+	    packed_activation( packed, type, sums[b] );
+      }
+    }
+
+    /*  Add the member's say to the outputs  */
+    for  ( b = 0 ; b < B ; b++ )  {
+      dst = ens->outValues + b*ens->Noutputs;
+      if  ( packed->softmax )
+	softmax_outputs( dst, packed->outputTypes, ens->Noutputs );
+      if  ( ens->vote )  {
+	k = class_of( dst, ens->Noutputs );
+	for  ( j = 0 ; j < ens->Noutputs ; j++ )
+	  outputs[b][j] += ( j == k ) ? ens->hardPos : ens->hardNeg;
+      }  else
+	for  ( j = 0 ; j < ens->Noutputs ; j++ )
+	  outputs[b][j] += dst[j];
+    }
+  }
+
+  for  ( b = 0 ; b < B ; b++ )
+    for  ( k = 0 ; k < ens->Noutputs ; k++ )
+      outputs[b][k] /= ens->Nmembers;
+}
+
+
+/*	TEST ENSEMBLE -  Test an ensemble on a data set, as 'test_net' tests
+	a network with 'parms'.  The outputs are scored against the types of
+	the first member's outputs, as its packed copy has them, and with the
+	same threshold for bits as 'test_net'.
+*/
+
+trial_result_t test_ensemble  ( ensemble_t *ens, train_parm_t *parms,
+				data_set_t *dSet )
+{
+  error_data_t   *err;
+  trial_result_t result;
+  net_t          scorer;	/*  Stands in for the first member  */
+  float          *inputs[PACK_BATCH],
+                 *outputs[PACK_BATCH],
+                 *block;
+  int            outVals,
+                 B, i, j;
+  char           *fn = "Test Ensemble";
+
+  memset( &scorer, 0, sizeof( net_t ) );
+  scorer.Noutputs    = ens->Noutputs;
+  scorer.outputTypes = ens->members[0]->outputTypes;
+  scorer.sigmoidMax  = ens->members[0]->sigMax;
+  scorer.sigmoidMin  = ens->members[0]->sigMin;
+
+  err = build_error_data( &scorer );
+  init_error( err, ens->Noutputs );
+  result.error_count = 0;
+
+  block = (float *)alloc_mem( PACK_BATCH * ens->Noutputs, sizeof( float ),
+			      fn );
+  for  ( j = 0 ; j < PACK_BATCH ; j++ )
+    outputs[j] = block + j*ens->Noutputs;
+
+  for  ( i = 0 ; i < dSet->Npts ; i += B )  {
+    B = dSet->Npts - i;
+    if  ( B > PACK_BATCH )
+      B = PACK_BATCH;
+    for  ( j = 0 ; j < B ; j++ )
+      inputs[j] = dSet->data[i+j].inputs;
+
+    ensemble_forward( ens, inputs, B, outputs );
+    for  ( j = 0 ; j < B ; j++ )
+      score_point( &scorer, outputs[j], dSet, i+j, err, 0.4999,
+		   parms->outPrimeOffset, &(result.error_count) );
+  }
+
+  outVals           = dSet->Npts * ens->Noutputs;
+  result.bits       = err->bits;
+  result.index      = ERROR_INDEX( err->sumSqDiffs, dSet->stdDev, outVals );
+  result.sumSqDiffs = err->sumSqDiffs;
+  result.sumSqError = err->sumSqError;
+  result.perCorrect = (((float)(outVals-result.bits))/outVals)*100.0;
+
+  free_mem( block );
+  free_error_data( &err );
+  return result;
+}
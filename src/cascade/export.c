@@ -0,0 +1,542 @@
+/*  CMU Cascade Neural Network Simulator (CNNS)
+    C Export Functions
+
+    The functions contained herein write a trained network out as a
+    standalone C source file, for programs that need the network's
+    predictions but not the simulator.  The weights become constants in
+    the code, every unit's sum is written out in full and each unit's
+    activation function is called directly, so that the compiler can fold
+    and schedule the whole forward pass.  The network's conversion maps
+    become tables, with functions to turn input tokens into inputs and
+    outputs into tokens.  The file needs only the C library.
+
+    For a network named 'net' the file defines:
+
+      void net_forward ( const float *inputs, float *outputs );
+      void net_forward ( const float *inputs, int reset, float *state,
+                         float *outputs );         (recurrent networks)
+      int  net_encode  ( const char **tokens, float *inputs );
+      void net_decode  ( const float *outputs, const char **tokens );
+
+    The last two are only written if the network has conversion maps.
+    Compiled with NET_SELFTEST defined, the file also holds a main()
+    which checks its outputs on a set of points against those recorded
+    from the simulator when the file was written.
+
+    The function export_c is linked to the main CLI via the interface
+    table.  It is called like any other of the interface functions located
+    on that table.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "cascade.h"
+#include "toolkit.h"
+
+#define EXPORT_TESTS 16        /*  Points checked by the self test  */
+#define EXPORT_TERMS 4         /*  Terms of a sum written per line  */
+
+
+/*  External declarations  */
+
+extern boolean interact;
+
+
+/*  EXPORT C -  Write the network 'netName' to the file 'filename' as C
+    source.
+*/
+
+void export_c  ( char *netName, char *filename )
+{
+  FILE  *cFile;
+  net_t *net;
+  char  name    [41],
+        outfile [41],
+        prefix  [41],
+        macro   [41];
+  int   i;
+
+  if  ( netName == NULL )
+    if  ( interact )  {
+      printf ("Name of network to export: ");
+      scanf  ("%40s", name );
+      netName = name;
+    } else {
+      fprintf ( stderr, "No name specified for network to export.\n");
+      fprintf ( stderr, "Network not exported.\n");
+      return;
+    }
+
+  if  ( filename == NULL )
+    if  ( interact )  {
+      printf ("File name to export '%s' to: ",netName);
+      scanf  ("%40s",outfile);
+      filename = outfile;
+    } else {
+      fprintf (stderr,"No filename specified for output file.  ");
+      fprintf (stderr,"Network not exported.\n");
+      return;
+    }
+
+  if  ( (net = select_net( netName )) == NULL )  {
+    fprintf ( stderr, "ERROR: Unable to find network %s.\n", netName );
+    return;
+  }
+
+  if  ((cFile = fopen( filename, "w" )) == NULL )  {
+    fprintf ( stderr, "ERROR: Unable to open C file %s.\n",filename );
+    return;
+  }
+
+  /*  Names in the file are prefixed with the network's name, made safe  */
+  for  ( i = 0 ; net->name[i] != '\0' && i < 40 ; i++ )  {
+    prefix[i] = ( isalnum( net->name[i] ) ) ? net->name[i] : '_';
+    macro[i]  = toupper( prefix[i] );
+  }
+  prefix[i] = macro[i] = '\0';
+  if  ( isdigit( prefix[0] ) )
+    prefix[0] = macro[0] = '_';
+
+  fprintf (cFile,"/*  %s -  Network '%s' exported by the CMU Cascade Neural\n",
+	   filename, net->name );
+  fprintf (cFile,"    Network Simulator after %d epochs of training.\n",
+	   net->epochsTrained );
+  fprintf (cFile,"    %d inputs, %d hidden units, %d outputs%s.\n\n",
+	   net->Ninputs, net->NhiddenUnits, net->Noutputs,
+	   (net->recurrent) ? ", recurrent" : "" );
+  if  ( net->recurrent )  {
+    fprintf (cFile,"    %s_forward( inputs, reset, state, outputs ) ",prefix);
+    fprintf (cFile,"evaluates a point.\n    'state' holds the %s_NUNITS ",
+	     macro);
+    fprintf (cFile,"unit values carried from one point\n    of a sequence ");
+    fprintf (cFile,"to the next, and 'reset' starts a new sequence.\n");
+  }  else
+    fprintf (cFile,"    %s_forward( inputs, outputs ) evaluates a point.\n",
+	     prefix);
+  if  ( net->inputMap != NULL && net->outputMap != NULL )  {
+    fprintf (cFile,"    %s_encode( tokens, inputs ) converts input tokens, ",
+	     prefix);
+    fprintf (cFile,"returning 0 if one\n    is unknown.  %s_decode( ",prefix);
+    fprintf (cFile,"outputs, tokens ) converts outputs to tokens,\n");
+    fprintf (cFile,"    giving NULL for numeric outputs and \"?\" where ");
+    fprintf (cFile,"no token matches.\n");
+  }
+  fprintf (cFile,"\n    Define %s_SELFTEST for a main() that checks the ",macro);
+  fprintf (cFile,"outputs against the\n    simulator's.\n*/\n\n");
+
+  fprintf (cFile,"#include <math.h>\n#include <stdlib.h>\n");
+  fprintf (cFile,"#include <string.h>\n\n");
+  fprintf (cFile,"#define %s_NINPUTS  %d\n", macro, net->Ninputs );
+  fprintf (cFile,"#define %s_NOUTPUTS %d\n", macro, net->Noutputs );
+  fprintf (cFile,"#define %s_NUNITS   %d\n\n", macro, net->Nunits );
+
+  export_forward( cFile, net, prefix, macro );
+  if  ( net->inputMap != NULL && net->outputMap != NULL )
+    export_maps( cFile, net, prefix );
+  export_test( cFile, net, prefix, macro );
+
+  if  ( fclose( cFile ) != 0 )
+    fprintf ( stderr, "ERROR: Unable to write C file %s.\n", filename );
+  else
+    printf ("Network '%s' exported to '%s'.\n", net->name, filename );
+}
+
+
+/*  EXPORT FORWARD -  Write the activation functions a network uses and its
+    forward pass.  The sums are written term by term in the order
+    'net_forward' and 'output_values' add them up, so that the results
+    agree.  Terms with zero weights are left out.
+*/
+
+void export_forward  ( FILE *cFile, net_t *net, char *prefix, char *macro )
+{
+  boolean used[SOFTMAX+1],
+          softmax = FALSE;
+  char    num[32];
+  int     i;
+
+  /*  The activation functions used, as 'activation' computes them  */
+  for  ( i = 0 ; i <= SOFTMAX ; i++ )
+    used[i] = FALSE;
+  for  ( i = net->Ninputs+1 ; i < net->Nunits ; i++ )
+    used[net->unitTypes[i]] = TRUE;
+  for  ( i = 0 ; i < net->Noutputs ; i++ )  {
+    used[net->outputTypes[i]] = TRUE;
+    softmax |= ( net->outputTypes[i] == SOFTMAX );
+  }
+
+  if  ( used[SIGMOID] )  {
+    fprintf (cFile,"static float %s_sigmoid ( float s )\n{\n", prefix );
+    fprintf (cFile,"  if  ( s < -15.0f ) return -0.5f;\n");
+    fprintf (cFile,"  if  ( s > 15.0f ) return 0.5f;\n");
+    fprintf (cFile,"  return 1.0 / (1.0 + exp( -s )) - 0.5;\n}\n\n");
+  }
+  if  ( used[ASIGMOID] )  {
+    fprintf (cFile,"static float %s_asigmoid ( float s )\n{\n", prefix );
+    fprintf (cFile,"  if  ( s < -15.0f ) return 0.0f;\n");
+    fprintf (cFile,"  if  ( s > 15.0f ) return 1.0f;\n");
+    fprintf (cFile,"  return 1.0 / (1.0 + exp( -s ));\n}\n\n");
+  }
+  if  ( used[VARSIGMOID] )  {
+    fprintf (cFile,"static float %s_varsigmoid ( float s )\n{\n", prefix );
+    fprintf (cFile,"  if  ( s < -15.0f ) return %s;\n",
+	     ftoc( num, net->sigmoidMin ) );
+    fprintf (cFile,"  if  ( s > 15.0f ) return %s;\n",
+	     ftoc( num, net->sigmoidMax ) );
+    fprintf (cFile,"  return (%s - ", ftoc( num, net->sigmoidMax ) );
+    fprintf (cFile,"%s) / (1.0 + exp( -s )) + ", ftoc( num, net->sigmoidMin ) );
+    fprintf (cFile,"%s;\n}\n\n", ftoc( num, net->sigmoidMin ) );
+  }
+  if  ( used[GAUSSIAN] )  {
+    fprintf (cFile,"static float %s_gaussian ( float s )\n{\n", prefix );
+    fprintf (cFile,"  float t = -0.5 * s * s;\n\n");
+    fprintf (cFile,"  return ( t < -75.0f ) ? 0.0f : exp( t );\n}\n\n");
+  }
+
+  if  ( net->recurrent )  {
+    fprintf (cFile,"void %s_forward ( const float *inputs, int reset, ",prefix);
+    fprintf (cFile,"float *state,\n\t\t  float *outputs )\n{\n");
+    fprintf (cFile,"  float *v = state,\n        s;\n\n");
+  }  else  {
+    fprintf (cFile,"void %s_forward ( const float *inputs, float *outputs )\n",
+	     prefix );
+    fprintf (cFile,"{\n  float v[%s_NUNITS],\n        s;\n\n", macro );
+  }
+
+  fprintf (cFile,"  v[0] = %s;\n", ftoc( num, BIAS ) );
+  for  ( i = 1 ; i <= net->Ninputs ; i++ )
+    fprintf (cFile,"  v[%d] = inputs[%d];\n", i, i-1 );
+
+  for  ( i = net->Ninputs+1 ; i < net->Nunits ; i++ )  {
+    fprintf (cFile,"\n  /*  Hidden unit %d  */\n", i-net->Ninputs );
+    export_sum( cFile, net->weights[i], i );
+    if  ( net->recurrent )
+      fprintf (cFile,"  if  ( !reset )\n    s += v[%d] * %s;\n", i,
+	       ftoc( num, net->weights[i][i] ) );
+    fprintf (cFile,"  v[%d] = ", i );
+    export_activation( cFile, net->unitTypes[i], prefix );
+  }
+
+  for  ( i = 0 ; i < net->Noutputs ; i++ )  {
+    fprintf (cFile,"\n  /*  Output %d  */\n", i );
+    export_sum( cFile, net->outWeights[i], net->Nunits );
+    fprintf (cFile,"  outputs[%d] = ", i );
+    export_activation( cFile, net->outputTypes[i], prefix );
+  }
+
+  /*  Normalize the SOFTMAX outputs as 'softmax_outputs' does  */
+  if  ( softmax )  {
+    fprintf (cFile,"\n  /*  Softmax outputs  */\n  {\n");
+    fprintf (cFile,"    float max = -1.0e20f,\n          total = 0.0f;\n\n");
+    for  ( i = 0 ; i < net->Noutputs ; i++ )
+      if  ( net->outputTypes[i] == SOFTMAX )
+	fprintf (cFile,"    if  ( outputs[%d] > max ) max = outputs[%d];\n",
+		 i, i );
+    for  ( i = 0 ; i < net->Noutputs ; i++ )
+      if  ( net->outputTypes[i] == SOFTMAX )  {
+	fprintf (cFile,"    outputs[%d] = exp( outputs[%d] - max );\n", i, i );
+	fprintf (cFile,"    total += outputs[%d];\n", i );
+      }
+    for  ( i = 0 ; i < net->Noutputs ; i++ )
+      if  ( net->outputTypes[i] == SOFTMAX )
+	fprintf (cFile,"    outputs[%d] = outputs[%d] / total - 0.5f;\n", i, i);
+    fprintf (cFile,"  }\n");
+  }
+
+  fprintf (cFile,"}\n\n");
+}
+
+
+/*  EXPORT SUM -  Write the sum of the first 'Nterms' unit values weighted
+    by 'weights' into 's'.
+*/
+
+void export_sum  ( FILE *cFile, float *weights, int Nterms )
+{
+  char num[32];
+  int  Nwritten = 0,
+       j;
+
+  fprintf (cFile,"  s = ");
+  for  ( j = 0 ; j < Nterms ; j++ )  {
+    if  ( weights[j] == 0.0 )
+      continue;
+    if  ( Nwritten > 0 )
+      fprintf (cFile,( Nwritten % EXPORT_TERMS == 0 ) ? "\n      + " : " + ");
+    fprintf (cFile,"v[%d] * %s", j, ftoc( num, weights[j] ) );
+    Nwritten++;
+  }
+  fprintf (cFile,"%s;\n", ( Nwritten == 0 ) ? "0.0f" : "" );
+}
+
+
+/*  EXPORT ACTIVATION -  Write the call of a unit's activation function on
+    the sum 's', ending the statement.
+*/
+
+void export_activation  ( FILE *cFile, node_t type, char *prefix )
+{
+  switch  ( type )  {
+    case SIGMOID:    fprintf (cFile,"%s_sigmoid( s );\n", prefix );
+                     break;
+    case ASIGMOID:   fprintf (cFile,"%s_asigmoid( s );\n", prefix );
+                     break;
+    case VARSIGMOID: fprintf (cFile,"%s_varsigmoid( s );\n", prefix );
+                     break;
+    case GAUSSIAN:   fprintf (cFile,"%s_gaussian( s );\n", prefix );
+                     break;
+    default:         fprintf (cFile,"s;\n");  /*  LINEAR and SOFTMAX  */
+  }
+}
+
+
+/*  EXPORT MAPS -  Write a network's conversion maps as tables, with the
+    functions converting input tokens and outputs through them.  They
+    follow 'ttof' and 'ftot' of the parser.
+*/
+
+void export_maps  ( FILE *cFile, net_t *net, char *prefix )
+{
+  char num[32];
+  int  NinSeries,
+       NoutSeries;
+
+  fprintf (cFile,"typedef struct {\n  int         Nenums,\n");
+  fprintf (cFile,"              Nunits;\n  const char  **enums;\n");
+  fprintf (cFile,"  const float *equivs,\n              *unknown;\n");
+  fprintf (cFile,"} %s_map_t;\n\n", prefix );
+
+  NinSeries  = export_map( cFile, net->inputMap, net->Ninputs, prefix, "in" );
+  NoutSeries = export_map( cFile, net->outputMap, net->Noutputs, prefix,
+			   "out" );
+
+  fprintf (cFile,"int %s_encode ( const char **tokens, float *inputs )\n",
+	   prefix );
+  fprintf (cFile,"{\n  const %s_map_t *map;\n  const float    *val;\n", prefix );
+  fprintf (cFile,"  char           *end;\n  int            node = 0,\n");
+  fprintf (cFile,"                 i, j, k;\n\n");
+  fprintf (cFile,"  for  ( i = 0 ; i < %d ; i++ )  {\n", NinSeries );
+  fprintf (cFile,"    map = %s_in_maps + i;\n", prefix );
+  fprintf (cFile,"    if  ( map->Nenums == 0 )  {\n");
+  fprintf (cFile,"      inputs[node++] = strtod( tokens[i], &end );\n");
+  fprintf (cFile,"      if  ( *end != '\\0' || end == tokens[i] )\n");
+  fprintf (cFile,"        return 0;\n      continue;\n    }\n");
+  fprintf (cFile,"    if  ( !strcmp( tokens[i], \"?\" ) || ");
+  fprintf (cFile,"!strcmp( tokens[i], \"#\" ) )\n");
+  fprintf (cFile,"      val = map->unknown;\n    else  {\n");
+  fprintf (cFile,"      for  ( j = 0 ; j < map->Nenums ; j++ )\n");
+  fprintf (cFile,"        if  ( !strcmp( tokens[i], map->enums[j] ) )\n");
+  fprintf (cFile,"          break;\n");
+  fprintf (cFile,"      if  ( j == map->Nenums )\n        return 0;\n");
+  fprintf (cFile,"      val = map->equivs + j * map->Nunits;\n    }\n");
+  fprintf (cFile,"    for  ( k = 0 ; k < map->Nunits ; k++ )\n");
+  fprintf (cFile,"      inputs[node++] = val[k];\n  }\n\n  return 1;\n}\n\n");
+
+  fprintf (cFile,"void %s_decode ( const float *outputs, const char **tokens )\n",
+	   prefix );
+  fprintf (cFile,"{\n  const %s_map_t *map;\n  const float    *val;\n", prefix );
+  fprintf (cFile,"  int            node = 0,\n                 i, j, k;\n\n");
+  fprintf (cFile,"  for  ( i = 0 ; i < %d ; i++ )  {\n", NoutSeries );
+  fprintf (cFile,"    map = %s_out_maps + i;\n", prefix );
+  fprintf (cFile,"    if  ( map->Nenums == 0 )  {\n");
+  fprintf (cFile,"      tokens[i] = NULL;\n      node++;\n      continue;\n");
+  fprintf (cFile,"    }\n    tokens[i] = \"?\";\n");
+  fprintf (cFile,"    for  ( j = 0 ; j < map->Nenums ; j++ )  {\n");
+  fprintf (cFile,"      val = map->equivs + j * map->Nunits;\n");
+  fprintf (cFile,"      for  ( k = 0 ; k < map->Nunits ; k++ )\n");
+  fprintf (cFile,"        if  ( fabs( outputs[node+k] - val[k] ) > %s )\n",
+	   ftoc( num, (net->sigmoidMax-net->sigmoidMin)/2.0 ) );
+  fprintf (cFile,"          break;\n");
+  fprintf (cFile,"      if  ( k == map->Nunits )  {\n");
+  fprintf (cFile,"        tokens[i] = map->enums[j];\n        break;\n");
+  fprintf (cFile,"      }\n    }\n    node += map->Nunits;\n  }\n}\n\n");
+}
+
+
+/*  EXPORT MAP -  Write the tables of one set of conversion maps, covering
+    'Nnodes' units, as '<prefix>_<which>_maps'.  Returns the number of
+    maps, which is the number of tokens converted.
+*/
+
+int export_map  ( FILE *cFile, cvrt_t *maps, int Nnodes, char *prefix,
+		  char *which )
+{
+  cvrt_t *map;
+  char   num[32];
+  int    Nmaps,
+         node,
+         i, j, k;
+
+  for  ( Nmaps = 0, node = 0 ; node < Nnodes ; Nmaps++ )  {
+    map = maps + Nmaps;
+    if  ( map->Nenums == 0 )  {
+      node++;
+      continue;
+    }
+    node += map->Nunits;
+
+    fprintf (cFile,"static const char *%s_%s_enums_%d[] = {", prefix, which,
+	     Nmaps );
+    for  ( j = 0 ; j < map->Nenums ; j++ )  {
+      fprintf (cFile,"%s\n  ", (j > 0) ? "," : "" );
+      export_string( cFile, map->enums[j] );
+    }
+    fprintf (cFile,"\n};\n");
+
+    fprintf (cFile,"static const float %s_%s_equivs_%d[] = {", prefix, which,
+	     Nmaps );
+    for  ( j = 0 ; j < map->Nenums ; j++ )
+      for  ( k = 0 ; k < map->Nunits ; k++ )
+	fprintf (cFile,"%s%s%s", (j+k > 0) ? "," : "", (k == 0) ? "\n  " : " ",
+		 ftoc( num, map->equivs[j][k] ) );
+    fprintf (cFile,"\n};\n");
+
+    fprintf (cFile,"static const float %s_%s_unknown_%d[] = {\n  ", prefix,
+	     which, Nmaps );
+    for  ( k = 0 ; k < map->Nunits ; k++ )
+      fprintf (cFile,"%s%s", (k > 0) ? ", " : "", ftoc( num, map->unknown[k] ));
+    fprintf (cFile,"\n};\n\n");
+  }
+
+  fprintf (cFile,"static const %s_map_t %s_%s_maps[] = {", prefix, prefix,
+	   which );
+  for  ( i = 0 ; i < Nmaps ; i++ )
+    if  ( maps[i].Nenums == 0 )
+      fprintf (cFile,"%s\n  { 0, 1, NULL, NULL, NULL }", (i > 0) ? "," : "" );
+    else
+      fprintf (cFile,"%s\n  { %d, %d, %s_%s_enums_%d, %s_%s_equivs_%d, "
+	       "%s_%s_unknown_%d }", (i > 0) ? "," : "", maps[i].Nenums,
+	       maps[i].Nunits, prefix, which, i, prefix, which, i, prefix,
+	       which, i );
+  fprintf (cFile,"\n};\n\n");
+
+  return Nmaps;
+}
+
+
+/*  EXPORT TEST -  Write the self test: EXPORT_TESTS points with the outputs
+    the simulator gives for them, and a main() checking the exported forward
+    pass against those outputs.  The inputs are drawn from [-1,1] with a
+    generator of our own, so that the simulator's random number sequence is
+    left alone.  For a recurrent network the points form sequences of four.
+*/
+
+void export_test  ( FILE *cFile, net_t *net, char *prefix, char *macro )
+{
+  float         *inputs,
+                *values,
+                *outputs;
+  boolean       reset;
+  unsigned long seed = 12345;
+  char          num[32];
+  int           i, j;
+  char          *fn = "Export Test";
+
+  inputs  = (float *)alloc_mem( EXPORT_TESTS * net->Ninputs, sizeof( float ),
+				fn );
+  outputs = (float *)alloc_mem( EXPORT_TESTS * net->Noutputs,
+				sizeof( float ), fn );
+  values  = (float *)alloc_mem( net->Nunits, sizeof( float ), fn );
+
+  /*  Record the simulator's outputs  */
+  for  ( i = 0 ; i < EXPORT_TESTS ; i++ )  {
+    for  ( j = 0 ; j < net->Ninputs ; j++ )  {
+      seed = seed * 1103515245 + 12345;
+      inputs[i*net->Ninputs+j] = ((seed >> 16) % 2001) / 1000.0 - 1.0;
+    }
+    reset = ( i % 4 == 0 );
+    net_forward( net, inputs + i*net->Ninputs, reset, values );
+    output_values( net, values, outputs + i*net->Noutputs );
+  }
+
+  fprintf (cFile,"#ifdef %s_SELFTEST\n\n#include <stdio.h>\n\n", macro );
+  fprintf (cFile,"static const float %s_test_inputs[%d][%s_NINPUTS] = {",
+	   prefix, EXPORT_TESTS, macro );
+  for  ( i = 0 ; i < EXPORT_TESTS ; i++ )  {
+    fprintf (cFile,"%s\n  {", (i > 0) ? "," : "" );
+    for  ( j = 0 ; j < net->Ninputs ; j++ )
+      fprintf (cFile,"%s %s", (j > 0) ? "," : "",
+	       ftoc( num, inputs[i*net->Ninputs+j] ) );
+    fprintf (cFile," }");
+  }
+  fprintf (cFile,"\n};\n\n");
+
+  fprintf (cFile,"static const float %s_test_outputs[%d][%s_NOUTPUTS] = {",
+	   prefix, EXPORT_TESTS, macro );
+  for  ( i = 0 ; i < EXPORT_TESTS ; i++ )  {
+    fprintf (cFile,"%s\n  {", (i > 0) ? "," : "" );
+    for  ( j = 0 ; j < net->Noutputs ; j++ )
+      fprintf (cFile,"%s %s", (j > 0) ? "," : "",
+	       ftoc( num, outputs[i*net->Noutputs+j] ) );
+    fprintf (cFile," }");
+  }
+  fprintf (cFile,"\n};\n\n");
+
+  fprintf (cFile,"int main ( void )\n{\n");
+  fprintf (cFile,"  float outputs[%s_NOUTPUTS],\n", macro );
+  if  ( net->recurrent )
+    fprintf (cFile,"        state[%s_NUNITS],\n", macro );
+  fprintf (cFile,"        diff,\n        worst = 0.0f;\n  int   i, j;\n\n");
+  fprintf (cFile,"  for  ( i = 0 ; i < %d ; i++ )  {\n", EXPORT_TESTS );
+  if  ( net->recurrent )
+    fprintf (cFile,"    %s_forward( %s_test_inputs[i], i %% 4 == 0, state, "
+	     "outputs );\n", prefix, prefix );
+  else
+    fprintf (cFile,"    %s_forward( %s_test_inputs[i], outputs );\n", prefix,
+	     prefix );
+  fprintf (cFile,"    for  ( j = 0 ; j < %s_NOUTPUTS ; j++ )  {\n", macro );
+  fprintf (cFile,"      diff = fabs( outputs[j] - %s_test_outputs[i][j] );\n",
+	   prefix );
+  fprintf (cFile,"      if  ( diff > worst )\n        worst = diff;\n");
+  fprintf (cFile,"    }\n  }\n\n");
+  fprintf (cFile,"  printf (\"%%s: largest difference from the simulator ");
+  fprintf (cFile,"%%g over %d points.\\n\", ", EXPORT_TESTS );
+  export_string( cFile, net->name );
+  fprintf (cFile,", worst );\n");
+  fprintf (cFile,"  return ( worst > 1.0e-5f );\n}\n\n#endif\n");
+
+  free_mem( inputs );
+  free_mem( outputs );
+  free_mem( values );
+}
+
+
+/*  EXPORT STRING -  Write 'str' as a C string literal, escaping the
+    characters that cannot appear in one as they are.
+*/
+
+void export_string  ( FILE *cFile, char *str )
+{
+  putc ( '"', cFile );
+  for  ( ; *str != '\0' ; str++ )
+    if  ( (*str == '"') || (*str == '\\') )
+      fprintf (cFile,"\\%c", *str );
+    else if  ( !isprint( (unsigned char)*str ) )
+      fprintf (cFile,"\\%03o", (unsigned char)*str );
+    else
+      putc ( *str, cFile );
+  putc ( '"', cFile );
+}
+
+
+/*  FTOC -  Write a float into 'buf' as a C constant that reads back as the
+    same float, and return 'buf'.
+*/
+
+char *ftoc  ( char *buf, float val )
+{
+  if  ( val != val )
+    return strcpy( buf, "NAN" );
+  if  ( val > 3.5e38 || val < -3.5e38 )
+    return strcpy( buf, (val > 0.0) ? "INFINITY" : "-INFINITY" );
+
+  sprintf ( buf, "%.9g", val );
+  if  ( strpbrk( buf, ".e" ) == NULL )
+    strcat ( buf, ".0" );
+  strcat ( buf, "f" );
+
+  return buf;
+}
@@ -9,11 +9,31 @@
 	used for training and simulating the network.
 */
 
+#include <math.h>
 #include <string.h>
 
 #include "toolkit.h"
 #include "cascade.h"
 
+#define CINIT_SPAN  2.0     /*  RMS summed input of a seeded candidate  */
+#define CINIT_NOISE 0.25    /*  Noise added to seeded weights, as a     */
+                            /* fraction of the weight range             */
+#define CINIT_MIX   0.5     /*  Weight of the other outputs' residuals  */
+#define CINIT_RIDGE 1.0e-3  /*  Ridge added to the Gram matrix, as a    */
+                            /* fraction of its mean diagonal            */
+
+#define ARM_DECAY   0.8     /*  Decay of an arm's credit each cycle     */
+#define ARM_EXPLORE 0.2     /*  Share of the pool spread evenly over    */
+                            /* all the arms                             */
+
+/*  The candidate input step sizes tried by an adaptive pool, as multiples
+    of candInEpsilon and candInMu.  Each is tried with every candidate type.  */
+#define NSTEPS 4
+static float armSteps[NSTEPS][2] = { { 1.0, 1.0 },
+				     { 0.3, 1.0 },
+				     { 3.0, 1.0 },
+				     { 1.0, 0.6 } };
+
 
 /*  BUILD NET -  Create a network with the parameters specified and initialize
     the fields to appropriate values.
@@ -48,6 +68,10 @@ net_t *build_net  ( char *name, int Ninputs, int Noutputs, int maxNewUnits,
 
   temp->inputMap      = NULL;
   temp->outputMap     = NULL;
+  temp->rls           = NULL;
+  temp->packed        = NULL;
+  temp->quant         = NULL;
+  temp->memo          = NULL;
   temp->next          = NULL;
 
   maxUnits           = Ninputs + maxNewUnits + 1;
@@ -125,6 +149,7 @@ void init_net ( net_t *net, float weightRange )
 
   net->epochsTrained = 0;
   net->NhiddenUnits  = 0;
+  free_rls( &(net->rls) );
   for  ( i = 0 ; i < net->Noutputs ; i++ )
     for  ( j = 0 ; j < net->Ninputs+1 ; j++ )
       net->outWeights[i][j] = random_weight( weightRange );
@@ -156,6 +181,20 @@ void free_net ( net_t **net )
     (*net)->outWeights[i] = free_mem( (*net)->outWeights[i] );
   (*net)->outWeights = free_mem( (*net)->outWeights );
 
+  if  ( (*net)->inputMap != NULL )
+    for  ( i = 0 ; i < (*net)->Ninputs ; i++ )
+      free_cmap( (*net)->inputMap[i] );
+  (*net)->inputMap = free_mem( (*net)->inputMap );
+  if  ( (*net)->outputMap != NULL )
+    for  ( i = 0 ; i < (*net)->Noutputs ; i++ )
+      free_cmap( (*net)->outputMap[i] );
+  (*net)->outputMap = free_mem( (*net)->outputMap );
+
+  free_rls( &((*net)->rls) );
+  free_packed( &((*net)->packed) );
+  free_quant( &((*net)->quant) );
+  free_memo( &((*net)->memo) );
+
   *net = free_mem( *net );
 }
 
@@ -174,21 +213,39 @@ train_parm_t *build_parm ( void )
   temp->maxNewUnits                   = 400;
   temp->validationPatience            = 8;
   temp->Ncand                         = 8;
+  temp->candLMUnits                   = 0;
+  temp->memoEntries                   = 0;
+  temp->maxResident                   = 0;
+  temp->Nthreads                      = 0;
+  temp->trialThreads                  = 1;
+  temp->trialSeed                     = 0;
+  temp->predictFormat                 = RAW_FORMAT;
+  temp->quantized                     = FALSE;
 
   temp->outPrimeOffset                = 0.1;
   temp->weightRange                   = 1.0;
   temp->indexThreshold                = 0.2;
   temp->scoreThreshold                = 0.4;
+  temp->pruneThreshold                = 0.0;
   temp->sigMax                        = DEF_SIGMAX;
   temp->sigMin                        = DEF_SIGMIN;
+  temp->rlsForget                     = 0.999;
+  temp->rlsDelta                      = 100.0;
   
   temp->overshootOK                   = FALSE;
   temp->useCache                      = TRUE;
   temp->test                          = TRUE;
   temp->validate                      = TRUE;
   temp->recurrent                     = FALSE;
+  temp->softmax                       = FALSE;
+  temp->classTargets                  = FALSE;
+  temp->candAdapt                     = FALSE;
+  temp->pruneRefit                    = FALSE;
+  temp->keepTrials                    = FALSE;
+  temp->ensembleVote                  = FALSE;
 
   temp->candType                      = SIGMOID;
+  temp->candInit                      = RANDOM_INIT;
   temp->algorithm                     = CASCOR;
   temp->errorMeasure                  = BITS;
 
@@ -209,6 +266,8 @@ train_parm_t *build_parm ( void )
   temp->outputParm.patience           = 12;
   temp->outputParm.changeThreshold    = 0.01;
 
+  temp->race                          = NULL;
+
   return temp;
 }
 
@@ -225,7 +284,11 @@ train_data_t *build_train_data  ( net_t *net, train_parm_t *parms, int Npts )
                Noutputs,
                maxUnits,
                NinConn,
+               lmUnits,
+               lmSize,
+               Ntypes,
                i,j;
+  node_t       armTypes[4] = { SIGMOID, ASIGMOID, VARSIGMOID, GAUSSIAN };
   char         *fn = "Build Network Training Data";
 
 
@@ -236,6 +299,9 @@ train_data_t *build_train_data  ( net_t *net, train_parm_t *parms, int Npts )
 
   temp = (train_data_t *)alloc_mem ( 1, sizeof( train_data_t ), fn );
 
+  temp->vSetPts   = 0;
+  temp->vSetUnits = 0;
+  temp->vSetCache = NULL;
   if  ( parms->useCache )  {
     temp->cachePts = Npts;
     parms->useCache = build_cache ( maxUnits, Noutputs, Npts,
@@ -296,6 +362,73 @@ train_data_t *build_train_data  ( net_t *net, train_parm_t *parms, int Npts )
     }
   }
 
+  /*  The Levenberg-Marquardt state is only built as large as the fan-in  */
+  /* it will be used for, plus the outputs trained with it by Cascade-2.  */
+  lmUnits       = ( parms->candLMUnits < NinConn ) ? parms->candLMUnits :
+                                                     NinConn;
+  temp->lmUnits = ( lmUnits > 0 ) ? lmUnits : 0;
+  temp->candLM  = FALSE;
+  if  ( temp->lmUnits > 0 )  {
+    lmSize = lmUnits + Noutputs;
+    temp->candLambda  = (float *)alloc_mem (Ncand, sizeof( float ), fn);
+    temp->candLMScore = (float *)alloc_mem (Ncand, sizeof( float ), fn);
+    temp->candResSq   = (float *)alloc_mem (Ncand, sizeof( float ), fn);
+    temp->candJacob   = (float *)alloc_mem (lmSize, sizeof( float ), fn);
+    temp->candLMWeights = (float **)alloc_mem (Ncand, sizeof( float * ), fn);
+    temp->candLMSlopes  = (float **)alloc_mem (Ncand, sizeof( float * ), fn);
+    temp->candHess      = (float ***)alloc_mem (Ncand, sizeof(float **), fn);
+    temp->candLMHess    = (float ***)alloc_mem (Ncand, sizeof(float **), fn);
+    for  ( i = 0 ; i < Ncand ; i++ )  {
+      temp->candLMWeights[i] = (float *)alloc_mem (lmSize,sizeof( float ),fn);
+      temp->candLMSlopes[i]  = (float *)alloc_mem (lmSize,sizeof( float ),fn);
+      temp->candHess[i]   = (float **)alloc_mem (lmSize,sizeof( float * ),fn);
+      temp->candLMHess[i] = (float **)alloc_mem (lmSize,sizeof( float * ),fn);
+      for  ( j = 0 ; j < lmSize ; j++ )  {
+	temp->candHess[i][j]   = (float *)alloc_mem (lmSize,sizeof(float),fn);
+	temp->candLMHess[i][j] = (float *)alloc_mem (lmSize,sizeof(float),fn);
+      }
+    }
+  }
+
+  /*  Seeding the candidates from the residual needs the cached values  */
+  temp->seedSize  = 0;
+  temp->gramUnits = 0;
+  if  ( parms->candInit == RESIDUAL_INIT )  {
+    if  ( parms->useCache )  {
+      temp->seedSize    = maxUnits;
+      temp->candGram    = (float **)alloc_mem (maxUnits,sizeof(float *),fn);
+      temp->candFactor  = (float **)alloc_mem (maxUnits,sizeof(float *),fn);
+      temp->candSeedDir = (float **)alloc_mem (Noutputs,sizeof(float *),fn);
+      for  ( i = 0 ; i < maxUnits ; i++ )  {
+	temp->candGram[i]   = (float *)alloc_mem (maxUnits,sizeof(float),fn);
+	temp->candFactor[i] = (float *)alloc_mem (maxUnits,sizeof(float),fn);
+      }
+      for  ( i = 0 ; i < Noutputs ; i++ )
+	temp->candSeedDir[i] = (float *)alloc_mem (maxUnits,sizeof(float),fn);
+    }  else
+      printf ("Seeding candidates needs the cache.  Using random weights.\n");
+  }
+
+  /*  An adaptive pool tries every candidate type with every step size  */
+  temp->Narms = 0;
+  if  ( parms->candAdapt )  {
+    Ntypes      = ( parms->candType == VARIED ) ? 4 : 1;
+    temp->Narms = Ntypes * NSTEPS;
+    temp->arms  = (pool_arm_t *)alloc_mem (temp->Narms,sizeof(pool_arm_t),fn);
+    for  ( i = 0 ; i < temp->Narms ; i++ )  {
+      temp->arms[i].type     = ( Ntypes == 1 ) ? parms->candType :
+	                       armTypes[i % Ntypes];
+      temp->arms[i].epsScale = armSteps[i / Ntypes][0];
+      temp->arms[i].muScale  = armSteps[i / Ntypes][1];
+      temp->arms[i].credit   = 1.0;
+      temp->arms[i].Nwins    = 0;
+    }
+    temp->candArm     = (int *)alloc_mem (Ncand, sizeof( int ), fn);
+    temp->candEpsilon = (float *)alloc_mem (Ncand, sizeof( float ), fn);
+    temp->candMu      = (float *)alloc_mem (Ncand, sizeof( float ), fn);
+    temp->candShrink  = (float *)alloc_mem (Ncand, sizeof( float ), fn);
+  }
+
   temp->outScaledEps         = parms->outputUpdate.epsilon / Npts;
   temp->output.shrinkFactor  = parms->outputUpdate.mu /
                                (parms->outputUpdate.mu + 1.0);
@@ -318,13 +451,15 @@ void  free_train_data  ( train_data_t **data, net_t *net, train_parm_t *parm )
       Noutputs,
       maxUnits,
       NinConn,
-      i;
+      i, j;
 
   Ncand    = parm->Ncand;
   Noutputs = net->Noutputs;
 
   if  ( parm->useCache )
     free_cache( &((*data)->valCache),&((*data)->errCache),(*data)->cachePts );
+  if  ( (*data)->vSetCache != NULL )
+    free_cache( &((*data)->vSetCache), NULL, (*data)->vSetPts );
 
   free_mem( (*data)->candScores );
   free_mem( (*data)->candValues );
@@ -335,7 +470,7 @@ void  free_train_data  ( train_data_t **data, net_t *net, train_parm_t *parm )
     free_mem( (*data)->candCorr[i] );
     free_mem( (*data)->candPrevCorr[i] );
     if  ( parm->recurrent )
-      free_mem( (*data)->candDVdW );
+      free_mem( (*data)->candDVdW[i] );
 
     free_mem( (*data)->candIn.weights[i] );
     free_mem( (*data)->candIn.deltas[i] );
@@ -373,6 +508,47 @@ void  free_train_data  ( train_data_t **data, net_t *net, train_parm_t *parm )
     free_mem( (*data)->candPrevValues );
   }
 
+  if  ( (*data)->lmUnits > 0 )  {
+    for  ( i = 0 ; i < Ncand ; i++ )  {
+      for  ( j = 0 ; j < (*data)->lmUnits+Noutputs ; j++ )  {
+	free_mem( (*data)->candHess[i][j] );
+	free_mem( (*data)->candLMHess[i][j] );
+      }
+      free_mem( (*data)->candHess[i] );
+      free_mem( (*data)->candLMHess[i] );
+      free_mem( (*data)->candLMWeights[i] );
+      free_mem( (*data)->candLMSlopes[i] );
+    }
+    free_mem( (*data)->candHess );
+    free_mem( (*data)->candLMHess );
+    free_mem( (*data)->candLMWeights );
+    free_mem( (*data)->candLMSlopes );
+    free_mem( (*data)->candLambda );
+    free_mem( (*data)->candLMScore );
+    free_mem( (*data)->candResSq );
+    free_mem( (*data)->candJacob );
+  }
+
+  if  ( (*data)->Narms > 0 )  {
+    free_mem( (*data)->arms );
+    free_mem( (*data)->candArm );
+    free_mem( (*data)->candEpsilon );
+    free_mem( (*data)->candMu );
+    free_mem( (*data)->candShrink );
+  }
+
+  if  ( (*data)->seedSize > 0 )  {
+    for  ( i = 0 ; i < (*data)->seedSize ; i++ )  {
+      free_mem( (*data)->candGram[i] );
+      free_mem( (*data)->candFactor[i] );
+    }
+    for  ( i = 0 ; i < Noutputs ; i++ )
+      free_mem( (*data)->candSeedDir[i] );
+    free_mem( (*data)->candGram );
+    free_mem( (*data)->candFactor );
+    free_mem( (*data)->candSeedDir );
+  }
+
   *data = free_mem( *data );
 }
 
@@ -385,7 +561,7 @@ void  free_train_data  ( train_data_t **data, net_t *net, train_parm_t *parm )
 void init_cand ( train_data_t *tData, int Ncand, int Noutputs, int Nunits,
 	         boolean recurrent, float weightRange, node_t candType )
 {
-  int i,j;
+  int i,j,k;
 
   for  ( i = 0 ; i < Ncand ; i++ )  {
     tData->candValues[i]  = 0.0;
@@ -424,6 +600,213 @@ void init_cand ( train_data_t *tData, int Ncand, int Noutputs, int Nunits,
     else
       tData->candTypes[i] = candType;
   }
+
+  /*  Candidates with a small fan-in are trained by Levenberg-Marquardt  */
+  tData->candLM = ( (Nunits+recurrent) < tData->lmUnits );
+  if  ( tData->candLM )
+    for  ( i = 0 ; i < Ncand ; i++ )  {
+      tData->candLambda[i]  = LM_LAMBDA;
+      tData->candLMScore[i] = -1.0e20;
+      tData->candResSq[i]   = 0.0;
+      for  ( j = 0 ; j < (Nunits+recurrent+Noutputs) ; j++ )
+	for  ( k = 0 ; k < (Nunits+recurrent+Noutputs) ; k++ )
+	  tData->candHess[i][j][k] = 0.0;
+    }
+}
+
+
+/*	SCHEDULE CAND -  Deal the slots of an adaptive pool out to the arms,
+	in proportion to the credit each arm has earned plus an even share
+	that keeps every arm being tried.  The slots are dealt by systematic
+	sampling, so an arm's number of slots never strays more than one from
+	its share.  Each candidate then takes the type and step sizes of its
+	arm.  Call this function after 'init_cand'.
+*/
+
+void schedule_cand  ( train_data_t *tData, train_parm_t *parms )
+{
+  pool_arm_t *arm;
+  float      total = 0.0,
+             share,
+             next,
+             mu;
+  int        Ncand = parms->Ncand,
+             a, i;
+
+  for  ( a = 0 ; a < tData->Narms ; a++ )
+    total += tData->arms[a].credit;
+
+  a     = 0;
+  share = (1.0 - ARM_EXPLORE) * tData->arms[0].credit / total +
+          ARM_EXPLORE / tData->Narms;
+  next  = (float)(thread_random() % 1000) / (1000.0 * Ncand);
+  for  ( i = 0 ; i < Ncand ; i++ )  {
+    while  ( (next > share) && (a < tData->Narms-1) )  {
+      a++;
+      share += (1.0 - ARM_EXPLORE) * tData->arms[a].credit / total +
+	       ARM_EXPLORE / tData->Narms;
+    }
+    next += 1.0 / Ncand;
+
+    arm  = tData->arms + a;
+    mu   = parms->candInUpdate.mu * arm->muScale;
+    tData->candArm[i]     = a;
+    tData->candTypes[i]   = arm->type;
+    tData->candEpsilon[i] = parms->candInUpdate.epsilon * arm->epsScale;
+    tData->candMu[i]      = mu;
+    tData->candShrink[i]  = mu / (mu + 1.0);
+  }
+}
+
+
+/*	REWARD CAND -  Credit the arm of the candidate that won the cycle.
+	Older wins count for less, so the pool can follow a change in which
+	configuration works best as the network grows.
+*/
+
+void reward_cand  ( train_data_t *tData )
+{
+  int a;
+
+  for  ( a = 0 ; a < tData->Narms ; a++ )
+    tData->arms[a].credit *= ARM_DECAY;
+
+  a = tData->candArm[tData->candBest];
+  tData->arms[a].credit += 1.0;
+  tData->arms[a].Nwins++;
+}
+
+
+/*	SEED CAND -  Replace the random input weights of the candidates with
+	ones that already point towards the residual error, so that candidate
+	training does not spend its first epochs finding it.  Each output's
+	residual, as held in the error cache, is fit by least squares to the
+	cached unit values.  Each candidate follows the fit of a randomly
+	chosen output mixed with random amounts of the others, scaled to a
+	useful range of summed input, plus noise to keep the pool diverse.
+	Cascade-2 candidates also get the output weights that best fit the
+	residual with their initial values.
+
+	The Gram matrix of the unit values is kept from cycle to cycle, since
+	the cached values of the existing units never change.  Only the units
+	added since the last call are summed into it.  Call this function
+	after 'init_cand'.
+*/
+
+void seed_cand  ( train_data_t *tData, net_t *net, train_parm_t *parms,
+		  int Npts )
+{
+  float **gram = tData->candGram,
+        **fact = tData->candFactor,
+        **dir  = tData->candSeedDir,
+        *vals,
+        *errs,
+        *w,
+        trace,
+        sum,
+        value,
+        mix;
+  int   n        = net->Nunits,
+        Noutputs = net->Noutputs,
+        Ncand    = parms->Ncand,
+        i, j, k, o, p;
+
+  if  ( tData->seedSize < n )
+    return;
+
+  /*  Bring the Gram matrix up to date with the new units  */
+  for  ( k = tData->gramUnits ; k < n ; k++ )
+    for  ( j = 0 ; j <= k ; j++ )
+      gram[j][k] = 0.0;
+  for  ( p = 0 ; p < Npts ; p++ )  {
+    vals = tData->valCache[p];
+    for  ( k = tData->gramUnits ; k < n ; k++ )
+      for  ( j = 0 ; j <= k ; j++ )
+	gram[j][k] += vals[j] * vals[k];
+  }
+  tData->gramUnits = n;
+
+  /*  Correlate the residual of each output with the unit values  */
+  for  ( o = 0 ; o < Noutputs ; o++ )
+    for  ( j = 0 ; j < n ; j++ )
+      dir[o][j] = 0.0;
+  for  ( p = 0 ; p < Npts ; p++ )  {
+    vals = tData->valCache[p];
+    errs = tData->errCache[p];
+    for  ( o = 0 ; o < Noutputs ; o++ )
+      for  ( j = 0 ; j < n ; j++ )
+	dir[o][j] += errs[o] * vals[j];
+  }
+
+  /*  Solve the ridge regularized normal equations for all the outputs  */
+  trace = 0.0;
+  for  ( j = 0 ; j < n ; j++ )
+    trace += gram[j][j];
+  for  ( j = 0 ; j < n ; j++ )  {
+    for  ( k = j ; k < n ; k++ )
+      fact[j][k] = gram[j][k];
+    fact[j][j] += CINIT_RIDGE * trace / n;
+  }
+  if  ( !lm_factor( fact, n ) )
+    return;
+  for  ( o = 0 ; o < Noutputs ; o++ )
+    lm_backsolve( fact, dir[o], n );
+
+  for  ( i = 0 ; i < Ncand ; i++ )  {
+    w = tData->candIn.weights[i];
+    o = thread_random() % Noutputs;
+    for  ( j = 0 ; j < n ; j++ )
+      w[j] = dir[o][j];
+    for  ( k = 0 ; k < Noutputs ; k++ )
+      if  ( k != o )  {
+	mix = random_weight( CINIT_MIX );
+	for  ( j = 0 ; j < n ; j++ )
+	  w[j] += mix * dir[k][j];
+      }
+
+    /*  Scale to the mean square summed input, w' G w / Npts  */
+    sum = 0.0;
+    for  ( j = 0 ; j < n ; j++ )  {
+      value = 0.5 * gram[j][j] * w[j];
+      for  ( k = j+1 ; k < n ; k++ )
+	value += gram[j][k] * w[k];
+      sum += 2.0 * w[j] * value;
+    }
+    value = ( sum > 0.0 ) ? CINIT_SPAN / sqrt( sum / Npts ) : 0.0;
+    for  ( j = 0 ; j < n ; j++ )
+      w[j] = value * w[j] + random_weight( CINIT_NOISE * parms->weightRange );
+  }
+
+  if  ( parms->algorithm != CASCADE2 )
+    return;
+
+  /*  Fit the output weights of each Cascade-2 candidate.  The recurrent  */
+  /* connection is left out of this first estimate.                       */
+  for  ( i = 0 ; i < Ncand ; i++ )  {
+    tData->candValues[i] = 0.0;
+    for  ( o = 0 ; o < Noutputs ; o++ )
+      tData->candOut.weights[i][o] = 0.0;
+  }
+  for  ( p = 0 ; p < Npts ; p++ )  {
+    vals = tData->valCache[p];
+    errs = tData->errCache[p];
+    for  ( i = 0 ; i < Ncand ; i++ )  {
+      w   = tData->candIn.weights[i];
+      sum = 0.0;
+      for  ( j = 0 ; j < n ; j++ )
+	sum += w[j] * vals[j];
+      value = activation( net, tData->candTypes[i], sum );
+      tData->candValues[i] += value * value;
+      for  ( o = 0 ; o < Noutputs ; o++ )
+	tData->candOut.weights[i][o] += value * errs[o];
+    }
+  }
+  for  ( i = 0 ; i < Ncand ; i++ )  {
+    if  ( tData->candValues[i] > 0.0 )
+      for  ( o = 0 ; o < Noutputs ; o++ )
+	tData->candOut.weights[i][o] /= tData->candValues[i];
+    tData->candValues[i] = 0.0;
+  }
 }
 
 
@@ -472,3 +855,48 @@ void init_error ( error_data_t *error, int Noutputs )
   for  ( i = 0 ; i < Noutputs ; i++ )
     error->sumErr[i] = 0.0;
 }
+
+
+/*  BUILD RLS -  Build the state for the online adaptation of the output
+    weights of a network with Nunits units.  The inverse correlation matrix
+    starts out as delta times the identity matrix.
+*/
+
+rls_data_t *build_rls ( int Nunits, float delta )
+{
+  rls_data_t *temp;
+  int        i, j;
+  char       *fn = "Build RLS Adaptation Data";
+
+  temp = (rls_data_t *)alloc_mem ( 1, sizeof( rls_data_t ), fn );
+  temp->Nunits = Nunits;
+  temp->Px     = (float *)alloc_mem ( Nunits, sizeof( float ), fn );
+  temp->gain   = (float *)alloc_mem ( Nunits, sizeof( float ), fn );
+  temp->P      = (float **)alloc_mem ( Nunits, sizeof( float * ), fn );
+  for  ( i = 0 ; i < Nunits ; i++ )  {
+    temp->P[i] = (float *)alloc_mem ( Nunits, sizeof( float ), fn );
+    for  ( j = 0 ; j < Nunits ; j++ )
+      temp->P[i][j] = (i == j) ? delta : 0.0;
+  }
+
+  return temp;
+}
+
+
+/*  FREE RLS -  Deallocate the online adaptation state of a network, if any.
+*/
+
+void free_rls ( rls_data_t **rls )
+{
+  int i;
+
+  if  ( *rls == NULL )
+    return;
+
+  for  ( i = 0 ; i < (*rls)->Nunits ; i++ )
+    free_mem( (*rls)->P[i] );
+  free_mem( (*rls)->P );
+  free_mem( (*rls)->Px );
+  free_mem( (*rls)->gain );
+  *rls = free_mem( *rls );
+}
@@ -20,44 +20,54 @@
 
 /*  Constants needed for the table lookup  */
 
-#define NUM_PARMS 55
+#define NUM_PARMS 81
 #define NOT_FOUND -1
 
 
 /*  External structures we need access to  */
 
-extern data_file_t   *cDFile;
-extern net_t         *cNet,
-                     *nets;
+extern net_t         *nets;
 extern df_t          *dFiles;
+extern registry_t    *models;
 extern train_parm_t  *cParms;
 extern boolean       interruptPending,
                      interact;
-extern jmp_buf       abort_trap;
+
+/*  Held by the run taking an interrupt, when several train at once  */
+
+static pthread_mutex_t interruptLock = PTHREAD_MUTEX_INITIALIZER;
 
 
 /*  A table of parameters and functions for the interface  */
 
 parm_t parmTable [NUM_PARMS] = {
   { "?",                  FUNC,    NULL, TRUE },
+  { "adaptNet",           FUNC,    NULL, FALSE },
   { "algorithm",          ALGO,    NULL, FALSE },
+  { "candAdapt",          BOOLEAN, NULL, FALSE },
   { "candChgThresh",      FLOAT,   NULL, TRUE },
   { "candEpochs",         INT,     NULL, TRUE },
   { "candInDecay",        FLOAT,   NULL, TRUE },
   { "candInEpsilon",      FLOAT,   NULL, TRUE },
+  { "candInit",           CINIT,   NULL, FALSE },
   { "candInMu",           FLOAT,   NULL, TRUE },
+  { "candLMUnits",        INT,     NULL, FALSE },
   { "candOutDecay",       FLOAT,   NULL, TRUE },
   { "candOutEpsilon",     FLOAT,   NULL, TRUE },
   { "candOutMu",          FLOAT,   NULL, TRUE },
   { "candPatience",       INT,     NULL, TRUE },
   { "candType",           NODE,    NULL, FALSE },
+  { "classTargets",       BOOLEAN, NULL, FALSE },
+  { "ensembleVote",       BOOLEAN, NULL, TRUE },
   { "errorIndexThresh",   FLOAT,   NULL, TRUE },
   { "errorMeasure",       ERR,     NULL, TRUE },
   { "errorScoreThresh",   FLOAT,   NULL, TRUE },
   { "exit",               FUNC,    NULL, TRUE },
+  { "exportC",            FUNC,    NULL, TRUE },
   { "inspectData",        FUNC,    NULL, TRUE },
   { "inspectNet",         FUNC,    NULL, TRUE },
   { "interact",           BOOLEAN, NULL, TRUE },
+  { "keepTrials",         BOOLEAN, NULL, FALSE },
   { "killData",           FUNC,    NULL, FALSE },
   { "killNet",            FUNC,    NULL, FALSE },
   { "list",               FUNC,    NULL, TRUE },
@@ -67,7 +77,10 @@ parm_t parmTable [NUM_PARMS] = {
   { "loadNet",            FUNC,    NULL, FALSE },
   { "loadScript",         FUNC,    NULL, TRUE },
   { "maxNewUnits",        INT,     NULL, FALSE },
+  { "maxResident",        INT,     NULL, TRUE },
+  { "memoEntries",        INT,     NULL, TRUE },
   { "NCands",             INT,     NULL, FALSE },
+  { "Nthreads",           INT,     NULL, TRUE },
   { "outPrimeOffset",     FLOAT,   NULL, TRUE },
   { "outputChgThresh",    FLOAT,   NULL, TRUE },
   { "outputDecay",        FLOAT,   NULL, TRUE },
@@ -76,20 +89,35 @@ parm_t parmTable [NUM_PARMS] = {
   { "outputMu",           FLOAT,   NULL, TRUE },
   { "outputPatience",     INT,     NULL, TRUE },
   { "overshootOK",        BOOLEAN, NULL, TRUE },
+  { "predictFile",        FUNC,    NULL, TRUE },
+  { "predictFormat",      PFMT,    NULL, TRUE },
   { "predictNet",         FUNC,    NULL, TRUE },
+  { "prune",              FUNC,    NULL, FALSE },
+  { "pruneRefit",         BOOLEAN, NULL, TRUE },
+  { "pruneThreshold",     FLOAT,   NULL, TRUE },
+  { "quantize",           FUNC,    NULL, FALSE },
+  { "quantized",          BOOLEAN, NULL, TRUE },
   { "query",              FUNC,    NULL, FALSE },
   { "quit",               FUNC,    NULL, TRUE },
   { "recurrent",          BOOLEAN, NULL, FALSE },
+  { "registerNet",        FUNC,    NULL, FALSE },
   { "resizeNet",          FUNC,    NULL, FALSE },
+  { "rlsDelta",           FLOAT,   NULL, TRUE },
+  { "rlsForget",          FLOAT,   NULL, TRUE },
   { "runTrials",          FUNC,    NULL, FALSE },
   { "saveNet",            FUNC,    NULL, TRUE },
   { "saveScript",         FUNC,    NULL, TRUE },
+  { "serve",              FUNC,    NULL, FALSE },
   { "sigMax",             FLOAT,   NULL, TRUE },
   { "sigMin",             FLOAT,   NULL, TRUE },
+  { "softmax",            BOOLEAN, NULL, FALSE },
+  { "sweep",              FUNC,    NULL, FALSE },
   { "syncNet",            FUNC,    NULL, FALSE },
   { "test",               BOOLEAN, NULL, TRUE },
   { "testNet",            FUNC,    NULL, FALSE },
   { "train",              FUNC,    NULL, FALSE },
+  { "trialSeed",          INT,     NULL, TRUE },
+  { "trialThreads",       INT,     NULL, TRUE },
   { "useCache",           BOOLEAN, NULL, FALSE },
   { "validate",           BOOLEAN, NULL, TRUE },
   { "validationPatience", INT,     NULL, TRUE },
@@ -100,10 +128,10 @@ parm_t parmTable [NUM_PARMS] = {
 /*  CLI -  Command Line Interface.  This function simply reads in command lines
     and then dispatches to another function that processes the commands.  This
     process continues until a false response is returned from the command 
-    processor.
+    processor.  'run' is the training run that was interrupted, if any.
 */
 
-void cli  ( boolean runStarted )
+void cli  ( train_ctx_t *run )
 {
   char inBuffer [MAX_INPUT],
        *parm = NULL,
@@ -123,28 +151,29 @@ void cli  ( boolean runStarted )
     parmVal  = strtok( NULL,     " \t" );
     parmVal2 = strtok( NULL,     " \t" );
 
-  }  while( process_command( runStarted, parm, parmVal, parmVal2 ) );
+  }  while( process_command( run, parm, parmVal, parmVal2 ) );
 }
 
 
 /*  PROCESS COMMAND -  This function dispatches the commands received at the
     cli.  There are two commands that need to be checked for specially:
     continue and abort.  These two commands are looked up explicitly, the
-    others done via table lookup.
+    others done via table lookup.  Both apply to 'run', the training run in
+    progress, or are refused if it is NULL.
 */
 
-boolean process_command  ( boolean runStarted, char *parm, char *parmVal, 
+boolean process_command  ( train_ctx_t *run, char *parm, char *parmVal, 
 			   char *parmVal2 )
 {
   int loc;
 
   /*  Check for continue and abort  */
-  if  ( runStarted && !strcasecmp( parm, "continue" ) )  return FALSE;
+  if  ( (run != NULL) && !strcasecmp( parm, "continue" ) )  return FALSE;
   if  ( !strcasecmp( parm, "abort" ) )
-    if  ( runStarted )  {
+    if  ( run != NULL )  {
       printf ( "Aborting training of %s on %s at epoch %d.\n",
-	       cNet->name, cDFile->filename, cNet->epochsTrained );
-      longjmp( abort_trap, 1 );
+	       run->net->name, run->dFile->filename, run->net->epochsTrained );
+      longjmp( run->abortTrap, 1 );
     }  else  {
       printf ( "Run not started.\n" );
       return TRUE;
@@ -159,7 +188,7 @@ boolean process_command  ( boolean runStarted, char *parm, char *parmVal,
   /*  If no value was specified for a parm, display information on it.  */
   if  ( interact && (parmVal == NULL) && (parmTable[loc].type != FUNC) )
     display_parm( parmTable[loc] );
-  set_parm( runStarted, parmTable[loc], parmVal, parmVal2 );
+  set_parm( run != NULL, parmTable[loc], parmVal, parmVal2 );
 
   return TRUE;
 }
@@ -225,6 +254,16 @@ void display_parm  ( parm_t parm )
                     printf ("Current value:\t%s",
 			    etoa( *(error_t *)parm.ptr ));
                     break;
+    case CINIT:     printf ("Type:\t\tCandidate Initialization ");
+                    printf ("(Random, Residual)\n");
+                    printf ("Current value:\t%s",
+			    citoa( *(cinit_t *)parm.ptr ));
+                    break;
+    case PFMT:      printf ("Type:\t\tPrediction File Format ");
+                    printf ("(Raw, Tokens, Both, Binary, Class)\n");
+                    printf ("Current value:\t%s",
+			    pftoa( *(pformat_t *)parm.ptr ));
+                    break;
     case FUNC:      printf ("Type:\t\tSpecial Function");
                     break;
     }
@@ -273,6 +312,10 @@ void set_parm  ( boolean runStarted, parm_t parm, char *parmVal, char *parmVal2
                    break;
     case ERR:      *(error_t *)parm.ptr = atoe( val );
                    break;
+    case CINIT:    *(cinit_t *)parm.ptr = atoci( val );
+                   break;
+    case PFMT:     *(pformat_t *)parm.ptr = atopf( val );
+                   break;
     case FUNC:     ((void (*)(char *, char *))parm.ptr)(parmVal, parmVal2);
                    break;
     }
@@ -288,24 +331,32 @@ void set_parmtable  ( train_parm_t *parms )
   int i = 0;
 
   parmTable[i++].ptr =  (void *)list_parms;
+  parmTable[i++].ptr =  (void *)adapt;
   parmTable[i++].ptr =  (void *)&(parms->algorithm);
+  parmTable[i++].ptr =  (void *)&(parms->candAdapt);
   parmTable[i++].ptr =  (void *)&(parms->candidateParm.changeThreshold);
   parmTable[i++].ptr =  (void *)&(parms->candidateParm.epochs);
   parmTable[i++].ptr =  (void *)&(parms->candInUpdate.decay);
   parmTable[i++].ptr =  (void *)&(parms->candInUpdate.epsilon);
+  parmTable[i++].ptr =  (void *)&(parms->candInit);
   parmTable[i++].ptr =  (void *)&(parms->candInUpdate.mu);
+  parmTable[i++].ptr =  (void *)&(parms->candLMUnits);
   parmTable[i++].ptr =  (void *)&(parms->candOutUpdate.decay);
   parmTable[i++].ptr =  (void *)&(parms->candOutUpdate.epsilon);
   parmTable[i++].ptr =  (void *)&(parms->candOutUpdate.mu);
   parmTable[i++].ptr =  (void *)&(parms->candidateParm.patience);
   parmTable[i++].ptr =  (void *)&(parms->candType);
+  parmTable[i++].ptr =  (void *)&(parms->classTargets);
+  parmTable[i++].ptr =  (void *)&(parms->ensembleVote);
   parmTable[i++].ptr =  (void *)&(parms->indexThreshold);
   parmTable[i++].ptr =  (void *)&(parms->errorMeasure);
   parmTable[i++].ptr =  (void *)&(parms->scoreThreshold);
   parmTable[i++].ptr =  (void *)quit;
+  parmTable[i++].ptr =  (void *)export_c;
   parmTable[i++].ptr =  (void *)inspect_data;
   parmTable[i++].ptr =  (void *)inspect_net;
   parmTable[i++].ptr =  (void *)&interact;
+  parmTable[i++].ptr =  (void *)&(parms->keepTrials);
   parmTable[i++].ptr =  (void *)kill_data;
   parmTable[i++].ptr =  (void *)kill_net;
   parmTable[i++].ptr =  (void *)list_parms;
@@ -315,7 +366,10 @@ void set_parmtable  ( train_parm_t *parms )
   parmTable[i++].ptr =  (void *)load_net;
   parmTable[i++].ptr =  (void *)load_script;
   parmTable[i++].ptr =  (void *)&(parms->maxNewUnits);
+  parmTable[i++].ptr =  (void *)&(parms->maxResident);
+  parmTable[i++].ptr =  (void *)&(parms->memoEntries);
   parmTable[i++].ptr =  (void *)&(parms->Ncand);
+  parmTable[i++].ptr =  (void *)&(parms->Nthreads);
   parmTable[i++].ptr =  (void *)&(parms->outPrimeOffset);
   parmTable[i++].ptr =  (void *)&(parms->outputParm.changeThreshold);
   parmTable[i++].ptr =  (void *)&(parms->outputUpdate.decay);
@@ -324,20 +378,35 @@ void set_parmtable  ( train_parm_t *parms )
   parmTable[i++].ptr =  (void *)&(parms->outputUpdate.mu);
   parmTable[i++].ptr =  (void *)&(parms->outputParm.patience);
   parmTable[i++].ptr =  (void *)&(parms->overshootOK);
+  parmTable[i++].ptr =  (void *)predict_file;
+  parmTable[i++].ptr =  (void *)&(parms->predictFormat);
   parmTable[i++].ptr =  (void *)predict;
+  parmTable[i++].ptr =  (void *)prune;
+  parmTable[i++].ptr =  (void *)&(parms->pruneRefit);
+  parmTable[i++].ptr =  (void *)&(parms->pruneThreshold);
+  parmTable[i++].ptr =  (void *)quantize;
+  parmTable[i++].ptr =  (void *)&(parms->quantized);
   parmTable[i++].ptr =  (void *)query_net;
   parmTable[i++].ptr =  (void *)quit;
   parmTable[i++].ptr =  (void *)&(parms->recurrent);
+  parmTable[i++].ptr =  (void *)register_net;
   parmTable[i++].ptr =  (void *)resize_net;
+  parmTable[i++].ptr =  (void *)&(parms->rlsDelta);
+  parmTable[i++].ptr =  (void *)&(parms->rlsForget);
   parmTable[i++].ptr =  (void *)run_trials;
   parmTable[i++].ptr =  (void *)save_net;
   parmTable[i++].ptr =  (void *)save_script;
+  parmTable[i++].ptr =  (void *)serve;
   parmTable[i++].ptr =  (void *)&(parms->sigMax);
   parmTable[i++].ptr =  (void *)&(parms->sigMin);
+  parmTable[i++].ptr =  (void *)&(parms->softmax);
+  parmTable[i++].ptr =  (void *)sweep;
   parmTable[i++].ptr =  (void *)sync_net;
   parmTable[i++].ptr =  (void *)&(parms->test);
   parmTable[i++].ptr =  (void *)test;
   parmTable[i++].ptr =  (void *)train;
+  parmTable[i++].ptr =  (void *)&(parms->trialSeed);
+  parmTable[i++].ptr =  (void *)&(parms->trialThreads);
   parmTable[i++].ptr =  (void *)&(parms->useCache);
   parmTable[i++].ptr =  (void *)&(parms->validate);
   parmTable[i++].ptr =  (void *)&(parms->validationPatience);
@@ -389,6 +458,9 @@ void train  ( char *netName, char *dFileName )
       fprintf ( stderr, "Unable to parse data file '%s'.\n", dFileName );
       return;
     }
+    if  ( cParms->classTargets && !class_targets( dFile ) )
+      fprintf ( stderr, "Targets in '%s' kept as output vectors.\n",
+		dFileName );
     add_data_file( dFile );
   }
 
@@ -396,7 +468,7 @@ void train  ( char *netName, char *dFileName )
   if  (dFile->train == NULL)  {
     fprintf (stderr,
 	     "No training data available in file '%s'.  Run not started.\n",
-	     cDFile->filename);
+	     dFile->filename);
     return;
   }
 
@@ -407,7 +479,7 @@ void train  ( char *netName, char *dFileName )
 		     cParms->sigMax, cParms->sigMin, cParms->recurrent );
     init_net( net, cParms->weightRange );
     if  ( !interact || prompt_yn( "Sync net outputs to data set", TRUE ) )
-      sync( net, dFile );
+      sync( net, cParms, dFile );
     add_net( net );
   } else if  ( (net->Ninputs != dFile->NinNodes) &&
 	       (net->Noutputs != dFile->NoutNodes ) )  {
@@ -421,6 +493,92 @@ void train  ( char *netName, char *dFileName )
 }
 
 
+/*  ADAPT -  Adapt a trained network online to the training data of a data
+    file.  Only the output weights are changed, one point at a time, so the
+    network can follow a drifting input distribution without a retrain.
+    Rules for locating networks and data are the same as for testing.
+*/
+
+void adapt  ( char *netName, char *dFileName )
+{
+  char           nName[61],
+                 dFName[61];
+  net_t          *net;
+  data_file_t    *dFile;
+  trial_result_t results;
+  int            outVals;
+  clock_t        start;
+  float          usecs;
+
+  /*  Get the name of the network  */
+  if  ( netName == NULL )
+    if  ( interact )  {
+      printf ("Network Name: ");
+      scanf  ("%s",nName);
+      netName = nName;
+    } else {
+      fprintf ( stderr, "No name specified for network to adapt.\n");
+      fprintf ( stderr, "Adaptation aborted.\n");
+      return;
+    }
+
+  /*  Get the name of the data file  */
+  if  ( dFileName == NULL )
+    if  ( interact )  {
+      printf ( "Data file name: " );
+      scanf  ( "%s", dFName );
+      dFileName = dFName;
+    } else {
+      fprintf ( stderr, "No data file specified for adaptation.\n" );
+      fprintf ( stderr, "Adaptation aborted.\n" );
+      return;
+    }
+
+  /*  Locate the data and check for training data  */
+  if  ( (dFile = select_data ( dFileName )) == NULL )  {
+    if  ( !parse_data ( dFileName, DEF_SIGMAX, DEF_SIGMIN, &dFile ) )  {
+      fprintf ( stderr, "Unable to parse data file '%s'.\n", dFileName );
+      return;
+    }
+    if  ( cParms->classTargets && !class_targets( dFile ) )
+      fprintf ( stderr, "Targets in '%s' kept as output vectors.\n",
+		dFileName );
+    add_data_file( dFile );
+  }
+  if  (dFile->train == NULL)  {
+    fprintf (stderr,
+	     "No training data available in file '%s'.  Adaptation aborted.\n",
+	     dFile->filename);
+    return;
+  }
+
+  /*  Locate the network  */
+  if  ( (net = select_net( netName )) == NULL )  {
+    fprintf (stderr, "Network '%s' not found.  Adaptation aborted.\n",
+	     netName );
+    return;
+  } else if  ( (net->Ninputs != dFile->NinNodes) ||
+	       (net->Noutputs != dFile->NoutNodes ) )  {
+    fprintf (stderr,"Number of inputs/outputs in net and data file must");
+    fprintf (stderr," be the same.\nAdaptation aborted.\n");
+    return;
+  }
+
+  /*  Stream the data through the network  */
+  printf ("Adapting '%s' to training data in '%s'...", netName, dFileName);
+
+  start   = clock( );
+  results = adapt_net( net, cParms, dFile->train );
+  usecs   = ( 1.0e6 * (clock( ) - start) ) / CLOCKS_PER_SEC;
+  outVals = dFile->train->Npts * net->Noutputs;
+  results.perCorrect = (((float)(outVals-results.bits))/outVals)*100.0;
+  
+  printf ("done!\n");
+  display_adapt_results  ( results, dFile->train->Npts,
+			   usecs / dFile->train->Npts );
+}
+
+
 /*  TEST -  Run a test epoch on the indicated network and then report the
     results.  Same rules for locating networks and data apply as in training.
     The value of the global variables is NOT maintained, but this should not
@@ -468,6 +626,9 @@ void test  ( char *netName, char *dFileName )
       fprintf ( stderr, "Unable to parse data file '%s'.\n", dFileName );
       return;
     }
+    if  ( cParms->classTargets && !class_targets( dFile ) )
+      fprintf ( stderr, "Targets in '%s' kept as output vectors.\n",
+		dFileName );
     add_data_file( dFile );
   }
   if  (dFile->test == NULL)  {
@@ -488,11 +649,10 @@ void test  ( char *netName, char *dFileName )
     return;
   }
 
-  /*  Set global variables and perform the test epoch  */
+  /*  Perform the test epoch  */
   printf ("Testing '%s' on test data in '%s'...", netName, dFileName);
 
-  set_globals ( net, cParms, NULL, dFile, NULL );
-  results = test_net( net, dFile->test );
+  results = test_net( net, cParms, dFile->test, NULL );
   outVals = dFile->test->Npts * net->Noutputs;
   results.perCorrect = (((float)(outVals-results.bits))/outVals)*100.0;
   
@@ -515,11 +675,14 @@ void predict  ( char *netName, char *dFileName )
                  dFName[61],
                  **intok,
                  **outtok;
+  net_t          *net;
   data_file_t    *dFile;
   data_set_t     *dSet;
   int            outVals,
                  i,j;
-  float          aveSig;
+  float          aveSig,
+                 **outputs;
+  char           *fn = "Predict";
 
   /*  Get the name of the network to use  */
   if  ( netName == NULL )
@@ -551,6 +714,9 @@ void predict  ( char *netName, char *dFileName )
       fprintf ( stderr, "Unable to parse data file '%s'.\n", dFileName );
       return;
     }
+    if  ( cParms->classTargets && !class_targets( dFile ) )
+      fprintf ( stderr, "Targets in '%s' kept as output vectors.\n",
+		dFileName );
     add_data_file( dFile );
   }
   if  (dFile->predict == NULL)  {
@@ -561,12 +727,12 @@ void predict  ( char *netName, char *dFileName )
   }
 
   /*  Select the network and check for appropriate inputs/outputs  */  
-  if  ( (cNet = select_net( netName )) == NULL )  {
+  if  ( (net = select_net( netName )) == NULL )  {
     fprintf (stderr, "Network '%s' not found.  Prediction aborted.\n", 
 	     netName );
     return;
-  } else if  ( (cNet->Ninputs != dFile->NinNodes) &&
-	       (cNet->Noutputs != dFile->NoutNodes ) )  {
+  } else if  ( (net->Ninputs != dFile->NinNodes) &&
+	       (net->Noutputs != dFile->NoutNodes ) )  {
     fprintf (stderr,"Number of inputs/outputs in net and data file must");
     fprintf (stderr," be the same.\nRun not started.\n");
     return;
@@ -574,33 +740,35 @@ void predict  ( char *netName, char *dFileName )
 
   printf ("Testing '%s' on prediction data in '%s'.\n", netName, dFileName);
 
-  /*  Set up for the epoch  */
-  set_globals ( cNet, cParms, NULL, dFile, NULL );
-  cNet->values = cNet->tempValues;
+  /*  Predict on every data point, then display the results in order  */
   dSet         = dFile->predict;
-  aveSig       = (cNet->sigmoidMax-cNet->sigmoidMin)/2.0;
+  aveSig       = (net->sigmoidMax-net->sigmoidMin)/2.0;
 
-  for  ( i = 0 ; i < dSet->Npts ; i++ )  {
-    /*  Predict on a data point  */
-    forward_pass ( dSet->data[i].inputs, dSet->data[i].reset );
+  outputs = (float **)alloc_mem( dSet->Npts, sizeof( float * ), fn );
+  for  ( i = 0 ; i < dSet->Npts ; i++ )
+    outputs[i] = (float *)alloc_mem( net->Noutputs, sizeof( float ), fn );
+  eval_net( net, cParms, dSet, NULL, outputs, NULL, NULL );
 
+  for  ( i = 0 ; i < dSet->Npts ; i++ )  {
     /*  Compute input/output token strings  */
-    intok  = ftot ( dSet->data[i].inputs, aveSig, cNet->Ninputs, 
-		    cNet->inputMap );
-    outtok = ftot ( cNet->outValues, aveSig, cNet->Noutputs, cNet->outputMap );
+    intok  = ftot ( dSet->data[i].inputs, aveSig, net->Ninputs, 
+		    net->inputMap );
+    outtok = ftot ( outputs[i], aveSig, net->Noutputs, net->outputMap );
 
     /*  Display the tokens  */
-    for  ( j = 0 ; j < cNet->Ninputs ; j++ )  {
-      printf ("%s%s",intok[j],(j==cNet->Ninputs-1)?" => ":", ");
+    for  ( j = 0 ; j < net->Ninputs ; j++ )  {
+      printf ("%s%s",intok[j],(j==net->Ninputs-1)?" => ":", ");
       free( intok[j] );
     }
     free( intok );
-    for  ( j = 0 ; j < cNet->Noutputs ; j++ )  {
-      printf ("%s%s",outtok[j],(j==cNet->Noutputs-1)?"\n":", ");
+    for  ( j = 0 ; j < net->Noutputs ; j++ )  {
+      printf ("%s%s",outtok[j],(j==net->Noutputs-1)?"\n":", ");
       free( outtok[j] );
     }
     free( outtok );
+    free_mem( outputs[i] );
   }
+  free_mem( outputs );
 }
 
 
@@ -646,6 +814,10 @@ void list_parms  ( char *d1, char *d2 )
 	              break;
 	case ERR:     printf ("%s\n",etoa( *(error_t *)(parmTable[i].ptr) ));
 	              break;
+	case CINIT:   printf ("%s\n",citoa( *(cinit_t *)(parmTable[i].ptr) ));
+	              break;
+	case PFMT:    printf ("%s\n",pftoa( *(pformat_t *)(parmTable[i].ptr) ));
+	              break;
 	}
     }
 
@@ -668,7 +840,8 @@ void list_parms  ( char *d1, char *d2 )
 }
 
 
-/*  LIST NETS -  List the neural networks that currently reside in memory.
+/*  LIST NETS -  List the neural networks that currently reside in memory,
+    and those registered to be loaded as they are used.
 */
 
 void list_nets ( char *d1, char *d2 )
@@ -681,6 +854,8 @@ void list_nets ( char *d1, char *d2 )
     printf ("  %s\n",index->name);
     index = index->next;
   }
+  if  ( models != NULL )
+    list_models( models );
 }
 
 
@@ -704,17 +879,39 @@ void list_data ( char *d1, char *d2 )
     used for training and is discarded after the results of training have been
     accumulated.  The aggregate results of training are reported at the end of
     the last trial.
+
+    If 'keepTrials' is set, each trial instead trains a network of its own,
+    named 'trial1', 'trial2' and so on, which is kept in memory.  At the end
+    of the run the kept networks are tested as an ensemble (see ensemble.c),
+    on the data the trials were scored on.
+
+    Up to 'trialThreads' trials are trained at once, each thread with a
+    dummy network of its own, and their progress reports are interleaved.
+    Each trial draws from a random stream of its own, seeded from
+    'trialSeed' and its number, and evaluates its data sets with
+    'Nthreads' threads as a lone trial would, so the results of a run do
+    not depend on how many trials run at once.  An interrupt suspends only the trial
+    that notices it, and parameters changed then do not reach the others.
 */
 
 void run_trials  ( char *numTrials, char *dataFile )
 {
   int            Ntrials,
+                 Nworkers,
                  i;
-  net_t          *tempNet;
+  net_t          **kept = NULL;
   data_file_t    *dFile;
+  data_set_t     *eSet;
+  ensemble_t     *ens;
+  trial_pool_t   pool;
+  pthread_t      *workers;
+  boolean        *threaded;
   trial_result_t trialResult,
-                 runResult;
-  char           dFileName [41];
+                 runResult,
+                 ensResult;
+  char           dFileName [41],
+                 trialName [21],
+                 *fn = "Run Trials";
 
   /*  Get the number of trials to run  */
   if  ( numTrials == NULL )
@@ -749,28 +946,69 @@ void run_trials  ( char *numTrials, char *dataFile )
       fprintf ( stderr, "Unable to parse data file '%s'.\n", dataFile );
       return;
     }
+    if  ( cParms->classTargets && !class_targets( dFile ) )
+      fprintf ( stderr, "Targets in '%s' kept as output vectors.\n",
+		dataFile );
     add_data_file( dFile );
   }
   if  (dFile->train == NULL)  {
     fprintf (stderr,
 	     "No training data available in file '%s'.  Run not started.\n",
-	     cDFile->filename);
+	     dFile->filename);
     return;
   }
 
-  tempNet   = build_net("Trial Net", dFile->NinNodes, dFile->NoutNodes,
-			cParms->maxNewUnits, cParms->weightRange, 
-			cParms->sigMax, cParms->sigMin, cParms->recurrent);
+  /*  Networks to be kept are made here, since the list of networks is  */
+  /* not to be changed by the threads                                  */
+  if  ( cParms->keepTrials )  {
+    kept = (net_t **)alloc_mem( Ntrials, sizeof( net_t * ), fn );
+    for  ( i = 0 ; i < Ntrials ; i++ )  {
+      sprintf ( trialName, "trial%d", i+1 );
+      if  ( del_net( trialName ) )
+	printf ("Network '%s' replaced.\n", trialName );
+      kept[i] = build_net( trialName, dFile->NinNodes, dFile->NoutNodes,
+			   cParms->maxNewUnits, cParms->weightRange, 
+			   cParms->sigMax, cParms->sigMin, cParms->recurrent );
+      add_net( kept[i] );
+    }
+  }
+
+  /*  Share the trials out among the threads, running the first share  */
+  /* on this one                                                      */
+  Nworkers = ( cParms->trialThreads > 0 ) ? cParms->trialThreads :
+                                            num_processors( );
+  if  ( Nworkers > Ntrials )
+    Nworkers = Ntrials;
+  pthread_mutex_init( &(pool.lock), NULL );
+  pool.dFile    = dFile;
+  pool.parms    = cParms;
+  pool.kept     = kept;
+  pool.results  = (trial_result_t *)alloc_mem( Ntrials,
+					       sizeof( trial_result_t ), fn );
+  pool.seed     = ( cParms->trialSeed != 0 ) ? cParms->trialSeed : random( );
+  pool.Ntrials  = Ntrials;
+  pool.next     = 0;
+
+  workers  = (pthread_t *)alloc_mem( Nworkers, sizeof( pthread_t ), fn );
+  threaded = (boolean *)alloc_mem( Nworkers, sizeof( boolean ), fn );
+  for  ( i = 1 ; i < Nworkers ; i++ )
+    threaded[i] = ( pthread_create( workers+i, NULL, trial_thread,
+				    (void *)&pool ) == 0 );
+  trial_thread( (void *)&pool );
+  for  ( i = 1 ; i < Nworkers ; i++ )
+    if  ( threaded[i] )
+      pthread_join( workers[i], NULL );
+  free_mem( workers );
+  free_mem( threaded );
+  pthread_mutex_destroy( &(pool.lock) );
 
   for  ( i = 0 ; i < Ntrials ; i++ )  {
-    /*  Run a trial  */
-    init_net( tempNet, cParms->weightRange );
-    trialResult = train_net( tempNet, cParms, dFile, i+1 );
+    trialResult = pool.results[i];
 
     /*  Add the results of this trial to the previous trials  */
     if  ( i == 0 )  {
       runResult        = trialResult;
-      runResult.Nunits -= tempNet->Ninputs+1;
+      runResult.Nunits -= dFile->NinNodes+1;
     } else {
       runResult.bits       += trialResult.bits;
       runResult.Nepochs    += trialResult.Nepochs;
@@ -779,16 +1017,74 @@ void run_trials  ( char *numTrials, char *dataFile )
 #endif
       runResult.time       += trialResult.time;
       runResult.Nvictories += trialResult.Nvictories;
-      runResult.Nunits     += trialResult.Nunits-cNet->Ninputs-1;
+      runResult.Nunits     += trialResult.Nunits-dFile->NinNodes-1;
       runResult.perCorrect += trialResult.perCorrect;
       runResult.index      += trialResult.index;
       runResult.sumSqDiffs += trialResult.sumSqDiffs;
       runResult.sumSqError += trialResult.sumSqError;
     }
   }
+  free_mem( pool.results );
 
   display_run_results  ( runResult, Ntrials, cParms->errorMeasure );
-  free_net( &tempNet );
+  if  ( !cParms->keepTrials )
+    return;
+
+  /*  Test the kept networks together on the data the trials were  */
+  /* scored on                                                     */
+  eSet = ( cParms->test && (dFile->test != NULL) ) ? dFile->test :
+                                                     dFile->train;
+  ens  = build_ensemble( kept, Ntrials, cParms->ensembleVote, dFile->binPos,
+			 dFile->binNeg );
+  if  ( ens != NULL )  {
+    ensResult = test_ensemble( ens, cParms, eSet );
+    display_ensemble_results( ensResult, runResult, Ntrials,
+			      cParms->ensembleVote, eSet->Npts );
+    free_ensemble( &ens );
+  }
+  free_mem( kept );
+}
+
+
+/*  TRIAL THREAD -  Train trials of the run 'arg' (a trial_pool_t) until
+    none are left to start.  The thread trains each trial with a fresh
+    copy of the run's parameters, on the trial's kept network or else on
+    a dummy network of its own.
+*/
+
+void *trial_thread  ( void *arg )
+{
+  trial_pool_t   *pool = (trial_pool_t *)arg;
+  train_parm_t   parms;
+  net_t          *net = NULL;
+  unsigned short stream[3];
+  int            i;
+
+  for  ( ;; )  {
+    pthread_mutex_lock( &(pool->lock) );
+    i = pool->next++;
+    pthread_mutex_unlock( &(pool->lock) );
+    if  ( i >= pool->Ntrials )
+      break;
+
+    parms          = *(pool->parms);
+    if  ( pool->kept != NULL )
+      net = pool->kept[i];
+    else if  ( net == NULL )
+      net = build_net( "Trial Net", pool->dFile->NinNodes,
+		       pool->dFile->NoutNodes, parms.maxNewUnits,
+		       parms.weightRange, parms.sigMax, parms.sigMin,
+		       parms.recurrent );
+
+    seed_random( stream, pool->seed + i );
+    init_net( net, parms.weightRange );
+    pool->results[i] = train_net( net, &parms, pool->dFile, i+1 );
+  }
+
+  seed_random( NULL, 0 );
+  if  ( pool->kept == NULL )
+    free_net( &net );
+  return NULL;
 }
 
 
@@ -836,7 +1132,7 @@ void load_script  ( char *script, char *d1 )
       parmVal2 = strtok( NULL,   " \t" );
       
       if  ( parm != NULL )
-	process_command ( FALSE, parm, parmVal, parmVal2 );
+	process_command ( NULL, parm, parmVal, parmVal2 );
     }
     fgets ( input_line, 80, fptr );
   }
@@ -897,6 +1193,12 @@ void save_script  ( char *script, char *d1 )
       case ERR:     fprintf (fptr, "%s\n",
 			     etoa( *(error_t *)(parmTable[i].ptr) ));
 	            break;
+      case CINIT:   fprintf (fptr, "%s\n",
+			     citoa( *(cinit_t *)(parmTable[i].ptr) ));
+	            break;
+      case PFMT:    fprintf (fptr, "%s\n",
+			     pftoa( *(pformat_t *)(parmTable[i].ptr) ));
+	            break;
     }
   }
 
@@ -913,8 +1215,6 @@ void save_net ( char *netName, char *filename )
 {
   FILE   *netFile;
   net_t  *net;
-  int    i,j,k;
-  cvrt_t *map;
   char   name    [41];
   char   outfile [41];
 
@@ -950,6 +1250,19 @@ void save_net ( char *netName, char *filename )
     return;
   }
 
+  write_net( net, netFile );
+  fclose( netFile );
+}
+
+
+/*  WRITE NET -  Write a network to an open file in the form read_net reads.
+*/
+
+void write_net ( net_t *net, FILE *netFile )
+{
+  int    i,j,k;
+  cvrt_t *map;
+
   fprintf (netFile,"Name: %s\n",net->name);
   fprintf (netFile,"epochsTrained: %d\tNunits: %d\tNinputs: %d\n",
 	   net->epochsTrained, net->Nunits, net->Ninputs);
@@ -1033,7 +1346,7 @@ void save_net ( char *netName, char *filename )
   for  ( i = net->Ninputs + 1; i < net->Nunits ; i++ )  {
     fprintf  ( netFile, "$hiddenWeights(%d)\n",i+1);
     j = 0;
-    while  ( j < i )  {
+    while  ( j < i + net->recurrent )  {
       fprintf  ( netFile, "%f  ", net->weights[i][j] );
       j++;
       if  ( ( j % 6 ) == 0 )
@@ -1043,8 +1356,6 @@ void save_net ( char *netName, char *filename )
       fprintf  ( netFile, "\n" );
     fprintf ( netFile, "\n");
   }
-
-  fclose( netFile );
 }
 
 
@@ -1055,17 +1366,7 @@ void load_net ( char *fname, char *d1 )
 {
   FILE    *netFile;
   net_t   *net;
-  char    filename[81],
-          netName[81],
-          lineIn[81],
-          recurrent[21],
-          *tok,
-          *delim = " \t\n",
-          *fn = "Load Network";
-  int     eTrained, Nunits, Ninputs,
-          Noutputs, NhiddenUnits,
-          count = 0,index,i,j;
-  float   sigMax, sigMin;
+  char    filename[81];
 
   if  ( fname == NULL )
     if  ( interact )  {
@@ -1083,6 +1384,41 @@ void load_net ( char *fname, char *d1 )
     return;
   }
 
+  net = read_net( netFile );
+  fclose( netFile );
+  if  ( net == NULL )
+    return;
+
+  if ( select_net( net->name ) != NULL )  {
+    fprintf (stderr,"ERROR: Network '%s' already in memory.\n", net->name);
+    free_net( &net );
+    return;
+  }
+  add_net( net );
+
+  printf ("Network '%s' loaded.\n", net->name );
+}
+
+
+/*  READ NET -  Read a network saved by save_net from an open file.  The
+    network is returned without being added to those in memory, or NULL
+    if the file does not hold a whole network.
+*/
+
+net_t *read_net ( FILE *netFile )
+{
+  net_t   *net = NULL;
+  char    netName[81],
+          lineIn[81],
+          recurrent[21],
+          *tok,
+          *delim = " \t\n",
+          *fn = "Read Network";
+  int     eTrained, Nunits, Ninputs,
+          Noutputs, NhiddenUnits,
+          count = 0,index = 0,i,j;
+  float   sigMax, sigMin;
+
   while ( !feof( netFile ) )  {
     fgets ( lineIn, 80, netFile );
     if  ( lineIn[0] == '$' )  {
@@ -1093,11 +1429,6 @@ void load_net ( char *fname, char *d1 )
     if  ( lineIn[0] != '#' && lineIn[0] != '\n' )
       switch ( count )  {
         case 0:  sscanf (lineIn, "Name: %s", netName);
-	         if ( select_net( netName ) != NULL )  {
-		   fprintf (stderr,"ERROR: Network '%s' already in memory.\n",
-			    netName);
-		   return;
-		 }
 	         count++;
 	         break;
 	case 1:  sscanf (lineIn, "epochsTrained: %d Nunits: %d Ninputs: %d",
@@ -1109,7 +1440,7 @@ void load_net ( char *fname, char *d1 )
 			     eTrained, Nunits );
 		   fprintf ( stderr, "Ninputs= %d\n", Ninputs);
 		   fprintf ( stderr, "Network not loaded.\n");
-		   return;
+		   return NULL;
 		 }
 	         count++;
 	         break;
@@ -1121,7 +1452,7 @@ void load_net ( char *fname, char *d1 )
 		   fprintf ( stderr, "Noutputs= %d\tNhiddenUnits= %d\n",
 			     Noutputs, NhiddenUnits );
 		   fprintf ( stderr, "Network not loaded.\n");
-		   return;
+		   return NULL;
 		 }
 	         count++;
 	         break;
@@ -1133,19 +1464,24 @@ void load_net ( char *fname, char *d1 )
 		   fprintf ( stderr, "sigmoidMax= %f\tsigmoidMin= %f\n",
 			     sigMax, sigMin );
 		   fprintf ( stderr, "Network not loaded.\n");
-		   return;
+		   return NULL;
 		 }
+	         if  ( net != NULL )
+		   break;
 	         net = build_net ( netName, Ninputs, Noutputs, NhiddenUnits,
 				    1.0, sigMax, sigMin, atob( recurrent ) );
 	         net->NhiddenUnits = NhiddenUnits;
 	         net->Nunits       = Nunits;
 	         net->maxNewUnits  = 0;
 	         net->epochsTrained = eTrained;
+	         for  ( i = Ninputs+1 ; i < Nunits && net->recurrent ; i++ )
+		   net->weights[i][i] = 0.0;  /*  Older files lack them  */
 	         net->inputMap = (cvrt_t *)alloc_mem( Ninputs, 
 						       sizeof( cvrt_t ), fn );
 	         net->outputMap = (cvrt_t *)alloc_mem( Noutputs,
 						        sizeof( cvrt_t ), fn );
-	         add_net( net );
+	         memset( net->inputMap, 0, Ninputs * sizeof( cvrt_t ) );
+	         memset( net->outputMap, 0, Noutputs * sizeof( cvrt_t ) );
 	         break;
 	case 4:  tok = strtok (lineIn, delim);
 	         while ( tok != NULL && tok[0] != '\n' && index < Noutputs )  {
@@ -1155,8 +1491,8 @@ void load_net ( char *fname, char *d1 )
 			      "ERROR: Output type for %d is undefined.\n",
 			      index);
 		     fprintf ( stderr, "Network not loaded.\n");
-		     del_net ( netName );
-		     return;
+		     free_net ( &net );
+		     return NULL;
 		   }
 		   tok = strtok( NULL, delim );
 		 }
@@ -1170,8 +1506,8 @@ void load_net ( char *fname, char *d1 )
 			      "ERROR: Unit type for %d is undefined.\n",
 			      Ninputs+index );
 		     fprintf ( stderr, "Network not loaded.\n" );
-		     del_net ( netName );
-		     return;
+		     free_net ( &net );
+		     return NULL;
 		   }
 		   tok = strtok( NULL, delim );
 		 }
@@ -1186,8 +1522,8 @@ void load_net ( char *fname, char *d1 )
 		     if  ( !isfloat( tok ) )  {
 		       fprintf ( stderr, "ERROR: Invalid weight value.\n" );
 		       fprintf ( stderr, "Network not loaded.\n" );
-		       del_net ( netName );
-		       return;
+		       free_net ( &net );
+		       return NULL;
 		     }
 		     net->outWeights[count-6-Ninputs-Noutputs][index++] =
 		       atof( tok );
@@ -1196,12 +1532,12 @@ void load_net ( char *fname, char *d1 )
 		 } else {
 		   tok = strtok( lineIn, delim );
 		   while ( tok != NULL && tok[0] != '\n' && 
-			  index < count-2*Noutputs-5 )  {
+			  index < count-2*Noutputs-5+net->recurrent )  {
 		     if  ( !isfloat( tok ) )  {
 		       fprintf ( stderr, "ERROR: Invalid weight value.\n" );
 		       fprintf ( stderr, "Network not loaded.\n" );
-		       del_net ( netName );
-		       return;
+		       free_net ( &net );
+		       return NULL;
 		     }
 		     net->weights[count-5-2*Noutputs][index++] =
 		       atof( tok );
@@ -1211,7 +1547,20 @@ void load_net ( char *fname, char *d1 )
 	}
   }
 
-  printf ("Network '%s' loaded.\n", netName );
+  /*  A file cut short, as one still being written may be, is refused  */
+  if  ( net != NULL && count == 4 + 2*Noutputs + Nunits )
+    j = ( Nunits > Ninputs+1 ) ? Nunits-1 + net->recurrent : Nunits;
+  else
+    j = -1;
+  if  ( index != j )  {
+    fprintf ( stderr, "ERROR: Network file ends early.\n" );
+    fprintf ( stderr, "Network not loaded.\n" );
+    if  ( net != NULL )
+      free_net ( &net );
+    return NULL;
+  }
+
+  return net;
 }
 
 
@@ -1223,33 +1572,32 @@ cvrt_t read_map ( FILE *fptr, char *firstline )
 {
   cvrt_t temp;
   int    i, j;
-  char   token[21],
-         linein[161],
-         *tok;
+  char   token[211],
+         linein[161];
 
+  /*  Enumerations are read a token at a time, since a series with many  */
+  /* of them has lines too long for a line buffer.                       */
   sscanf ( firstline, "Nenums: %d Nunits: %d", &temp.Nenums, &temp.Nunits );
+  temp.enums  = NULL;
+  temp.equivs = NULL;
   if ( temp.Nenums > 0 )  {
     temp.enums = (char **)alloc_mem( temp.Nenums,sizeof( char * ),"Read Map" );
     temp.equivs = (float **)alloc_mem(temp.Nenums,sizeof(float *),"Read Map");
     for ( i = 0 ; i < temp.Nenums ; i++ )  {
-      fgets ( linein, 160, fptr );
-      tok = strtok ( linein, " \t\n");
-      temp.enums[i] = strdup( tok );
-      temp.equivs[i] = (float *)alloc_mem(temp.Nunits,sizeof(float *),
+      fscanf ( fptr, "%210s", token );
+      temp.enums[i] = strdup( token );
+      temp.equivs[i] = (float *)alloc_mem(temp.Nunits,sizeof(float),
 					  "Read Map");
-      for ( j = 0 ; j < temp.Nunits ; j++ )  {
-	tok = strtok ( NULL, " \t\n" );
-	temp.equivs[i][j] = atof( tok );
-      }
+      for ( j = 0 ; j < temp.Nunits ; j++ )
+	fscanf ( fptr, "%f", &(temp.equivs[i][j]) );
     }
   }
   temp.unknown = (float *)alloc_mem(temp.Nunits,sizeof( float ),"Read Map");
+  fscanf ( fptr, "%210s", token );
+  for ( i = 0 ; i < temp.Nunits ; i++ )
+    fscanf ( fptr, "%f", &(temp.unknown[i]) );
   fgets ( linein, 160, fptr );
-  tok = strtok ( linein+8, " \t\n" );
-  for ( i = 0 ; i < temp.Nunits ; i++ )  {
-    temp.unknown[i] = atof( tok );
-    tok = strtok ( NULL, " \t\n" );
-  }
+  index_map( &temp );
 
   return temp;
 }
@@ -1299,6 +1647,7 @@ void resize_net ( char *netName, char *newUnits )
   }
 
   realloc_net ( net, nUnits );
+  free_memo( &(net->memo) );
   printf ("%s resized to allow an additional %d units.\n",netName, nUnits);
 }
 
@@ -1322,10 +1671,10 @@ void kill_net  ( char *netName, char *d1 )
       return;
     }
 
-  if  ( !del_net( name ) )
-    printf ("ERROR: Could not find network '%s'.\n",name);
+  if  ( !del_net( netName ) )
+    printf ("ERROR: Could not find network '%s'.\n",netName);
   else
-    printf ("Network '%s' removed from memory.\n",name);
+    printf ("Network '%s' removed from memory.\n",netName);
 }
 
 
@@ -1540,6 +1889,9 @@ void load_data ( char *filename, char *d1 )
       fprintf ( stderr, "Unable to parse data file '%s'.\n", filename );
       return;
     }
+    if  ( cParms->classTargets && !class_targets( dFile ) )
+      fprintf ( stderr, "Targets in '%s' kept as output vectors.\n",
+		filename );
     add_data_file( dFile );
   }  else  {
     fprintf ( stderr, "Data file already in memory.\n" );
@@ -1589,7 +1941,7 @@ void sync_net ( char *netName, char *dFileName )
     return;
   }
 
-  sync( net, dFile );
+  sync( net, cParms, dFile );
   printf ("%s synchronized with %s.\n", net->name, dFile->filename );
 }
 
@@ -1606,23 +1958,35 @@ void trap_ctrl_c  ( int sig )
 
 
 /*  HANDLE INTERRUPT -  This function handles the actually break out of the
-    training cycle.  It starts up the CLI and then, upon returning,
-    recalculates dependant variables.
+    training cycle.  It starts up the CLI on the run 'tc' and then, upon
+    returning, recalculates dependant variables.
 */
 
-void handle_interrupt  ( train_data_t *tData, int Npts )
+void handle_interrupt  ( train_ctx_t *tc )
 {
-  printf  ("\nSimulation suspended at epoch %d.\n",cNet->epochsTrained);
+  train_data_t *tData = tc->tData;
+  train_parm_t *parms = tc->parms;
+
+  /*  Only the first of the runs training at once to notice the  */
+  /* interrupt takes it                                          */
+  pthread_mutex_lock( &interruptLock );
+  if  ( !interruptPending )  {
+    pthread_mutex_unlock( &interruptLock );
+    return;
+  }
   interruptPending = FALSE;
-  cli( TRUE );
-
-  tData->outScaledEps         = cParms->outputUpdate.epsilon / Npts;
-  tData->output.shrinkFactor  = cParms->outputUpdate.mu /
-                                (cParms->outputUpdate.mu + 1.0);
-  tData->candIn.shrinkFactor  = cParms->candInUpdate.mu / 
-                                (cParms->candInUpdate.mu + 1.0);
-  tData->candOut.shrinkFactor = cParms->candOutUpdate.mu /
-                                (cParms->candOutUpdate.mu + 1.0);
+  pthread_mutex_unlock( &interruptLock );
+
+  printf  ("\nSimulation suspended at epoch %d.\n",tc->net->epochsTrained);
+  cli( tc );
+
+  tData->outScaledEps         = parms->outputUpdate.epsilon / tc->dSet->Npts;
+  tData->output.shrinkFactor  = parms->outputUpdate.mu /
+                                (parms->outputUpdate.mu + 1.0);
+  tData->candIn.shrinkFactor  = parms->candInUpdate.mu / 
+                                (parms->candInUpdate.mu + 1.0);
+  tData->candOut.shrinkFactor = parms->candOutUpdate.mu /
+                                (parms->candOutUpdate.mu + 1.0);
 
   printf ("Simulation continuing...\n");
 }
@@ -0,0 +1,359 @@
+/*	CMU Cascade Neural Network Simulator (CNNS)
+	Library interface code
+
+	These routines are the interface for programs that link the
+	simulator as a library, 'libcascade.a', rather than run it and read
+	what it prints.  Everything but 'main.c' is in the library, and the
+	declarations are in 'cascade.h'.  A program calls 'cascade_init'
+	once, then works with networks and data of its own:
+
+	  - Data is given as matrices the caller owns, one row of floats
+	    per point.  'matrix_set' wraps a matrix as a data set without
+	    copying it, and 'matrix_file' puts the training, validation and
+	    test sets together as a data file.  No text is parsed.
+	  - 'cascade_net' builds a network for a data file, 'cascade_train'
+	    trains it and 'cascade_test' tests it, returning the results as
+	    a trial_result_t.
+	  - 'cascade_context' makes an inference context on a network, and
+	    'cascade_infer' runs a matrix of points through it into a matrix
+	    of outputs the caller owns.
+
+	Every routine that depends on the training parameters is handed a
+	table of them, so callers with different settings do not share any.
+	  - 'cascade_load' and 'cascade_save' read and write network files.
+
+	Each inference context is used by one thread at a time, but any
+	number of contexts may infer with the same network at once.
+	Training keeps its state in a context of its own (see cascade.c),
+	so several networks may be trained at once on threads of their own,
+	sharing a data file.  Each needs a parameter table of its own,
+	since training may change it.  Training reports its progress on
+	stdout, as it does for the command line.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "toolkit.h"
+#include "cascade.h"
+
+/*	External Global Variable Declarations	*/
+
+extern train_parm_t *cParms;
+extern boolean      interruptPending,
+                    interact;
+
+
+/*	CASCADE INIT -  Set up the simulator for use as a library, and return
+	a table of training parameters with their defaults.  The table is
+	also the one the command line routines use.  Further tables may be
+	made with 'build_parm'.
+*/
+
+train_parm_t *cascade_init  ( void )
+{
+  time_t t;
+
+  interruptPending = FALSE;
+  interact         = FALSE;
+  time( &t );
+  srandom( t );
+
+  cParms = build_parm( );
+  return cParms;
+}
+
+
+/*	MATRIX SET -  Wrap 'Npts' points as a data set.  Row 'i' of 'inputs'
+	holds the 'Ninputs' inputs of point 'i', and row 'i' of 'outputs'
+	its 'Noutputs' outputs, or 'outputs' is NULL for points to be
+	predicted.  The rows are used where they are, so the matrices must
+	outlive the data set.  The points form a single sequence for a
+	recurrent network.
+*/
+
+data_set_t *matrix_set  ( char *name, float *inputs, float *outputs,
+			  int Npts, int Ninputs, int Noutputs )
+{
+  data_set_t *temp;
+  int        i;
+  char       *fn = "Matrix Set";
+
+  temp = (data_set_t *)alloc_mem( 1, sizeof( data_set_t ), fn );
+  temp->name        = strdup( name );
+  temp->Npts        = Npts;
+  temp->predictOnly = ( outputs == NULL );
+  temp->data        = (dv_t *)alloc_mem( Npts, sizeof( dv_t ), fn );
+  for  ( i = 0 ; i < Npts ; i++ )  {
+    temp->data[i].inputs  = inputs + i * Ninputs;
+    temp->data[i].outputs = ( outputs != NULL ) ? outputs + i * Noutputs :
+                                                  NULL;
+    temp->data[i].target  = NOT_FOUND;
+    temp->data[i].reset   = ( i == 0 );
+  }
+  temp->stdDev = ( temp->predictOnly ) ? 0.0 :
+                 calc_std_dev( temp->data, Noutputs, Npts );
+
+  return temp;
+}
+
+
+/*	FREE MATRIX SET -  Deallocate a data set built by 'matrix_set'.  The
+	caller's matrices are left alone.
+*/
+
+void free_matrix_set  ( data_set_t **dSet )
+{
+  if  ( *dSet == NULL )
+    return;
+
+  free( (*dSet)->name );
+  (*dSet)->data = free_mem( (*dSet)->data );
+  *dSet = free_mem( *dSet );
+}
+
+
+/*	MATRIX FILE -  Put data sets built by 'matrix_set' together as a data
+	file with 'Ninputs' inputs and 'Noutputs' outputs.  'types' gives
+	whether each output is BINARY or CONT, or is NULL if all are CONT.
+	Binary outputs are taken to be DEF_SIGMAX when on and DEF_SIGMIN when
+	off.  Any of the sets but 'train' may be NULL.  The data sets stay
+	the caller's.
+*/
+
+data_file_t *matrix_file  ( char *name, int Ninputs, int Noutputs,
+			    out_t *types, data_set_t *train,
+			    data_set_t *validate, data_set_t *test )
+{
+  data_file_t *temp;
+  cvrt_t      *map;
+  int         i;
+  char        *fn = "Matrix File";
+
+  temp = (data_file_t *)alloc_mem( 1, sizeof( data_file_t ), fn );
+  temp->filename  = strdup( name );
+  temp->Ninputs   = Ninputs;
+  temp->Noutputs  = Noutputs;
+  temp->NinNodes  = Ninputs;
+  temp->NoutNodes = Noutputs;
+  temp->NdataSets = 0;
+  temp->binPos    = DEF_SIGMAX;
+  temp->binNeg    = DEF_SIGMIN;
+  temp->dataSets  = NULL;
+  temp->train     = train;
+  temp->validate  = validate;
+  temp->test      = test;
+  temp->predict   = NULL;
+
+  temp->outputType = (out_t *)alloc_mem( Noutputs, sizeof( out_t ), fn );
+  for  ( i = 0 ; i < Noutputs ; i++ )
+    temp->outputType[i] = ( types != NULL ) ? types[i] : CONT;
+
+  /*  Every series is a single continuous unit  */
+  temp->inputMap  = (cvrt_t *)alloc_mem( Ninputs, sizeof( cvrt_t ), fn );
+  temp->outputMap = (cvrt_t *)alloc_mem( Noutputs, sizeof( cvrt_t ), fn );
+  for  ( i = 0 ; i < Ninputs + Noutputs ; i++ )  {
+    map = ( i < Ninputs ) ? temp->inputMap + i : temp->outputMap + i-Ninputs;
+    map->Nenums     = 0;
+    map->Nunits     = 1;
+    map->enums      = NULL;
+    map->equivs     = NULL;
+    map->unknown    = (float *)alloc_mem( 1, sizeof( float ), fn );
+    map->unknown[0] = 0.0;
+    map->index      = NULL;
+    index_map( map );
+  }
+
+  return temp;
+}
+
+
+/*	FREE MATRIX FILE -  Deallocate a data file built by 'matrix_file'.
+	Its data sets are left alone.
+*/
+
+void free_matrix_file  ( data_file_t **dFile )
+{
+  int i;
+
+  if  ( *dFile == NULL )
+    return;
+
+  for  ( i = 0 ; i < (*dFile)->Ninputs ; i++ )
+    free_cmap( (*dFile)->inputMap[i] );
+  for  ( i = 0 ; i < (*dFile)->Noutputs ; i++ )
+    free_cmap( (*dFile)->outputMap[i] );
+  (*dFile)->inputMap   = free_mem( (*dFile)->inputMap );
+  (*dFile)->outputMap  = free_mem( (*dFile)->outputMap );
+  (*dFile)->outputType = free_mem( (*dFile)->outputType );
+  free( (*dFile)->filename );
+  *dFile = free_mem( *dFile );
+}
+
+
+/*	CASCADE NET -  Build an untrained network named 'name' for a data
+	file, as 'train' does for a network not yet in memory.  The network
+	is not added to those the command line knows of.
+*/
+
+net_t *cascade_net  ( char *name, train_parm_t *parms, data_file_t *dFile )
+{
+  net_t *net;
+
+  net = build_net( name, dFile->NinNodes, dFile->NoutNodes,
+		   parms->maxNewUnits, parms->weightRange, parms->sigMax,
+		   parms->sigMin, parms->recurrent );
+  init_net( net, parms->weightRange );
+  sync( net, parms, dFile );
+
+  return net;
+}
+
+
+/*	CASCADE TRAIN -  Train a network on a data file with the parameters
+	given, and return the results.  A data file without training data
+	returns a LOSS having trained nothing.
+*/
+
+trial_result_t cascade_train  ( net_t *net, train_parm_t *parms,
+				data_file_t *dFile )
+{
+  trial_result_t result;
+
+  if  ( (dFile->train == NULL) || (net->Ninputs != dFile->NinNodes) ||
+	(net->Noutputs != dFile->NoutNodes) )  {
+    fprintf ( stderr, "Network '%s' cannot be trained on '%s'.\n",
+	      net->name, dFile->filename );
+    memset( &result, 0, sizeof( trial_result_t ) );
+    result.endStatus = LOSS;
+    return result;
+  }
+
+  return train_net( net, parms, dFile, 1 );
+}
+
+
+/*	CASCADE TEST -  Test a network on a data set with the parameters
+	given and return the results.  Only the error fields and the number
+	of units of the result are set.
+*/
+
+trial_result_t cascade_test  ( net_t *net, train_parm_t *parms,
+			       data_set_t *dSet )
+{
+  trial_result_t result;
+  int            outVals = dSet->Npts * net->Noutputs;
+
+  memset( &result, 0, sizeof( trial_result_t ) );
+  if  ( dSet->predictOnly || (outVals == 0) )  {
+    fprintf ( stderr, "Data set '%s' has no outputs to test against.\n",
+	      dSet->name );
+    return result;
+  }
+
+  result = test_net( net, parms, dSet, NULL );
+  result.endStatus  = TRAINING;
+  result.Nepochs    = 0;
+  result.connx      = 0;
+  result.time       = 0;
+  result.Nvictories = 0;
+  result.Nunits     = net->Nunits;
+  result.perCorrect = (((float)(outVals-result.bits))/outVals)*100.0;
+
+  return result;
+}
+
+
+/*	CASCADE CONTEXT -  Return an inference context on a network, packing
+	the network first if it has not been.  While the 'quantized'
+	parameter in 'parms' is set, a network with a quantized copy infers
+	with that instead.  A network that is to be
+	shared by threads should have its first context made before the
+	threads start, since packing changes the network.  Free the context
+	with 'free_infer_ctx'.
+*/
+
+infer_ctx_t *cascade_context  ( net_t *net, train_parm_t *parms )
+{
+  infer_ctx_t *ctx;
+
+  if  ( net->packed == NULL )
+    net->packed = pack_net( net );
+
+  ctx = build_infer_ctx( net->packed );
+  if  ( parms->quantized && (net->quant != NULL) )
+    quant_infer_ctx( ctx, net->quant );
+
+  return ctx;
+}
+
+
+/*	CASCADE INFER -  Run 'Npts' points through an inference context.
+	Row 'i' of 'inputs' holds the inputs of point 'i', and its outputs
+	are stored in row 'i' of 'outputs'.  For a recurrent network the
+	points continue the sequence of the context's last call, until the
+	context is reset with 'reset_infer_ctx'.
+*/
+
+void cascade_infer  ( infer_ctx_t *ctx, float *inputs, int Npts,
+		      float *outputs )
+{
+  float   *in[PACK_BATCH],
+          *out[PACK_BATCH];
+  boolean resets[PACK_BATCH];
+  int     Ninputs  = ctx->model->Ninputs,
+          Noutputs = ctx->model->Noutputs,
+          n, i, b;
+
+  for  ( b = 0 ; b < PACK_BATCH ; b++ )
+    resets[b] = FALSE;
+
+  for  ( i = 0 ; i < Npts ; i += n )  {
+    n = ( Npts-i > PACK_BATCH ) ? PACK_BATCH : Npts-i;
+    for  ( b = 0 ; b < n ; b++ )  {
+      in[b]  = inputs + (i+b) * Ninputs;
+      out[b] = outputs + (i+b) * Noutputs;
+    }
+    infer_batch( ctx, in, resets, n, out );
+  }
+}
+
+
+/*	CASCADE LOAD -  Load the network saved in 'filename'.  The network is
+	not added to those the command line knows of.  Returns NULL if the
+	file does not hold a network.
+*/
+
+net_t *cascade_load  ( char *filename )
+{
+  FILE  *netFile;
+  net_t *net;
+
+  if  ( (netFile = fopen( filename, "r" )) == NULL )  {
+    fprintf ( stderr, "ERROR: Unable to open network data file %s.\n",
+	      filename );
+    return NULL;
+  }
+
+  net = read_net( netFile );
+  fclose( netFile );
+  return net;
+}
+
+
+/*	CASCADE SAVE -  Save a network to 'filename'.  Returns FALSE if the
+	file cannot be written.
+*/
+
+boolean cascade_save  ( net_t *net, char *filename )
+{
+  FILE *netFile;
+
+  if  ( (netFile = fopen( filename, "w" )) == NULL )  {
+    fprintf ( stderr, "ERROR: Unable to open network file %s.\n", filename );
+    return FALSE;
+  }
+
+  write_net( net, netFile );
+  return ( fclose( netFile ) == 0 );
+}
@@ -0,0 +1,302 @@
+/*	CMU Cascade Neural Network Simulator (CNNS)
+	Levenberg-Marquardt candidate training code
+
+	These routines train the input weights of the candidate units with the
+	Levenberg-Marquardt method instead of Quickprop.  This is only done
+	while the candidates have a small fan-in (see 'candLMUnits'), since the
+	cost of each epoch grows with the square of the number of inputs and
+	each weight update solves a system of that size.
+
+	While the slopes are collected, the candidate training code also
+	accumulates the Gauss-Newton approximation of the Hessian, J'J, where J
+	is the derivative of the candidate's value with respect to its input
+	weights.  For Cascade-2 this is the usual approximation of the sum
+	squared error, and the candidate's output weights are trained along
+	with its inputs since the two are strongly coupled.  For
+	Cascade-Correlation it is the Hessian of fitting the candidate's values
+	to the residual error, signed by the direction of each correlation,
+	which is the direction the slopes point in.  The correlation does not
+	depend on the size of that residual, so the cascor step is scaled to
+	move the values about as far as the range of a sigmoid unit (LM_SPAN)
+	and the damping shortens it from there.
+
+	Each candidate keeps the weights of the last step that improved its
+	score.  A step that improves the score is accepted and the damping is
+	reduced.  Otherwise the candidate returns to its accepted weights and
+	tries a shorter step with more damping.  The scores reported to the
+	stagnation tests are those of the accepted weights, so they never
+	decrease.
+*/
+
+#include <math.h>
+
+#include "toolkit.h"
+#include "cascade.h"
+
+#define LM_MIN_LAMBDA 1.0e-6   /*  Limits on the damping factor  */
+#define LM_MAX_LAMBDA 1.0e6
+#define LM_MIN_DIAG   1.0e-4   /*  Keeps unused inputs from making the  */
+                               /* system singular                       */
+#define LM_SPAN       0.5      /*  Size of a full cascor step  */
+
+
+/*	LM ACCUMULATE -  Add scale * jacob * jacob' into the upper triangle of
+	'hess'.  The lower triangle is filled in when the system is solved.
+	The caller counts the n * (n+1) / 2 connection crossings made.
+*/
+
+void lm_accumulate  ( float **hess, float *jacob, int n, float scale )
+{
+  float *row,
+        val;
+  int   j, k;
+
+  for  ( j = 0 ; j < n ; j++ )  {
+    row = hess[j];
+    val = scale * jacob[j];
+    for  ( k = j ; k < n ; k++ )
+      row[k] += val * jacob[k];
+  }
+}
+
+
+/*	LM ACCUMULATE C2 -  Add a point's contribution to the Gauss-Newton
+	Hessian of a Cascade-2 candidate, whose input and output weights are
+	trained together.  'jacob' is the derivative of the candidate's summed
+	input with respect to its n input weights, 'prime' the derivative of
+	its value with respect to that sum, and 'used' flags the outputs whose
+	error counted for this point.
+*/
+
+void lm_accumulate_c2  ( train_ctx_t *tc, float **hess, float *jacob, int n,
+			 float prime, float value, float *outWeights,
+			 float *used )
+{
+  float wSqSum = 0.0,
+        val;
+  int   j, o;
+
+  for  ( o = 0 ; o < tc->Noutputs ; o++ )
+    wSqSum += used[o] * outWeights[o] * outWeights[o];
+  lm_accumulate( hess, jacob, n, prime * prime * wSqSum );
+
+  for  ( o = 0 ; o < tc->Noutputs ; o++ )
+    if  ( used[o] != 0.0 )  {
+      val = prime * value * outWeights[o];
+      for  ( j = 0 ; j < n ; j++ )
+	hess[j][n+o] += val * jacob[j];
+      hess[n+o][n+o] += value * value;
+    }
+#ifdef CONNX
+  tc->connx += n * (n+1) / 2 + n * tc->Noutputs;
+#endif
+}
+
+
+/*	LM ADJUST CI WEIGHTS -  Make a Levenberg-Marquardt step on the input
+	weights of each candidate, and for Cascade-2 on its output weights as
+	well.  The candidate scores must already reflect the weights used
+	during the last epoch.
+*/
+
+void lm_adjust_ci_weights  ( train_ctx_t *tc )
+{
+  train_data_t *tData = tc->tData;
+  train_parm_t *parms = tc->parms;
+  float        *cw,
+               *cs,
+               *ow,
+               *os,
+               **ch,
+               *lw,
+               *ls,
+               **lh,
+               gain,
+               inDecay  = parms->candInUpdate.decay,
+               outDecay = parms->candOutUpdate.decay;
+  int          n = tc->net->Nunits + tc->recurrent,
+               m = (parms->algorithm == CASCADE2) ? tc->Noutputs : 0,
+               i, j, k;
+  boolean      first;
+
+  for  ( i = 0 ; i < tc->Ncand ; i++ )  {
+    cw = tData->candIn.weights[i];
+    cs = tData->candIn.slopes[i];
+    ow = tData->candOut.weights[i];
+    os = tData->candOut.slopes[i];
+    ch = tData->candHess[i];
+    lw = tData->candLMWeights[i];
+    ls = tData->candLMSlopes[i];
+    lh = tData->candLMHess[i];
+
+    gain = 1.0;
+    if  ( (parms->algorithm == CASCOR) && (tData->candResSq[i] > 0.0) )
+      gain = LM_SPAN * sqrt( tc->dSet->Npts / tData->candResSq[i] );
+    tData->candResSq[i] = 0.0;
+
+    /*  Accept the last step if it helped, otherwise back up  */
+    first = ( tData->candLMScore[i] <= -1.0e20 );
+    if  ( tData->candScores[i] >= tData->candLMScore[i] )  {
+      if  ( !first )
+	tData->candLambda[i] /= 10.0;
+      if  ( tData->candLambda[i] < LM_MIN_LAMBDA )
+	tData->candLambda[i] = LM_MIN_LAMBDA;
+      tData->candLMScore[i] = tData->candScores[i];
+      for  ( j = 0 ; j < n ; j++ )  {
+	lw[j] = cw[j];
+	ls[j] = gain * cs[j] + inDecay * cw[j];
+      }
+      for  ( j = 0 ; j < m ; j++ )  {
+	lw[n+j] = ow[j];
+	ls[n+j] = os[j] + outDecay * ow[j];
+      }
+      for  ( j = 0 ; j < n+m ; j++ )
+	for  ( k = j ; k < n+m ; k++ )
+	  lh[j][k] = ch[j][k];
+    }  else  {
+      tData->candLambda[i] *= 10.0;
+      if  ( tData->candLambda[i] > LM_MAX_LAMBDA )
+	tData->candLambda[i] = LM_MAX_LAMBDA;
+      tData->candScores[i] = tData->candLMScore[i];
+    }
+
+    /*  Solve (H + lambda*diag(H)) step = slopes, using the Hessian as  */
+    /* workspace since it is cleared for the next epoch                */
+    for  ( j = 0 ; j < n+m ; j++ )  {
+      tData->candJacob[j] = ls[j];
+      for  ( k = j ; k < n+m ; k++ )
+	ch[j][k] = lh[j][k];
+      ch[j][j] = ch[j][j] * (1.0 + tData->candLambda[i]) + LM_MIN_DIAG +
+	         ( (j < n) ? inDecay : outDecay );
+    }
+    /*  A Cascade-2 candidate's random output weights are far from      */
+    /* their best values for its random inputs.  The first step only     */
+    /* fits the output weights, or the joint step tends to zero them     */
+    /* and leave the candidate stranded where the input slopes vanish.   */
+    if  ( first && (m > 0) )  {
+      for  ( j = 0 ; j < n ; j++ )
+	tData->candJacob[j] = 0.0;
+      for  ( j = n ; j < n+m ; j++ )
+	tData->candJacob[j] /= ch[j][j];
+    }  else if  ( !lm_solve( ch, tData->candJacob, n+m ) )  {
+      for  ( j = 0 ; j < n+m ; j++ )
+	tData->candJacob[j] = 0.0;
+      tData->candLambda[i] *= 10.0;
+    }
+    for  ( j = 0 ; j < n ; j++ )
+      cw[j] = lw[j] - tData->candJacob[j];
+    for  ( j = 0 ; j < m ; j++ )
+      ow[j] = lw[n+j] - tData->candJacob[n+j];
+#ifdef CONNX
+    tc->connx += (n+m) * (n+m) * (n+m) / 6;
+#endif
+
+    for  ( j = 0 ; j < n ; j++ )
+      cs[j] = 0.0;
+    for  ( j = 0 ; j < m ; j++ )
+      os[j] = 0.0;
+    for  ( j = 0 ; j < n+m ; j++ )
+      for  ( k = j ; k < n+m ; k++ )
+	ch[j][k] = 0.0;
+  }
+
+  /*  The best candidate is judged by its accepted score  */
+  tData->candBest      = 0;
+  tData->candBestScore = tData->candScores[0];
+  for  ( i = 1 ; i < tc->Ncand ; i++ )
+    if  ( tData->candScores[i] > tData->candBestScore )  {
+      tData->candBest      = i;
+      tData->candBestScore = tData->candScores[i];
+    }
+}
+
+
+/*	LM RESTORE CI WEIGHTS -  Return each candidate to the last weights
+	that were accepted, so that an untried step is never installed.
+*/
+
+void lm_restore_ci_weights  ( train_ctx_t *tc )
+{
+  train_data_t *tData = tc->tData;
+  int          n = tc->net->Nunits + tc->recurrent,
+               i, j;
+
+  for  ( i = 0 ; i < tc->Ncand ; i++ )
+    if  ( tData->candLMScore[i] > -1.0e20 )  {
+      for  ( j = 0 ; j < n ; j++ )
+	tData->candIn.weights[i][j] = tData->candLMWeights[i][j];
+      if  ( tc->parms->algorithm == CASCADE2 )
+	for  ( j = 0 ; j < tc->Noutputs ; j++ )
+	  tData->candOut.weights[i][j] = tData->candLMWeights[i][n+j];
+    }
+}
+
+
+/*	LM SOLVE -  Solve a x = b for a symmetric positive definite matrix
+	whose upper triangle is given, by Cholesky decomposition.  The matrix
+	is overwritten with its factor and b with the solution.  Returns FALSE
+	if the matrix is not positive definite.
+*/
+
+boolean lm_solve  ( float **a, float *b, int n )
+{
+  if  ( !lm_factor( a, n ) )
+    return FALSE;
+  lm_backsolve( a, b, n );
+
+  return TRUE;
+}
+
+
+/*	LM FACTOR -  Factor a symmetric positive definite matrix, whose upper
+	triangle is given, into L L'.  L is stored in the lower triangle and
+	on the diagonal, leaving the rest of the upper triangle intact.
+	Returns FALSE if the matrix is not positive definite.
+*/
+
+boolean lm_factor  ( float **a, int n )
+{
+  double sum;
+  int    i, j, k;
+
+  for  ( j = 0 ; j < n ; j++ )  {
+    sum = a[j][j];
+    for  ( k = 0 ; k < j ; k++ )
+      sum -= a[j][k] * a[j][k];
+    if  ( sum <= 0.0 )
+      return FALSE;
+    a[j][j] = sqrt( sum );
+    for  ( i = j+1 ; i < n ; i++ )  {
+      sum = a[j][i];
+      for  ( k = 0 ; k < j ; k++ )
+	sum -= a[i][k] * a[j][k];
+      a[i][j] = sum / a[j][j];
+    }
+  }
+
+  return TRUE;
+}
+
+
+/*	LM BACKSOLVE -  Solve L L' x = b by forward and back substitution,
+	given the factor left by lm_factor.  b is overwritten with x.
+*/
+
+void lm_backsolve  ( float **a, float *b, int n )
+{
+  double sum;
+  int    i, k;
+
+  for  ( i = 0 ; i < n ; i++ )  {
+    sum = b[i];
+    for  ( k = 0 ; k < i ; k++ )
+      sum -= a[i][k] * b[k];
+    b[i] = sum / a[i][i];
+  }
+  for  ( i = n-1 ; i >= 0 ; i-- )  {
+    sum = b[i];
+    for  ( k = i+1 ; k < n ; k++ )
+      sum -= a[k][i] * b[k];
+    b[i] = sum / a[i][i];
+  }
+}
@@ -0,0 +1,43 @@
+/*	CMU Cascade Neural Network Simulator (CNNS)
+	Program entry
+
+	The simulator program is this file linked with the library of the
+	simulator's routines, 'libcascade.a'.  The program sets up the
+	library for an interactive user and hands control to the Command
+	Line Interface in file 'interface.c'.  Programs embedding the
+	simulator link the same library without this file (see
+	libcascade.c).
+*/
+
+#include <signal.h>
+
+#include "toolkit.h"
+#include "cascade.h"
+
+/*	External Global Variable Declarations	*/
+
+extern boolean interact;
+
+
+void main ( int argc, char *argv[] )
+{
+  train_parm_t *parms;
+  int          i;
+
+  display_banner( );             /*  Welcome user and then do some  */
+                                 /* initializations.                */
+  parms    = cascade_init( );    /*  Build and initialize a parm table  */
+  interact = TRUE;
+  signal( SIGINT, trap_ctrl_c ); /*  Trap C-c so we can break out of a run  */
+  set_parmtable( parms );
+
+
+  /*  Process command line arguments  */
+
+  for  ( i = 1 ; i < argc ; i++ )  
+    load_script( argv[i], NULL );
+
+  /*  Invoke command interpreter  */
+
+  cli( NULL );
+}
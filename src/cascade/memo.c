@@ -0,0 +1,253 @@
+/*	CMU Cascade Neural Network Simulator (CNNS)
+	Result cache code
+
+	These routines remember the outputs a network gave for the inputs it
+	was last queried with, so that a query repeating one of them is
+	answered without a forward pass.  Query traffic for tokenized data
+	often repeats a small set of input combinations, and a repeated one
+	then costs a hash of its inputs and a lookup.
+
+	A cache is keyed by the converted input vector, compared bit for bit,
+	and holds at most 'memoEntries' results, set by the parameter of that
+	name.  Entries are kept in a list from the most to the least recently
+	used, and a full cache drops its least recently used entry to make
+	room for a new one.  Besides its outputs an entry has room for the
+	outputs decoded into tokens, which the server fills in the first time
+	they are asked for (see server.c).
+
+	A network's cache is dropped whenever the network changes, by
+	training, adaptation, pruning, quantizing or 'resizeNet', and a
+	network loaded from a file starts with none.  Since a recurrent
+	network's outputs depend on the points before, recurrent networks
+	are never cached.
+*/
+
+#include <string.h>
+
+#include "toolkit.h"
+#include "cascade.h"
+
+/*	External Global Variable Declarations	*/
+
+extern train_parm_t *cParms;
+
+
+/*	BUILD MEMO -  Build an empty result cache for a network, holding at
+	most 'maxEntries' results.
+*/
+
+memo_t *build_memo  ( net_t *net, int maxEntries )
+{
+  memo_t *temp;
+  int    i;
+  char   *fn = "Build Result Cache";
+
+  temp = (memo_t *)alloc_mem( 1, sizeof( memo_t ), fn );
+  temp->Ninputs    = net->Ninputs;
+  temp->Noutputs   = net->Noutputs;
+  temp->Nentries   = 0;
+  temp->maxEntries = maxEntries;
+  temp->textWidth  = ( net->outputMap != NULL ) ? token_width( net ) : 0;
+  temp->hits       = 0;
+  temp->misses     = 0;
+  temp->quantized  = ( cParms->quantized && (net->quant != NULL) );
+  temp->newest     = NULL;
+  temp->oldest     = NULL;
+
+  for  ( temp->Nbuckets = 1 ; temp->Nbuckets < maxEntries ; )
+    temp->Nbuckets *= 2;
+  temp->buckets = (memo_entry_t **)alloc_mem( temp->Nbuckets,
+					      sizeof( memo_entry_t * ), fn );
+  for  ( i = 0 ; i < temp->Nbuckets ; i++ )
+    temp->buckets[i] = NULL;
+
+  temp->entries = (memo_entry_t *)alloc_mem( maxEntries,
+					     sizeof( memo_entry_t ), fn );
+  temp->block   = (float *)alloc_mem( maxEntries *
+				      (net->Ninputs + net->Noutputs),
+				      sizeof( float ), fn );
+  temp->texts   = (char *)alloc_mem( maxEntries * (temp->textWidth+1),
+				     sizeof( char ), fn );
+  for  ( i = 0 ; i < maxEntries ; i++ )  {
+    temp->entries[i].inputs  = temp->block + i * (net->Ninputs+net->Noutputs);
+    temp->entries[i].outputs = temp->entries[i].inputs + net->Ninputs;
+    temp->entries[i].text    = temp->texts + i * (temp->textWidth+1);
+  }
+
+  return temp;
+}
+
+
+/*	FREE MEMO -  Deallocate a result cache.
+*/
+
+void free_memo  ( memo_t **memo )
+{
+  if  ( *memo == NULL )
+    return;
+
+  (*memo)->buckets = free_mem( (*memo)->buckets );
+  (*memo)->entries = free_mem( (*memo)->entries );
+  (*memo)->block   = free_mem( (*memo)->block );
+  (*memo)->texts   = free_mem( (*memo)->texts );
+  *memo = free_mem( *memo );
+}
+
+
+/*	MEMO NET -  Bring a network's result cache in line with the
+	parameters before it is queried.  A cache is built if 'memoEntries'
+	is set and the network is not recurrent, and rebuilt if its size
+	has changed or it was filled with or without the quantized copy
+	while the other is now used.
+*/
+
+void memo_net  ( net_t *net )
+{
+  boolean quantized = ( cParms->quantized && (net->quant != NULL) );
+
+  if  ( net->memo != NULL && (net->memo->maxEntries != cParms->memoEntries ||
+			      net->memo->quantized != quantized) )
+    free_memo( &(net->memo) );
+
+  if  ( net->memo == NULL && cParms->memoEntries > 0 && !net->recurrent )
+    net->memo = build_memo( net, cParms->memoEntries );
+}
+
+
+/*	MEMO HASH -  Hash the bits of an input vector (FNV-1a).
+*/
+
+unsigned long memo_hash  ( float *inputs, int n )
+{
+  unsigned long hash = 2166136261UL;
+  unsigned char *byte = (unsigned char *)inputs;
+  int           i;
+
+  for  ( i = 0 ; i < n * sizeof( float ) ; i++ )  {
+    hash ^= byte[i];
+    hash *= 16777619UL;
+  }
+
+  return hash;
+}
+
+
+/*	MEMO FIND -  Return the entry of a result cache for the inputs given,
+	making it the most recently used, or NULL if they are not cached.
+	The entry stays good until the next call to 'memo_insert'.
+*/
+
+memo_entry_t *memo_find  ( memo_t *memo, float *inputs )
+{
+  memo_entry_t  *entry;
+  unsigned long hash = memo_hash( inputs, memo->Ninputs );
+
+  for  ( entry = memo->buckets[hash & (memo->Nbuckets-1)] ; entry != NULL ;
+	 entry = entry->next )
+    if  ( entry->hash == hash &&
+	  !memcmp( entry->inputs, inputs, memo->Ninputs * sizeof( float ) ) )
+      break;
+
+  if  ( entry == NULL )  {
+    memo->misses++;
+    return NULL;
+  }
+
+  memo->hits++;
+  memo_unlink( memo, entry );
+  memo_link( memo, entry );
+  return entry;
+}
+
+
+/*	MEMO INSERT -  Cache the outputs a network gave for the inputs given,
+	dropping the least recently used entry if the cache is full.  Inputs
+	already cached have their outputs replaced.  Returns the entry.
+*/
+
+memo_entry_t *memo_insert  ( memo_t *memo, float *inputs, float *outputs )
+{
+  memo_entry_t  *entry,
+                **link;
+  unsigned long hash = memo_hash( inputs, memo->Ninputs );
+
+  for  ( entry = memo->buckets[hash & (memo->Nbuckets-1)] ; entry != NULL ;
+	 entry = entry->next )
+    if  ( entry->hash == hash &&
+	  !memcmp( entry->inputs, inputs, memo->Ninputs * sizeof( float ) ) )
+      break;
+
+  if  ( entry != NULL )
+    memo_unlink( memo, entry );
+  else  {
+    /*  Take a free entry, or the least recently used one  */
+    if  ( memo->Nentries < memo->maxEntries )
+      entry = memo->entries + memo->Nentries++;
+    else  {
+      entry = memo->oldest;
+      memo_unlink( memo, entry );
+      for  ( link = &(memo->buckets[entry->hash & (memo->Nbuckets-1)]) ;
+	     *link != entry ; link = &((*link)->next) )
+	;
+      *link = entry->next;
+    }
+
+    entry->hash = hash;
+    memcpy( entry->inputs, inputs, memo->Ninputs * sizeof( float ) );
+    entry->next = memo->buckets[hash & (memo->Nbuckets-1)];
+    memo->buckets[hash & (memo->Nbuckets-1)] = entry;
+  }
+
+  memcpy( entry->outputs, outputs, memo->Noutputs * sizeof( float ) );
+  entry->textLen = -1;
+  memo_link( memo, entry );
+
+  return entry;
+}
+
+
+/*	MEMO LINK -  Make an entry the most recently used of its cache.
+*/
+
+void memo_link  ( memo_t *memo, memo_entry_t *entry )
+{
+  entry->older = memo->newest;
+  entry->newer = NULL;
+  if  ( memo->newest != NULL )
+    memo->newest->newer = entry;
+  else
+    memo->oldest = entry;
+  memo->newest = entry;
+}
+
+
+/*	MEMO UNLINK -  Take an entry out of its cache's list of use.
+*/
+
+void memo_unlink  ( memo_t *memo, memo_entry_t *entry )
+{
+  if  ( entry->newer != NULL )
+    entry->newer->older = entry->older;
+  else
+    memo->newest = entry->older;
+  if  ( entry->older != NULL )
+    entry->older->newer = entry->newer;
+  else
+    memo->oldest = entry->newer;
+}
+
+
+/*	MEMO POINT -  Return the outputs of a network for a point, from its
+	result cache if they are there, or from the inference context given,
+	caching them.  The outputs stay good until the next call.
+*/
+
+float *memo_point  ( memo_t *memo, infer_ctx_t *ctx, float *inputs )
+{
+  memo_entry_t *entry;
+
+  if  ( (entry = memo_find( memo, inputs )) == NULL )
+    entry = memo_insert( memo, inputs, infer_point( ctx, inputs, TRUE ) );
+
+  return entry->outputs;
+}
@@ -0,0 +1,674 @@
+/*	CMU Cascade Neural Network Simulator (CNNS)
+	Packed inference code
+
+	These routines compile a trained network into a form meant only for
+	inference.  The network keeps the weights of each hidden unit in an
+	allocation of its own, which suits a net that grows one unit at a
+	time, but scatters the weights over memory.  The packed copy keeps
+	the lower triangular hidden weights row after row in one aligned
+	buffer, with each row padded out to PACK_ALIGN bytes, and the output
+	weights as a dense matrix with rows of the same stride.
+
+	Points are evaluated in batches of PACK_BATCH, unit by unit rather
+	than point by point.  The unit values of a batch are kept unit-major,
+	so each unit's weight row is read once per batch and the inner loop
+	of each dot product runs across the points of the batch, where the
+	compiler can vectorize it.  Recurrent networks are evaluated the same
+	way, except that the self connection of each unit is applied point by
+	point in order.
+
+	When only the class of a point is wanted, the largest output, a
+	feed-forward network whose outputs are all of one monotone type may
+	stop early.  The output sums are built up unit by unit, and no unit
+	can move an output by more than its weight times the largest value
+	the unit can take.  Once the outputs' bounds no longer overlap, the
+	remaining units cannot change the class, and are not evaluated.
+
+	Rows that are mostly zeros, as pruning leaves them (see prune.c),
+	also get a list of the units their nonzero weights come from, and
+	their dot products run over that list alone.
+
+	A packed copy is not updated when its network changes, so it is only
+	built for a network that is not being trained.
+*/
+
+#include <math.h>
+#include <float.h>
+
+#include "toolkit.h"
+#include "cascade.h"
+
+#define PACK_WIDTH ( PACK_ALIGN / sizeof( float ) )  /*  Floats per row   */
+                                                     /* alignment         */
+
+
+/*	PACK NET -  Build a packed copy of a network for inference.
+*/
+
+packed_net_t *pack_net  ( net_t *net )
+{
+  packed_net_t *temp;
+  float        *row;
+  int          size,
+               len,
+               Nrows,
+               i, j;
+  char         *fn = "Pack Network";
+
+  temp = (packed_net_t *)alloc_mem( 1, sizeof( packed_net_t ), fn );
+
+  temp->Ninputs   = net->Ninputs;
+  temp->Nunits    = net->Nunits;
+  temp->Noutputs  = net->Noutputs;
+  temp->recurrent = net->recurrent;
+  temp->softmax   = FALSE;
+  temp->sigMax    = net->sigmoidMax;
+  temp->sigMin    = net->sigmoidMin;
+  temp->outStride = ( (net->Nunits + PACK_WIDTH-1) / PACK_WIDTH ) * PACK_WIDTH;
+
+  /*  Lay out the hidden unit rows  */
+  temp->rowStart  = (int *)alloc_mem( net->Nunits, sizeof( int ), fn );
+  temp->unitTypes = (node_t *)alloc_mem( net->Nunits, sizeof( node_t ), fn );
+  size = 0;
+  for  ( i = 0 ; i < net->Nunits ; i++ )  {
+    temp->rowStart[i] = size;
+    if  ( i > net->Ninputs )  {
+      temp->unitTypes[i] = net->unitTypes[i];
+      len   = i + net->recurrent;
+      size += ( (len + PACK_WIDTH-1) / PACK_WIDTH ) * PACK_WIDTH;
+    }
+  }
+
+  /*  The hidden and output weights share one buffer  */
+  temp->weights    = pack_alloc( size + net->Noutputs * temp->outStride,
+				 &(temp->block), fn );
+  temp->outWeights = temp->weights + size;
+  for  ( i = 0 ; i < size + net->Noutputs * temp->outStride ; i++ )
+    temp->weights[i] = 0.0;
+
+  for  ( i = net->Ninputs+1 ; i < net->Nunits ; i++ )  {
+    row = temp->weights + temp->rowStart[i];
+    for  ( j = 0 ; j < i + net->recurrent ; j++ )
+      row[j] = net->weights[i][j];
+  }
+
+  temp->outputTypes = (node_t *)alloc_mem( net->Noutputs, sizeof( node_t ),
+					   fn );
+  for  ( i = 0 ; i < net->Noutputs ; i++ )  {
+    row = temp->outWeights + i * temp->outStride;
+    for  ( j = 0 ; j < net->Nunits ; j++ )
+      row[j] = net->outWeights[i][j];
+    temp->outputTypes[i] = net->outputTypes[i];
+    temp->softmax |= ( net->outputTypes[i] == SOFTMAX );
+  }
+
+  /*  Lists of the nonzero weights of the sparse rows.  Row 'i' is      */
+  /* hidden unit 'i' for i < Nunits, and output i-Nunits after that.    */
+  Nrows         = net->Nunits + net->Noutputs;
+  temp->nzStart = (int *)alloc_mem( Nrows, sizeof( int ), fn );
+  temp->nzCount = (int *)alloc_mem( Nrows, sizeof( int ), fn );
+  size = 0;
+  for  ( i = 0 ; i < Nrows ; i++ )  {
+    temp->nzStart[i] = size;
+    temp->nzCount[i] = -1;
+    if  ( i <= net->Ninputs )
+      continue;
+    row = packed_row( temp, i, &len );
+    for  ( j = 0, temp->nzCount[i] = 0 ; j < len ; j++ )
+      temp->nzCount[i] += ( row[j] != 0.0 );
+    if  ( temp->nzCount[i] < PACK_SPARSE * len )
+      size += temp->nzCount[i];
+    else
+      temp->nzCount[i] = -1;
+  }
+  temp->nzIndex = (int *)alloc_mem( (size > 0) ? size : 1, sizeof( int ), fn );
+  for  ( i = net->Ninputs+1 ; i < Nrows ; i++ )
+    if  ( temp->nzCount[i] >= 0 )  {
+      row  = packed_row( temp, i, &len );
+      size = temp->nzStart[i];
+      for  ( j = 0 ; j < len ; j++ )
+	if  ( row[j] != 0.0 )
+	  temp->nzIndex[size++] = j;
+    }
+
+  /*  Whether the class of a point can be decided early, and the most    */
+  /* the units from each one on can still add to each output            */
+  temp->earlyExit = !net->recurrent;
+  for  ( i = 0 ; i < net->Noutputs ; i++ )
+    temp->earlyExit &= ( net->outputTypes[i] == net->outputTypes[0] );
+  temp->earlyExit &= ( net->outputTypes[0] != GAUSSIAN );
+  temp->earlyExit &= ( net->outputTypes[0] != VARSIGMOID ||
+		       net->sigmoidMax > net->sigmoidMin );
+
+  temp->remaining = NULL;
+  if  ( temp->earlyExit )  {
+    temp->remaining = (float *)alloc_mem( net->Noutputs * (net->Nunits+1),
+					  sizeof( float ), fn );
+    for  ( i = 0 ; i < net->Noutputs ; i++ )  {
+      row = temp->remaining + i * (net->Nunits+1);
+      row[net->Nunits] = 0.0;
+      for  ( j = net->Nunits-1 ; j > net->Ninputs ; j-- )
+	row[j] = row[j+1] + ( (net->outWeights[i][j] != 0.0) ?
+			      fabs( net->outWeights[i][j] ) *
+			      packed_bound( temp, temp->unitTypes[j] ) : 0.0 );
+    }
+  }
+
+  return temp;
+}
+
+
+/*	FREE PACKED -  Deallocate a packed network.
+*/
+
+void free_packed  ( packed_net_t **packed )
+{
+  if  ( *packed == NULL )
+    return;
+
+  (*packed)->rowStart    = free_mem( (*packed)->rowStart );
+  (*packed)->unitTypes   = free_mem( (*packed)->unitTypes );
+  (*packed)->outputTypes = free_mem( (*packed)->outputTypes );
+  (*packed)->block       = free_mem( (*packed)->block );
+  (*packed)->remaining   = free_mem( (*packed)->remaining );
+  (*packed)->nzStart     = free_mem( (*packed)->nzStart );
+  (*packed)->nzCount     = free_mem( (*packed)->nzCount );
+  (*packed)->nzIndex     = free_mem( (*packed)->nzIndex );
+
+  *packed = free_mem( *packed );
+}
+
+
+/*	PACKED ROW -  Return the weights of row 'r' of a packed network,
+	hidden unit 'r' if r < Nunits and output r-Nunits otherwise, and
+	in 'len' the number of them a dot product runs over.  A recurrent
+	unit's self connection is not counted.
+*/
+
+float *packed_row  ( packed_net_t *packed, int r, int *len )
+{
+  if  ( r < packed->Nunits )  {
+    *len = r;
+    return packed->weights + packed->rowStart[r];
+  }
+
+  *len = packed->Nunits;
+  return packed->outWeights + (r - packed->Nunits) * packed->outStride;
+}
+
+
+/*	PACK ALLOC -  Allocate 'Nfloats' floats aligned to PACK_ALIGN bytes.
+	The allocation to free later is returned in 'block'.
+*/
+
+float *pack_alloc  ( int Nfloats, void **block, char *fn )
+{
+  unsigned long addr;
+
+  *block = alloc_mem( Nfloats + PACK_WIDTH, sizeof( float ), fn );
+  addr   = ( (unsigned long)*block + PACK_ALIGN-1 ) &
+           ~( (unsigned long)PACK_ALIGN-1 );
+
+  return (float *)addr;
+}
+
+
+/*	PACKED ACTIVATION -  Compute the activation of a unit of a packed
+	network.  A VARSIGMOID unit takes its range from the packed copy, so
+	that the network itself need not be at hand.
+*/
+
+float packed_activation  ( packed_net_t *packed, node_t type, float sum )
+{
+  if  ( type != VARSIGMOID )
+    return activation( NULL, type, sum );
+
+  if  ( sum < -15.0 )
+    return packed->sigMin;
+  if  ( sum > 15.0 )
+    return packed->sigMax;
+  return (packed->sigMax - packed->sigMin) / (1.0 + exp( -sum )) +
+         packed->sigMin;
+}
+
+
+/*	PACKED BOUND -  Return the largest magnitude a unit of the given type
+	can take, or HUGE_VAL if it has no bound.
+*/
+
+float packed_bound  ( packed_net_t *packed, node_t type )
+{
+  switch  ( type )  {
+    case SIGMOID:    return 0.5;
+    case ASIGMOID:
+    case GAUSSIAN:   return 1.0;
+    case VARSIGMOID: return ( fabs( packed->sigMax ) > fabs( packed->sigMin ) ) ?
+			    fabs( packed->sigMax ) : fabs( packed->sigMin );
+    default:         return HUGE_VAL;
+    }
+}
+
+
+/*	PACKED FORWARD -  Evaluate a batch of 'B' points, at most PACK_BATCH,
+	whose inputs are given in 'inputs', storing the outputs of each
+	point in 'outputs'.  'work' holds the unit values of the batch,
+	unit-major, and must have room for Nunits * PACK_BATCH floats.  The
+	dot products always run over a whole batch, since a fixed trip count
+	is what lets the compiler vectorize them, so a short batch is padded
+	out with zeros.
+
+	For a recurrent network 'resets' flags the points that begin a new
+	sequence, and 'state' holds the unit values of the point before the
+	batch.  It is left holding those of the last point of the batch.  If
+	'states' is given instead, each point is the next step of a sequence
+	of its own, whose unit values are in 'states', and are updated there.
+	The sequences must then all differ.  No training globals are touched,
+	so this may run on a thread of its own with its own 'state' and
+	'work'.
+*/
+
+void packed_forward  ( packed_net_t *packed, float **inputs, boolean *resets,
+		       int B, float *state, float **states, float *work,
+		       float **outputs )
+{
+  float  sums[PACK_BATCH],  /*  Summed inputs of a unit over the batch  */
+         *row,              /*  A unit's weights  */
+         *src,              /*  Values of an earlier unit over the batch  */
+         *dst,              /*  Values of this unit over the batch  */
+         weight,
+         prev;
+  node_t type;
+  int    *index,            /*  Units a sparse row's weights come from  */
+         i, j, n, b;
+
+  /*  The bias and the inputs  */
+  for  ( b = 0 ; b < PACK_BATCH ; b++ )
+    work[b] = BIAS;
+  for  ( i = 1 ; i <= packed->Ninputs ; i++ )  {
+    dst = work + i*PACK_BATCH;
+    for  ( b = 0 ; b < B ; b++ )
+      dst[b] = inputs[b][i-1];
+    for  ( ; b < PACK_BATCH ; b++ )
+      dst[b] = 0.0;
+  }
+
+  /*  The hidden units, each over the whole batch  */
+  for  ( i = packed->Ninputs+1 ; i < packed->Nunits ; i++ )  {
+    row  = packed->weights + packed->rowStart[i];
+    dst  = work + i*PACK_BATCH;
+    type = packed->unitTypes[i];
+
+    for  ( b = 0 ; b < PACK_BATCH ; b++ )
+      sums[b] = 0.0;
+    n     = packed->nzCount[i];
+    index = packed->nzIndex + packed->nzStart[i];
+    for  ( j = 0 ; j < ( (n < 0) ? i : n ) ; j++ )  {
+      weight = ( n < 0 ) ? row[j] : row[index[j]];
+      src    = work + (( n < 0 ) ? j : index[j])*PACK_BATCH;
+      for  ( b = 0 ; b < PACK_BATCH ; b++ )
+	sums[b] += weight * src[b];
+    }
+
+    if  ( packed->recurrent && (states != NULL) )  {
+      weight = row[i];
+      for  ( b = 0 ; b < B ; b++ )  {
+	if  ( !resets[b] )
+	  sums[b] += weight * states[b][i];
+	states[b][i] = dst[b] = packed_activation( packed, type, sums[b] );
+      }
+    }  else if  ( packed->recurrent )  {
+      weight = row[i];
+      prev   = state[i];
+      for  ( b = 0 ; b < B ; b++ )  {
+	if  ( !resets[b] )
+	  sums[b] += weight * prev;
+	prev = dst[b] = packed_activation( packed, type, sums[b] );
+      }
+      state[i] = prev;
+    }  else
+      for  ( b = 0 ; b < B ; b++ )
+	dst[b] = packed_activation( packed, type, sums[b] );
+    for  ( ; b < PACK_BATCH ; b++ )
+      dst[b] = 0.0;
+  }
+
+  /*  The outputs  */
+  for  ( i = 0 ; i < packed->Noutputs ; i++ )  {
+    row  = packed->outWeights + i * packed->outStride;
+    type = packed->outputTypes[i];
+
+    for  ( b = 0 ; b < PACK_BATCH ; b++ )
+      sums[b] = 0.0;
+    n     = packed->nzCount[packed->Nunits+i];
+    index = packed->nzIndex + packed->nzStart[packed->Nunits+i];
+    for  ( j = 0 ; j < ( (n < 0) ? packed->Nunits : n ) ; j++ )  {
+      weight = ( n < 0 ) ? row[j] : row[index[j]];
+      src    = work + (( n < 0 ) ? j : index[j])*PACK_BATCH;
+      for  ( b = 0 ; b < PACK_BATCH ; b++ )
+	sums[b] += weight * src[b];
+    }
+    for  ( b = 0 ; b < B ; b++ )
+      outputs[b][i] = packed_activation( packed, type, sums[b] );
+  }
+
+  if  ( packed->softmax )
+    for  ( b = 0 ; b < B ; b++ )
+      softmax_outputs( outputs[b], packed->outputTypes, packed->Noutputs );
+}
+
+
+/*	PACKED POINT -  Evaluate a single point with a packed network, for
+	callers that cannot wait for a batch.  The unit values are left in
+	'values', which for a recurrent network must hold those of the
+	previous point, and the outputs in 'outValues'.
+*/
+
+void packed_point  ( packed_net_t *packed, float *inputs, boolean reset,
+		     float *values, float *outValues )
+{
+  float  sum;
+  int    i;
+
+  values[0] = BIAS;
+  for  ( i = 1 ; i <= packed->Ninputs ; i++ )
+    values[i] = inputs[i-1];
+
+  for  ( i = packed->Ninputs+1 ; i < packed->Nunits ; i++ )  {
+    sum = packed_dot( packed, i, values );
+    if  ( packed->recurrent && !reset )
+      sum += values[i] * packed->weights[packed->rowStart[i] + i];
+    values[i] = packed_activation( packed, packed->unitTypes[i], sum );
+  }
+
+  for  ( i = 0 ; i < packed->Noutputs ; i++ )
+    outValues[i] = packed_activation( packed, packed->outputTypes[i],
+				      packed_dot( packed, packed->Nunits+i,
+						  values ) );
+
+  if  ( packed->softmax )
+    softmax_outputs( outValues, packed->outputTypes, packed->Noutputs );
+}
+
+
+/*	PACKED DOT -  Return the dot product of row 'r' of a packed network
+	(see 'packed_row') with the unit values of one point.  A sparse row
+	only visits its nonzero weights.
+*/
+
+float packed_dot  ( packed_net_t *packed, int r, float *values )
+{
+  float sum = 0.0,
+        *row;
+  int   *index,
+        len,
+        j;
+
+  row = packed_row( packed, r, &len );
+  if  ( packed->nzCount[r] < 0 )
+    for  ( j = 0 ; j < len ; j++ )
+      sum += values[j] * row[j];
+  else  {
+    index = packed->nzIndex + packed->nzStart[r];
+    for  ( j = 0 ; j < packed->nzCount[r] ; j++ )
+      sum += values[index[j]] * row[index[j]];
+  }
+
+  return sum;
+}
+
+
+/*	PACKED CLASS -  Return the class of a single point, the index of its
+	largest output, evaluating only as many hidden units as it takes to
+	decide it.  The result is always that of a full pass.  The number of
+	hidden units evaluated is returned in 'Nhidden'.  'sums' and 'mags'
+	need room for the outputs; the outputs are left in 'sums' if the
+	class is only decided by the full pass.
+
+	Networks the class cannot be decided early for are evaluated in full.
+	Otherwise, with the units before unit 'i' evaluated, each output sum
+	lies within the bound in 'remaining' of its partial sum, widened by
+	the rounding any order of summing could add.  Once the lower bound
+	of one output is above the upper bound of every other, and stays so
+	through the activation, its class is decided.  A SOFTMAX group also
+	needs a small gap, since the normalization rounds.
+*/
+
+int packed_class  ( packed_net_t *packed, float *inputs, boolean reset,
+		    float *values, float *sums, float *mags, int *Nhidden )
+{
+  float  sum,
+         slack,          /*  Rounding per unit of magnitude  */
+         low,            /*  Lower bound of the leading output  */
+         high,           /*  Highest upper bound of the others  */
+         topHigh = HUGE_VAL,  /*  Upper bound of the leading output  */
+         bound,
+         *row,
+         *remain;
+  node_t type = packed->outputTypes[0];
+  int    top,
+         i, j, k;
+
+  if  ( !packed->earlyExit )  {
+    packed_point( packed, inputs, reset, values, sums );
+    *Nhidden = packed->Nunits - packed->Ninputs - 1;
+    return class_of( sums, packed->Noutputs );
+  }
+
+  values[0] = BIAS;
+  for  ( i = 1 ; i <= packed->Ninputs ; i++ )
+    values[i] = inputs[i-1];
+  for  ( k = 0 ; k < packed->Noutputs ; k++ )  {
+    row     = packed->outWeights + k * packed->outStride;
+    sums[k] = mags[k] = 0.0;
+    for  ( j = 0 ; j <= packed->Ninputs ; j++ )  {
+      sums[k] += values[j] * row[j];
+      mags[k] += fabs( values[j] * row[j] );
+    }
+  }
+  slack = 2.0 * packed->Nunits * FLT_EPSILON;
+
+  for  ( i = packed->Ninputs+1 ; ; i++ )  {
+    /*  The leading output, and the highest any other could reach  */
+    top = 0;
+    low = -HUGE_VAL;
+    for  ( k = 0 ; k < packed->Noutputs ; k++ )  {
+      remain = packed->remaining + k * (packed->Nunits+1);
+      bound  = sums[k] - remain[i] - slack * (mags[k] + remain[i]);
+      if  ( bound > low )  {
+	low = bound;
+	top = k;
+      }
+    }
+    high = -HUGE_VAL;
+    for  ( k = 0 ; k < packed->Noutputs ; k++ )  {
+      remain = packed->remaining + k * (packed->Nunits+1);
+      bound  = sums[k] + remain[i] + slack * (mags[k] + remain[i]);
+      if  ( k == top )
+	topHigh = bound;
+      else if  ( bound > high )
+	high = bound;
+    }
+
+    if  ( type == SOFTMAX )
+      high += 1.0e-6 * packed->Noutputs +
+	      1.0e-5 * (fabs( low ) + fabs( topHigh ) + fabs( high ));
+    if  ( packed->Noutputs == 1 )
+      break;
+    if  ( (low > high) &&
+	  ( type == LINEAR || type == SOFTMAX ||
+	    packed_activation( packed, type, low ) >
+	    packed_activation( packed, type, high ) ) )
+      break;
+
+    if  ( i == packed->Nunits )  {
+      /*  Undecided: finish the outputs as a full pass does  */
+      for  ( k = 0 ; k < packed->Noutputs ; k++ )
+	sums[k] = packed_activation( packed, type, sums[k] );
+      if  ( packed->softmax )
+	softmax_outputs( sums, packed->outputTypes, packed->Noutputs );
+      top = class_of( sums, packed->Noutputs );
+      break;
+    }
+
+    /*  Evaluate unit 'i' and add it to the output sums  */
+    row = packed->weights + packed->rowStart[i];
+    sum = 0.0;
+    for  ( j = 0 ; j < i ; j++ )
+      sum += values[j] * row[j];
+    values[i] = packed_activation( packed, packed->unitTypes[i], sum );
+    for  ( k = 0 ; k < packed->Noutputs ; k++ )  {
+      sum      = values[i] * packed->outWeights[k * packed->outStride + i];
+      sums[k] += sum;
+      mags[k] += fabs( sum );
+    }
+  }
+
+  *Nhidden = i - packed->Ninputs - 1;
+  return top;
+}
+
+
+/*	BUILD INFER CTX -  Build an inference context for a packed network.
+	The context holds everything one caller changes while it evaluates
+	points, so any number of contexts may evaluate points with the same
+	packed network at once, each on a thread of its own, without
+	locking.  The recurrent state starts out reset.
+*/
+
+infer_ctx_t *build_infer_ctx  ( packed_net_t *model )
+{
+  infer_ctx_t *temp;
+  char        *fn = "Build Inference Context";
+
+  temp = (infer_ctx_t *)alloc_mem( 1, sizeof( infer_ctx_t ), fn );
+
+  temp->model      = model;
+  temp->quant      = NULL;
+  temp->qwork      = NULL;
+  temp->qworkBlock = NULL;
+  temp->values     = (float *)alloc_mem( model->Nunits, sizeof( float ), fn );
+  temp->outValues  = (float *)alloc_mem( model->Noutputs, sizeof( float ), fn );
+  temp->outMags    = (float *)alloc_mem( model->Noutputs, sizeof( float ), fn );
+  temp->work       = pack_alloc( PACK_BATCH * model->Nunits,
+				 &(temp->workBlock), fn );
+  reset_infer_ctx( temp );
+
+  return temp;
+}
+
+
+/*	FREE INFER CTX -  Deallocate an inference context.  The packed
+	network it was built for is left alone.
+*/
+
+void free_infer_ctx  ( infer_ctx_t **ctx )
+{
+  if  ( *ctx == NULL )
+    return;
+
+  (*ctx)->values     = free_mem( (*ctx)->values );
+  (*ctx)->outValues  = free_mem( (*ctx)->outValues );
+  (*ctx)->outMags    = free_mem( (*ctx)->outMags );
+  (*ctx)->workBlock  = free_mem( (*ctx)->workBlock );
+  (*ctx)->qworkBlock = free_mem( (*ctx)->qworkBlock );
+
+  *ctx = free_mem( *ctx );
+}
+
+
+/*	RESET INFER CTX -  Clear the recurrent state of an inference context.
+*/
+
+void reset_infer_ctx  ( infer_ctx_t *ctx )
+{
+  int i;
+
+  for  ( i = 0 ; i < ctx->model->Nunits ; i++ )
+    ctx->values[i] = 0.0;
+}
+
+
+/*	INFER POINT -  Evaluate a single point in an inference context.
+	Returns the outputs, which stay in the context until its next call.
+*/
+
+float *infer_point  ( infer_ctx_t *ctx, float *inputs, boolean reset )
+{
+  if  ( ctx->quant != NULL )
+    quant_point( ctx->quant, inputs, reset, ctx->values, ctx->qwork,
+		 ctx->outValues );
+  else
+    packed_point( ctx->model, inputs, reset, ctx->values, ctx->outValues );
+
+  return ctx->outValues;
+}
+
+
+/*	INFER CLASS -  Return the class of a single point in an inference
+	context, deciding it early where the network allows (see
+	'packed_class').  The number of hidden units evaluated is returned in
+	'Nhidden'.  A quantized copy is always evaluated in full.
+*/
+
+int infer_class  ( infer_ctx_t *ctx, float *inputs, boolean reset,
+		   int *Nhidden )
+{
+  if  ( ctx->quant != NULL )  {
+    quant_point( ctx->quant, inputs, reset, ctx->values, ctx->qwork,
+		 ctx->outValues );
+    *Nhidden = ctx->quant->Nunits - ctx->quant->Ninputs - 1;
+    return class_of( ctx->outValues, ctx->quant->Noutputs );
+  }
+
+  return packed_class( ctx->model, inputs, reset, ctx->values,
+		       ctx->outValues, ctx->outMags, Nhidden );
+}
+
+
+/*	INFER BATCH -  Evaluate 'B' points in an inference context, PACK_BATCH
+	at a time, storing the outputs of each point in 'outputs'.  'resets'
+	is only used by recurrent networks, and may be NULL for the others.
+*/
+
+void infer_batch  ( infer_ctx_t *ctx, float **inputs, boolean *resets, int B,
+		    float **outputs )
+{
+  int i, n;
+
+  for  ( i = 0 ; i < B ; i += n )  {
+    n = ( B-i > PACK_BATCH ) ? PACK_BATCH : B-i;
+    if  ( ctx->quant != NULL )
+      quant_forward( ctx->quant, inputs+i, (resets != NULL) ? resets+i : NULL,
+		     n, ctx->values, ctx->qwork, outputs+i );
+    else
+      packed_forward( ctx->model, inputs+i, (resets != NULL) ? resets+i : NULL,
+		      n, ctx->values, NULL, ctx->work, outputs+i );
+  }
+}
+
+
+/*	INFER SESSIONS -  Evaluate the next step of each of 'B' sequences in
+	an inference context, PACK_BATCH at a time, storing the outputs of
+	each in 'outputs'.  The recurrent state of each sequence is in
+	'states', and 'resets' flags the sequences that begin with this step.
+	The sequences must all differ.
+*/
+
+void infer_sessions  ( infer_ctx_t *ctx, float **inputs, boolean *resets,
+		       float **states, int B, float **outputs )
+{
+  int i, n;
+
+  if  ( ctx->quant != NULL )  {
+    for  ( i = 0 ; i < B ; i++ )
+      quant_point( ctx->quant, inputs[i], resets[i], states[i], ctx->qwork,
+		   outputs[i] );
+    return;
+  }
+
+  for  ( i = 0 ; i < B ; i += n )  {
+    n = ( B-i > PACK_BATCH ) ? PACK_BATCH : B-i;
+    packed_forward( ctx->model, inputs+i, resets+i, n, NULL, states+i,
+		    ctx->work, outputs+i );
+  }
+}
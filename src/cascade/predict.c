@@ -0,0 +1,416 @@
+/*  CMU Cascade Neural Network Simulator (CNNS)
+    Batch Prediction Functions
+
+    The functions contained herein write the predictions of a network on the
+    prediction data of a whole data file to a file of their own, for scoring
+    large data sets offline.  The points are fed through the network on
+    several threads (see 'eval_net'), and then formatted a block at a time,
+    also on several threads, each into a buffer of its own.  The buffers are
+    written out in order through one large stream buffer.  Output tokens are
+    decoded in place, without the allocations made by 'ftot'.
+
+    The format is set by the 'predictFormat' parameter.  'Raw' writes the
+    raw outputs of each point as a line of comma separated values, 'Tokens'
+    the decoded output tokens, and 'Both' the raw outputs followed by the
+    tokens.  'Binary' writes three ints (PRED_MAGIC, the number of points and
+    the number of outputs) followed by the raw outputs as floats, point by
+    point, all in the machine's own byte order.  'Class' writes the index of
+    each point's largest output, deciding it with as few hidden units as
+    will do (see 'packed_class'), and reports how many were evaluated.
+
+    The function predict_file is linked to the main CLI via the interface
+    table.  It is called like any other of the interface functions located
+    on that table.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "cascade.h"
+#include "toolkit.h"
+
+#define PRED_BUFSIZE  (1 << 20)  /*  Size of the output stream buffer  */
+
+
+/*  External declarations  */
+
+extern train_parm_t *cParms;
+extern boolean      interact;
+
+
+/*  PREDICT FILE -  Predict on the prediction data of a data file and write
+    the results to a file named after the data file, with '.pred' appended.
+    Rules for network and data file selection are the same as for the
+    predict function.
+*/
+
+void predict_file  ( char *netName, char *dFileName )
+{
+  char        nName[61],
+              dFName[61],
+              *outName;
+  net_t       *net;
+  data_file_t *dFile;
+  data_set_t  *dSet;
+  FILE        *outFile;
+  pred_job_t  *jobs;
+  float       *block,
+              **outputs,
+              range,
+              Nhidden;
+  int         header[3],
+              lineMax,
+              Nthreads,
+              maxThreads,
+              maxShare,
+              start,
+              end,
+              i, t;
+  char        *fn = "Predict to File";
+
+  /*  Get the name of the network to use  */
+  if  ( netName == NULL )
+    if  ( interact )  {
+      printf ("Network Name: ");
+      scanf  ("%s",nName);
+      netName = nName;
+    } else {
+      fprintf ( stderr, "No name specified for network to predict with.\n");
+      fprintf ( stderr, "Predicting aborted.\n");
+      return;
+    }
+
+  /*  Get the name of the data file to use  */
+  if  ( dFileName == NULL )
+    if  ( interact )  {
+      printf ( "Data file name: " );
+      scanf  ( "%s", dFName );
+      dFileName = dFName;
+    } else {
+      fprintf ( stderr, "No data file specified for predicting.\n" );
+      fprintf ( stderr, "Predicting aborted.\n" );
+      return;
+    }
+
+  /*  Select the data file and check it for prediction data  */
+  if  ( (dFile = select_data ( dFileName )) == NULL )  {
+    if  ( !parse_data ( dFileName, DEF_SIGMAX, DEF_SIGMIN, &dFile ) )  {
+      fprintf ( stderr, "Unable to parse data file '%s'.\n", dFileName );
+      return;
+    }
+    if  ( cParms->classTargets && !class_targets( dFile ) )
+      fprintf ( stderr, "Targets in '%s' kept as output vectors.\n",
+		dFileName );
+    add_data_file( dFile );
+  }
+  if  (dFile->predict == NULL)  {
+    fprintf (stderr,
+	     "No prediction data available in file '%s'.\n", dFile->filename);
+    fprintf (stderr, "Prediction aborted\n");
+    return;
+  }
+
+  /*  Select the network and check for appropriate inputs/outputs  */
+  if  ( (net = select_net( netName )) == NULL )  {
+    fprintf (stderr, "Network '%s' not found.  Prediction aborted.\n",
+	     netName );
+    return;
+  } else if  ( (net->Ninputs != dFile->NinNodes) ||
+	       (net->Noutputs != dFile->NoutNodes ) )  {
+    fprintf (stderr,"Number of inputs/outputs in net and data file must");
+    fprintf (stderr," be the same.\nRun not started.\n");
+    return;
+  } else if  ( (cParms->predictFormat == TOKEN_FORMAT ||
+		cParms->predictFormat == BOTH_FORMAT) &&
+	       (net->outputMap == NULL) )  {
+    fprintf (stderr,"Network '%s' has no output tokens.", netName );
+    fprintf (stderr,"  Prediction aborted.\n");
+    return;
+  }
+
+  /*  Open the output file with a large buffer  */
+  outName = (char *)alloc_mem( strlen( dFileName )+6, sizeof( char ), fn );
+  sprintf ( outName, "%s.pred", dFileName );
+  if  ( (outFile = fopen( outName, "wb" )) == NULL )  {
+    fprintf ( stderr, "ERROR: Unable to open prediction file %s.\n", outName );
+    free_mem( outName );
+    return;
+  }
+  setvbuf ( outFile, NULL, _IOFBF, PRED_BUFSIZE );
+
+  printf ("Predicting with '%s' on prediction data in '%s'...", netName,
+	  dFileName);
+
+  dSet = dFile->predict;
+  if  ( cParms->predictFormat == CLASS_FORMAT )  {
+    Nhidden = predict_classes( net, dSet, outFile );
+    if  ( fclose( outFile ) != 0 )
+      fprintf ( stderr, "ERROR: Unable to write prediction file %s.\n",
+		outName );
+    else  {
+      printf ("done!\n%d predictions written to '%s'.\n", dSet->Npts,
+	      outName );
+      printf ("Hidden units evaluated per point: %.2f of %d\n", Nhidden,
+	      net->Nunits - net->Ninputs - 1);
+    }
+    free_mem( outName );
+    return;
+  }
+
+  /*  Predict on every point, into one block  */
+  block   = (float *)alloc_mem( dSet->Npts * net->Noutputs, sizeof( float ),
+				fn );
+  outputs = (float **)alloc_mem( dSet->Npts, sizeof( float * ), fn );
+  for  ( i = 0 ; i < dSet->Npts ; i++ )
+    outputs[i] = block + i * net->Noutputs;
+  eval_net( net, cParms, dSet, NULL, outputs, NULL, NULL );
+
+  if  ( cParms->predictFormat == BINARY_FORMAT )  {
+    header[0] = PRED_MAGIC;
+    header[1] = dSet->Npts;
+    header[2] = net->Noutputs;
+    fwrite ( header, sizeof( int ), 3, outFile );
+    fwrite ( block, sizeof( float ), dSet->Npts * net->Noutputs, outFile );
+  }  else  {
+    /*  Format a block of points at a time, on as many threads as pay  */
+    range   = (net->sigmoidMax-net->sigmoidMin)/2.0;
+    lineMax = 1;
+    if  ( cParms->predictFormat != TOKEN_FORMAT )
+      lineMax += PRED_FLOAT_MAX * net->Noutputs;
+    if  ( cParms->predictFormat != RAW_FORMAT )
+      lineMax += token_width( net );
+
+    /*  Each buffer must hold the largest share of any block, and a  */
+    /* short block is split over fewer threads                      */
+    maxThreads = num_threads( cParms, PRED_BLOCK, EVAL_MIN_PTS );
+    maxShare   = 0;
+    for  ( start = 0 ; start < dSet->Npts ; start = end )  {
+      end = start + PRED_BLOCK;
+      if  ( end > dSet->Npts )
+	end = dSet->Npts;
+      Nthreads = num_threads( cParms, end-start, EVAL_MIN_PTS );
+      if  ( (end-start + Nthreads-1) / Nthreads > maxShare )
+	maxShare = (end-start + Nthreads-1) / Nthreads;
+    }
+
+    jobs = (pred_job_t *)alloc_mem( maxThreads, sizeof( pred_job_t ), fn );
+    for  ( t = 0 ; t < maxThreads ; t++ )  {
+      jobs[t].net     = net;
+      jobs[t].outputs = outputs;
+      jobs[t].range   = range;
+      jobs[t].format  = cParms->predictFormat;
+      jobs[t].buf     = (char *)alloc_mem( maxShare * lineMax,
+					   sizeof( char ), fn );
+    }
+
+    for  ( start = 0 ; start < dSet->Npts ; start = end )  {
+      end = start + PRED_BLOCK;
+      if  ( end > dSet->Npts )
+	end = dSet->Npts;
+      Nthreads = num_threads( cParms, end-start, EVAL_MIN_PTS );
+
+      for  ( t = 0 ; t < Nthreads ; t++ )  {
+	jobs[t].start = start + ((end-start) * t) / Nthreads;
+	jobs[t].end   = start + ((end-start) * (t+1)) / Nthreads;
+	jobs[t].threaded = ( (t > 0) &&
+			     (pthread_create( &(jobs[t].thread), NULL,
+					      format_thread,
+					      (void *)(jobs+t) ) == 0) );
+      }
+      for  ( t = 0 ; t < Nthreads ; t++ )  {
+	if  ( jobs[t].threaded )
+	  pthread_join( jobs[t].thread, NULL );
+	else
+	  format_thread( (void *)(jobs+t) );
+	fwrite ( jobs[t].buf, sizeof( char ), jobs[t].len, outFile );
+      }
+    }
+
+    for  ( t = 0 ; t < maxThreads ; t++ )
+      free_mem( jobs[t].buf );
+    free_mem( jobs );
+  }
+
+  if  ( fclose( outFile ) != 0 )
+    fprintf ( stderr, "ERROR: Unable to write prediction file %s.\n",
+	      outName );
+  else
+    printf ("done!\n%d predictions written to '%s'.\n", dSet->Npts, outName );
+
+  free_mem( outputs );
+  free_mem( block );
+  free_mem( outName );
+}
+
+
+/*  PREDICT CLASSES -  Write the class of each point of a data set to
+    'outFile', one line per point, for 'predict_file'.  The points are
+    taken one at a time, so that each may stop as soon as its class is
+    decided.  Returns the average number of hidden units evaluated.
+*/
+
+float predict_classes  ( net_t *net, data_set_t *dSet, FILE *outFile )
+{
+  packed_net_t *packed = NULL;
+  infer_ctx_t  *ctx;
+  double       total = 0.0;
+  int          Nhidden,
+               i;
+
+  if  ( net->packed == NULL )
+    packed = pack_net( net );
+  ctx = build_infer_ctx( (packed != NULL) ? packed : net->packed );
+  if  ( cParms->quantized && (net->quant != NULL) )
+    quant_infer_ctx( ctx, net->quant );
+
+  for  ( i = 0 ; i < dSet->Npts ; i++ )  {
+    fprintf ( outFile, "%d\n", infer_class( ctx, dSet->data[i].inputs,
+					     dSet->data[i].reset, &Nhidden ) );
+    total += Nhidden;
+  }
+
+  free_infer_ctx( &ctx );
+  free_packed( &packed );
+
+  return ( dSet->Npts > 0 ) ? total / dSet->Npts : 0.0;
+}
+
+
+/*  FORMAT THREAD -  Format the predictions of one share of a block of
+    points for 'predict_file', one line per point.  Nothing is allocated,
+    so the shares may be formatted on threads of their own.
+*/
+
+void *format_thread  ( void *arg )
+{
+  pred_job_t *job = (pred_job_t *)arg;
+  float      *vals;
+  char       *buf = job->buf;
+  int        i, j;
+
+  for  ( i = job->start ; i < job->end ; i++ )  {
+    vals = job->outputs[i];
+    if  ( job->format != TOKEN_FORMAT )
+      for  ( j = 0 ; j < job->net->Noutputs ; j++ )  {
+	if  ( j > 0 )
+	  *buf++ = ',';
+	buf = put_float( buf, vals[j] );
+      }
+    if  ( job->format == BOTH_FORMAT )
+      *buf++ = ',';
+    if  ( job->format != RAW_FORMAT )
+      buf = put_tokens( buf, job->net, vals, job->range );
+    *buf++ = '\n';
+  }
+  job->len = buf - job->buf;
+
+  return NULL;
+}
+
+
+/*  PUT FLOAT -  Write a value into 'buf' with six decimal places, as
+    printf's "%f" would, but without its overhead.  Values too large for
+    that are written with "%g".  Returns the end of the text written, which
+    is not terminated.
+*/
+
+char *put_float  ( char *buf, float val )
+{
+  double        v = val;
+  unsigned long whole,
+                frac;
+  char          digits[12];
+  int           n, i;
+
+  if  ( !(v > -1.0e9 && v < 1.0e9) )
+    return buf + sprintf( buf, "%g", v );
+
+  if  ( v < 0.0 )  {
+    *buf++ = '-';
+    v      = -v;
+  }
+  frac  = (unsigned long)( v * 1.0e6 + 0.5 );
+  whole = frac / 1000000;
+  frac  = frac % 1000000;
+
+  n = 0;
+  do  {
+    digits[n++] = '0' + whole % 10;
+    whole /= 10;
+  }  while  ( whole > 0 );
+  while  ( n > 0 )
+    *buf++ = digits[--n];
+
+  *buf++ = '.';
+  for  ( i = 5 ; i >= 0 ; i-- )  {
+    buf[i] = '0' + frac % 10;
+    frac /= 10;
+  }
+
+  return buf + 6;
+}
+
+
+/*  PUT TOKENS -  Decode a point's outputs into tokens through the network's
+    output map, as 'ftot' does, and write them into 'buf' separated by
+    commas.  Outputs that match none of their enumerations are written as
+    '?'.  Returns the end of the text written, which is not terminated.
+*/
+
+char *put_tokens  ( char *buf, net_t *net, float *vals, float range )
+{
+  cvrt_t *map;
+  char   *tok;
+  int    node, i, j;
+
+  for  ( i = 0, node = 0 ; node < net->Noutputs ; i++ )  {
+    map = &(net->outputMap[i]);
+    if  ( i > 0 )
+      *buf++ = ',';
+    if  ( map->Nenums == 0 )  {
+      buf = put_float( buf, vals[node++] );
+      continue;
+    }
+
+    j   = nearest_enum( map, vals+node, range );
+    tok = ( j == NOT_FOUND ) ? "?" : map->enums[j];
+    while  ( *tok != '\0' )
+      *buf++ = *tok++;
+    node += map->Nunits;
+  }
+
+  return buf;
+}
+
+
+/*  TOKEN WIDTH -  Return the most characters 'put_tokens' can write for
+    one point of a network, separators included.
+*/
+
+int token_width  ( net_t *net )
+{
+  cvrt_t *map;
+  int    width = 0,
+         widest,
+         node, i, j;
+
+  for  ( i = 0, node = 0 ; node < net->Noutputs ; i++ )  {
+    map = &(net->outputMap[i]);
+    if  ( map->Nenums == 0 )  {
+      width += PRED_FLOAT_MAX;
+      node++;
+      continue;
+    }
+
+    widest = 1;
+    for  ( j = 0 ; j < map->Nenums ; j++ )
+      if  ( strlen( map->enums[j] ) > widest )
+	widest = strlen( map->enums[j] );
+    width += widest + 1;
+    node  += map->Nunits;
+  }
+
+  return width;
+}
@@ -0,0 +1,526 @@
+/*	CMU Cascade Neural Network Simulator (CNNS)
+	Network pruning code
+
+	These routines shrink a trained network for inference.  A cascade
+	often ends up with hidden units that add almost nothing to the
+	outputs, and a network with many inputs with many input weights near
+	zero.  Pruning removes both, so long as the error on a held out data
+	set, the validation set if the file has one, grows by no more than
+	the 'pruneThreshold' parameter, in the units of the error measure.
+	Every change is checked against the error of the unpruned network,
+	so the bound holds for the result as a whole.
+
+	Hidden units are tried one at a time, least salient first, where a
+	unit's saliency is its RMS value over the data times the magnitude
+	of its outgoing weights.  A unit is taken out by zeroing its
+	outgoing weights, and kept out if the error stays within the bound.
+	The single weights left are then cut below a saliency, their
+	magnitude times the RMS value of the unit they come from, and the
+	highest cut that stays within the bound is found by bisection.
+	Units left with no outgoing weights are removed from the network
+	and the units after them renumbered.
+
+	If 'pruneRefit' is set, the output weights that are left are then
+	refit to the training data by Gauss-Newton steps, kept for as long
+	as they lower the held out error.  The packed copy made for
+	inference (see packed.c) lists the nonzero weights of rows left
+	mostly zero, and skips the others.
+*/
+
+#include <math.h>
+#include <string.h>
+
+#include "toolkit.h"
+#include "cascade.h"
+
+/*	External Global Variable Declarations	*/
+
+extern train_parm_t *cParms;
+extern boolean      interact;
+
+#define PRUNE_STEPS 16      /*  Bisection steps for the weight cut  */
+#define PRUNE_FITS  4       /*  Most Gauss-Newton steps of a refit  */
+#define PRUNE_RIDGE 1.0e-4  /*  Ridge added to the refit system  */
+
+
+/*	PRUNE -  Prune a network on the held out data of a data file, and
+	report its size and error before and after.
+*/
+
+void prune  ( char *netName, char *dFileName )
+{
+  char           nName[61],
+                 dFName[61];
+  net_t          *net;
+  data_file_t    *dFile;
+  data_set_t     *dSet;
+  trial_result_t before,
+                 after;
+  float          limit,
+                 *scale;
+  int            unitsBefore,
+                 weightsBefore,
+                 outVals;
+
+  /*  Get the name of the network  */
+  if  ( netName == NULL )
+    if  ( interact )  {
+      printf ("Network Name: ");
+      scanf  ("%s",nName);
+      netName = nName;
+    } else {
+      fprintf ( stderr, "No name specified for network to prune.\n");
+      fprintf ( stderr, "Pruning aborted.\n");
+      return;
+    }
+
+  /*  Get the name of the data file  */
+  if  ( dFileName == NULL )
+    if  ( interact )  {
+      printf ( "Data file name: " );
+      scanf  ( "%s", dFName );
+      dFileName = dFName;
+    } else {
+      fprintf ( stderr, "No data file specified for pruning.\n" );
+      fprintf ( stderr, "Pruning aborted.\n" );
+      return;
+    }
+
+  /*  Locate the data and the network  */
+  if  ( (dFile = select_data ( dFileName )) == NULL )  {
+    if  ( !parse_data ( dFileName, DEF_SIGMAX, DEF_SIGMIN, &dFile ) )  {
+      fprintf ( stderr, "Unable to parse data file '%s'.\n", dFileName );
+      return;
+    }
+    if  ( cParms->classTargets && !class_targets( dFile ) )
+      fprintf ( stderr, "Targets in '%s' kept as output vectors.\n",
+		dFileName );
+    add_data_file( dFile );
+  }
+  if  ( dFile->train == NULL )  {
+    fprintf (stderr, "No training data available in file '%s'.",
+	     dFile->filename);
+    fprintf (stderr, "  Pruning aborted.\n");
+    return;
+  }
+  if  ( (net = select_net( netName )) == NULL )  {
+    fprintf (stderr, "Network '%s' not found.  Pruning aborted.\n",
+	     netName );
+    return;
+  } else if  ( (net->Ninputs != dFile->NinNodes) ||
+	       (net->Noutputs != dFile->NoutNodes ) )  {
+    fprintf (stderr,"Number of inputs/outputs in net and data file must");
+    fprintf (stderr," be the same.\nPruning aborted.\n");
+    return;
+  }
+
+  dSet = ( dFile->validate != NULL ) ? dFile->validate :
+         ( dFile->test != NULL ) ? dFile->test : dFile->train;
+  printf ("Pruning '%s' on %s data in '%s'...", netName,
+	  ( dSet == dFile->validate ) ? "validation" :
+	  ( dSet == dFile->test ) ? "test" : "training", dFileName);
+  fflush (stdout);
+
+  /*  Copies and state built for the unpruned network no longer fit  */
+  free_packed( &(net->packed) );
+  free_quant( &(net->quant) );
+  free_memo( &(net->memo) );
+  free_rls( &(net->rls) );
+
+  before        = test_net( net, cParms, dSet, NULL );
+  limit         = ( (cParms->errorMeasure == BITS) ? before.bits :
+		    before.index ) + cParms->pruneThreshold;
+  unitsBefore   = net->NhiddenUnits;
+  weightsBefore = prune_count( net );
+
+  scale = prune_scales( net, dSet );
+  prune_units( net, dSet, limit, scale );
+  prune_compact( net );
+  free_mem( scale );
+
+  scale = prune_scales( net, dSet );
+  prune_weights( net, dSet, limit, scale );
+  prune_compact( net );
+  free_mem( scale );
+
+  if  ( cParms->pruneRefit )
+    prune_refit( net, dFile->train, dSet );
+  printf ("done!\n");
+
+  after   = test_net( net, cParms, dSet, NULL );
+  outVals = dSet->Npts * net->Noutputs;
+  before.perCorrect = (((float)(outVals-before.bits))/outVals)*100.0;
+  after.perCorrect  = (((float)(outVals-after.bits))/outVals)*100.0;
+  display_prune_results( before, after, unitsBefore, net->NhiddenUnits,
+			 weightsBefore, prune_count( net ) );
+}
+
+
+/*	PRUNE ERROR -  Return the error of a network on a data set, in bits
+	or as an error index, as the error measure says.
+*/
+
+float prune_error  ( net_t *net, data_set_t *dSet )
+{
+  trial_result_t result;
+
+  result = test_net( net, cParms, dSet, NULL );
+
+  return ( cParms->errorMeasure == BITS ) ? result.bits : result.index;
+}
+
+
+/*	PRUNE SCALES -  Return the RMS value of each unit of a network over a
+	data set, in a vector the caller frees.
+*/
+
+float *prune_scales  ( net_t *net, data_set_t *dSet )
+{
+  float *scale,
+        *values;
+  int   i, j;
+  char  *fn = "Prune Scales";
+
+  scale  = (float *)alloc_mem( net->Nunits, sizeof( float ), fn );
+  values = (float *)alloc_mem( net->Nunits, sizeof( float ), fn );
+  for  ( j = 0 ; j < net->Nunits ; j++ )
+    scale[j] = values[j] = 0.0;
+
+  for  ( i = 0 ; i < dSet->Npts ; i++ )  {
+    net_forward( net, dSet->data[i].inputs, dSet->data[i].reset, values );
+    for  ( j = 0 ; j < net->Nunits ; j++ )
+      scale[j] += values[j] * values[j];
+  }
+  for  ( j = 0 ; j < net->Nunits ; j++ )
+    scale[j] = sqrt( scale[j] / dSet->Npts );
+
+  free_mem( values );
+  return scale;
+}
+
+
+/*	PRUNE SALIENCY -  Return the saliency of hidden unit 'i', its RMS
+	value in 'scale' times the magnitude of its outgoing weights.  A
+	unit with no outgoing weights has a saliency of zero.
+*/
+
+float prune_saliency  ( net_t *net, int i, float *scale )
+{
+  float sum = 0.0;
+  int   j;
+
+  for  ( j = 0 ; j < net->Noutputs ; j++ )
+    sum += fabs( net->outWeights[j][i] );
+  for  ( j = i+1 ; j < net->Nunits ; j++ )
+    sum += fabs( net->weights[j][i] );
+
+  return scale[i] * sum;
+}
+
+
+/*	PRUNE UNITS -  Take the hidden units of a network out one at a time,
+	least salient first, keeping each out that leaves the error on the
+	data set within 'limit'.  A unit is taken out by zeroing its
+	outgoing weights; call 'prune_compact' to remove it.
+*/
+
+void prune_units  ( net_t *net, data_set_t *dSet, float limit, float *scale )
+{
+  boolean *tried;
+  float   *saved,
+          least,
+          sal;
+  int     unit,
+          i, j;
+  char    *fn = "Prune Units";
+
+  tried = (boolean *)alloc_mem( net->Nunits, sizeof( boolean ), fn );
+  saved = (float *)alloc_mem( net->Noutputs + net->Nunits, sizeof( float ),
+			      fn );
+  for  ( i = 0 ; i < net->Nunits ; i++ )
+    tried[i] = FALSE;
+
+  for  ( ;; )  {
+    /*  The least salient unit not yet tried  */
+    unit  = -1;
+    least = HUGE_VAL;
+    for  ( i = net->Ninputs+1 ; i < net->Nunits ; i++ )
+      if  ( !tried[i] && ((sal = prune_saliency( net, i, scale )) < least) )  {
+	least = sal;
+	unit  = i;
+      }
+    if  ( unit < 0 )
+      break;
+    tried[unit] = TRUE;
+
+    for  ( j = 0 ; j < net->Noutputs ; j++ )  {
+      saved[j] = net->outWeights[j][unit];
+      net->outWeights[j][unit] = 0.0;
+    }
+    for  ( j = unit+1 ; j < net->Nunits ; j++ )  {
+      saved[net->Noutputs+j] = net->weights[j][unit];
+      net->weights[j][unit]  = 0.0;
+    }
+
+    if  ( prune_error( net, dSet ) > limit )  {
+      for  ( j = 0 ; j < net->Noutputs ; j++ )
+	net->outWeights[j][unit] = saved[j];
+      for  ( j = unit+1 ; j < net->Nunits ; j++ )
+	net->weights[j][unit] = saved[net->Noutputs+j];
+    }
+  }
+
+  free_mem( tried );
+  free_mem( saved );
+}
+
+
+/*	PRUNE WEIGHTS -  Zero the single weights of a network whose saliency,
+	their magnitude times the RMS value in 'scale' of the unit they come
+	from, is below a cut, choosing the highest cut that leaves the error
+	on the data set within 'limit'.  The bias weights and the self
+	connections of a recurrent network are kept.
+*/
+
+void prune_weights  ( net_t *net, data_set_t *dSet, float limit, float *scale )
+{
+  float **weight,  /*  The weights that may be cut  */
+        *value,    /*  Their values  */
+        *sal,      /*  Their saliencies  */
+        low = 0.0, /*  Highest cut known to stay within the limit  */
+        high = 0.0,
+        cut;
+  int   N,
+        i, j, n;
+  char  *fn = "Prune Weights";
+
+  N = net->Noutputs * net->Nunits;
+  for  ( i = net->Ninputs+1 ; i < net->Nunits ; i++ )
+    N += i;
+  weight = (float **)alloc_mem( N, sizeof( float * ), fn );
+  value  = (float *)alloc_mem( N, sizeof( float ), fn );
+  sal    = (float *)alloc_mem( N, sizeof( float ), fn );
+
+  N = 0;
+  for  ( i = net->Ninputs+1 ; i < net->Nunits + net->Noutputs ; i++ )
+    for  ( j = 1 ; j < ( (i < net->Nunits) ? i : net->Nunits ) ; j++ )  {
+      weight[N] = ( i < net->Nunits ) ? &(net->weights[i][j]) :
+	                                &(net->outWeights[i-net->Nunits][j]);
+      if  ( *weight[N] == 0.0 )
+	continue;
+      value[N] = *weight[N];
+      sal[N]   = fabs( value[N] ) * scale[j];
+      if  ( sal[N] > high )
+	high = sal[N];
+      N++;
+    }
+
+  for  ( n = 0 ; n < PRUNE_STEPS ; n++ )  {
+    cut = (low + high) / 2.0;
+    for  ( i = 0 ; i < N ; i++ )
+      *weight[i] = ( sal[i] < cut ) ? 0.0 : value[i];
+    if  ( prune_error( net, dSet ) <= limit )
+      low = cut;
+    else
+      high = cut;
+  }
+  for  ( i = 0 ; i < N ; i++ )
+    *weight[i] = ( sal[i] < low ) ? 0.0 : value[i];
+
+  free_mem( weight );
+  free_mem( value );
+  free_mem( sal );
+}
+
+
+/*	PRUNE REFIT -  Refit the nonzero output weights of a network to the
+	points of 'fitSet' by Gauss-Newton steps on the squared error, as
+	the outputs are trained, damped as the Levenberg-Marquardt steps of
+	lm.c are.  Steps are kept while they do not raise the error on
+	'dSet'.  Returns TRUE if any step was kept.
+*/
+
+boolean prune_refit  ( net_t *net, data_set_t *fitSet, data_set_t *dSet )
+{
+  float   ***hess,   /*  Gauss-Newton system of each output  */
+          **grad,    /*  Gradient of each output  */
+          **saved,   /*  Output weights before the step  */
+          *values,
+          *outValues,
+          *jacob,
+          error,
+          next,
+          dif,
+          prime;
+  int     **active,  /*  Units with nonzero weights to each output  */
+          *Nactive,
+          step,
+          i, j, k, p;
+  boolean kept = FALSE;
+  char    *fn = "Prune Refit";
+
+  hess      = (float ***)alloc_mem( net->Noutputs, sizeof( float ** ), fn );
+  grad      = (float **)alloc_mem( net->Noutputs, sizeof( float * ), fn );
+  saved     = (float **)alloc_mem( net->Noutputs, sizeof( float * ), fn );
+  active    = (int **)alloc_mem( net->Noutputs, sizeof( int * ), fn );
+  Nactive   = (int *)alloc_mem( net->Noutputs, sizeof( int ), fn );
+  values    = (float *)alloc_mem( net->Nunits, sizeof( float ), fn );
+  outValues = (float *)alloc_mem( net->Noutputs, sizeof( float ), fn );
+  jacob     = (float *)alloc_mem( net->Nunits, sizeof( float ), fn );
+  for  ( k = 0 ; k < net->Noutputs ; k++ )  {
+    active[k]  = (int *)alloc_mem( net->Nunits, sizeof( int ), fn );
+    Nactive[k] = 0;
+    for  ( j = 0 ; j < net->Nunits ; j++ )
+      if  ( (j == 0) || (net->outWeights[k][j] != 0.0) )
+	active[k][Nactive[k]++] = j;
+    hess[k]  = (float **)alloc_mem( Nactive[k], sizeof( float * ), fn );
+    for  ( i = 0 ; i < Nactive[k] ; i++ )
+      hess[k][i] = (float *)alloc_mem( Nactive[k], sizeof( float ), fn );
+    grad[k]  = (float *)alloc_mem( Nactive[k], sizeof( float ), fn );
+    saved[k] = (float *)alloc_mem( net->Nunits, sizeof( float ), fn );
+  }
+
+  error = prune_error( net, dSet );
+  for  ( step = 0 ; step < PRUNE_FITS ; step++ )  {
+    for  ( k = 0 ; k < net->Noutputs ; k++ )
+      for  ( i = 0 ; i < Nactive[k] ; i++ )  {
+	grad[k][i] = 0.0;
+	for  ( j = 0 ; j < Nactive[k] ; j++ )
+	  hess[k][i][j] = 0.0;
+      }
+
+    /*  Accumulate the system of each output over the fitting data  */
+    for  ( p = 0 ; p < fitSet->Npts ; p++ )  {
+      net_forward( net, fitSet->data[p].inputs, fitSet->data[p].reset,
+		   values );
+      output_values( net, values, outValues );
+      for  ( k = 0 ; k < net->Noutputs ; k++ )  {
+	dif   = outValues[k] - GOAL( fitSet, &(fitSet->data[p]), k );
+	prime = output_prime( net, net->outputTypes[k], outValues[k],
+			      cParms->outPrimeOffset );
+	for  ( i = 0 ; i < Nactive[k] ; i++ )  {
+	  jacob[i]    = values[active[k][i]];
+	  grad[k][i] += prime * dif * jacob[i];
+	}
+	lm_accumulate( hess[k], jacob, Nactive[k], prime * prime );
+      }
+    }
+
+    /*  Step each output's weights  */
+    for  ( k = 0 ; k < net->Noutputs ; k++ )  {
+      memcpy( saved[k], net->outWeights[k], net->Nunits * sizeof( float ) );
+      for  ( i = 0 ; i < Nactive[k] ; i++ )
+	hess[k][i][i] = hess[k][i][i] * (1.0 + LM_LAMBDA) + PRUNE_RIDGE;
+      if  ( lm_solve( hess[k], grad[k], Nactive[k] ) )
+	for  ( i = 0 ; i < Nactive[k] ; i++ )
+	  net->outWeights[k][active[k][i]] -= grad[k][i];
+    }
+
+    if  ( (next = prune_error( net, dSet )) > error )  {
+      for  ( k = 0 ; k < net->Noutputs ; k++ )
+	memcpy( net->outWeights[k], saved[k], net->Nunits * sizeof( float ) );
+      break;
+    }
+    error = next;
+    kept  = TRUE;
+  }
+
+  for  ( k = 0 ; k < net->Noutputs ; k++ )  {
+    for  ( i = 0 ; i < Nactive[k] ; i++ )
+      free_mem( hess[k][i] );
+    free_mem( hess[k] );
+    free_mem( grad[k] );
+    free_mem( saved[k] );
+    free_mem( active[k] );
+  }
+  free_mem( hess );
+  free_mem( grad );
+  free_mem( saved );
+  free_mem( active );
+  free_mem( Nactive );
+  free_mem( values );
+  free_mem( outValues );
+  free_mem( jacob );
+
+  return kept;
+}
+
+
+/*	PRUNE COMPACT -  Remove the hidden units of a network that have no
+	outgoing weights left.  Returns the number removed.
+*/
+
+int prune_compact  ( net_t *net )
+{
+  boolean used;
+  int     Nremoved = 0,
+          i, j;
+
+  for  ( i = net->Nunits-1 ; i > net->Ninputs ; i-- )  {
+    used = FALSE;
+    for  ( j = 0 ; j < net->Noutputs ; j++ )
+      used |= ( net->outWeights[j][i] != 0.0 );
+    for  ( j = i+1 ; j < net->Nunits ; j++ )
+      used |= ( net->weights[j][i] != 0.0 );
+
+    if  ( !used )  {
+      prune_unit( net, i );
+      Nremoved++;
+    }
+  }
+
+  return Nremoved;
+}
+
+
+/*	PRUNE UNIT -  Remove hidden unit 'k' from a network, renumbering the
+	units after it.  Its row of weights goes to the end of the spare
+	rows, resized to suit its new place.
+*/
+
+void prune_unit  ( net_t *net, int k )
+{
+  float *row;
+  int   maxUnits = net->Nunits + net->maxNewUnits,
+        i, j;
+
+  for  ( i = k+1 ; i < net->Nunits ; i++ )
+    memmove( net->weights[i] + k, net->weights[i] + k+1,
+	     (i + net->recurrent - k-1) * sizeof( float ) );
+  for  ( j = 0 ; j < net->Noutputs ; j++ )
+    memmove( net->outWeights[j] + k, net->outWeights[j] + k+1,
+	     (net->Nunits - k-1) * sizeof( float ) );
+
+  row = net->weights[k];
+  for  ( i = k ; i < maxUnits-1 ; i++ )  {
+    net->weights[i]   = net->weights[i+1];
+    net->unitTypes[i] = net->unitTypes[i+1];
+  }
+  net->weights[maxUnits-1] = (float *)realloc_mem( row, maxUnits-1 +
+						   net->recurrent,
+						   sizeof( float ),
+						   "Prune Unit" );
+
+  net->Nunits--;
+  net->NhiddenUnits--;
+  net->maxNewUnits++;
+}
+
+
+/*	PRUNE COUNT -  Return the number of nonzero weights in a network.
+*/
+
+int prune_count  ( net_t *net )
+{
+  int count = 0,
+      i, j;
+
+  for  ( i = net->Ninputs+1 ; i < net->Nunits ; i++ )
+    for  ( j = 0 ; j < i + net->recurrent ; j++ )
+      count += ( net->weights[i][j] != 0.0 );
+  for  ( i = 0 ; i < net->Noutputs ; i++ )
+    for  ( j = 0 ; j < net->Nunits ; j++ )
+      count += ( net->outWeights[i][j] != 0.0 );
+
+  return count;
+}
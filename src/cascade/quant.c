@@ -0,0 +1,519 @@
+/*	CMU Cascade Neural Network Simulator (CNNS)
+	Quantized inference code
+
+	These routines build an 8 bit copy of a trained network for
+	inference, a quarter the size of the packed copy.  Every unit value
+	is held as a signed byte times a scale of the unit's own.  The
+	bounded activations (SIGMOID, ASIGMOID, VARSIGMOID and GAUSSIAN) have
+	fixed scales set by their range, while the inputs and any LINEAR
+	hidden units are calibrated by running a data set through the float
+	network and taking the largest value each one reaches.
+
+	Each weight is multiplied by the scale of the unit feeding it, and
+	each hidden unit's or output's row of weights is then quantized to
+	bytes with a scale of its own, so a sum is accumulated in integers
+	and scaled once.  The hidden units look up their activations in
+	tables of QUANT_TABLE bytes covering sums of +/- QUANT_TABLE /
+	(2 * QUANT_STEPS), beyond which the bounded activations are flat.
+	The outputs are activated in floating point from the scaled sums.
+	The self connections of recurrent networks are kept in floating
+	point as well.
+
+	Points are evaluated in batches laid out as in packed.c.  Like a
+	packed copy, a quantized copy is not updated when its network
+	changes.
+*/
+
+#include <math.h>
+
+#include "toolkit.h"
+#include "cascade.h"
+
+#define QUANT_BYTES PACK_ALIGN          /*  Row alignment in bytes  */
+
+extern train_parm_t *cParms;
+extern boolean      interact;
+
+
+/*	QUANTIZE NET -  Build a quantized copy of a network, calibrated on
+	the points of 'dSet'.
+*/
+
+quant_net_t *quantize_net  ( net_t *net, data_set_t *dSet )
+{
+  quant_net_t  *temp;
+  packed_net_t *packed;
+  float        *values,
+               *outValues,
+               *maxVal,
+               *scaled,
+               top;
+  int          size,
+               i, j, k;
+  char         *fn = "Quantize Network";
+
+  /*  Calibrate on the float network  */
+  packed    = pack_net( net );
+  values    = (float *)alloc_mem( net->Nunits, sizeof( float ), fn );
+  outValues = (float *)alloc_mem( net->Noutputs, sizeof( float ), fn );
+  maxVal    = (float *)alloc_mem( net->Nunits, sizeof( float ), fn );
+  for  ( i = 0 ; i < net->Nunits ; i++ )
+    maxVal[i] = values[i] = 0.0;
+  for  ( i = 0 ; i < dSet->Npts ; i++ )  {
+    packed_point( packed, dSet->data[i].inputs, dSet->data[i].reset, values,
+		  outValues );
+    for  ( j = 0 ; j < net->Nunits ; j++ )
+      if  ( fabs( values[j] ) > maxVal[j] )
+	maxVal[j] = fabs( values[j] );
+  }
+
+  temp = (quant_net_t *)alloc_mem( 1, sizeof( quant_net_t ), fn );
+
+  temp->Ninputs   = net->Ninputs;
+  temp->Nunits    = net->Nunits;
+  temp->Noutputs  = net->Noutputs;
+  temp->recurrent = net->recurrent;
+  temp->softmax   = packed->softmax;
+  temp->sigMax    = net->sigmoidMax;
+  temp->sigMin    = net->sigmoidMin;
+  temp->outStride = ( (net->Nunits + QUANT_BYTES-1) / QUANT_BYTES ) *
+                    QUANT_BYTES;
+
+  /*  The scale of each unit's value  */
+  temp->unitTypes = (node_t *)alloc_mem( net->Nunits, sizeof( node_t ), fn );
+  temp->unitScale = (float *)alloc_mem( net->Nunits, sizeof( float ), fn );
+  temp->unitScale[0] = BIAS / 127.0;
+  for  ( i = 1 ; i < net->Nunits ; i++ )  {
+    temp->unitTypes[i] = ( i > net->Ninputs ) ? net->unitTypes[i] : LINEAR;
+    switch  ( temp->unitTypes[i] )  {
+      case SIGMOID:    top = 0.5;
+                       break;
+      case ASIGMOID:
+      case GAUSSIAN:   top = 1.0;
+                       break;
+      case VARSIGMOID: top = ( fabs( net->sigmoidMax ) > fabs( net->sigmoidMin ) )
+                             ? fabs( net->sigmoidMax ) : fabs( net->sigmoidMin );
+                       break;
+      default:         top = ( maxVal[i] > 0.0 ) ? maxVal[i] : 1.0;
+    }
+    temp->unitScale[i] = top / 127.0;
+  }
+
+  /*  Lay out the hidden unit rows and the output rows, in bytes  */
+  temp->rowStart = (int *)alloc_mem( net->Nunits, sizeof( int ), fn );
+  size = 0;
+  for  ( i = 0 ; i < net->Nunits ; i++ )  {
+    temp->rowStart[i] = size;
+    if  ( i > net->Ninputs )
+      size += ( (i + QUANT_BYTES-1) / QUANT_BYTES ) * QUANT_BYTES;
+  }
+  temp->weights    = (signed char *)pack_alloc( (size + net->Noutputs *
+						 temp->outStride + 3) / 4,
+						&(temp->block), fn );
+  temp->outWeights = temp->weights + size;
+  for  ( i = 0 ; i < size + net->Noutputs * temp->outStride ; i++ )
+    temp->weights[i] = 0;
+
+  /*  Quantize each row with a scale of its own  */
+  scaled = (float *)alloc_mem( net->Nunits, sizeof( float ), fn );
+  temp->rowScale    = (float *)alloc_mem( net->Nunits, sizeof( float ), fn );
+  temp->selfWeights = (float *)alloc_mem( net->Nunits, sizeof( float ), fn );
+  for  ( i = net->Ninputs+1 ; i < net->Nunits ; i++ )  {
+    for  ( j = 0 ; j < i ; j++ )
+      scaled[j] = net->weights[i][j] * temp->unitScale[j];
+    temp->rowScale[i] = quantize_row( scaled, i,
+				      temp->weights + temp->rowStart[i] );
+    temp->selfWeights[i] = ( net->recurrent ) ? net->weights[i][i] : 0.0;
+  }
+
+  temp->outputTypes = (node_t *)alloc_mem( net->Noutputs, sizeof( node_t ),
+					   fn );
+  temp->outScale    = (float *)alloc_mem( net->Noutputs, sizeof( float ), fn );
+  for  ( k = 0 ; k < net->Noutputs ; k++ )  {
+    for  ( j = 0 ; j < net->Nunits ; j++ )
+      scaled[j] = net->outWeights[k][j] * temp->unitScale[j];
+    temp->outScale[k]    = quantize_row( scaled, net->Nunits,
+					 temp->outWeights + k*temp->outStride );
+    temp->outputTypes[k] = net->outputTypes[k];
+  }
+
+  /*  The activation tables, in the fixed scales of their types  */
+  temp->tables = (signed char *)alloc_mem( 4 * QUANT_TABLE,
+					   sizeof( signed char ), fn );
+  for  ( i = 0 ; i <= SOFTMAX ; i++ )
+    temp->table[i] = NULL;
+  temp->table[SIGMOID]    = temp->tables;
+  temp->table[ASIGMOID]   = temp->tables + QUANT_TABLE;
+  temp->table[VARSIGMOID] = temp->tables + 2*QUANT_TABLE;
+  temp->table[GAUSSIAN]   = temp->tables + 3*QUANT_TABLE;
+  for  ( i = 0 ; i <= SOFTMAX ; i++ )
+    if  ( temp->table[i] != NULL )  {
+      top = ( i == VARSIGMOID ) ?
+	    ( ( fabs( temp->sigMax ) > fabs( temp->sigMin ) ) ?
+	      fabs( temp->sigMax ) : fabs( temp->sigMin ) ) / 127.0 :
+	    ( ( i == SIGMOID ) ? 0.5 : 1.0 ) / 127.0;
+      for  ( k = 0 ; k < QUANT_TABLE ; k++ )
+	temp->table[i][k] = quant_byte( quant_activation( temp, i,
+		              (float)(k - QUANT_TABLE/2) / QUANT_STEPS ) / top );
+    }
+
+  free_packed( &packed );
+  free_mem( values );
+  free_mem( outValues );
+  free_mem( maxVal );
+  free_mem( scaled );
+
+  return temp;
+}
+
+
+/*	QUANTIZE ROW -  Quantize 'N' weights into 'row', scaled so the largest
+	becomes 127.  Returns the scale.
+*/
+
+float quantize_row  ( float *weights, int N, signed char *row )
+{
+  float top = 0.0,
+        scale;
+  int   j;
+
+  for  ( j = 0 ; j < N ; j++ )
+    if  ( fabs( weights[j] ) > top )
+      top = fabs( weights[j] );
+  scale = ( top > 0.0 ) ? top / 127.0 : 1.0;
+
+  for  ( j = 0 ; j < N ; j++ )
+    row[j] = quant_byte( weights[j] / scale );
+
+  return scale;
+}
+
+
+/*	QUANT BYTE -  Round a value to the nearest signed byte, saturating at
+	+/- 127.
+*/
+
+signed char quant_byte  ( float val )
+{
+  if  ( val >= 127.0 )
+    return 127;
+  if  ( val <= -127.0 )
+    return -127;
+
+  return (signed char)floor( val + 0.5 );
+}
+
+
+/*	FREE QUANT -  Deallocate a quantized network.
+*/
+
+void free_quant  ( quant_net_t **quant )
+{
+  if  ( *quant == NULL )
+    return;
+
+  (*quant)->rowStart    = free_mem( (*quant)->rowStart );
+  (*quant)->unitTypes   = free_mem( (*quant)->unitTypes );
+  (*quant)->outputTypes = free_mem( (*quant)->outputTypes );
+  (*quant)->unitScale   = free_mem( (*quant)->unitScale );
+  (*quant)->rowScale    = free_mem( (*quant)->rowScale );
+  (*quant)->outScale    = free_mem( (*quant)->outScale );
+  (*quant)->selfWeights = free_mem( (*quant)->selfWeights );
+  (*quant)->tables      = free_mem( (*quant)->tables );
+  (*quant)->block       = free_mem( (*quant)->block );
+
+  *quant = free_mem( *quant );
+}
+
+
+/*	QUANT BYTES -  Return the bytes taken by the weights of a quantized
+	network and their scales, to compare with the float weights.
+*/
+
+int quant_bytes  ( quant_net_t *quant )
+{
+  int size = 0,
+      i;
+
+  for  ( i = quant->Ninputs+1 ; i < quant->Nunits ; i++ )
+    size += i + sizeof( float ) * (1 + quant->recurrent);
+  size += quant->Noutputs * (quant->Nunits + sizeof( float ));
+
+  return size;
+}
+
+
+/*	QUANT ACTIVATION -  Compute the activation of a unit of a quantized
+	network from its summed input.  Used for the outputs, and to fill the
+	activation tables.
+*/
+
+float quant_activation  ( quant_net_t *quant, node_t type, float sum )
+{
+  if  ( type != VARSIGMOID )
+    return activation( NULL, type, sum );
+
+  if  ( sum < -15.0 )
+    return quant->sigMin;
+  if  ( sum > 15.0 )
+    return quant->sigMax;
+  return (quant->sigMax - quant->sigMin) / (1.0 + exp( -sum )) +
+         quant->sigMin;
+}
+
+
+/*	QUANT UNIT -  Return the quantized value of hidden unit 'i' given its
+	summed input.  Bounded units look their values up in their type's
+	table, and the others are scaled.
+*/
+
+signed char quant_unit  ( quant_net_t *quant, int i, float sum )
+{
+  signed char *table = quant->table[quant->unitTypes[i]];
+  float       pos;
+
+  if  ( table == NULL )
+    return quant_byte( sum / quant->unitScale[i] );
+
+  pos = sum * QUANT_STEPS + QUANT_TABLE/2;
+  if  ( pos <= 0.0 )
+    return table[0];
+  if  ( pos >= QUANT_TABLE-1 )
+    return table[QUANT_TABLE-1];
+  return table[(int)(pos + 0.5)];
+}
+
+
+/*	QUANT FORWARD -  Evaluate a batch of 'B' points, at most PACK_BATCH,
+	with a quantized network, as 'packed_forward' does with a packed one.
+	'work' holds the quantized unit values of the batch, unit-major, and
+	must have room for Nunits * PACK_BATCH bytes.  For a recurrent
+	network 'state' holds the unit values of the point before the batch,
+	and is left holding those of the last point.
+*/
+
+void quant_forward  ( quant_net_t *quant, float **inputs, boolean *resets,
+		      int B, float *state, signed char *work, float **outputs )
+{
+  int         sums[PACK_BATCH];  /*  Summed inputs over the batch  */
+  signed char *row,              /*  A unit's weights  */
+              *src,              /*  Values of an earlier unit  */
+              *dst;              /*  Values of this unit  */
+  float       scale,
+              prev;
+  int         weight,
+              i, j, b;
+
+  /*  The bias and the inputs  */
+  for  ( b = 0 ; b < PACK_BATCH ; b++ )
+    work[b] = 127;
+  for  ( i = 1 ; i <= quant->Ninputs ; i++ )  {
+    dst   = work + i*PACK_BATCH;
+    scale = 1.0 / quant->unitScale[i];
+    for  ( b = 0 ; b < B ; b++ )
+      dst[b] = quant_byte( inputs[b][i-1] * scale );
+    for  ( ; b < PACK_BATCH ; b++ )
+      dst[b] = 0;
+  }
+
+  /*  The hidden units, each over the whole batch  */
+  for  ( i = quant->Ninputs+1 ; i < quant->Nunits ; i++ )  {
+    row   = quant->weights + quant->rowStart[i];
+    dst   = work + i*PACK_BATCH;
+    scale = quant->rowScale[i];
+
+    for  ( b = 0 ; b < PACK_BATCH ; b++ )
+      sums[b] = 0;
+    for  ( j = 0 ; j < i ; j++ )  {
+      if  ( (weight = row[j]) == 0 )
+	continue;
+      src = work + j*PACK_BATCH;
+      for  ( b = 0 ; b < PACK_BATCH ; b++ )
+	sums[b] += weight * src[b];
+    }
+
+    if  ( quant->recurrent )  {
+      prev = state[i];
+      for  ( b = 0 ; b < B ; b++ )  {
+	dst[b] = quant_unit( quant, i, sums[b] * scale +
+			     ( (resets[b]) ? 0.0 : quant->selfWeights[i] * prev ) );
+	prev   = dst[b] * quant->unitScale[i];
+      }
+      state[i] = prev;
+    }  else
+      for  ( b = 0 ; b < B ; b++ )
+	dst[b] = quant_unit( quant, i, sums[b] * scale );
+    for  ( ; b < PACK_BATCH ; b++ )
+      dst[b] = 0;
+  }
+
+  /*  The outputs  */
+  for  ( i = 0 ; i < quant->Noutputs ; i++ )  {
+    row = quant->outWeights + i * quant->outStride;
+
+    for  ( b = 0 ; b < PACK_BATCH ; b++ )
+      sums[b] = 0;
+    for  ( j = 0 ; j < quant->Nunits ; j++ )  {
+      if  ( (weight = row[j]) == 0 )
+	continue;
+      src = work + j*PACK_BATCH;
+      for  ( b = 0 ; b < PACK_BATCH ; b++ )
+	sums[b] += weight * src[b];
+    }
+    for  ( b = 0 ; b < B ; b++ )
+      outputs[b][i] = quant_activation( quant, quant->outputTypes[i],
+					sums[b] * quant->outScale[i] );
+  }
+
+  if  ( quant->softmax )
+    for  ( b = 0 ; b < B ; b++ )
+      softmax_outputs( outputs[b], quant->outputTypes, quant->Noutputs );
+}
+
+
+/*	QUANT POINT -  Evaluate a single point with a quantized network.  The
+	quantized unit values are left in 'work', which needs Nunits bytes,
+	and for a recurrent network 'values' holds the unit values of the
+	previous point.  The outputs are left in 'outValues'.
+*/
+
+void quant_point  ( quant_net_t *quant, float *inputs, boolean reset,
+		    float *values, signed char *work, float *outValues )
+{
+  signed char *row;
+  int         sum,
+              i, j;
+
+  work[0] = 127;
+  for  ( i = 1 ; i <= quant->Ninputs ; i++ )
+    work[i] = quant_byte( inputs[i-1] / quant->unitScale[i] );
+
+  for  ( i = quant->Ninputs+1 ; i < quant->Nunits ; i++ )  {
+    row = quant->weights + quant->rowStart[i];
+    sum = 0;
+    for  ( j = 0 ; j < i ; j++ )
+      sum += row[j] * work[j];
+    work[i] = quant_unit( quant, i, sum * quant->rowScale[i] +
+			  ( (quant->recurrent && !reset) ?
+			    quant->selfWeights[i] * values[i] : 0.0 ) );
+    values[i] = work[i] * quant->unitScale[i];
+  }
+
+  for  ( i = 0 ; i < quant->Noutputs ; i++ )  {
+    row = quant->outWeights + i * quant->outStride;
+    sum = 0;
+    for  ( j = 0 ; j < quant->Nunits ; j++ )
+      sum += row[j] * work[j];
+    outValues[i] = quant_activation( quant, quant->outputTypes[i],
+				     sum * quant->outScale[i] );
+  }
+
+  if  ( quant->softmax )
+    softmax_outputs( outValues, quant->outputTypes, quant->Noutputs );
+}
+
+
+/*	QUANT INFER CTX -  Have an inference context evaluate its points with
+	a quantized copy of its network rather than the packed copy.
+*/
+
+void quant_infer_ctx  ( infer_ctx_t *ctx, quant_net_t *quant )
+{
+  ctx->quant = quant;
+  ctx->qwork = (signed char *)pack_alloc( (PACK_BATCH * quant->Nunits + 3) / 4,
+					  &(ctx->qworkBlock),
+					  "Quantized Inference Context" );
+}
+
+
+/*	QUANTIZE -  Quantize a network, calibrating it on the training data of
+	a data file, and report how its results on the test data change.  If
+	the file has no test data, the training data is used for both.  The
+	quantized copy is kept with the network, and is used for inference
+	while the 'quantized' parameter is set.
+*/
+
+void quantize  ( char *netName, char *dFileName )
+{
+  char           nName[61],
+                 dFName[61];
+  net_t          *net;
+  data_file_t    *dFile;
+  data_set_t     *dSet;
+  trial_result_t floatRes,
+                 quantRes;
+  boolean        quantized;
+  int            outVals;
+
+  /*  Get the name of the network  */
+  if  ( netName == NULL )
+    if  ( interact )  {
+      printf ("Network Name: ");
+      scanf  ("%s",nName);
+      netName = nName;
+    } else {
+      fprintf ( stderr, "No name specified for network to quantize.\n");
+      fprintf ( stderr, "Quantizing aborted.\n");
+      return;
+    }
+
+  /*  Get the name of the data file  */
+  if  ( dFileName == NULL )
+    if  ( interact )  {
+      printf ( "Data file name: " );
+      scanf  ( "%s", dFName );
+      dFileName = dFName;
+    } else {
+      fprintf ( stderr, "No data file specified for calibration.\n" );
+      fprintf ( stderr, "Quantizing aborted.\n" );
+      return;
+    }
+
+  /*  Locate the data and the network  */
+  if  ( (dFile = select_data ( dFileName )) == NULL )  {
+    if  ( !parse_data ( dFileName, DEF_SIGMAX, DEF_SIGMIN, &dFile ) )  {
+      fprintf ( stderr, "Unable to parse data file '%s'.\n", dFileName );
+      return;
+    }
+    if  ( cParms->classTargets && !class_targets( dFile ) )
+      fprintf ( stderr, "Targets in '%s' kept as output vectors.\n",
+		dFileName );
+    add_data_file( dFile );
+  }
+  if  ( dFile->train == NULL )  {
+    fprintf (stderr, "No training data available in file '%s'.",
+	     dFile->filename);
+    fprintf (stderr, "  Quantizing aborted.\n");
+    return;
+  }
+  if  ( (net = select_net( netName )) == NULL )  {
+    fprintf (stderr, "Network '%s' not found.  Quantizing aborted.\n",
+	     netName );
+    return;
+  } else if  ( (net->Ninputs != dFile->NinNodes) ||
+	       (net->Noutputs != dFile->NoutNodes ) )  {
+    fprintf (stderr,"Number of inputs/outputs in net and data file must");
+    fprintf (stderr," be the same.\nQuantizing aborted.\n");
+    return;
+  }
+
+  printf ("Quantizing '%s' on training data in '%s'...", netName, dFileName);
+  free_quant( &(net->quant) );
+  free_memo( &(net->memo) );
+  net->quant = quantize_net( net, dFile->train );
+  printf ("done!\n");
+
+  /*  Test with and without the quantized copy  */
+  dSet = ( dFile->test != NULL ) ? dFile->test : dFile->train;
+  quantized = cParms->quantized;
+  cParms->quantized = FALSE;
+  floatRes = test_net( net, cParms, dSet, NULL );
+  cParms->quantized = TRUE;
+  quantRes = test_net( net, cParms, dSet, NULL );
+  cParms->quantized = quantized;
+
+  outVals = dSet->Npts * net->Noutputs;
+  floatRes.perCorrect = (((float)(outVals-floatRes.bits))/outVals)*100.0;
+  quantRes.perCorrect = (((float)(outVals-quantRes.bits))/outVals)*100.0;
+  display_quant_results( floatRes, quantRes, net, quant_bytes( net->quant ) );
+}
@@ -23,31 +23,30 @@
 #include "toolkit.h"
 
 
-/*  External declarations needed for the feedforward predictions  */
+/*  External declarations  */
 
-extern net_t   *cNet;
-extern int     Ninputs,
-               Noutputs;
-extern float   sigMax,
-               sigMin;
-extern boolean recurrent,
-               interact;
+extern boolean      interact;
+extern train_parm_t *cParms;
 
 
 /*  QUERY NET -  This is the main function of the query module.  Note that
     script execution is suspended while in this module and that no scripts
     can be executed while within this module.
 
-    The first thing this function does is establish the network to query,
-    locate that network and then set the necessary global variables to
-    reflect that network.  After this initial setup is done, a simple command
-    line interface is executed as a while loop.  The predictions are handled
-    by subordinate functions.
+    The first thing this function does is establish the network to query
+    and locate that network in memory.  The network is packed for inference
+    and the queries are run in an inference context of their own, so that
+    no globals are touched.  Results are cached while 'memoEntries' is set
+    (see memo.c).  After this initial setup is done, a simple
+    command line interface is executed as a while loop.  The predictions are
+    handled by subordinate functions.
 */
 
 void query_net ( char *netName, char *d1 )
 {
-  char  inLine[81];
+  char        inLine[81];
+  net_t       *net;
+  infer_ctx_t *ctx;
 
   /*  Determine network to query and locate that network in memory  */
   if  ( netName == NULL )
@@ -60,17 +59,18 @@ void query_net ( char *netName, char *d1 )
 	       "Network not specified.  Entrance to query mode aborted.\n");
       return;
     }
-  if  ( (cNet = select_net( netName )) == NULL )  {
+  if  ( (net = select_net( netName )) == NULL )  {
     fprintf ( stderr, "ERROR: Unable to find network %s.\n", netName );
     return;
   }
 
-  /*  Set global variables to reflect this network  */
-  Ninputs   = cNet->Ninputs;
-  Noutputs  = cNet->Noutputs;
-  sigMax    = cNet->sigmoidMax;
-  sigMin    = cNet->sigmoidMin;
-  recurrent = cNet->recurrent;
+  /*  The network does not change while it is queried, so pack it  */
+  free_packed( &(net->packed) );
+  net->packed = pack_net( net );
+  ctx = build_infer_ctx( net->packed );
+  if  ( cParms->quantized && (net->quant != NULL) )
+    quant_infer_ctx( ctx, net->quant );
+  memo_net( net );
 
   /*  Execute the simple CLI  */
   printf ("Querying '%s'.  Type 'exit' to return to CLI.\n", netName );
@@ -81,12 +81,16 @@ void query_net ( char *netName, char *d1 )
     
     if  ( !strncasecmp( inLine, "exit", 4 ) || 
 	  !strncasecmp( inLine, "quit", 4 ) )
-      return;
+      break;
     else if  ( !strncasecmp( inLine, "rawinput", 8 ) )
-      raw_input( inLine+8 );
+      raw_input( net, ctx, inLine+8 );
     else if  ( !strncasecmp( inLine, "input", 5 ) )
-      token_input( inLine+5 );
+      token_input( net, ctx, inLine+5 );
   }
+
+  free_infer_ctx( &ctx );
+  free_packed( &(net->packed) );
+  display_memo_results( net );
 }
 
 
@@ -98,16 +102,17 @@ void query_net ( char *netName, char *d1 )
     performing the prediction.
 */
 
-void raw_input  ( char *inp )
+void raw_input  ( net_t *net, infer_ctx_t *ctx, char *inp )
 {
-  float   *inputs;       /*  The floating point inputs to the network  */
+  float   *inputs,       /*  The floating point inputs to the network  */
+          *outValues;    /*  The outputs of the network  */
   boolean reset = FALSE; /*  Network reset flag  */
   int     i,             /*  Indexing variable  */
           start = 0;     /*  Point on input vector to start loop  */
   char    *tok,          /*  Character token being evaluated  */
           **outtok;      /*  Tokenized outputs  */
 
-  inputs = (float *)alloc_mem( Ninputs, sizeof( float ), "Raw Input" );
+  inputs = (float *)alloc_mem( net->Ninputs, sizeof( float ), "Raw Input" );
 
   /*  Read first token.  Allow the keyword 'reset' as well as floats  */
   if  ( (tok = strtok( inp, " \t," )) == NULL )  {
@@ -125,7 +130,7 @@ void raw_input  ( char *inp )
   }
 
   /*  Read the rest of the tokens.  From this point floats only.  */
-  for  ( i = start ; i < Ninputs ; i++ )  {
+  for  ( i = start ; i < net->Ninputs ; i++ )  {
     if  ( (tok = strtok( NULL, " \t," )) == NULL )  {
       fprintf (stderr,"Insufficient tokens for input.\n");
       return;
@@ -138,22 +143,22 @@ void raw_input  ( char *inp )
     inputs[i] = ( isint( tok ) ) ? atoi( tok ) : atof( tok );
   }
 
-  /*  Perform the forward pass  */
-  cNet->values = cNet->tempValues;
-  forward_pass ( inputs, reset );
+  /*  Perform the forward pass, unless the result is cached  */
+  outValues = ( net->memo != NULL ) ? memo_point( net->memo, ctx, inputs ) :
+                                      infer_point( ctx, inputs, reset );
 
   /*  Display the raw output  */
   printf ("Raw output: ");
-  for  ( i = 0 ; i < Noutputs ; i++ )
-    printf ("%5.3f ",cNet->outValues[i]);
+  for  ( i = 0 ; i < net->Noutputs ; i++ )
+    printf ("%5.3f ",outValues[i]);
   printf ("\n");
 
   /*  Display the tokenized output  */
-  outtok = ftot ( cNet->outValues, (cNet->sigmoidMax-cNet->sigmoidMin)/2.0,
-		 Noutputs, cNet->outputMap );
+  outtok = ftot ( outValues, (net->sigmoidMax-net->sigmoidMin)/2.0,
+		 net->Noutputs, net->outputMap );
   printf ("Tokenized output: ");
-  for  ( i = 0 ; i < Noutputs ; i++ )  {
-    printf ("%s%s",outtok[i],(i==Noutputs-1)?"\n":", ");
+  for  ( i = 0 ; i < net->Noutputs ; i++ )  {
+    printf ("%s%s",outtok[i],(i==net->Noutputs-1)?"\n":", ");
     free( outtok[i] );
   }
   free( outtok );
@@ -166,9 +171,10 @@ void raw_input  ( char *inp )
     reset keyword, are the same as for raw input
 */
 
-void token_input ( char *inp )
+void token_input ( net_t *net, infer_ctx_t *ctx, char *inp )
 {
-  float   *inputs;
+  float   *inputs,
+          *outValues;
   boolean reset = FALSE;
   int     i,
           start = 0;
@@ -176,8 +182,10 @@ void token_input ( char *inp )
           **intok,
           **outtok;
 
-  inputs = (float *)alloc_mem( Ninputs, sizeof( float ), "Tokenized Input" );
-  intok  = (char **)alloc_mem( Ninputs, sizeof( char * ), "Tokenized Input" );
+  inputs = (float *)alloc_mem( net->Ninputs, sizeof( float ),
+			       "Tokenized Input" );
+  intok  = (char **)alloc_mem( net->Ninputs, sizeof( char * ),
+			       "Tokenized Input" );
 
   /*  Tokenize the input string  */
   if  ( (tok = strtok( inp, " \t," )) == NULL )  {
@@ -189,7 +197,7 @@ void token_input ( char *inp )
   else
     intok[start++] = strdup( tok );
 
-  for  ( i = start ; i < Ninputs ; i++ )  {
+  for  ( i = start ; i < net->Ninputs ; i++ )  {
     if  ( (tok = strtok( NULL, " \t," )) == NULL )  {
       fprintf (stderr,"Insufficient tokens for input.\n");
       return;
@@ -198,28 +206,28 @@ void token_input ( char *inp )
   }
 
   /*  Convert tokens to floating point inputs  */
-  if  ( ttof ( inputs, intok, Ninputs, cNet->inputMap ) )  {
-    /*  Perform feedforward prediction  */
-    cNet->values = cNet->tempValues;
-    forward_pass ( inputs, reset );
+  if  ( ttof ( inputs, intok, net->Ninputs, net->inputMap ) )  {
+    /*  Perform feedforward prediction, unless the result is cached  */
+    outValues = ( net->memo != NULL ) ? memo_point( net->memo, ctx, inputs ) :
+                                        infer_point( ctx, inputs, reset );
 
     /*  Display outputs  */
     printf ("Raw output: ");
-    for  ( i = 0 ; i < Noutputs ; i++ )
-      printf ("%5.3f ",cNet->outValues[i]);
+    for  ( i = 0 ; i < net->Noutputs ; i++ )
+      printf ("%5.3f ",outValues[i]);
     printf ("\n");
 
-    outtok = ftot ( cNet->outValues, (cNet->sigmoidMax-cNet->sigmoidMin)/2.0,
-		    Noutputs, cNet->outputMap );
+    outtok = ftot ( outValues, (net->sigmoidMax-net->sigmoidMin)/2.0,
+		    net->Noutputs, net->outputMap );
     printf ("Tokenized output: ");
-    for  ( i = 0 ; i < Noutputs ; i++ )  {
-      printf ("%s%s",outtok[i],(i==Noutputs-1)?"\n":", ");
+    for  ( i = 0 ; i < net->Noutputs ; i++ )  {
+      printf ("%s%s",outtok[i],(i==net->Noutputs-1)?"\n":", ");
       free( outtok[i] );
     }
     free( outtok );
   }
 
-  for  ( i = 0 ; i < Ninputs ; i++ )
+  for  ( i = 0 ; i < net->Ninputs ; i++ )
     free( intok[i] );
   free( intok );
 }
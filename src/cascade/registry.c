@@ -0,0 +1,423 @@
+/*	CMU Cascade Neural Network Simulator (CNNS)
+	Network registry code
+
+	These routines keep a registry of networks by name, each with the
+	file it is saved in, so that many networks may be on hand without
+	all of them being in memory.  'registerNet' names a file without
+	reading it.  The network is loaded the first time its name is used
+	by any command, and is then in memory like any loaded network.
+
+	Names are kept in a hash table, looked up without regard to case as
+	'select_net' does, which doubles in size whenever it holds more
+	models than buckets.  While 'maxResident' is set, at most that many
+	registered networks are kept in memory, and loading another drops
+	the one least recently used.  A dropped network is loaded again from
+	its file the next time it is used, so changes made to it in memory
+	and not saved are lost.
+
+	Each time a resident network is used its file is checked, and if the
+	file has been replaced or changed the network is loaded again.  The
+	new copy is read in full before it takes the place of the old one,
+	so a file that cannot be read leaves the old copy in use.  Files
+	should be replaced by renaming a new file over the old one, so that
+	a file is never read while it is half written.
+
+	A file is read by mapping it into memory and parsing the mapping.
+	Network files are text, so the network still has to be parsed into
+	a network of its own; the mapping saves copying the file through
+	the stream's buffer.  A server binds its networks when it starts, so
+	a registered network is served by naming it to 'serve'.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <sys/mman.h>
+
+#include "toolkit.h"
+#include "cascade.h"
+
+/*	External Global Variable Declarations	*/
+
+extern net_t        *nets;
+extern registry_t   *models;
+extern train_parm_t *cParms;
+extern boolean      interact;
+
+
+/*	REGISTER NET -  Register the network 'netName' as kept in the file
+	'filename'.  A name already registered is given the new file, which
+	is loaded the next time the network is used.
+*/
+
+void register_net  ( char *netName, char *filename )
+{
+  struct stat info;
+  char        name[81],
+              fname[81];
+
+  if  ( netName == NULL )
+    if  ( interact )  {
+      printf ("Name of network to register: ");
+      scanf  ("%80s", name);
+      netName = name;
+    } else {
+      fprintf ( stderr, "No name specified for network to register.\n" );
+      fprintf ( stderr, "Network not registered.\n" );
+      return;
+    }
+
+  if  ( filename == NULL )
+    if  ( interact )  {
+      printf ("File '%s' is kept in: ", netName);
+      scanf  ("%80s", fname);
+      filename = fname;
+    } else {
+      fprintf ( stderr, "No file specified for network '%s'.\n", netName );
+      fprintf ( stderr, "Network not registered.\n" );
+      return;
+    }
+
+  if  ( stat( filename, &info ) == -1 )  {
+    fprintf ( stderr, "ERROR: Unable to find network file %s.\n", filename );
+    fprintf ( stderr, "Network not registered.\n" );
+    return;
+  }
+
+  if  ( models == NULL )
+    models = build_registry( );
+  if  ( find_model( models, netName ) == NULL &&
+	select_net( netName ) != NULL )  {
+    fprintf ( stderr, "ERROR: Network '%s' already in memory.\n", netName );
+    fprintf ( stderr, "Network not registered.\n" );
+    return;
+  }
+
+  add_model( models, netName, filename );
+  printf ("Network '%s' registered as '%s'.\n", netName, filename );
+}
+
+
+/*	BUILD REGISTRY -  Build an empty registry.
+*/
+
+registry_t *build_registry  ( void )
+{
+  registry_t *temp;
+  int        i;
+  char       *fn = "Build Registry";
+
+  temp = (registry_t *)alloc_mem( 1, sizeof( registry_t ), fn );
+  temp->Nmodels   = 0;
+  temp->Nresident = 0;
+  temp->Nbuckets  = REGISTRY_BUCKETS;
+  temp->loads     = 0;
+  temp->reloads   = 0;
+  temp->evictions = 0;
+  temp->newest    = NULL;
+  temp->oldest    = NULL;
+  temp->buckets   = (model_t **)alloc_mem( REGISTRY_BUCKETS,
+					   sizeof( model_t * ), fn );
+  for  ( i = 0 ; i < REGISTRY_BUCKETS ; i++ )
+    temp->buckets[i] = NULL;
+
+  return temp;
+}
+
+
+/*	MODEL HASH -  Hash a network name, without regard to case (FNV-1a).
+*/
+
+unsigned long model_hash  ( char *name )
+{
+  unsigned long hash = 2166136261UL;
+
+  while  ( *name != '\0' )  {
+    hash ^= (unsigned char)tolower( (unsigned char)*name++ );
+    hash *= 16777619UL;
+  }
+
+  return hash;
+}
+
+
+/*	FIND MODEL -  Return the model registered as 'name', or NULL if there
+	is none.
+*/
+
+model_t *find_model  ( registry_t *reg, char *name )
+{
+  model_t       *model;
+  unsigned long hash = model_hash( name );
+
+  for  ( model = reg->buckets[hash & (reg->Nbuckets-1)] ; model != NULL ;
+	 model = model->next )
+    if  ( model->hash == hash && !strcasecmp( model->name, name ) )
+      return model;
+
+  return NULL;
+}
+
+
+/*	ADD MODEL -  Register 'name' as kept in 'filename', and return its
+	model.  A model already registered keeps its network in memory, but
+	the new file is loaded in its place the next time it is used.
+*/
+
+model_t *add_model  ( registry_t *reg, char *name, char *filename )
+{
+  model_t *model,
+          *next,
+          **buckets;
+  int     i;
+  char    *fn = "Add Model";
+
+  if  ( (model = find_model( reg, name )) != NULL )  {
+    free( model->filename );
+    model->filename = strdup( filename );
+    model->size     = -1;  /*  Never the size of a file  */
+    return model;
+  }
+
+  /*  Double the table once it holds as many models as buckets  */
+  if  ( reg->Nmodels == reg->Nbuckets )  {
+    buckets = (model_t **)alloc_mem( 2 * reg->Nbuckets, sizeof( model_t * ),
+				     fn );
+    for  ( i = 0 ; i < 2 * reg->Nbuckets ; i++ )
+      buckets[i] = NULL;
+    for  ( i = 0 ; i < reg->Nbuckets ; i++ )
+      for  ( model = reg->buckets[i] ; model != NULL ; model = next )  {
+	next = model->next;
+	model->next = buckets[model->hash & (2*reg->Nbuckets-1)];
+	buckets[model->hash & (2*reg->Nbuckets-1)] = model;
+      }
+    free_mem( reg->buckets );
+    reg->buckets   = buckets;
+    reg->Nbuckets *= 2;
+  }
+
+  model = (model_t *)alloc_mem( 1, sizeof( model_t ), fn );
+  model->name     = strdup( name );
+  model->filename = strdup( filename );
+  model->net      = NULL;
+  model->mtime    = 0;
+  model->size     = -1;
+  model->inode    = 0;
+  model->device   = 0;
+  model->hash     = model_hash( name );
+  model->newer    = NULL;
+  model->older    = NULL;
+
+  model->next = reg->buckets[model->hash & (reg->Nbuckets-1)];
+  reg->buckets[model->hash & (reg->Nbuckets-1)] = model;
+  reg->Nmodels++;
+
+  return model;
+}
+
+
+/*	USE MODEL -  Return the network of a model, making it the most
+	recently used.  The network is loaded if it is not in memory, or if
+	its file has changed since it was loaded, and the least recently
+	used networks are dropped if this puts more than 'maxResident' in
+	memory.  Returns NULL if the network is not in memory and cannot be
+	loaded.
+*/
+
+net_t *use_model  ( registry_t *reg, model_t *model )
+{
+  struct stat info;
+  net_t       *net,
+              **link;
+
+  /*  A network whose file is unchanged, or gone, is used as it is  */
+  if  ( model->net != NULL &&
+	( stat( model->filename, &info ) == -1 ||
+	  (info.st_mtime == model->mtime && info.st_size == model->size &&
+	   info.st_ino == model->inode && info.st_dev == model->device) ) )  {
+    model_unlink( reg, model );
+    model_link( reg, model );
+    return model->net;
+  }
+
+  net = map_net( model->filename, &info );
+
+  /*  The file read is remembered even if it is bad, so that it is not  */
+  /* tried again until it changes.                                      */
+  model->mtime  = info.st_mtime;
+  model->size   = info.st_size;
+  model->inode  = info.st_ino;
+  model->device = info.st_dev;
+
+  if  ( net == NULL )  {
+    if  ( model->net == NULL )
+      return NULL;
+    fprintf ( stderr, "Network '%s' not reloaded.  The copy in memory is "
+	      "kept.\n", model->name );
+    model_unlink( reg, model );
+    model_link( reg, model );
+    return model->net;
+  }
+
+  /*  The network goes by its registered name, whatever its file says  */
+  free_mem( net->name );
+  net->name     = strdup( model->name );
+  net->filename = strdup( model->filename );
+
+  if  ( model->net != NULL )  {
+    for  ( link = &nets ; *link != model->net ; link = &((*link)->next) )
+      ;
+    *link     = net;
+    net->next = model->net->next;
+    free_net( &(model->net) );
+    model_unlink( reg, model );
+    reg->reloads++;
+    printf ("Network '%s' reloaded from '%s'.\n", model->name,
+	    model->filename );
+  }  else  {
+    add_net( net );
+    reg->Nresident++;
+    reg->loads++;
+    printf ("Network '%s' loaded from '%s'.\n", model->name,
+	    model->filename );
+  }
+  model->net = net;
+  model_link( reg, model );
+
+  while  ( cParms->maxResident > 0 && reg->Nresident > cParms->maxResident )
+    evict_model( reg, reg->oldest );
+
+  return net;
+}
+
+
+/*	MAP NET -  Read the network saved in 'filename' by mapping the file
+	into memory and parsing it.  The status of the file read is left in
+	'info', with a size of -1 if it could not be opened.  Returns NULL if
+	the file does not hold a network.
+*/
+
+net_t *map_net  ( char *filename, struct stat *info )
+{
+  FILE  *netFile;
+  net_t *net;
+  char  *text;
+
+  info->st_size = -1;
+  if  ( (netFile = fopen( filename, "r" )) == NULL )  {
+    fprintf ( stderr, "ERROR: Unable to open network data file %s.\n",
+	      filename );
+    return NULL;
+  }
+  if  ( fstat( fileno( netFile ), info ) == -1 || info->st_size == 0 )  {
+    fprintf ( stderr, "ERROR: Network file %s is empty.\n", filename );
+    fclose( netFile );
+    return NULL;
+  }
+
+  text = (char *)mmap( NULL, info->st_size, PROT_READ, MAP_PRIVATE,
+		       fileno( netFile ), 0 );
+  fclose( netFile );
+  if  ( text == (char *)MAP_FAILED )  {
+    fprintf ( stderr, "ERROR: Unable to map network file %s.\n", filename );
+    return NULL;
+  }
+
+  if  ( (netFile = fmemopen( text, info->st_size, "r" )) == NULL )
+    net = NULL;
+  else  {
+    net = read_net( netFile );
+    fclose( netFile );
+  }
+
+  munmap( text, info->st_size );
+  return net;
+}
+
+
+/*	EVICT MODEL -  Drop a model's network from memory.  It stays
+	registered, and is loaded again when it is next used.
+*/
+
+void evict_model  ( registry_t *reg, model_t *model )
+{
+  net_t **link;
+
+  for  ( link = &nets ; *link != model->net ; link = &((*link)->next) )
+    ;
+  *link = model->net->next;
+  free_net( &(model->net) );
+
+  model_unlink( reg, model );
+  reg->Nresident--;
+  reg->evictions++;
+}
+
+
+/*	DROP MODEL -  Forget the network of a model as it is removed from
+	memory by other means, such as 'killNet'.  Networks not registered
+	are left alone.
+*/
+
+void drop_model  ( registry_t *reg, net_t *net )
+{
+  model_t *model;
+
+  if  ( (model = find_model( reg, net->name )) == NULL || model->net != net )
+    return;
+
+  model->net = NULL;
+  model_unlink( reg, model );
+  reg->Nresident--;
+}
+
+
+/*	MODEL LINK -  Make a resident model the most recently used.
+*/
+
+void model_link  ( registry_t *reg, model_t *model )
+{
+  model->older = reg->newest;
+  model->newer = NULL;
+  if  ( reg->newest != NULL )
+    reg->newest->newer = model;
+  else
+    reg->oldest = model;
+  reg->newest = model;
+}
+
+
+/*	MODEL UNLINK -  Take a resident model out of the order of use.
+*/
+
+void model_unlink  ( registry_t *reg, model_t *model )
+{
+  if  ( model->newer != NULL )
+    model->newer->older = model->older;
+  else
+    reg->newest = model->older;
+  if  ( model->older != NULL )
+    model->older->newer = model->newer;
+  else
+    reg->oldest = model->newer;
+}
+
+
+/*	LIST MODELS -  List the registered networks, and whether each is in
+	memory.
+*/
+
+void list_models  ( registry_t *reg )
+{
+  model_t *model;
+  int     i;
+
+  printf ("Registered networks:\n");
+  for  ( i = 0 ; i < reg->Nbuckets ; i++ )
+    for  ( model = reg->buckets[i] ; model != NULL ; model = model->next )
+      printf ("  %-20s %-8s %s\n", model->name,
+	      ( model->net != NULL ) ? "loaded" : "on disk", model->filename );
+  printf ("  %d of %d in memory.  %d loads, %d reloads, %d dropped.\n",
+	  reg->Nresident, reg->Nmodels, reg->loads, reg->reloads,
+	  reg->evictions );
+}
@@ -0,0 +1,834 @@
+/*  CMU Cascade Neural Network Simulator (CNNS)
+    Query Server Functions
+
+    The functions contained herein answer queries from other programs on a
+    local (Unix domain) socket.  One or more networks are served at once,
+    to any number of clients, from a single thread that waits on all the
+    sockets together.  Each pass of the server reads whatever queries have
+    arrived, batches them by network, evaluates each batch with the
+    network's packed copy, and writes the replies in the order the queries
+    arrived.  A lone query is evaluated on its own, so that it is answered
+    as soon as it arrives.
+
+    A query is either a line of text or a binary frame:
+
+      rawinput <net> <value> <value> ...  ->  <output>,<output>,...
+      input <net> <token> <token> ...     ->  <token>,<token>,...
+      step <net> <session> <value> ...    ->  <output>,<output>,...
+      end <net> <session>                 ->  OK
+
+    Values and tokens may be separated by spaces, tabs or commas.  A failed
+    text query is answered with a line starting 'ERROR'.  A binary frame is
+    a serve_frame_t header followed by the inputs as floats, and is answered
+    with a frame holding the outputs.  The networks of binary frames are
+    numbered in the order the server lists them when it starts; a frame
+    has room for the numbers of the first SERVE_FRAME_NETS of them.
+
+    A 'step' query is the next time step of the named session, a sequence
+    that carries its recurrent state from step to step (see session.c).
+    Sessions are opened by their first step, and 'end' closes one, so
+    that its next step starts it again.  Any number of sessions share the
+    network, and the steps of different sessions are batched together.
+    Every other query starts a sequence of its own, so recurrent networks
+    are reset before each one.
+
+    While the 'memoEntries' parameter is set, the results of the queries
+    to networks that are not recurrent are cached (see memo.c).  A query
+    whose inputs are cached is answered from the cache as it is read, and
+    the results of the others are cached once the pass has replied.
+
+    The function serve is linked to the main CLI via the interface table.
+    It is called like any other of the interface functions located on that
+    table.  The server runs until Ctrl-C is pressed.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cascade.h"
+#include "toolkit.h"
+
+
+/*  External declarations  */
+
+extern net_t        *nets;
+extern train_parm_t *cParms;
+extern boolean      interact,
+                    interruptPending;
+
+
+/*  SERVE -  Serve the network 'netName', or every network in memory if no
+    name is given, on the socket 'path'.
+*/
+
+void serve  ( char *path, char *netName )
+{
+  char     pName[81];
+  net_t    **served,
+           *net;
+  server_t *server;
+  int      Nnets = 0,
+           i;
+  char     *fn = "Serve";
+
+  /*  Get the address to listen at  */
+  if  ( path == NULL )
+    if  ( interact )  {
+      printf ("Socket path: ");
+      scanf  ("%80s",pName);
+      path = pName;
+    } else {
+      fprintf ( stderr, "No socket specified.  Server not started.\n" );
+      return;
+    }
+
+  /*  Collect the networks to serve  */
+  if  ( netName != NULL )  {
+    if  ( (net = select_net( netName )) == NULL )  {
+      fprintf ( stderr, "ERROR: Unable to find network %s.\n", netName );
+      return;
+    }
+    served = (net_t **)alloc_mem( 1, sizeof( net_t * ), fn );
+    served[Nnets++] = net;
+  }  else  {
+    for  ( net = nets ; net != NULL ; net = net->next )
+      Nnets++;
+    if  ( Nnets == 0 )  {
+      fprintf ( stderr, "No networks to serve.  Server not started.\n" );
+      return;
+    }
+    served = (net_t **)alloc_mem( Nnets, sizeof( net_t * ), fn );
+    for  ( net = nets, i = 0 ; net != NULL ; net = net->next )
+      served[i++] = net;
+  }
+
+  if  ( (server = build_server( path, served, Nnets )) == NULL )  {
+    free_mem( served );
+    return;
+  }
+
+  for  ( i = 0 ; i < Nnets ; i++ )
+    printf ("Serving '%s' as network %d.\n", served[i]->name, i );
+  if  ( Nnets > SERVE_FRAME_NETS )
+    printf ("Networks past number %d answer text queries only.\n",
+	    SERVE_FRAME_NETS-1 );
+  printf ("Listening on '%s'.  Type Ctrl-C to stop.\n", path );
+  fflush (stdout);
+
+  interruptPending = FALSE;
+  while  ( !interruptPending )
+    serve_pass( server, (server->Nbacklog > 0) ? 0 : SERVE_POLL_MS );
+  interruptPending = FALSE;
+
+  printf ("\nServer stopped after answering %d queries in %d passes.\n",
+	  server->Nqueries, server->Npasses );
+  for  ( i = 0 ; i < Nnets ; i++ )
+    display_memo_results( served[i] );
+  free_server( &server );
+  free_mem( served );
+}
+
+
+/*  BUILD SERVER -  Start listening on 'path' for queries to the 'Nnets'
+    networks in 'served'.  Each network is packed for inference, and given
+    room to batch as many queries as a pass may answer.  Returns NULL if
+    the socket cannot be opened.
+*/
+
+server_t *build_server  ( char *path, net_t **served, int Nnets )
+{
+  server_t    *server;
+  serve_net_t *sNet;
+  net_t       *net;
+  int         fd,
+              node,
+              i, j;
+  char        *fn = "Build Server";
+
+  if  ( (fd = sock_listen( path )) == ERROR )
+    return NULL;
+
+  server = (server_t *)alloc_mem( 1, sizeof( server_t ), fn );
+  server->fd       = fd;
+  server->path     = strdup( path );
+  server->poller   = new_poller( SERVE_CLIENTS+1 );
+  server->Nnets    = Nnets;
+  server->Nclients = 0;
+  server->Nreqs    = 0;
+  server->Nbacklog = 0;
+  server->Nclosing = 0;
+  server->Nqueries = 0;
+  server->Npasses  = 0;
+  server->clients  = (serve_client_t **)alloc_mem( SERVE_CLIENTS,
+						   sizeof( serve_client_t * ),
+						   fn );
+  server->reqs     = (serve_req_t *)alloc_mem( SERVE_BATCH,
+					       sizeof( serve_req_t ), fn );
+  server->nets     = (serve_net_t *)alloc_mem( Nnets, sizeof( serve_net_t ),
+					       fn );
+  poll_add( server->poller, fd, (void *)server );
+
+  for  ( i = 0 ; i < Nnets ; i++ )  {
+    sNet = server->nets + i;
+    net  = served[i];
+    free_packed( &(net->packed) );
+    net->packed = pack_net( net );
+
+    sNet->net     = net;
+    sNet->ctx     = build_infer_ctx( net->packed );
+    if  ( cParms->quantized && (net->quant != NULL) )
+      quant_infer_ctx( sNet->ctx, net->quant );
+    memo_net( net );
+    sNet->Nqueued = 0;
+    sNet->block   = (float *)alloc_mem( SERVE_BATCH *
+					(net->Ninputs + net->Noutputs),
+					sizeof( float ), fn );
+    sNet->inputs  = (float **)alloc_mem( SERVE_BATCH, sizeof( float * ), fn );
+    sNet->outputs = (float **)alloc_mem( SERVE_BATCH, sizeof( float * ), fn );
+    sNet->resets  = (boolean *)alloc_mem( SERVE_BATCH, sizeof( boolean ), fn );
+    sNet->stepped = (session_t **)alloc_mem( SERVE_BATCH, sizeof( session_t * ),
+					     fn );
+    sNet->states  = (float **)alloc_mem( SERVE_BATCH, sizeof( float * ), fn );
+    sNet->loose   = (float *)alloc_mem( net->Nunits, sizeof( float ), fn );
+    for  ( j = 0 ; j < SERVE_BATCH ; j++ )  {
+      sNet->inputs[j]  = sNet->block + j * net->Ninputs;
+      sNet->outputs[j] = sNet->block + SERVE_BATCH * net->Ninputs +
+	                 j * net->Noutputs;
+      sNet->resets[j]  = TRUE;
+      sNet->stepped[j] = NULL;
+    }
+    sNet->sessions = build_sessions( net->packed );
+    sNet->ended    = NULL;
+    sNet->Nstepped = 0;
+
+    /*  Tokenized queries give one token per input series  */
+    sNet->Nseries = 0;
+    if  ( net->inputMap != NULL )
+      for  ( node = 0 ; node < net->Ninputs ; sNet->Nseries++ )
+	node += ( net->inputMap[sNet->Nseries].Nenums == 0 ) ? 1 :
+	        net->inputMap[sNet->Nseries].Nunits;
+    sNet->tokens     = (char **)alloc_mem( sNet->Nseries+1, sizeof( char * ),
+					   fn );
+    sNet->tokenWidth = ( net->outputMap != NULL ) ? token_width( net ) : 0;
+  }
+
+  return server;
+}
+
+
+/*  FREE SERVER -  Hang up on every client, stop listening and free the
+    server.  The networks served are unpacked, and their sessions closed.
+*/
+
+void free_server  ( server_t **server )
+{
+  serve_net_t *sNet;
+  int         i;
+
+  while  ( (*server)->Nclients > 0 )
+    serve_drop( *server, (*server)->clients[0] );
+  sock_close( (*server)->fd, (*server)->path );
+  free_poller( &((*server)->poller) );
+
+  for  ( i = 0 ; i < (*server)->Nnets ; i++ )  {
+    sNet = (*server)->nets + i;
+    free_infer_ctx( &(sNet->ctx) );
+    free_packed( &(sNet->net->packed) );
+    free_mem( sNet->block );
+    free_mem( sNet->inputs );
+    free_mem( sNet->outputs );
+    free_mem( sNet->resets );
+    free_mem( sNet->tokens );
+    free_mem( sNet->stepped );
+    free_mem( sNet->states );
+    free_mem( sNet->loose );
+    free_sessions( &(sNet->sessions) );
+  }
+
+  free_mem( (*server)->nets );
+  free_mem( (*server)->reqs );
+  free_mem( (*server)->clients );
+  free( (*server)->path );
+  *server = free_mem( *server );
+}
+
+
+/*  SERVE PASS -  Wait up to 'ms' milliseconds for the sockets, then read
+    the queries that have arrived, answer them and hang up on the clients
+    that have gone.  Queries left over from the last pass, when more
+    arrived than a pass may answer, are taken first.
+*/
+
+void serve_pass  ( server_t *server, int ms )
+{
+  poll_event_t   events[SERVE_CLIENTS+1];
+  serve_client_t *client;
+  int            Nevents,
+                 i;
+
+  server->Nreqs = 0;
+  if  ( server->Nbacklog > 0 )
+    for  ( i = 0 ; i < server->Nclients && server->Nreqs < SERVE_BATCH ; i++ )
+      if  ( server->clients[i]->backlog )
+	serve_parse( server, server->clients[i] );
+
+  Nevents = poll_wait( server->poller, ms, events, SERVE_CLIENTS+1 );
+  for  ( i = 0 ; i < Nevents ; i++ )  {
+    if  ( events[i].data == (void *)server )  {
+      serve_accept( server );
+      continue;
+    }
+    client = (serve_client_t *)events[i].data;
+    if  ( events[i].writable )
+      serve_flush( server, client );
+    if  ( events[i].readable )
+      serve_read( server, client );
+  }
+
+  if  ( server->Nreqs > 0 )  {
+    serve_eval( server );
+    for  ( i = 0 ; i < server->Nreqs ; i++ )
+      serve_reply( server, server->reqs + i );
+    serve_memo( server );
+    for  ( i = 0 ; i < server->Nreqs ; i++ )
+      if  ( server->reqs[i].client->outLen > 0 )
+	serve_flush( server, server->reqs[i].client );
+    server->Nqueries += server->Nreqs;
+    server->Npasses++;
+  }
+
+  if  ( server->Nclosing > 0 )
+    for  ( i = server->Nclients-1 ; i >= 0 ; i-- )
+      if  ( server->clients[i]->closing && !server->clients[i]->backlog )
+	serve_drop( server, server->clients[i] );
+}
+
+
+/*  SERVE ACCEPT -  Accept every client waiting to connect, hanging up on
+    those beyond SERVE_CLIENTS.
+*/
+
+void serve_accept  ( server_t *server )
+{
+  serve_client_t *client;
+  int            fd;
+  char           *fn = "Serve Accept";
+
+  while  ( (fd = sock_accept( server->fd )) != ERROR )  {
+    if  ( server->Nclients == SERVE_CLIENTS )  {
+      sock_close( fd, NULL );
+      continue;
+    }
+
+    client = (serve_client_t *)alloc_mem( 1, sizeof( serve_client_t ), fn );
+    client->fd      = fd;
+    client->slot    = server->Nclients;
+    client->inLen   = 0;
+    client->outLen  = 0;
+    client->outSize = 4096;
+    client->in      = (char *)alloc_mem( SERVE_BUFSIZE, sizeof( char ), fn );
+    client->out     = (char *)alloc_mem( client->outSize, sizeof( char ), fn );
+    client->backlog = FALSE;
+    client->closing = FALSE;
+    client->polling = FALSE;
+
+    server->clients[server->Nclients++] = client;
+    poll_add( server->poller, fd, (void *)client );
+  }
+}
+
+
+/*  SERVE READ -  Read what a client has sent and queue the queries that
+    are whole.  A client that sends more than SERVE_BUFSIZE bytes without
+    completing a query is hung up on.
+*/
+
+void serve_read  ( server_t *server, serve_client_t *client )
+{
+  int got;
+
+  if  ( client->closing || client->inLen == SERVE_BUFSIZE )
+    return;
+
+  got = sock_read( client->fd, client->in + client->inLen,
+		   SERVE_BUFSIZE - client->inLen );
+  if  ( got == ERROR )  {
+    client->closing = TRUE;
+    server->Nclosing++;
+  }  else
+    client->inLen += got;
+
+  serve_parse( server, client );
+
+  if  ( !client->backlog && client->inLen == SERVE_BUFSIZE )  {
+    fprintf ( stderr, "Query longer than %d bytes.  Client dropped.\n",
+	      SERVE_BUFSIZE );
+    client->closing = TRUE;
+    server->Nclosing++;
+  }
+}
+
+
+/*  SERVE PARSE -  Queue the whole queries at the front of a client's
+    input, until the pass is full.  Blank lines are skipped.
+*/
+
+void serve_parse  ( server_t *server, serve_client_t *client )
+{
+  serve_req_t *req;
+  char        *text = client->in;
+  int         left  = client->inLen,
+              used;
+
+  while  ( left > 0 && server->Nreqs < SERVE_BATCH )  {
+    if  ( *text == '\n' )  {
+      text++;
+      left--;
+      continue;
+    }
+
+    req         = server->reqs + server->Nreqs;
+    req->client = client;
+    req->hit    = NULL;
+    req->error  = NULL;
+    used = ( *text == SERVE_FRAME ) ? serve_frame( server, req, text, left ) :
+                                      serve_line( server, req, text, left );
+    if  ( used == 0 )  /*  The rest has not arrived  */
+      break;
+
+    server->Nreqs++;
+    text += used;
+    left -= used;
+  }
+
+  memmove( client->in, text, left );
+  client->inLen = left;
+
+  if  ( client->backlog )
+    server->Nbacklog--;
+  client->backlog = ( left > 0 && server->Nreqs == SERVE_BATCH );
+  if  ( client->backlog )
+    server->Nbacklog++;
+}
+
+
+/*  SERVE LINE -  Read a text query from the 'len' bytes at 'text' into
+    'req', and batch its inputs for its network.  Returns the number of
+    bytes used, or 0 if the line is not whole yet.  A query that cannot
+    be answered has its 'error' set.
+*/
+
+int serve_line  ( server_t *server, serve_req_t *req, char *text, int len )
+{
+  serve_net_t *sNet = NULL;
+  session_t   *sess;
+  char        *nl,
+              *tok,
+              *end,
+              *id = NULL;
+  float       *inputs;
+  boolean     step = FALSE,
+              close = FALSE;
+  int         used,
+              i;
+
+  if  ( (nl = memchr( text, '\n', len )) == NULL )
+    return 0;
+  *nl  = '\0';
+  used = nl - text + 1;
+
+  /*  The query type and the network queried  */
+  if  ( (tok = strtok( text, " \t\r," )) == NULL )  {
+    req->format = RAW_FORMAT;
+    req->error  = "Empty query";
+    return used;
+  }
+  if  ( !strcasecmp( tok, "rawinput" ) )
+    req->format = RAW_FORMAT;
+  else if  ( !strcasecmp( tok, "input" ) )
+    req->format = TOKEN_FORMAT;
+  else if  ( !strcasecmp( tok, "step" ) )  {
+    req->format = RAW_FORMAT;
+    step        = TRUE;
+  }  else if  ( !strcasecmp( tok, "end" ) )  {
+    req->format = RAW_FORMAT;
+    close       = TRUE;
+  }  else  {
+    req->format = RAW_FORMAT;
+    req->error  = "Unknown query";
+    return used;
+  }
+
+  if  ( (tok = strtok( NULL, " \t\r," )) != NULL )
+    for  ( i = 0 ; i < server->Nnets ; i++ )
+      if  ( !strcasecmp( server->nets[i].net->name, tok ) )  {
+	sNet = server->nets + i;
+	break;
+      }
+  if  ( sNet == NULL )  {
+    req->error = "Unknown network";
+    return used;
+  }
+  inputs = sNet->inputs[sNet->Nqueued];
+
+  /*  The session, which is kept until the end of the pass if closed  */
+  if  ( (step || close) && (id = strtok( NULL, " \t\r," )) == NULL )  {
+    req->error = "No session given";
+    return used;
+  }
+  if  ( close )  {
+    if  ( (sess = end_session( sNet->sessions, id )) == NULL )  {
+      req->error = "Unknown session";
+      return used;
+    }
+    sess->next  = sNet->ended;
+    sNet->ended = sess;
+    req->net = sNet - server->nets;
+    req->row = -1;
+    return used;
+  }
+
+  /*  The inputs  */
+  if  ( req->format == RAW_FORMAT )
+    for  ( i = 0 ; i < sNet->net->Ninputs ; i++ )  {
+      if  ( (tok = strtok( NULL, " \t\r," )) == NULL )  {
+	req->error = "Insufficient tokens for input";
+	return used;
+      }
+      inputs[i] = strtod( tok, &end );
+      if  ( *end != '\0' )  {
+	req->error = "Invalid token, a numerical value is expected";
+	return used;
+      }
+    }
+  else  {
+    if  ( sNet->net->inputMap == NULL || sNet->net->outputMap == NULL )  {
+      req->error = "Network has no tokens";
+      return used;
+    }
+    for  ( i = 0 ; i < sNet->Nseries ; i++ )
+      if  ( (sNet->tokens[i] = strtok( NULL, " \t\r," )) == NULL )  {
+	req->error = "Insufficient tokens for input";
+	return used;
+      }
+    if  ( !ttof( inputs, sNet->tokens, sNet->Nseries, sNet->net->inputMap ) )  {
+      req->error = "Invalid token";
+      return used;
+    }
+  }
+
+  /*  A query whose result is cached is not batched  */
+  req->net = sNet - server->nets;
+  if  ( !step && sNet->net->memo != NULL &&
+	(req->hit = memo_find( sNet->net->memo, inputs )) != NULL )  {
+    req->row = -1;
+    return used;
+  }
+
+  /*  A step opens its session if need be  */
+  sess = NULL;
+  if  ( step )  {
+    if  ( (sess = find_session( sNet->sessions, id )) == NULL )  {
+      if  ( sNet->sessions->Nsessions == SERVE_SESSIONS )  {
+	req->error = "Too many sessions";
+	return used;
+      }
+      sess = open_session( sNet->sessions, id );
+    }
+    sNet->Nstepped++;
+  }
+  sNet->stepped[sNet->Nqueued] = sess;
+
+  req->row = sNet->Nqueued++;
+
+  return used;
+}
+
+
+/*  SERVE FRAME -  Read a binary query from the 'len' bytes at 'text' into
+    'req', and batch its inputs for its network.  Returns the number of
+    bytes used, or 0 if the frame is not whole yet.  A query that cannot
+    be answered has its 'error' set.
+*/
+
+int serve_frame  ( server_t *server, serve_req_t *req, char *text, int len )
+{
+  serve_frame_t head;
+  serve_net_t   *sNet;
+  int           used;
+
+  if  ( len < sizeof( serve_frame_t ) )
+    return 0;
+  memcpy( &head, text, sizeof( serve_frame_t ) );
+  used = sizeof( serve_frame_t ) + head.Nvals * sizeof( float );
+  if  ( len < used )
+    return 0;
+
+  req->format = BINARY_FORMAT;
+  req->net    = head.net;
+  if  ( head.net >= server->Nnets )  {
+    req->error = "Unknown network";
+    return used;
+  }
+  sNet = server->nets + head.net;
+  if  ( head.Nvals != sNet->net->Ninputs )  {
+    req->error = "Wrong number of inputs";
+    return used;
+  }
+
+  memcpy( sNet->inputs[sNet->Nqueued], text + sizeof( serve_frame_t ),
+	  head.Nvals * sizeof( float ) );
+  if  ( sNet->net->memo != NULL &&
+	(req->hit = memo_find( sNet->net->memo,
+			       sNet->inputs[sNet->Nqueued] )) != NULL )  {
+    req->row = -1;
+    return used;
+  }
+  sNet->stepped[sNet->Nqueued] = NULL;
+  req->row = sNet->Nqueued++;
+
+  return used;
+}
+
+
+/*  SERVE EVAL -  Evaluate the queries batched for each network.  Batches
+    too small to pay for a batched pass are evaluated a point at a time.
+    A batch that steps a session more than once is split before each
+    repeated step, since a step needs the state left by the one before.
+    Sessions ended in the pass are freed once their steps are done.
+*/
+
+void serve_eval  ( server_t *server )
+{
+  serve_net_t *sNet;
+  session_t   *sess;
+  int         start,
+              i, j;
+
+  for  ( i = 0 ; i < server->Nnets ; i++ )  {
+    sNet = server->nets + i;
+    if  ( sNet->Nstepped > 0 )  {
+      for  ( j = 0, start = 0 ; j < sNet->Nqueued ; j++ )  {
+	if  ( (sess = sNet->stepped[j]) == NULL )
+	  continue;
+	if  ( sess->row >= start )  {
+	  serve_steps( sNet, start, j );
+	  start = j;
+	}
+	sess->row = j;
+      }
+      serve_steps( sNet, start, sNet->Nqueued );
+      for  ( j = 0 ; j < sNet->Nqueued ; j++ )
+	if  ( sNet->stepped[j] != NULL )
+	  sNet->stepped[j]->row = -1;
+    }  else if  ( sNet->Nqueued >= SERVE_MIN_BATCH )
+      infer_batch( sNet->ctx, sNet->inputs, sNet->resets, sNet->Nqueued,
+		   sNet->outputs );
+    else
+      for  ( j = 0 ; j < sNet->Nqueued ; j++ )
+	if  ( sNet->ctx->quant != NULL )
+	  quant_point( sNet->ctx->quant, sNet->inputs[j], TRUE,
+		       sNet->ctx->values, sNet->ctx->qwork, sNet->outputs[j] );
+	else
+	  packed_point( sNet->ctx->model, sNet->inputs[j], TRUE,
+			sNet->ctx->values, sNet->outputs[j] );
+
+    while  ( (sess = sNet->ended) != NULL )  {
+      sNet->ended = sess->next;
+      free_session( &sess );
+    }
+    sNet->Nqueued  = 0;
+    sNet->Nstepped = 0;
+  }
+}
+
+
+/*  SERVE STEPS -  Evaluate the queries batched for a network from row
+    'start' up to row 'end', which step no session twice.  Each session
+    stepped carries its state on, and starts its sequence on its first
+    step.  The other queries start sequences of their own.
+*/
+
+void serve_steps  ( serve_net_t *sNet, int start, int end )
+{
+  session_t *sess;
+  int       j;
+
+  for  ( j = start ; j < end ; j++ )  {
+    sess = sNet->stepped[j];
+    sNet->states[j] = ( sess != NULL ) ? sess->values : sNet->loose;
+    sNet->resets[j] = ( sess == NULL || sess->Nsteps == 0 );
+  }
+
+  if  ( sNet->ctx->quant != NULL || end-start >= SERVE_MIN_BATCH )
+    infer_sessions( sNet->ctx, sNet->inputs+start, sNet->resets+start,
+		    sNet->states+start, end-start, sNet->outputs+start );
+  else
+    for  ( j = start ; j < end ; j++ )
+      packed_point( sNet->ctx->model, sNet->inputs[j], sNet->resets[j],
+		    sNet->states[j], sNet->outputs[j] );
+
+  for  ( j = start ; j < end ; j++ )  {
+    if  ( sNet->stepped[j] != NULL )
+      sNet->stepped[j]->Nsteps++;
+    sNet->resets[j] = TRUE;
+  }
+}
+
+
+/*  SERVE REPLY -  Add the reply to a query to its client's output.
+*/
+
+void serve_reply  ( server_t *server, serve_req_t *req )
+{
+  serve_client_t *client = req->client;
+  serve_net_t    *sNet   = NULL;
+  serve_frame_t  head;
+  float          *outputs = NULL;
+  char           *out;
+  int            need,
+                 i;
+
+  if  ( req->error == NULL && req->hit != NULL )  {
+    sNet    = server->nets + req->net;
+    outputs = req->hit->outputs;
+  }  else if  ( req->error == NULL && req->row >= 0 )  {
+    sNet    = server->nets + req->net;
+    outputs = sNet->outputs[req->row];
+  }
+
+  /*  Make room for the longest reply the query can have  */
+  if  ( req->format == BINARY_FORMAT )
+    need = sizeof( serve_frame_t ) +
+           ( (sNet == NULL) ? 0 : sNet->net->Noutputs * sizeof( float ) );
+  else if  ( req->error != NULL )
+    need = strlen( req->error ) + 8;
+  else if  ( outputs == NULL )
+    need = 4;
+  else if  ( req->format == RAW_FORMAT )
+    need = PRED_FLOAT_MAX * sNet->net->Noutputs + 1;
+  else
+    need = sNet->tokenWidth + 1;
+  if  ( client->outLen + need > client->outSize )  {
+    while  ( client->outLen + need > client->outSize )
+      client->outSize *= 2;
+    client->out = (char *)realloc_mem( client->out, client->outSize,
+				       sizeof( char ), "Serve Reply" );
+  }
+
+  out = client->out + client->outLen;
+  if  ( req->format == BINARY_FORMAT )  {
+    head.tag   = SERVE_FRAME;
+    head.net   = req->net;
+    head.Nvals = ( sNet == NULL ) ? 0 : sNet->net->Noutputs;
+    memcpy( out, &head, sizeof( serve_frame_t ) );
+    out += sizeof( serve_frame_t );
+    if  ( head.Nvals > 0 )
+      memcpy( out, outputs, head.Nvals * sizeof( float ) );
+    out += head.Nvals * sizeof( float );
+  }  else if  ( req->error != NULL )
+    out += sprintf( out, "ERROR %s\n", req->error );
+  else if  ( outputs == NULL )
+    out += sprintf( out, "OK\n" );
+  else if  ( req->format == RAW_FORMAT )  {
+    for  ( i = 0 ; i < sNet->net->Noutputs ; i++ )  {
+      if  ( i > 0 )
+	*out++ = ',';
+      out = put_float( out, outputs[i] );
+    }
+    *out++ = '\n';
+  }  else if  ( req->hit != NULL )  {
+    /*  Cached tokens are decoded the first time they are asked for  */
+    if  ( req->hit->textLen < 0 )
+      req->hit->textLen = put_tokens( req->hit->text, sNet->net, outputs,
+				      (sNet->net->sigmoidMax -
+				       sNet->net->sigmoidMin)/2.0 ) -
+	                  req->hit->text;
+    memcpy( out, req->hit->text, req->hit->textLen );
+    out   += req->hit->textLen;
+    *out++ = '\n';
+  }  else  {
+    out = put_tokens( out, sNet->net, outputs,
+		      (sNet->net->sigmoidMax-sNet->net->sigmoidMin)/2.0 );
+    *out++ = '\n';
+  }
+  client->outLen = out - client->out;
+}
+
+
+/*  SERVE MEMO -  Cache the results of the queries of a pass that were
+    evaluated, for the networks that keep a cache.  This waits until the
+    pass has replied, since caching a result may drop the entry that
+    answers another query of the pass.
+*/
+
+void serve_memo  ( server_t *server )
+{
+  serve_req_t *req;
+  serve_net_t *sNet;
+  int         i;
+
+  for  ( i = 0 ; i < server->Nreqs ; i++ )  {
+    req = server->reqs + i;
+    if  ( req->error != NULL || req->hit != NULL || req->row < 0 )
+      continue;
+    sNet = server->nets + req->net;
+    if  ( sNet->net->memo != NULL )
+      memo_insert( sNet->net->memo, sNet->inputs[req->row],
+		   sNet->outputs[req->row] );
+  }
+}
+
+
+/*  SERVE FLUSH -  Write as much of a client's output as its socket takes.
+    While output is left over, the socket is watched for room to write.
+*/
+
+void serve_flush  ( server_t *server, serve_client_t *client )
+{
+  boolean wait;
+  int     put;
+
+  if  ( client->outLen > 0 )  {
+    if  ( (put = sock_write( client->fd, client->out, client->outLen ))
+	  == ERROR )  {
+      if  ( !client->closing )  {
+	client->closing = TRUE;
+	server->Nclosing++;
+      }
+      client->outLen = 0;
+    }  else if  ( put > 0 )  {
+      client->outLen -= put;
+      memmove( client->out, client->out + put, client->outLen );
+    }
+  }
+
+  wait = ( client->outLen > 0 );
+  if  ( wait != client->polling )  {
+    poll_output( server->poller, client->fd, (void *)client, wait );
+    client->polling = wait;
+  }
+}
+
+
+/*  SERVE DROP -  Hang up on a client and free it.
+*/
+
+void serve_drop  ( server_t *server, serve_client_t *client )
+{
+  poll_remove( server->poller, client->fd );
+  sock_close( client->fd, NULL );
+  if  ( client->backlog )
+    server->Nbacklog--;
+  if  ( client->closing )
+    server->Nclosing--;
+
+  server->Nclients--;
+  server->clients[client->slot] = server->clients[server->Nclients];
+  server->clients[client->slot]->slot = client->slot;
+
+  free_mem( client->in );
+  free_mem( client->out );
+  free_mem( client );
+}
@@ -0,0 +1,216 @@
+/*	CMU Cascade Neural Network Simulator (CNNS)
+	Streaming session code
+
+	These routines keep the state of many sequences fed through one
+	recurrent network a time step at a time.  Each session holds only
+	the unit values of its last step, which are all a step needs besides
+	the network's weights, so a step costs one pass over the weights no
+	matter how long the sequence has run.  The network itself is a
+	packed copy shared by every session.
+
+	Sessions are named, and kept in a hash table that doubles in size
+	whenever it holds more sessions than buckets.  A session's first
+	step begins its sequence; ending a session and stepping it again
+	begins a new one.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "toolkit.h"
+#include "cascade.h"
+
+
+/*	BUILD SESSIONS -  Build an empty table of sessions on a packed
+	network.
+*/
+
+session_table_t *build_sessions  ( packed_net_t *model )
+{
+  session_table_t *temp;
+  int             i;
+  char            *fn = "Build Sessions";
+
+  temp = (session_table_t *)alloc_mem( 1, sizeof( session_table_t ), fn );
+  temp->model     = model;
+  temp->Nsessions = 0;
+  temp->Nbuckets  = SESSION_BUCKETS;
+  temp->buckets   = (session_t **)alloc_mem( SESSION_BUCKETS,
+					     sizeof( session_t * ), fn );
+  for  ( i = 0 ; i < SESSION_BUCKETS ; i++ )
+    temp->buckets[i] = NULL;
+
+  return temp;
+}
+
+
+/*	FREE SESSIONS -  Deallocate a table of sessions and every session in
+	it.  The packed network is left alone.
+*/
+
+void free_sessions  ( session_table_t **table )
+{
+  session_t *sess,
+            *next;
+  int       i;
+
+  if  ( *table == NULL )
+    return;
+
+  for  ( i = 0 ; i < (*table)->Nbuckets ; i++ )
+    for  ( sess = (*table)->buckets[i] ; sess != NULL ; sess = next )  {
+      next = sess->next;
+      free_session( &sess );
+    }
+
+  (*table)->buckets = free_mem( (*table)->buckets );
+  *table = free_mem( *table );
+}
+
+
+/*	SESSION HASH -  Hash a session name (FNV-1a).
+*/
+
+unsigned long session_hash  ( char *id )
+{
+  unsigned long hash = 2166136261UL;
+
+  while  ( *id != '\0' )  {
+    hash ^= (unsigned char)*id++;
+    hash *= 16777619UL;
+  }
+
+  return hash;
+}
+
+
+/*	FIND SESSION -  Return the session named 'id', or NULL if there is
+	none.
+*/
+
+session_t *find_session  ( session_table_t *table, char *id )
+{
+  session_t     *sess;
+  unsigned long hash = session_hash( id );
+
+  for  ( sess = table->buckets[hash & (table->Nbuckets-1)] ; sess != NULL ;
+	 sess = sess->next )
+    if  ( sess->hash == hash && !strcmp( sess->id, id ) )
+      return sess;
+
+  return NULL;
+}
+
+
+/*	OPEN SESSION -  Return the session named 'id', starting a new one if
+	there is none.
+*/
+
+session_t *open_session  ( session_table_t *table, char *id )
+{
+  session_t *sess;
+  int       i;
+  char      *fn = "Open Session";
+
+  if  ( (sess = find_session( table, id )) != NULL )
+    return sess;
+
+  if  ( table->Nsessions == table->Nbuckets )
+    grow_sessions( table );
+
+  sess = (session_t *)alloc_mem( 1, sizeof( session_t ), fn );
+  sess->id     = strdup( id );
+  sess->hash   = session_hash( id );
+  sess->values = (float *)alloc_mem( table->model->Nunits, sizeof( float ),
+				     fn );
+  for  ( i = 0 ; i < table->model->Nunits ; i++ )
+    sess->values[i] = 0.0;
+  sess->Nsteps = 0;
+  sess->row    = -1;
+
+  sess->next = table->buckets[sess->hash & (table->Nbuckets-1)];
+  table->buckets[sess->hash & (table->Nbuckets-1)] = sess;
+  table->Nsessions++;
+
+  return sess;
+}
+
+
+/*	END SESSION -  Take the session named 'id' out of its table, and
+	return it so that the caller may free it once it is done with it.
+	Returns NULL if there is no such session.
+*/
+
+session_t *end_session  ( session_table_t *table, char *id )
+{
+  session_t     **link,
+                *sess;
+  unsigned long hash = session_hash( id );
+
+  for  ( link = &(table->buckets[hash & (table->Nbuckets-1)]) ;
+	 (sess = *link) != NULL ; link = &(sess->next) )
+    if  ( sess->hash == hash && !strcmp( sess->id, id ) )  {
+      *link      = sess->next;
+      sess->next = NULL;
+      table->Nsessions--;
+      return sess;
+    }
+
+  return NULL;
+}
+
+
+/*	FREE SESSION -  Deallocate a session taken out of its table.
+*/
+
+void free_session  ( session_t **sess )
+{
+  if  ( *sess == NULL )
+    return;
+
+  free( (*sess)->id );
+  (*sess)->values = free_mem( (*sess)->values );
+  *sess = free_mem( *sess );
+}
+
+
+/*	GROW SESSIONS -  Double the buckets of a table of sessions.
+*/
+
+void grow_sessions  ( session_table_t *table )
+{
+  session_t **buckets,
+            *sess,
+            *next;
+  int       Nbuckets = 2 * table->Nbuckets,
+            i;
+
+  buckets = (session_t **)alloc_mem( Nbuckets, sizeof( session_t * ),
+				     "Grow Sessions" );
+  for  ( i = 0 ; i < Nbuckets ; i++ )
+    buckets[i] = NULL;
+
+  for  ( i = 0 ; i < table->Nbuckets ; i++ )
+    for  ( sess = table->buckets[i] ; sess != NULL ; sess = next )  {
+      next       = sess->next;
+      sess->next = buckets[sess->hash & (Nbuckets-1)];
+      buckets[sess->hash & (Nbuckets-1)] = sess;
+    }
+
+  free_mem( table->buckets );
+  table->buckets  = buckets;
+  table->Nbuckets = Nbuckets;
+}
+
+
+/*	SESSION STEP -  Feed the next step of a session's sequence through
+	its table's network, leaving the outputs in 'outValues'.
+*/
+
+void session_step  ( session_table_t *table, session_t *sess, float *inputs,
+		     float *outValues )
+{
+  packed_point( table->model, inputs, (sess->Nsteps == 0), sess->values,
+		outValues );
+  sess->Nsteps++;
+}
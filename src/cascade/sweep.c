@@ -0,0 +1,630 @@
+/*	CMU Cascade Neural Network Simulator (CNNS)
+	Parameter sweep code
+
+	'sweep' tries configurations of the training parameters on a data
+	file and ranks them.  The sweep file names the parameters to vary,
+	one to a line, each with a list of values or a range to draw them
+	from:
+
+	  candInEpsilon   50 100 200
+	  NCands          range 4 16
+	  outputEpsilon   logrange 0.1 10
+
+	A few more lines set up the sweep itself:
+
+	  samples  20         Configurations to draw (otherwise every
+	                      combination of the lists is tried)
+	  trials   3          Trials of each configuration (1)
+	  margin   0.5        Share by which a run may fall behind (0.5)
+	  warmup   2          Hidden units added before a run may lose (2)
+	  output   sweep.out  File the ranked table is written to
+
+	A range needs 'samples'.  Lines beginning with a '#' are ignored.
+	Parameters not varied are as they were set when the sweep started.
+
+	Up to 'trialThreads' trials are trained at once, as by 'runTrials',
+	and trial 't' of every configuration draws from the same random
+	stream, so that configurations are compared on the same draws.  The
+	runs of a trial race: once a run has added 'warmup' hidden units, it
+	is stopped if the error of its outputs on the training data is worse
+	by more than 'margin' than the least any run of the trial had with
+	as many hidden units.  A configuration with a run stopped starts no
+	more trials and is ranked below those that finished.  Which runs
+	lose may depend on the order the threads get to them.
+
+	Configurations are ranked by the average test results of their
+	trials, as 'errorMeasure' gives, then by the hidden units and epochs
+	they took.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "toolkit.h"
+#include "cascade.h"
+
+#define SWEEP_MAX_CONFIGS 100000  /*  Most configurations a sweep tries  */
+
+/*	External Global Variable Declarations	*/
+
+extern parm_t       parmTable[];
+extern train_parm_t *cParms;
+extern boolean      interact;
+
+
+/*	SWEEP -  Sweep the configurations given in the sweep file 'sweepFile'
+	on the data file 'dataFile', and report them ranked.
+*/
+
+void sweep  ( char *sweepFile, char *dataFile )
+{
+  sweep_t        sw;
+  data_file_t    *dFile;
+  sweep_config_t *cfg;
+  pthread_t      *workers;
+  boolean        *threaded;
+  FILE           *fptr;
+  int            Nworkers,
+                 Njobs,
+                 i, u;
+  char           sFileName [41],
+                 dFileName [41],
+                 *fn = "Sweep";
+
+  /*  Get the sweep file  */
+  if  ( sweepFile == NULL )
+    if  ( interact )  {
+      printf ("Sweep file: ");
+      scanf  ("%s", sFileName );
+      sweepFile = sFileName;
+    } else {
+      fprintf ( stderr, "Sweep file not specified.  Sweep not started.\n");
+      return;
+    }
+
+  /*  Get the data file  */
+  if  ( dataFile == NULL )
+    if  ( interact )  {
+      printf ("Data file for training: ");
+      scanf ("%s", dFileName);
+      dataFile = dFileName;
+    } else {
+      fprintf ( stderr, "Data file for training not specified.\n");
+      fprintf ( stderr, "Sweep not started.\n");
+      return;
+    }
+  if  ( (dFile = select_data ( dataFile )) == NULL )  {
+    if  ( !parse_data ( dataFile, DEF_SIGMAX, DEF_SIGMIN, &dFile ) )  {
+      fprintf ( stderr, "Unable to parse data file '%s'.\n", dataFile );
+      return;
+    }
+    if  ( cParms->classTargets && !class_targets( dFile ) )
+      fprintf ( stderr, "Targets in '%s' kept as output vectors.\n",
+		dataFile );
+    add_data_file( dFile );
+  }
+  if  (dFile->train == NULL)  {
+    fprintf (stderr,
+	     "No training data available in file '%s'.  Sweep not started.\n",
+	     dFile->filename);
+    return;
+  }
+
+  if  ( !read_sweep( &sw, sweepFile ) )  {
+    fprintf ( stderr, "Sweep not started.\n");
+    free_sweep( &sw );
+    return;
+  }
+  sw.dFile = dFile;
+  sw.seed  = ( cParms->trialSeed != 0 ) ? cParms->trialSeed : random( );
+  if  ( !make_configs( &sw ) )  {
+    fprintf ( stderr, "Sweep not started.\n");
+    free_sweep( &sw );
+    return;
+  }
+
+  /*  No run of a trial has been seen with any number of hidden units  */
+  sw.best = (float **)alloc_mem( sw.Ntrials, sizeof( float * ), fn );
+  for  ( i = 0 ; i < sw.Ntrials ; i++ )  {
+    sw.best[i] = (float *)alloc_mem( sw.maxUnits+1, sizeof( float ), fn );
+    for  ( u = 0 ; u <= sw.maxUnits ; u++ )
+      sw.best[i][u] = -1.0;
+  }
+
+  /*  Share the trials out among the threads, as 'run_trials' does  */
+  Njobs    = sw.Nconfigs * sw.Ntrials;
+  Nworkers = ( cParms->trialThreads > 0 ) ? cParms->trialThreads :
+                                            num_processors( );
+  if  ( Nworkers > Njobs )
+    Nworkers = Njobs;
+  sw.next = 0;
+  pthread_mutex_init( &(sw.lock), NULL );
+
+  printf ("Sweeping %d configurations of %d trial%s each on '%s'.\n",
+	  sw.Nconfigs, sw.Ntrials, ( sw.Ntrials == 1 ) ? "" : "s",
+	  dFile->filename );
+  workers  = (pthread_t *)alloc_mem( Nworkers, sizeof( pthread_t ), fn );
+  threaded = (boolean *)alloc_mem( Nworkers, sizeof( boolean ), fn );
+  for  ( i = 1 ; i < Nworkers ; i++ )
+    threaded[i] = ( pthread_create( workers+i, NULL, sweep_thread,
+				    (void *)&sw ) == 0 );
+  sweep_thread( (void *)&sw );
+  for  ( i = 1 ; i < Nworkers ; i++ )
+    if  ( threaded[i] )
+      pthread_join( workers[i], NULL );
+  free_mem( workers );
+  free_mem( threaded );
+  pthread_mutex_destroy( &(sw.lock) );
+
+  /*  Rank the configurations and report them  */
+  for  ( i = 0 ; i < sw.Nconfigs ; i++ )  {
+    cfg = sw.configs + i;
+    cfg->score = 0.0;
+    if  ( cfg->Ntrials > 0 )
+      cfg->score = ( (cParms->errorMeasure == BITS) ? cfg->total.bits :
+		                                      cfg->total.index ) /
+	           (float)cfg->Ntrials;
+  }
+  qsort( sw.configs, sw.Nconfigs, sizeof( sweep_config_t ),
+	 compare_configs );
+
+  printf ("\n");
+  write_sweep( &sw, stdout );
+  if  ( (fptr = fopen( sw.output, "w" )) == NULL )
+    fprintf ( stderr, "ERROR: Unable to open sweep output file %s.\n",
+	      sw.output );
+  else  {
+    write_sweep( &sw, fptr );
+    fclose( fptr );
+    printf ("\nRanked configurations written to '%s'.\n", sw.output );
+  }
+
+  free_sweep( &sw );
+}
+
+
+/*	READ SWEEP -  Read the sweep file 'filename' into 'sw', as described
+	at the top of this file.  Returns FALSE, having said why, if the file
+	cannot be read or is not a sweep.  'sw' should be freed either way.
+*/
+
+boolean read_sweep  ( sweep_t *sw, char *filename )
+{
+  FILE         *fptr;
+  sweep_axis_t *axis;
+  char         line [256],
+               *name,
+               *val,
+               *val2;
+  long         offset;
+  boolean      ranged = FALSE,
+               bad    = FALSE;
+  int          loc;
+  char         *fn = "Read Sweep";
+
+  sw->axes     = NULL;
+  sw->configs  = NULL;
+  sw->best     = NULL;
+  sw->margin   = 0.5;
+  sw->output   = strdup( "sweep.out" );
+  sw->Naxes    = 0;
+  sw->Nconfigs = 0;
+  sw->Nsamples = 0;
+  sw->Ntrials  = 1;
+  sw->warmup   = 2;
+
+  if  ( (fptr = fopen( filename, "r" )) == NULL )  {
+    fprintf ( stderr, "ERROR: Unable to open sweep file %s.\n", filename );
+    return FALSE;
+  }
+
+  while  ( !bad && (fgets( line, 256, fptr ) != NULL) )  {
+    if  ( ((name = strtok( line, " \t\n" )) == NULL) || (name[0] == '#') )
+      continue;
+    val  = strtok( NULL, " \t\n" );
+
+    /*  Settings of the sweep itself  */
+    if  ( !strcasecmp( name, "samples" ) || !strcasecmp( name, "trials" ) ||
+	  !strcasecmp( name, "warmup" ) )  {
+      if  ( (val == NULL) || !isint( val ) || (atoi( val ) < 0) )  {
+	fprintf ( stderr, "'%s' in sweep file %s needs a count.\n", name,
+		  filename );
+	bad = TRUE;
+	break;
+      }
+      if  ( !strcasecmp( name, "samples" ) )
+	sw->Nsamples = atoi( val );
+      else if  ( !strcasecmp( name, "trials" ) )
+	sw->Ntrials = ( atoi( val ) > 0 ) ? atoi( val ) : 1;
+      else
+	sw->warmup = atoi( val );
+      continue;
+    }
+    if  ( !strcasecmp( name, "margin" ) )  {
+      if  ( (val == NULL) || !isfloat( val ) || (atof( val ) < 0.0) )  {
+	fprintf ( stderr, "'margin' in sweep file %s needs a share.\n",
+		  filename );
+	bad = TRUE;
+	break;
+      }
+      sw->margin = atof( val );
+      continue;
+    }
+    if  ( !strcasecmp( name, "output" ) )  {
+      if  ( val == NULL )  {
+	fprintf ( stderr, "'output' in sweep file %s needs a file name.\n",
+		  filename );
+	bad = TRUE;
+	break;
+      }
+      free( sw->output );
+      sw->output = strdup( val );
+      continue;
+    }
+
+    /*  A parameter to vary, which must be one a parameter table holds  */
+    loc = find_key( name );
+    offset = ( loc == NOT_FOUND ) ? -1 :
+             (char *)parmTable[loc].ptr - (char *)cParms;
+    if  ( (loc == NOT_FOUND) || (parmTable[loc].type == FUNC) ||
+	  (offset < 0) || (offset >= sizeof( train_parm_t )) )  {
+      fprintf ( stderr, "'%s' in sweep file %s is not a training "
+		"parameter.\n", name, filename );
+      bad = TRUE;
+      break;
+    }
+    if  ( val == NULL )  {
+      fprintf ( stderr, "No values given for '%s' in sweep file %s.\n",
+		name, filename );
+      bad = TRUE;
+      break;
+    }
+
+    sw->axes = (sweep_axis_t *)realloc_mem( sw->axes, sw->Naxes+1,
+					    sizeof( sweep_axis_t ), fn );
+    axis = sw->axes + sw->Naxes++;
+    axis->parm     = parmTable[loc];
+    axis->offset   = offset;
+    axis->values   = NULL;
+    axis->Nvalues  = 0;
+    axis->logScale = !strcasecmp( val, "logrange" );
+
+    if  ( !strcasecmp( val, "range" ) || axis->logScale )  {
+      val  = strtok( NULL, " \t\n" );
+      val2 = strtok( NULL, " \t\n" );
+      if  ( ((axis->parm.type != INT) && (axis->parm.type != FLOAT)) ||
+	    (val == NULL) || (val2 == NULL) ||
+	    !isfloat( val ) || !isfloat( val2 ) )  {
+	fprintf ( stderr, "'%s' in sweep file %s needs a numeric range.\n",
+		  name, filename );
+	bad = TRUE;
+	break;
+      }
+      axis->low  = atof( val );
+      axis->high = atof( val2 );
+      if  ( axis->logScale && ((axis->low <= 0.0) || (axis->high <= 0.0)) )  {
+	fprintf ( stderr, "The range of '%s' in sweep file %s must be "
+		  "positive.\n", name, filename );
+	bad = TRUE;
+	break;
+      }
+      ranged = TRUE;
+      continue;
+    }
+
+    /*  A list of values, each of which must suit the parameter  */
+    for  ( ; val != NULL ; val = strtok( NULL, " \t\n" ) )  {
+      if  ( (strlen( val ) > 40) ||
+	    ((axis->parm.type == INT) && !isint( val )) ||
+	    ((axis->parm.type == FLOAT) && !isfloat( val )) ||
+	    ((axis->parm.type == BOOLEAN) && !isboolean( val )) )  {
+	fprintf ( stderr, "'%s' is not a value of '%s' in sweep file %s.\n",
+		  val, name, filename );
+	bad = TRUE;
+	break;
+      }
+      axis->values = (char **)realloc_mem( axis->values, axis->Nvalues+1,
+					   sizeof( char * ), fn );
+      axis->values[axis->Nvalues++] = strdup( val );
+    }
+  }
+  fclose( fptr );
+  if  ( bad )
+    return FALSE;
+
+  if  ( sw->Naxes == 0 )  {
+    fprintf ( stderr, "Sweep file %s varies no parameters.\n", filename );
+    return FALSE;
+  }
+  if  ( ranged && (sw->Nsamples == 0) )  {
+    fprintf ( stderr, "Sweep file %s gives ranges but no 'samples'.\n",
+	      filename );
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+
+/*	MAKE CONFIGS -  Make the configurations of a sweep read by
+	'read_sweep': every combination of the values listed, or 'Nsamples'
+	configurations drawn from the lists and ranges.  The draws come from
+	a random stream seeded by the sweep's seed, so a sweep with a set
+	'trialSeed' tries the same configurations each time.  Returns FALSE
+	if there would be too many.
+*/
+
+boolean make_configs  ( sweep_t *sw )
+{
+  sweep_axis_t   *axis;
+  sweep_config_t *cfg;
+  parm_t         parm;
+  unsigned short stream[3];
+  double         Ncombos = 1.0,
+                 u, x;
+  int            index,
+                 c, a;
+  char           value [41],
+                 *fn = "Make Configs";
+
+  for  ( a = 0 ; a < sw->Naxes ; a++ )
+    if  ( sw->axes[a].Nvalues > 0 )
+      Ncombos *= sw->axes[a].Nvalues;
+  sw->Nconfigs = ( sw->Nsamples > 0 ) ? sw->Nsamples : (int)Ncombos;
+  if  ( (sw->Nsamples == 0) && (Ncombos > SWEEP_MAX_CONFIGS) )  {
+    fprintf ( stderr, "A sweep of %.0f configurations is too many; try "
+	      "'samples'.\n", Ncombos );
+    sw->Nconfigs = 0;
+    return FALSE;
+  }
+
+  seed_random( stream, sw->seed - 1 );
+  sw->configs  = (sweep_config_t *)alloc_mem( sw->Nconfigs,
+					      sizeof( sweep_config_t ), fn );
+  sw->maxUnits = 0;
+  for  ( c = 0 ; c < sw->Nconfigs ; c++ )  {
+    cfg = sw->configs + c;
+    cfg->parms      = *cParms;
+    cfg->parms.race = NULL;
+    cfg->values     = (char **)alloc_mem( sw->Naxes, sizeof( char * ), fn );
+    cfg->Ntrials    = 0;
+    cfg->score      = 0.0;
+    cfg->lost       = FALSE;
+    memset( &(cfg->total), 0, sizeof( trial_result_t ) );
+
+    /*  Configuration 'c' of a grid counts through the lists, the first  */
+    /* changing fastest                                                  */
+    index = c;
+    for  ( a = 0 ; a < sw->Naxes ; a++ )  {
+      axis = sw->axes + a;
+      if  ( axis->Nvalues > 0 )  {
+	if  ( sw->Nsamples > 0 )
+	  strcpy( value, axis->values[thread_random() % axis->Nvalues] );
+	else  {
+	  strcpy( value, axis->values[index % axis->Nvalues] );
+	  index /= axis->Nvalues;
+	}
+      }  else  {
+	u = (double)(thread_random() % 1000001) / 1000000.0;
+	x = ( axis->logScale ) ? axis->low * pow( axis->high/axis->low, u ) :
+	                         axis->low + u * (axis->high - axis->low);
+	if  ( axis->parm.type == INT )
+	  sprintf ( value, "%d", (int)floor( x + 0.5 ) );
+	else
+	  sprintf ( value, "%g", x );
+      }
+
+      cfg->values[a] = strdup( value );
+      parm     = axis->parm;
+      parm.ptr = (char *)&(cfg->parms) + axis->offset;
+      set_parm( FALSE, parm, value, NULL );
+    }
+
+    if  ( cfg->parms.maxNewUnits > sw->maxUnits )
+      sw->maxUnits = cfg->parms.maxNewUnits;
+  }
+  seed_random( NULL, 0 );
+
+  return TRUE;
+}
+
+
+/*	SWEEP THREAD -  Train the trials of the sweep 'arg' (a sweep_t) until
+	none are left to start, skipping those of configurations that have
+	lost a race.  Each trial is trained on a network of its own, with a
+	copy of its configuration's parameters.
+*/
+
+void *sweep_thread  ( void *arg )
+{
+  sweep_t        *sw = (sweep_t *)arg;
+  sweep_config_t *cfg;
+  train_parm_t   parms;
+  race_t         race;
+  net_t          *net;
+  trial_result_t result;
+  unsigned short stream[3];
+  int            Njobs = sw->Nconfigs * sw->Ntrials,
+                 job, t;
+
+  for  ( ;; )  {
+    pthread_mutex_lock( &(sw->lock) );
+    while  ( (sw->next < Njobs) && sw->configs[sw->next % sw->Nconfigs].lost )
+      sw->next++;
+    job = sw->next++;
+    pthread_mutex_unlock( &(sw->lock) );
+    if  ( job >= Njobs )
+      break;
+
+    cfg = sw->configs + job % sw->Nconfigs;
+    t   = job / sw->Nconfigs;
+
+    race.lock      = &(sw->lock);
+    race.best      = sw->best[t];
+    race.margin    = sw->margin;
+    race.maxUnits  = sw->maxUnits;
+    race.warmup    = sw->warmup;
+    race.lost      = FALSE;
+    parms          = cfg->parms;
+    parms.race     = &race;
+
+    net = build_net( "Sweep Net", sw->dFile->NinNodes, sw->dFile->NoutNodes,
+		     parms.maxNewUnits, parms.weightRange, parms.sigMax,
+		     parms.sigMin, parms.recurrent );
+    seed_random( stream, sw->seed + t );
+    init_net( net, parms.weightRange );
+    result = train_net( net, &parms, sw->dFile, t+1 );
+    free_net( &net );
+
+    /*  Add the results of the trial to its configuration's, as  */
+    /* 'run_trials' does                                        */
+    pthread_mutex_lock( &(sw->lock) );
+    if  ( race.lost )
+      cfg->lost = TRUE;
+    else  {
+      cfg->total.bits       += result.bits;
+      cfg->total.Nepochs    += result.Nepochs;
+      cfg->total.Nvictories += result.Nvictories;
+      cfg->total.Nunits     += result.Nunits - sw->dFile->NinNodes-1;
+      cfg->total.perCorrect += result.perCorrect;
+      cfg->total.index      += result.index;
+      cfg->total.sumSqDiffs += result.sumSqDiffs;
+      cfg->total.sumSqError += result.sumSqError;
+      cfg->Ntrials++;
+    }
+    pthread_mutex_unlock( &(sw->lock) );
+  }
+
+  seed_random( NULL, 0 );
+  return NULL;
+}
+
+
+/*	RACE BEHIND -  Check a run of a sweep that has 'Nhidden' hidden units
+	and 'error' as the sum of the squared differences of its outputs.
+	Returns TRUE, and marks the run lost, if it has fallen behind the
+	least error of its trial with as many hidden units.  Otherwise the
+	run's error becomes the least if it is.
+*/
+
+boolean race_behind  ( race_t *race, int Nhidden, float error )
+{
+  float   best;
+  boolean behind = FALSE;
+
+  if  ( (Nhidden < 0) || (Nhidden > race->maxUnits) )
+    return FALSE;
+
+  pthread_mutex_lock( race->lock );
+  best = race->best[Nhidden];
+  if  ( (best >= 0.0) && (Nhidden >= race->warmup) &&
+	(error > best * (1.0 + race->margin)) )
+    behind = TRUE;
+  else if  ( (best < 0.0) || (error < best) )
+    race->best[Nhidden] = error;
+  pthread_mutex_unlock( race->lock );
+
+  if  ( behind )  {
+    race->lost = TRUE;
+    printf ("Run fell behind with %d hidden units (error %.3f, best %.3f).\n",
+	    Nhidden, error, best );
+  }
+  return behind;
+}
+
+
+/*	COMPARE CONFIGS -  Order two configurations of a sweep for 'qsort',
+	best first.  Those that finished their trials come before those that
+	lost a race, then those with more trials, then the lower average
+	error, then the fewer hidden units and epochs.
+*/
+
+int compare_configs  ( const void *a, const void *b )
+{
+  sweep_config_t *x = (sweep_config_t *)a,
+                 *y = (sweep_config_t *)b;
+
+  if  ( x->lost != y->lost )
+    return ( x->lost ) ? 1 : -1;
+  if  ( x->Ntrials != y->Ntrials )
+    return y->Ntrials - x->Ntrials;
+  if  ( x->score != y->score )
+    return ( x->score < y->score ) ? -1 : 1;
+  if  ( x->total.Nunits != y->total.Nunits )
+    return x->total.Nunits - y->total.Nunits;
+  return x->total.Nepochs - y->total.Nepochs;
+}
+
+
+/*	WRITE SWEEP -  Write the ranked table of a sweep's configurations to
+	'fptr', with the averages of the trials each finished.
+*/
+
+void write_sweep  ( sweep_t *sw, FILE *fptr )
+{
+  sweep_config_t *cfg;
+  int            width,
+                 c, a;
+
+  fprintf ( fptr, "Sweep of '%s': %d configurations, %d trial%s each\n\n",
+	    sw->dFile->filename, sw->Nconfigs, sw->Ntrials,
+	    ( sw->Ntrials == 1 ) ? "" : "s" );
+
+  fprintf ( fptr, "Rank" );
+  for  ( a = 0 ; a < sw->Naxes ; a++ )  {
+    width = strlen( sw->axes[a].parm.name );
+    fprintf ( fptr, "  %*s", ( width > 10 ) ? width : 10,
+	      sw->axes[a].parm.name );
+  }
+  fprintf ( fptr, "  Trials    Epochs   Units  %9s  Correct  Status\n",
+	    ( cParms->errorMeasure == BITS ) ? "Bits" : "Index" );
+
+  for  ( c = 0 ; c < sw->Nconfigs ; c++ )  {
+    cfg = sw->configs + c;
+    fprintf ( fptr, "%4d", c+1 );
+    for  ( a = 0 ; a < sw->Naxes ; a++ )  {
+      width = strlen( sw->axes[a].parm.name );
+      fprintf ( fptr, "  %*s", ( width > 10 ) ? width : 10, cfg->values[a] );
+    }
+    if  ( cfg->Ntrials == 0 )
+      fprintf ( fptr, "  %6d  %8s  %6s  %9s  %7s", 0, "-", "-", "-", "-" );
+    else
+      fprintf ( fptr, "  %6d  %8.1f  %6.1f  %9.3f  %6.2f%%", cfg->Ntrials,
+		((float)cfg->total.Nepochs) / cfg->Ntrials,
+		((float)cfg->total.Nunits) / cfg->Ntrials, cfg->score,
+		cfg->total.perCorrect / cfg->Ntrials );
+    fprintf ( fptr, "  %s\n", ( cfg->lost ) ? "lost" : "done" );
+  }
+}
+
+
+/*	FREE SWEEP -  Deallocate what a sweep holds.  The data file is left
+	alone.
+*/
+
+void free_sweep  ( sweep_t *sw )
+{
+  int i, j;
+
+  for  ( i = 0 ; i < sw->Naxes ; i++ )  {
+    for  ( j = 0 ; j < sw->axes[i].Nvalues ; j++ )
+      free( sw->axes[i].values[j] );
+    free_mem( sw->axes[i].values );
+  }
+  sw->axes = free_mem( sw->axes );
+
+  if  ( sw->configs != NULL )
+    for  ( i = 0 ; i < sw->Nconfigs ; i++ )  {
+      for  ( j = 0 ; j < sw->Naxes ; j++ )
+	free( sw->configs[i].values[j] );
+      free_mem( sw->configs[i].values );
+    }
+  sw->configs = free_mem( sw->configs );
+
+  if  ( sw->best != NULL )
+    for  ( i = 0 ; i < sw->Ntrials ; i++ )
+      free_mem( sw->best[i] );
+  sw->best   = free_mem( sw->best );
+  sw->output = free_mem( sw->output );
+}
@@ -10,6 +10,7 @@
 	etc.
 */
 
+#include <stdlib.h>
 #include <math.h>
 #include <string.h>
 
@@ -18,140 +19,205 @@
 
 /*	External Global Variable Declarations	*/
 
-extern net_t        *cNet,
-                    *nets;
-extern df_t         *dFiles;
-extern train_parm_t *cParms;
-extern train_data_t *cTData;
-extern error_data_t *cError;
+extern net_t      *nets;
+extern df_t       *dFiles;
+extern registry_t *models;
 
-extern int	    Ninputs,
-		    Noutputs;
+/*  FORWARD PASS -  Feed forward through the current network with inputs
+    specified.  The outputs are computed as well.  This is for training;
+    inference goes through a context on a packed copy (see packed.c).
+*/
+
+void forward_pass  ( train_ctx_t *tc, float *inputs, boolean reset )
+{
+  net_t *net = tc->net;
 #ifdef CONNX
-extern int          connx;
+  int   i;
+
+  for  ( i = tc->Ninputs+1 ; i < net->Nunits ; i++ )
+    tc->connx += i + (net->recurrent);
 #endif
-extern float        sigMax,
-                    sigMin;
 
-/*  FORWARD PASS -  Feed forward through the current network with inputs
-    specified.  Call 'compute_outputs' to compute the outputs of the network.
+  net_forward( net, inputs, reset, net->values );
+  compute_outputs( tc );
+}
+
+
+/*  NET FORWARD -  Feed the inputs given forward through the hidden units of
+    a network, into the 'values' vector.  For a recurrent network 'values'
+    must hold the unit values of the previous point, unless 'reset' is set.
+    No training globals are touched, so this may run on a thread of its own
+    with its own 'values'.  Call 'output_values' to compute the outputs.
 */
 
-void forward_pass  ( float *inputs, boolean reset )
+void net_forward  ( net_t *net, float *inputs, boolean reset, float *values )
 {
   int   i,j;
   float sum,
         *weights;
 
-  cNet->values[0] = BIAS;
+  values[0] = BIAS;
   
-  for  ( i = 1 ; i <= Ninputs ; i++ )
-    cNet->values[i] = inputs[i-1];
+  for  ( i = 1 ; i <= net->Ninputs ; i++ )
+    values[i] = inputs[i-1];
 
-  for  ( i = Ninputs+1 ; i < cNet->Nunits ; i++ )  {
+  for  ( i = net->Ninputs+1 ; i < net->Nunits ; i++ )  {
     sum     = 0.0;
-    weights = cNet->weights[i];
+    weights = net->weights[i];
 
     for  ( j = 0 ; j < i ; j++ )
-      sum += cNet->values[j] * weights[j];
-    if  ( cNet->recurrent && !reset )
-      sum += cNet->values[i] * weights[i];
+      sum += values[j] * weights[j];
+    if  ( net->recurrent && !reset )
+      sum += values[i] * weights[i];
+
+    values[i] = activation( net, net->unitTypes[i], sum );
+  }
+}
+
+
+/*  COMPUTE OUTPUTS -  Compute the output values of the network.
+*/
+
+void compute_outputs  ( train_ctx_t *tc )
+{
+  net_t *net = tc->net;
 
-    cNet->values[i] = activation( cNet->unitTypes[i], sum );
+  output_values( net, net->values, net->outValues );
 
 #ifdef CONNX
-    connx += i + (cNet->recurrent);
+  tc->connx += tc->Noutputs * (net->Nunits+net->recurrent);
 #endif
-  }
-
-  compute_outputs( );
 }
 
 
-/*  COMPUTE OUTPUTS -  Compute the output values of the network.
+/*  OUTPUT VALUES -  Compute the outputs of a network from the unit values
+    given, storing them in 'outValues'.  No training globals are touched,
+    so this may run on a thread of its own.
 */
 
-void compute_outputs  ( void )
+void output_values  ( net_t *net, float *values, float *outValues )
 {
-  int   i, j;
-  float sum,
-        *weights;
+  int     i, j;
+  float   sum,
+          *weights;
+  boolean softmax = FALSE;
 
-  for  ( i = 0 ; i < Noutputs ; i++ )  {
+  for  ( i = 0 ; i < net->Noutputs ; i++ )  {
     sum     = 0.0;
-    weights = cNet->outWeights[i];
+    weights = net->outWeights[i];
 
-    for  ( j = 0 ; j < cNet->Nunits ; j++ )
-      sum += cNet->values[j] * weights[j];
-    cNet->outValues[i] = activation( cNet->outputTypes[i], sum );
+    for  ( j = 0 ; j < net->Nunits ; j++ )
+      sum += values[j] * weights[j];
+    outValues[i] = activation( net, net->outputTypes[i], sum );
+    softmax |= ( net->outputTypes[i] == SOFTMAX );
   }
 
-#ifdef CONNX
-  connx += Noutputs * (cNet->Nunits+cNet->recurrent);
-#endif
+  if  ( softmax )
+    softmax_outputs( outValues, net->outputTypes, net->Noutputs );
 }
 
 
-/*  COMPUTE ERROR -  Compute the error of the network, given a specific goal
-    vector.  If alterStats is set, then the error statistics will be modified
-    to reflect the current goal vector.  If alterSlopes is set, then the output
-    slopes will be modified appropriately as well.
+/*  SOFTMAX OUTPUTS -  Normalize the summed inputs of the SOFTMAX outputs into
+    a probability distribution.  The probabilities are offset to the same
+    range as a SIGMOID unit so that goals, error bits and the output maps are
+    interpreted just as they are for sigmoid outputs.
 */
-    
-void compute_error  ( float *goal, boolean alterStats, boolean alterSlopes,
-		      boolean useEPrime, float threshold )
+
+void softmax_outputs  ( float *vals, node_t *types, int num )
 {
-  float dif,
-        error,
-        val;
-  int   i, j;
+  float max   = -1.0e20,
+        total = 0.0;
+  int   i;
 
-  for  ( i = 0 ; i < Noutputs ; i++ )  {
-    val   = cNet->outValues[i];
-    dif   = val - goal [i];
-    error = (useEPrime) ? (dif*output_prime(cNet->outputTypes[i], val)) : dif;
+  for  ( i = 0 ; i < num ; i++ )
+    if  ( (types[i] == SOFTMAX) && (vals[i] > max) )
+      max = vals[i];
+
+  for  ( i = 0 ; i < num ; i++ )
+    if  ( types[i] == SOFTMAX )  {
+      vals[i] = exp( vals[i] - max );
+      total   += vals[i];
+    }
 
-    cError->errors[i] = error;
+  for  ( i = 0 ; i < num ; i++ )
+    if  ( types[i] == SOFTMAX )
+      vals[i] = vals[i] / total - 0.5;
+}
+
+
+/*  COMPUTE ERROR -  Compute the error of the network, given a specific data
+    point.  If alterStats is set, then the error statistics will be modified
+    to reflect the point's goal.  If alterSlopes is set, then the output
+    slopes will be modified appropriately as well.
+
+    For SOFTMAX outputs the difference is the gradient of the cross-entropy
+    error with respect to the output's summed input, so output_prime is 1.
+*/
+    
+void compute_error  ( train_ctx_t *tc, dv_t *point, boolean alterStats,
+		      boolean alterSlopes, boolean useEPrime, float threshold )
+{
+  net_t        *net = tc->net;
+  error_data_t *err = tc->error;
+  float        offset = tc->parms->outPrimeOffset,
+               dif,
+               error,
+               val;
+  int          i, j;
+
+  for  ( i = 0 ; i < tc->Noutputs ; i++ )  {
+    val   = net->outValues[i];
+    dif   = val - GOAL( tc->dSet, point, i );
+    error = (useEPrime) ?
+            (dif*output_prime(net, net->outputTypes[i], val, offset)) : dif;
+
+    err->errors[i] = error;
     
     if  ( alterStats )  {
       if  ( fabs( dif ) > threshold )
-	cError->bits++;
-      cError->sumSqDiffs += dif * dif;
-      cError->sumSqError += error * error;
-      cError->sumErr[i]  += error;
+	err->bits++;
+      err->sumSqDiffs += dif * dif;
+      err->sumSqError += error * error;
+      err->sumErr[i]  += error;
     }
 
     if  ( alterSlopes )
-      for  ( j = 0 ; j < cNet->Nunits ; j++ )
-	cTData->output.slopes[i][j] += error * cNet->values[j];
+      for  ( j = 0 ; j < net->Nunits ; j++ )
+	tc->tData->output.slopes[i][j] += error * net->values[j];
   }
 }
 
-void compute_normal_error  ( float *goal, int *error_count )
+void compute_normal_error  ( train_ctx_t *tc, dv_t *point, int *error_count )
 {
   float val;
   int   i;
 
   int max_val_idx, max_goal_idx;
   float max_val, max_goal;
+  float *goal = point->outputs;
 
   max_val_idx = 0;
   max_goal_idx = 0;
 
-  max_val = cNet->outValues[0];
-  max_goal = goal[0];
+  max_val = tc->net->outValues[0];
 
-  for  ( i = 0 ; i < Noutputs ; i++ )  {
-    val   = cNet->outValues[i];
+  for  ( i = 0 ; i < tc->Noutputs ; i++ )  {
+    val   = tc->net->outValues[i];
     if( val > max_val) {
     	max_val = val;
     	max_val_idx = i;
     }
+  }
 
-    if( goal[i] > max_goal) {
-    	max_goal = goal[i];
-    	max_goal_idx = i;
-    }
+  if ( goal == NULL )
+    max_goal_idx = point->target;
+  else {
+    max_goal = goal[0];
+    for  ( i = 0 ; i < tc->Noutputs ; i++ )
+      if( goal[i] > max_goal) {
+	max_goal = goal[i];
+	max_goal_idx = i;
+      }
   }
 
   if(max_val_idx != max_goal_idx){
@@ -159,6 +225,111 @@ void compute_normal_error  ( float *goal, int *error_count )
   }
 }
 
+/*  SCORE POINT -  Add the error of a network's outputs on point 'p' of a
+    data set to the statistics in 'err', as compute_error does when a
+    network is tested, and count the point in 'errorCount' if its largest
+    output is not the goal's.  'offset' is the sigmoid prime offset of the
+    outputs.  Nothing else is touched, so this may run on a thread of its
+    own.
+*/
+
+void score_point  ( net_t *net, float *outValues, data_set_t *dSet, int p,
+		    error_data_t *err, float threshold, float offset,
+		    int *errorCount )
+{
+  dv_t  *point = &(dSet->data[p]);
+  float dif,
+        error,
+        val;
+  int   i;
+
+  for  ( i = 0 ; i < net->Noutputs ; i++ )  {
+    val   = outValues[i];
+    dif   = val - GOAL( dSet, point, i );
+    error = dif * output_prime( net, net->outputTypes[i], val, offset );
+
+    if  ( fabs( dif ) > threshold )
+      err->bits++;
+    err->sumSqDiffs += dif * dif;
+    err->sumSqError += error * error;
+    err->sumErr[i]  += error;
+  }
+
+  if  ( class_of( outValues, net->Noutputs ) !=
+	( (point->outputs == NULL) ? point->target :
+	  class_of( point->outputs, net->Noutputs ) ) )
+    (*errorCount)++;
+}
+
+
+/*  CLASS OF -  Return the index of the largest of 'num' values.  The first
+    is returned in case of a tie.
+*/
+
+int class_of  ( float *vals, int num )
+{
+  int i,
+      best = 0;
+
+  for  ( i = 1 ; i < num ; i++ )
+    if  ( vals[i] > vals[best] )
+      best = i;
+
+  return best;
+}
+
+
+/*  RLS UPDATE -  Adapt the output weights of the current network to a single
+    data point using recursive least squares.  The network must already have
+    been fed forward on the point, and its 'rls' must match its size.  The
+    error of a non-linear output is carried back through the output prime
+    so that each output is adapted as a linear unit on its summed input.
+    Hidden units are not touched and the cost is O(Nunits^2) per point.
+*/
+
+void rls_update  ( train_ctx_t *tc, dv_t *point )
+{
+  net_t      *net = tc->net;
+  rls_data_t *rls = net->rls;
+  float      *x = net->values,
+             denom,
+             error,
+             *weights;
+  int        i, j;
+
+  /*  Compute the gain vector  */
+  denom = tc->parms->rlsForget;
+  for  ( i = 0 ; i < rls->Nunits ; i++ )  {
+    rls->Px[i] = 0.0;
+    for  ( j = 0 ; j < rls->Nunits ; j++ )
+      rls->Px[i] += rls->P[i][j] * x[j];
+    denom += x[i] * rls->Px[i];
+  }
+  for  ( i = 0 ; i < rls->Nunits ; i++ )
+    rls->gain[i] = rls->Px[i] / denom;
+
+  /*  Move each output's weights along the gain vector  */
+  for  ( i = 0 ; i < tc->Noutputs ; i++ )  {
+    error   = ( GOAL( tc->dSet, point, i ) - net->outValues[i] ) /
+              output_prime( net, net->outputTypes[i], net->outValues[i],
+			    tc->parms->outPrimeOffset );
+    weights = net->outWeights[i];
+    for  ( j = 0 ; j < rls->Nunits ; j++ )
+      weights[j] += rls->gain[j] * error;
+  }
+
+  /*  Update the inverse correlation matrix  */
+  for  ( i = 0 ; i < rls->Nunits ; i++ )
+    for  ( j = 0 ; j < rls->Nunits ; j++ )
+      rls->P[i][j] = ( rls->P[i][j] - rls->gain[i] * rls->Px[j] ) /
+	             tc->parms->rlsForget;
+
+#ifdef CONNX
+  tc->connx += (tc->Noutputs + 2 * rls->Nunits) * rls->Nunits;
+#endif
+}
+
+
 /*  QUICKPROP -  Perform a quickprop update on a weight.  Pointers to the
     weight, delta, slope, and previous slope values should be passed to the
     function as should the epsilon, decay, mu and shrink factor values to use.
@@ -196,10 +367,11 @@ void quickprop ( float *w, float *d, float *s, float *p, float epsilon,
 
 
 /*  ACTIVATION -  Compute the activation level of a unit based on its type and
-    the sum of its inputs.
+    the sum of its inputs.  A VARSIGMOID unit takes its range from 'net',
+    which may be NULL for the other types.
 */
 
-float activation  ( node_t unitType, float sum )
+float activation  ( net_t *net, node_t unitType, float sum )
 {
   float temp;
 
@@ -215,12 +387,13 @@ float activation  ( node_t unitType, float sum )
 		       return 1.0;
                      return 1.0 / (1.0 + exp( -sum ));
     case LINEAR:     return sum;
+    case SOFTMAX:    return sum;       /*  Normalized in compute_outputs  */
     case VARSIGMOID: if ( sum < -15.0 )
-                       return sigMin;
+                       return net->sigmoidMin;
                      if ( sum > 15.0 )
-		       return sigMax;
-                     return( (sigMax - sigMin) /
-			     (1.0 + exp( -sum )) + sigMin );
+		       return net->sigmoidMax;
+                     return( (net->sigmoidMax - net->sigmoidMin) /
+			     (1.0 + exp( -sum )) + net->sigmoidMin );
     case GAUSSIAN:   temp = -0.5 * sum * sum;
                      if  ( temp < -75.0 )
 		       return 0.0;
@@ -233,18 +406,20 @@ float activation  ( node_t unitType, float sum )
 /*	ACTIVATION PRIME -  Compute the activation prime value of a unit.  This
 	version of the function does NOT use the sigmoid prime offset to
 	increase learning speed because the offset confuses cascor's 
-	correlation machinery.
+	correlation machinery.  'net' gives the range of a VARSIGMOID unit.
 */
 
-float activation_prime  ( node_t unitType, float value, float sum )
+float activation_prime  ( net_t *net, node_t unitType, float value,
+			  float sum )
 {
   switch  ( unitType )  {
     case SIGMOID:    return( 0.25 - value * value );
     case ASIGMOID:   return( value * (1.0 - value) );
     case LINEAR:     return 1.0;
-    case VARSIGMOID: return( (value - sigMin) *
-			     ( 1.0 - (value - sigMin) ) /
-			     ( sigMax - sigMin ) );
+    case SOFTMAX:    return 1.0;
+    case VARSIGMOID: return( (value - net->sigmoidMin) *
+			     ( 1.0 - (value - net->sigmoidMin) ) /
+			     ( net->sigmoidMax - net->sigmoidMin ) );
     case GAUSSIAN:   return( sum * (-value) );
     }
 }
@@ -252,20 +427,21 @@ float activation_prime  ( node_t unitType, float value, float sum )
 
 /*  OUTPUT PRIME -  Compute the activation prime of a unit, based on its type
     and value.  Use this function only on output units, since it uses the
-    sigmoid prime offset to eliminate flat spot and this tends to confuse
-    hidden units.
+    sigmoid prime offset, 'offset', to eliminate flat spot and this tends to
+    confuse hidden units.
 */
 
-float output_prime  ( node_t outType, float value )
+float output_prime  ( net_t *net, node_t outType, float value, float offset )
 {
   switch  ( outType )  {
-    case SIGMOID:  return( cParms->outPrimeOffset + 0.25 - value * value );
-    case ASIGMOID: return( cParms->outPrimeOffset + value * (1.0 - value ) );
+    case SIGMOID:  return( offset + 0.25 - value * value );
+    case ASIGMOID: return( offset + value * (1.0 - value ) );
     case LINEAR:   return 1.0;
-    case VARSIGMOID: return( cParms->outPrimeOffset +
-			     (value - sigMin) *
-			     ( 1.0 - (value - sigMin) ) /
-			     ( sigMax - sigMin ) );    }
+    case SOFTMAX:  return 1.0;
+    case VARSIGMOID: return( offset +
+			     (value - net->sigmoidMin) *
+			     ( 1.0 - (value - net->sigmoidMin) ) /
+			     ( net->sigmoidMax - net->sigmoidMin ) );    }
 }
 
 
@@ -275,27 +451,109 @@ float output_prime  ( node_t outType, float value )
 
 float random_weight ( float x )
 {
-  return( x * ((float)(random() % 1000) / 500.0) - x );
+  return( x * ((float)(thread_random() % 1000) / 500.0) - x );
+}
+
+
+/*  Threads given a random stream of their own by 'seed_random'  */
+
+static pthread_key_t  streamKey;
+static pthread_once_t streamOnce = PTHREAD_ONCE_INIT;
+
+void make_stream_key  ( void )
+{
+  pthread_key_create( &streamKey, NULL );
+}
+
+
+/*  SEED RANDOM -  Give the calling thread a random stream of its own,
+    started from 'seed' and kept in 'state', so that what it draws does
+    not depend on what other threads draw.  'state' must last as long as
+    the thread uses it.  A NULL 'state' returns the thread to the stream
+    of 'random'.
+*/
+
+void seed_random  ( unsigned short *state, long seed )
+{
+  pthread_once( &streamOnce, make_stream_key );
+  if  ( state != NULL )  {
+    state[0] = 0x330E;
+    state[1] = (unsigned short)( seed & 0xFFFF );
+    state[2] = (unsigned short)( (seed >> 16) & 0xFFFF );
+  }
+  pthread_setspecific( streamKey, state );
+}
+
+
+/*  THREAD RANDOM -  Return a random non-negative integer, as 'random'
+    does, from the calling thread's own stream if 'seed_random' gave it
+    one.
+*/
+
+long thread_random  ( void )
+{
+  unsigned short *state;
+
+  pthread_once( &streamOnce, make_stream_key );
+  if  ( (state = pthread_getspecific( streamKey )) != NULL )
+    return nrand48( state );
+  return random( );
+}
+
+
+/*  NUM THREADS -  Return the number of threads to split 'Npts' points over,
+    giving each at least 'minPts' of them.  The 'Nthreads' parameter in
+    'parms' sets the most threads used, with zero meaning one per processor.
+*/
+
+int num_threads ( train_parm_t *parms, int Npts, int minPts )
+{
+  int Nthreads = parms->Nthreads;
+
+  if  ( Nthreads <= 0 )
+    Nthreads = num_processors( );
+  if  ( Nthreads > Npts / minPts )
+    Nthreads = Npts / minPts;
+
+  return ( Nthreads < 1 ) ? 1 : Nthreads;
 }
 
 
 /*	SYNC -  Synchronize a network to a data file so that its outputs are
 	of the correct types (and whatever other changes need to be made before
-	training).
+	training).  The 'softmax' parameter in 'parms' is honored.
 */
 
-void sync  ( net_t *net, data_file_t *dFile )
+void sync  ( net_t *net, train_parm_t *parms, data_file_t *dFile )
 {
-  int    i,j,k;
-  char   *fn = "Sync Net";
-  cvrt_t *map;
+  int     i,j,k;
+  char    *fn = "Sync Net";
+  cvrt_t  *map;
+  boolean softmax;
+
+  /*  Packed and quantized copies of the net, and its cached query  */
+  /* results, would keep the old outputs                             */
+  free_packed( &(net->packed) );
+  free_quant( &(net->quant) );
+  free_memo( &(net->memo) );
+
+  /*  Match the output types.  If every output is binary, the outputs may  */
+  /* instead be trained as a single softmax group.                         */
+  softmax = ( parms->softmax && (net->Noutputs > 1) &&
+	      (dFile->binPos == 0.5) && (dFile->binNeg == -0.5) );
+  for  ( i = 0 ; i < net->Noutputs ; i++ )
+    softmax &= ( dFile->outputType[i] == BINARY );
+  if  ( parms->softmax && !softmax )
+    fprintf (stderr, "Outputs of '%s' are not all binary.  %s\n",
+	     dFile->filename, "Softmax not used.");
 
-  /*  Match the output types  */
   for  ( i = 0 ; i < net->Noutputs ; i++ )
     if  ( dFile->outputType[i] == CONT )
       net->outputTypes[i] = LINEAR;
     else  {
-      if  ( (dFile->binPos == 0.5) && (dFile->binNeg == -0.5) )
+      if  ( softmax )
+	net->outputTypes[i] = SOFTMAX;
+      else if  ( (dFile->binPos == 0.5) && (dFile->binNeg == -0.5) )
 	net->outputTypes[i] = SIGMOID;
       else if  ( (dFile->binPos == 1.0) && (dFile->binNeg == 0.0) )
 	net->outputTypes[i] = ASIGMOID;
@@ -317,6 +575,8 @@ void sync  ( net_t *net, data_file_t *dFile )
       free( map->equivs );
       free( map->enums );
       free( map->unknown );
+      if  ( map->index != NULL )
+	free( map->index );
     }
     free( net->inputMap );
   }
@@ -331,6 +591,8 @@ void sync  ( net_t *net, data_file_t *dFile )
       free( map->equivs );
       free( map->enums );
       free( map->unknown );
+      if  ( map->index != NULL )
+	free( map->index );
     }
     free( net->outputMap );
   }
@@ -339,6 +601,16 @@ void sync  ( net_t *net, data_file_t *dFile )
   net->inputMap = (cvrt_t *) alloc_mem( net->Ninputs, sizeof( cvrt_t ), fn );
   for  ( i = 0 ; i < net->Ninputs ; i++ )  {
     map = &(net->inputMap[i]);
+    map->enums  = NULL;
+    map->equivs = NULL;
+    if  ( i >= dFile->Ninputs )  {
+      /*  A series may span several units, leaving maps to spare  */
+      map->Nenums     = 0;
+      map->Nunits     = 1;
+      map->unknown    = (float *)alloc_mem( 1, sizeof( float ), fn );
+      map->unknown[0] = 0.0;
+      continue;
+    }
     map->Nenums = dFile->inputMap[i].Nenums;
     map->Nunits = dFile->inputMap[i].Nunits;
     map->unknown = (float *)alloc_mem( map->Nunits, sizeof( float ), fn );
@@ -357,10 +629,22 @@ void sync  ( net_t *net, data_file_t *dFile )
     for  ( j = 0 ; j < map->Nunits ; j++ )
       map->unknown[j] = dFile->inputMap[i].unknown[j];
   }
+  for  ( i = 0 ; i < net->Ninputs ; i++ )
+    index_map( &(net->inputMap[i]) );
 
   net->outputMap = (cvrt_t *) alloc_mem( net->Noutputs, sizeof( cvrt_t ), fn );
   for  ( i = 0 ; i < net->Noutputs ; i++ )  {
     map = &(net->outputMap[i]);
+    map->enums  = NULL;
+    map->equivs = NULL;
+    if  ( i >= dFile->Noutputs )  {
+      /*  A series may span several units, leaving maps to spare  */
+      map->Nenums     = 0;
+      map->Nunits     = 1;
+      map->unknown    = (float *)alloc_mem( 1, sizeof( float ), fn );
+      map->unknown[0] = 0.0;
+      continue;
+    }
     map->Nenums = dFile->outputMap[i].Nenums;
     map->Nunits = dFile->outputMap[i].Nunits;
     map->unknown = (float *)alloc_mem( map->Nunits, sizeof( float ), fn );
@@ -379,16 +663,24 @@ void sync  ( net_t *net, data_file_t *dFile )
     for  ( j = 0 ; j < map->Nunits ; j++ )
       map->unknown[j] = dFile->outputMap[i].unknown[j];
   }
+  for  ( i = 0 ; i < net->Noutputs ; i++ )
+    index_map( &(net->outputMap[i]) );
 }
 
 
 /*  SELECT NET -  Locate the indicated network in memory.  If the network is
-    not found, return a NULL.
+    not found, return a NULL.  A registered network is loaded if need be
+    (see registry.c).
 */
 
 net_t *select_net ( char *name )
 {
-  net_t *index;
+  net_t   *index;
+  model_t *model;
+
+  if  ( models != NULL && (model = find_model( models, name )) != NULL &&
+	(index = use_model( models, model )) != NULL )
+    return index;
 
   index = nets;
   while ( index != NULL )  {
@@ -435,6 +727,8 @@ boolean del_net ( char *netName )
   if ( index == NULL )
     return FALSE;
 
+  if  ( models != NULL )
+    drop_model( models, index );
   free_net( &index );
   return TRUE;
 }
@@ -517,6 +811,7 @@ char *ntoa  ( node_t value )
     case ASIGMOID:   return "ASigmoid";
     case LINEAR:     return "Linear";
     case GAUSSIAN:   return "Gaussian";
+    case SOFTMAX:    return "Softmax";
     default:         return "(illegal)";
     }
 }
@@ -550,6 +845,36 @@ char *etoa  ( error_t value )
 }
 
 
+/*	CITOA -  Return the character string associated with a candidate
+	initialization mode.
+*/
+
+char *citoa  ( cinit_t value )
+{
+  switch ( value )  {
+    case RANDOM_INIT:   return "Random";
+    case RESIDUAL_INIT: return "Residual";
+    default:            return "(illegal)";
+    }
+}
+
+
+/*	PFTOA -  Converts a prediction file format to a character string.
+*/
+
+char *pftoa  ( pformat_t value )
+{
+  switch ( value )  {
+    case RAW_FORMAT:    return "Raw";
+    case TOKEN_FORMAT:  return "Tokens";
+    case BOTH_FORMAT:   return "Both";
+    case BINARY_FORMAT: return "Binary";
+    case CLASS_FORMAT:  return "Class";
+    default:            return "(illegal)";
+    }
+}
+
+
 /*	STOA -  Converts a status type to a character string.
 */
 
@@ -587,6 +912,35 @@ error_t atoe  ( char *value )
 }
 
 
+/*	ATOCI -  Extract a candidate initialization mode from the character
+	string passed.
+*/
+
+cinit_t atoci  ( char *value )
+{
+  if  ( !strcasecmp( value, "residual" ) )
+    return RESIDUAL_INIT;
+  return RANDOM_INIT;
+}
+
+
+/*	ATOPF -  Extract a prediction file format from the character string.
+*/
+
+pformat_t atopf  ( char *value )
+{
+  if  ( !strcasecmp( value, "tokens" ) )
+    return TOKEN_FORMAT;
+  if  ( !strcasecmp( value, "both" ) )
+    return BOTH_FORMAT;
+  if  ( !strcasecmp( value, "binary" ) )
+    return BINARY_FORMAT;
+  if  ( !strcasecmp( value, "class" ) )
+    return CLASS_FORMAT;
+  return RAW_FORMAT;
+}
+
+
 /*	ATON -  Extract a node type from the character string.
 */
 
@@ -600,6 +954,8 @@ node_t aton  ( char *value )
     return GAUSSIAN;
   if  ( !strcasecmp( value, "linear" ) )
     return LINEAR;
+  if  ( !strcasecmp( value, "softmax" ) )
+    return SOFTMAX;
   if  ( !strcasecmp( value, "varied" ) )
     return VARIED;
   return UNDEFINED;
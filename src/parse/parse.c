@@ -128,6 +128,80 @@ Using the library functions:
                    strings representing the returned tokens.
 
 
+   void index_map  ( cvrt_t *map )
+
+     DESCRIPTION:  Builds the hash index of a conversion map's enumerations
+     and works out the layout of their values, so that 'find_enum' and
+     'nearest_enum' need not search every enumeration.  The parser indexes
+     the maps it builds.  Maps built or copied elsewhere should be indexed
+     once they are filled in, and any index they had must be freed first.
+
+     map        :  A pointer to the conversion map to index.
+
+
+   int find_enum  ( cvrt_t *map, char *token )
+
+     DESCRIPTION:  Looks a token up among the enumerations of a conversion
+     map.  'ttof' converts tokens with this function.
+
+     map        :  A pointer to the conversion map.
+     token      :  The character token to look up.
+
+     RETURNS    :  The number of the enumeration, or NOT_FOUND.
+
+
+   int nearest_enum  ( cvrt_t *map, float *vals, float range )
+
+     DESCRIPTION:  Finds the first enumeration of a conversion map whose
+     values are each within 'range' of the values given, as 'ftot' does.
+     One-hot (enum) and binary (binenum) series are decoded in one pass over
+     their values, however many enumerations they have.
+
+     map        :  A pointer to the conversion map.
+     vals       :  The values of the map's units.
+     range      :  As for 'ftot'.
+
+     RETURNS    :  The number of the enumeration, or NOT_FOUND if none is
+                   close enough.
+
+
+   boolean class_targets  ( data_file_t *dFile )
+
+     DESCRIPTION:  Stores the outputs of every data set in 'dFile' as a class
+     index rather than as a vector of floating point values.  This is only
+     possible when every output unit is BINARY and exactly one of them is on
+     at each point, as with a single enumerated series or a group of binary
+     series coded one-hot.  The output vectors are freed and each point's
+     'target' field is set to the index of the unit that is on.  Each data
+     set keeps the file's binary values, from which the goals are rebuilt.
+
+     dFile      :  A pointer to a parsed data file.
+
+     RETURNS    :  TRUE if the targets were converted, FALSE if the outputs
+                   of the data file cannot be represented as class indices.
+
+
+   void free_cmap  ( cvrt_t cmap )
+
+     DESCRIPTION:  Frees everything a conversion map points to, for maps
+     built or copied outside the parser.  The map itself is left alone.
+
+     cmap       :  The conversion map.
+
+
+   float calc_std_dev  ( dv_t *data, int NoutNodes, int Npts )
+
+     DESCRIPTION:  Computes the standard deviation of the outputs of a run
+     of points, as the parser does for each data set it builds ('stdDev').
+     Data sets built outside the parser need it for their error index.
+
+     data       :  The points.
+     NoutNodes  :  The number of outputs of each point.
+     Npts       :  The number of points.
+
+     RETURNS    :  The standard deviation of every output of every point.
+
+
 Using the library data structures:
 
     data_file_t  -  Master structure for a parsed data file.  Contains all the
@@ -195,6 +269,16 @@ Using the library data structures:
                  representation in case we can't determine what the value in a
                  position actually is.  Continuous series have a one value
                  array that contains the mean value for the continuous series.
+      Nbuckets : Size of the hash index of the enumerations, a power of two.
+                 Zero if the map has not been indexed.
+      index    : The hash index, an array of Nbuckets enumeration numbers
+                 placed by hashing their tokens.  Unused buckets hold
+                 NOT_FOUND.
+      code     : UNARY_CODE if each enumeration turns on one unit of its own,
+                 as enums do, BINARY_CODE if the units count the enumeration
+                 number in binary, as binenums do, LIST_CODE otherwise.
+      codePos/ : The on and off values of a UNARY_CODE or BINARY_CODE.
+      codeNeg
 
 
     data_set_t  -  A data set.  Contains input to output mappings for use by
@@ -203,6 +287,8 @@ Using the library data structures:
       name        :  The name of the data set.
       Npts        :  The number of data vectors in the data set.
       stdDev      :  The standard deviation of the data set's outputs.
+      binPos/     :  The values of an output unit that is on and off, for
+      binNeg         points whose targets are stored as a class index.
       predictOnly :  TRUE if there are no outputs in this data set.  FALSE
                      otherwise.
       data        :  An array of data vectors.  One element for each point.
@@ -214,7 +300,10 @@ Using the library data structures:
       reset   :  For networks with short term memories, this indicates that
                  they should reset their short term memories.
       inputs  :  The floating point input vector.
-      outputs :  The floating point output vector.
+      outputs :  The floating point output vector.  NULL if the targets have
+                 been converted to class indices by class_targets.
+      target  :  The index of the output unit that is on when the outputs are
+                 stored as a class index, NOT_FOUND otherwise.
 
 
 
@@ -438,6 +527,7 @@ float       *gen_datavect  ( int, int, cvrt_t *, int **, dvect_t * );
 float       get_cont_data  ( token_t *, float );
 float       *get_enum_data ( token_t *, cvrt_t * );
 float       *lookup_ident  ( char *, cvrt_t *, int );
+unsigned long hash_token   ( char * );
 float       calc_std_dev   ( dv_t *, int, int );
 
 void        uninterp       ( data_file_t * );
@@ -556,7 +646,6 @@ void free_data  ( data_file_t **data )
 
 boolean ttof ( float *retval, char **tokens, int Ntokens, cvrt_t *map )
 {
-  boolean found; 
   int     i,j,
           node = 0;
   float   *val;
@@ -580,17 +669,11 @@ boolean ttof ( float *retval, char **tokens, int Ntokens, cvrt_t *map )
       continue;
     }
 
-    found = FALSE;
-    for  ( j = 0 ; j < map[i].Nenums ; j++ )
-      if  ( !strcmp( tokens[i], map[i].enums[j] ) )  {
-	val   = map[i].equivs[j];
-	found = TRUE;
-	break;
-      }
-    if  ( !found )  {
+    if  ( (j = find_enum( &(map[i]), tokens[i] )) == NOT_FOUND )  {
       fprintf (stderr, "\nERROR:  Unknown identifier %s\n", tokens[i] );
       return FALSE;
     }
+    val = map[i].equivs[j];
 
     for  ( j = 0 ; j < map[i].Nunits ; j++ )
       retval[node++] = val[j];
@@ -608,9 +691,7 @@ boolean ttof ( float *retval, char **tokens, int Ntokens, cvrt_t *map )
 char **ftot ( float *vals, float range, int Ntokens, cvrt_t *map )
 {
   int     node = 0,
-          tnode,
-          i,j,k;
-  boolean found;
+          i,j;
   char    **temp,
           *fn = "Float to token";
 
@@ -623,29 +704,209 @@ char **ftot ( float *vals, float range, int Ntokens, cvrt_t *map )
       continue;
     }
 
-    j = 0;
-    while ( TRUE )  {
-      if  ( j == map[i].Nenums )  {
-	temp[i] = strdup("?");
-	break;
-      } else {
-	found = TRUE;
-	for  ( k = 0, tnode = node; k < map[i].Nunits ; k++, tnode++ )
-	  if  ( fabs( vals[tnode] - map[i].equivs[j][k] ) > range )  {
-	    found = FALSE;
-	    j++;
+    j = nearest_enum( &(map[i]), vals+node, range );
+    temp[i] = strdup( ( j == NOT_FOUND ) ? "?" : map[i].enums[j] );
+    node += map[i].Nunits;
+  }
+
+  return temp;
+}
+
+
+/*	INDEX MAP -  Build the hash index of a conversion map's enumerations
+	and find the layout of their values.  For information on usage, see
+	the header information at the top of this file.
+*/
+
+void index_map  ( cvrt_t *map )
+{
+  int i, j, b;
+
+  map->Nbuckets = 0;
+  map->index    = NULL;
+  map->code     = LIST_CODE;
+  map->codePos  = 0.0;
+  map->codeNeg  = 0.0;
+  if  ( map->Nenums == 0 )
+    return;
+
+  /*  Each enumeration goes in the first free bucket from its hash.  A    */
+  /* token declared twice keeps its first enumeration, as a search would. */
+
+  for  ( map->Nbuckets = 2 ; map->Nbuckets < 2 * map->Nenums ; )
+    map->Nbuckets *= 2;
+  map->index = (int *)alloc_mem( map->Nbuckets, sizeof( int ), "Index map" );
+  for  ( b = 0 ; b < map->Nbuckets ; b++ )
+    map->index[b] = NOT_FOUND;
+
+  for  ( i = 0 ; i < map->Nenums ; i++ )  {
+    if  ( find_enum( map, map->enums[i] ) != NOT_FOUND )
+      continue;
+    for  ( b = hash_token( map->enums[i] ) & (map->Nbuckets-1) ;
+	   map->index[b] != NOT_FOUND ; b = (b+1) & (map->Nbuckets-1) )
+      ;
+    map->index[b] = i;
+  }
+
+  /*  Enums turn on a unit of their own, binenums count in binary.  The   */
+  /* values are checked, since a map read from a network file could hold  */
+  /* any pattern.                                                          */
+
+  if  ( map->Nenums < 2 )
+    return;
+  if  ( map->Nunits == map->Nenums )  {
+    map->code    = UNARY_CODE;
+    map->codePos = map->equivs[0][0];
+    map->codeNeg = map->equivs[1][0];
+  } else if  ( map->Nunits == num_bin( map->Nenums ) )  {
+    map->code    = BINARY_CODE;
+    map->codePos = map->equivs[1][0];
+    map->codeNeg = map->equivs[0][0];
+  } else
+    return;
+
+  for  ( i = 0 ; i < map->Nenums ; i++ )
+    for  ( j = 0 ; j < map->Nunits ; j++ )
+      if  ( map->equivs[i][j] !=
+	    ( ( ( map->code == UNARY_CODE ) ? (i == j) : ((i >> j) & 1) ) ?
+	      map->codePos : map->codeNeg ) )  {
+	map->code = LIST_CODE;
+	return;
+      }
+}
+
+
+/*	FIND ENUM -  Look a token up in a conversion map, through its hash
+	index if it has one.  For information on usage, see the header
+	information at the top of this file.
+*/
+
+int find_enum  ( cvrt_t *map, char *token )
+{
+  int i, b;
+
+  if  ( map->Nbuckets == 0 )  {
+    for  ( i = 0 ; i < map->Nenums ; i++ )
+      if  ( !strcmp( token, map->enums[i] ) )
+	return i;
+    return NOT_FOUND;
+  }
+
+  for  ( b = hash_token( token ) & (map->Nbuckets-1) ;
+	 map->index[b] != NOT_FOUND ; b = (b+1) & (map->Nbuckets-1) )
+    if  ( !strcmp( token, map->enums[map->index[b]] ) )
+      return map->index[b];
+
+  return NOT_FOUND;
+}
+
+
+/*	NEAREST ENUM -  Find the first enumeration of a conversion map whose
+	values are all within 'range' of 'vals'.  For information on usage,
+	see the header information at the top of this file.
+*/
+
+int nearest_enum  ( cvrt_t *map, float *vals, float range )
+{
+  int on = NOT_FOUND,
+      num = 0,
+      i, k;
+
+  switch  ( map->code )  {
+    case UNARY_CODE:
+      /*  Every unit but the one that is on must be off  */
+      for  ( k = 0 ; k < map->Nunits ; k++ )
+	if  ( fabs( vals[k] - map->codeNeg ) > range )  {
+	  if  ( on != NOT_FOUND )
+	    return NOT_FOUND;
+	  on = k;
+	}
+      if  ( on != NOT_FOUND )
+	return ( fabs( vals[on] - map->codePos ) > range ) ? NOT_FOUND : on;
+
+      /*  Every unit is off.  The first that could also be on matches.  */
+      for  ( k = 0 ; k < map->Nunits ; k++ )
+	if  ( fabs( vals[k] - map->codePos ) <= range )
+	  return k;
+      return NOT_FOUND;
+
+    case BINARY_CODE:
+      /*  A bit that could be either is taken as off, giving the first  */
+      /* enumeration that matches.                                       */
+      for  ( k = 0 ; k < map->Nunits ; k++ )
+	if  ( fabs( vals[k] - map->codeNeg ) > range )  {
+	  if  ( fabs( vals[k] - map->codePos ) > range )
+	    return NOT_FOUND;
+	  num |= 1 << k;
+	}
+      return ( num < map->Nenums ) ? num : NOT_FOUND;
+
+    default:
+      for  ( i = 0 ; i < map->Nenums ; i++ )  {
+	for  ( k = 0 ; k < map->Nunits ; k++ )
+	  if  ( fabs( vals[k] - map->equivs[i][k] ) > range )
 	    break;
-	  }
-	if  ( found )  {
-	  temp[i] = strdup( map[i].enums[j] );
-	  break;
+	if  ( k == map->Nunits )
+	  return i;
+      }
+      return NOT_FOUND;
+  }
+}
+
+
+/*	CLASS TARGETS -  Replace the output vectors of each data set with the
+	index of the output unit that is on.  For information on usage, see
+	the header information at the top of this file.
+*/
+
+boolean class_targets ( data_file_t *dFile )
+{
+  data_set_t *dSet;
+  dv_t       *pt;
+  int        Non,
+             pass,
+             i,j,k;
+
+  if  ( dFile->NoutNodes < 2 )
+    return FALSE;
+  for  ( k = 0 ; k < dFile->NoutNodes ; k++ )
+    if  ( dFile->outputType[k] != BINARY )
+      return FALSE;
+
+  /*  The first pass checks that every point is one-hot, the second pass  */
+  /* does the conversion.                                                 */
+
+  for  ( pass = 0 ; pass < 2 ; pass++ )
+    for  ( i = 0 ; i < dFile->NdataSets ; i++ )  {
+      dSet = (dFile->dataSets)+i;
+      if  ( dSet->predictOnly )
+	continue;
+      dSet->binPos = dFile->binPos;
+      dSet->binNeg = dFile->binNeg;
+      for  ( j = 0 ; j < dSet->Npts ; j++ )  {
+	pt = (dSet->data)+j;
+	if  ( pt->outputs == NULL )
+	  continue;
+	if  ( pass == 0 )  {
+	  Non = 0;
+	  for  ( k = 0 ; k < dFile->NoutNodes ; k++ )
+	    if  ( pt->outputs[k] == dFile->binPos )
+	      Non++;
+	    else if  ( pt->outputs[k] != dFile->binNeg )
+	      return FALSE;
+	  if  ( Non != 1 )
+	    return FALSE;
+	} else {
+	  for  ( k = 0 ; pt->outputs[k] != dFile->binPos ; k++ )
+	    ;
+	  pt->target = k;
+	  free( pt->outputs );
+	  pt->outputs = NULL;
 	}
       }
     }
-    node += map[i].Nunits;
-  }
 
-  return temp;
+  return TRUE;
 }
 
 /********************************* Lexer *************************************/
@@ -1909,6 +2170,7 @@ void  get_equivs  ( int **mapping, ser_t *series, float *means, float binPos,
       case specEnumT:  (*cvrtMap)[i] = senum_equiv( ser );
 	               break;
       };
+    index_map( &((*cvrtMap)[i]) );
     totNodes += (*cvrtMap)[i].Nunits;
   }
 
@@ -2134,7 +2396,8 @@ data_set_t  gen_dataset  ( data_file_t *dFile, map_t *map, dvect_t data,
   step  = map->step;
   point = 0;
   for  ( index = begin ; index < end ; index += step, point++ )  {
-    dSet.data[point].reset = data.endSeg[index];
+    dSet.data[point].reset  = data.endSeg[index];
+    dSet.data[point].target = NOT_FOUND;
     
     dSet.data[point].inputs = (float *)alloc_mem( dFile->NinNodes, 
 						 sizeof( float ), fn );
@@ -2263,7 +2526,7 @@ int lookup_label ( char *lbl, lbl_t *labels )
 
 
 /*	LOOKUP IDENT -  Lookup an identifier in mapping table.  Complain if
-	you can't find it.  The search is linear.
+	you can't find it.  The search goes through the map's hash index.
 */
 
 float *lookup_ident  ( char *ident, cvrt_t *cMap, int line )
@@ -2271,9 +2534,8 @@ float *lookup_ident  ( char *ident, cvrt_t *cMap, int line )
   char errMess [EMLEN];
   int  i;
 
-  for  ( i = 0 ; i < cMap->Nenums ; i++ )
-    if  ( !strcmp( ident, cMap->enums[i] ) )
-      return cMap->equivs[i];
+  if  ( (i = find_enum( cMap, ident )) != NOT_FOUND )
+    return cMap->equivs[i];
 
   sprintf   ( errMess, "Unknown identifier '%s'", ident );
   parse_err ( line, errMess );
@@ -2281,6 +2543,23 @@ float *lookup_ident  ( char *ident, cvrt_t *cMap, int line )
 }
 
 
+/*	HASH TOKEN -  Hash an identifier for the index of a conversion map
+	(FNV-1a).
+*/
+
+unsigned long hash_token  ( char *token )
+{
+  unsigned long hash = 2166136261UL;
+
+  while  ( *token != '\0' )  {
+    hash ^= (unsigned char)*token++;
+    hash *= 16777619UL;
+  }
+
+  return hash;
+}
+
+
 /*	CALC STD DEV -  Calculate the standard deviation for the outputs of a
 	data set and return that value.
 */
@@ -2376,7 +2655,9 @@ void  print_data  ( data_set_t data, int Nin, int Nout )
       printf ("        ");
     for  ( j = 0 ; j < Nin ; j++ )
       printf ("%6.4f ", data.data[i].inputs[j]);
-    if  ( !data.predictOnly )  {
+    if  ( !data.predictOnly && (data.data[i].outputs == NULL) )
+      printf ("=> class %d", data.data[i].target);
+    else if  ( !data.predictOnly )  {
       printf ("=> ");
       for  ( j = 0 ; j < Nout ; j++ )
 	printf ("%6.4f ", data.data[i].outputs[j]);
@@ -2560,6 +2841,8 @@ void  free_cmap  ( cvrt_t cmap )
     free( cmap.equivs );
   if  ( cmap.unknown != NULL )
     free( cmap.unknown );
+  if  ( cmap.index != NULL )
+    free( cmap.index );
 }
 
 void  free_data_set  ( data_set_t dSet )
@@ -18,6 +18,12 @@ typedef enum {		/*  Outputs can be either BINARY or                  */
   BINARY		/*  and enumerated units while CONTinuous values are */
   }  out_t;		/*  used for standard floating point numbers.        */
 
+typedef enum {		/*  The layout of an enumerated series' values.      */
+  LIST_CODE,		/*  UNARY_CODE and BINARY_CODE are the one-hot and   */
+  UNARY_CODE,		/*  binary counting patterns of enums and binenums,  */
+  BINARY_CODE		/*  LIST_CODE is any other list of values.           */
+  }  code_t;
+
 
 /*	DATA SET -  This structure contains the information needed to train a
 	network to perform a specific task.  The filename that the data came
@@ -28,23 +34,31 @@ typedef enum {		/*  Outputs can be either BINARY or                  */
 
 
 typedef struct  {
-  int   Nenums,
-        Nunits;
-  char  **enums;
-  float **equivs,
-        *unknown;
+  int    Nenums,
+         Nunits;
+  char   **enums;
+  float  **equivs,
+         *unknown;
+  int    Nbuckets,
+         *index;
+  code_t code;
+  float  codePos,
+         codeNeg;
 } cvrt_t;
 
 typedef struct  {
   float   *inputs,
           *outputs;
+  int     target;
   boolean reset;
 } dv_t;
 
 typedef struct  {
   char     *name;
   int      Npts;
-  float    stdDev;
+  float    stdDev,
+           binPos,
+           binNeg;
   boolean  predictOnly;
   dv_t     *data;
 }  data_set_t;
@@ -75,5 +89,11 @@ boolean parse_data  ( char *, float, float, data_file_t ** );
 void    free_data   ( data_file_t ** );
 boolean ttof        ( float *, char **, int, cvrt_t * );
 char    **ftot      ( float *, float, int, cvrt_t * );
+void    index_map   ( cvrt_t * );
+int     find_enum   ( cvrt_t *, char * );
+int     nearest_enum ( cvrt_t *, float *, float );
+boolean class_targets ( data_file_t * );
 char    *otoa       ( out_t );
+void    free_cmap   ( cvrt_t );
+float   calc_std_dev ( dv_t *, int, int );
 #endif
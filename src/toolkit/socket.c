@@ -0,0 +1,296 @@
+/*	Socket Library
+
+	Local stream sockets and a readiness poller for servers that handle
+	many clients on one thread.  All sockets are non-blocking.  The poller
+	uses epoll where the system has it, and poll() elsewhere.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#else
+#include <poll.h>
+#endif
+
+#include "toolkit.h"
+
+
+/*	SOCK LISTEN -  Create a non-blocking stream socket listening at the
+	local address 'path', replacing any socket file left there.  Returns
+	the socket, or ERROR.
+*/
+
+int sock_listen ( char *path )
+{
+  struct sockaddr_un addr;
+  int                fd;
+
+  if  ( strlen( path ) >= sizeof( addr.sun_path ) )  {
+    fprintf ( stderr, "ERROR: Socket path '%s' is too long.\n", path );
+    return ERROR;
+  }
+  memset ( &addr, 0, sizeof( addr ) );
+  addr.sun_family = AF_UNIX;
+  strcpy ( addr.sun_path, path );
+
+  if  ( (fd = socket( AF_UNIX, SOCK_STREAM, 0 )) < 0 )  {
+    perror ( "socket" );
+    return ERROR;
+  }
+  unlink ( path );
+  if  ( bind( fd, (struct sockaddr *)&addr, sizeof( addr ) ) < 0 ||
+	listen( fd, SOMAXCONN ) < 0 )  {
+    perror ( path );
+    close  ( fd );
+    return ERROR;
+  }
+  fcntl ( fd, F_SETFL, fcntl( fd, F_GETFL ) | O_NONBLOCK );
+
+  return fd;
+}
+
+
+/*	SOCK ACCEPT -  Accept a waiting connection on a listening socket.
+	Returns the new non-blocking socket, or ERROR if none is waiting.
+*/
+
+int sock_accept ( int fd )
+{
+  int client;
+#ifdef SO_NOSIGPIPE
+  int on = 1;
+#endif
+
+  if  ( (client = accept( fd, NULL, NULL )) < 0 )
+    return ERROR;
+  fcntl ( client, F_SETFL, fcntl( client, F_GETFL ) | O_NONBLOCK );
+#ifdef SO_NOSIGPIPE
+  setsockopt ( client, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof( on ) );
+#endif
+
+  return client;
+}
+
+
+/*	SOCK READ -  Read up to 'n' bytes from a socket.  Returns the number
+	of bytes read, 0 if nothing is waiting, or ERROR once the other end
+	has closed or the socket has failed.
+*/
+
+int sock_read ( int fd, char *buf, int n )
+{
+  ssize_t got;
+
+  while  ( (got = read( fd, buf, n )) < 0 && errno == EINTR )
+    ;
+  if  ( got > 0 )
+    return (int)got;
+  if  ( got < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) )
+    return 0;
+
+  return ERROR;
+}
+
+
+/*	SOCK WRITE -  Write up to 'n' bytes to a socket without raising
+	SIGPIPE.  Returns the number of bytes written, 0 if the socket is
+	full, or ERROR if it has failed.
+*/
+
+int sock_write ( int fd, char *buf, int n )
+{
+  ssize_t put;
+
+#ifdef MSG_NOSIGNAL
+  while  ( (put = send( fd, buf, n, MSG_NOSIGNAL )) < 0 && errno == EINTR )
+    ;
+#else
+  while  ( (put = write( fd, buf, n )) < 0 && errno == EINTR )
+    ;
+#endif
+  if  ( put >= 0 )
+    return (int)put;
+  if  ( errno == EAGAIN || errno == EWOULDBLOCK )
+    return 0;
+
+  return ERROR;
+}
+
+
+/*	SOCK CLOSE -  Close a socket.  If 'path' is not NULL, the socket file
+	of a listening socket is removed as well.
+*/
+
+void sock_close ( int fd, char *path )
+{
+  close ( fd );
+  if  ( path != NULL )
+    unlink ( path );
+}
+
+
+/*	NEW POLLER -  Create a poller able to watch 'maxFds' sockets.
+*/
+
+poller_t *new_poller ( int maxFds )
+{
+  poller_t *poller;
+  char     *fn = "New Poller";
+
+  poller = (poller_t *)alloc_mem( 1, sizeof( poller_t ), fn );
+  poller->maxFds = maxFds;
+  poller->Nfds   = 0;
+#ifdef __linux__
+  poller->fd     = epoll_create( maxFds );
+  poller->fds    = alloc_mem( maxFds, sizeof( struct epoll_event ), fn );
+  poller->data   = NULL;
+#else
+  poller->fd     = ERROR;
+  poller->fds    = alloc_mem( maxFds, sizeof( struct pollfd ), fn );
+  poller->data   = (void **)alloc_mem( maxFds, sizeof( void * ), fn );
+#endif
+
+  return poller;
+}
+
+
+/*	FREE POLLER -  Free a poller.  The sockets it watched are not closed.
+*/
+
+void free_poller ( poller_t **poller )
+{
+  if  ( *poller == NULL )
+    return;
+
+  if  ( (*poller)->fd != ERROR )
+    close ( (*poller)->fd );
+  free_mem ( (*poller)->fds );
+  free_mem ( (*poller)->data );
+  *poller = free_mem( *poller );
+}
+
+
+/*	POLL ADD -  Watch a socket for input.  'data' is handed back with its
+	events.  Returns FALSE if the poller is full.
+*/
+
+boolean poll_add ( poller_t *poller, int fd, void *data )
+{
+#ifdef __linux__
+  struct epoll_event ev;
+
+  if  ( poller->Nfds == poller->maxFds )
+    return FALSE;
+  ev.events   = EPOLLIN;
+  ev.data.ptr = data;
+  if  ( epoll_ctl( poller->fd, EPOLL_CTL_ADD, fd, &ev ) < 0 )
+    return FALSE;
+#else
+  struct pollfd *pfd = (struct pollfd *)poller->fds + poller->Nfds;
+
+  if  ( poller->Nfds == poller->maxFds )
+    return FALSE;
+  pfd->fd     = fd;
+  pfd->events = POLLIN;
+  poller->data[poller->Nfds] = data;
+#endif
+  poller->Nfds++;
+
+  return TRUE;
+}
+
+
+/*	POLL REMOVE -  Stop watching a socket.
+*/
+
+void poll_remove ( poller_t *poller, int fd )
+{
+#ifdef __linux__
+  struct epoll_event ev;
+
+  if  ( epoll_ctl( poller->fd, EPOLL_CTL_DEL, fd, &ev ) == 0 )
+    poller->Nfds--;
+#else
+  struct pollfd *pfds = (struct pollfd *)poller->fds;
+  int           i;
+
+  for  ( i = 0 ; i < poller->Nfds ; i++ )
+    if  ( pfds[i].fd == fd )  {
+      poller->Nfds--;
+      pfds[i]         = pfds[poller->Nfds];
+      poller->data[i] = poller->data[poller->Nfds];
+      break;
+    }
+#endif
+}
+
+
+/*	POLL OUTPUT -  Set whether a watched socket is also watched for room
+	to write, which a server wants only while it has output waiting.
+*/
+
+void poll_output ( poller_t *poller, int fd, void *data, boolean on )
+{
+#ifdef __linux__
+  struct epoll_event ev;
+
+  ev.events   = ( on ) ? EPOLLIN | EPOLLOUT : EPOLLIN;
+  ev.data.ptr = data;
+  epoll_ctl( poller->fd, EPOLL_CTL_MOD, fd, &ev );
+#else
+  struct pollfd *pfds = (struct pollfd *)poller->fds;
+  int           i;
+
+  for  ( i = 0 ; i < poller->Nfds ; i++ )
+    if  ( pfds[i].fd == fd )
+      pfds[i].events = ( on ) ? POLLIN | POLLOUT : POLLIN;
+#endif
+}
+
+
+/*	POLL WAIT -  Wait up to 'ms' milliseconds (forever if negative) for
+	watched sockets to become ready, and store at most 'max' of their
+	events in 'events'.  Hang-ups and errors are reported as input, so
+	that the next read sees them.  Returns the number of events, which is
+	0 on a timeout or a signal.
+*/
+
+int poll_wait ( poller_t *poller, int ms, poll_event_t *events, int max )
+{
+  int                n, i;
+#ifdef __linux__
+  struct epoll_event *evs = (struct epoll_event *)poller->fds;
+
+  if  ( max > poller->maxFds )
+    max = poller->maxFds;
+  if  ( (n = epoll_wait( poller->fd, evs, max, ms )) < 0 )
+    return 0;
+  for  ( i = 0 ; i < n ; i++ )  {
+    events[i].data     = evs[i].data.ptr;
+    events[i].readable = ( (evs[i].events & ~EPOLLOUT) != 0 );
+    events[i].writable = ( (evs[i].events & EPOLLOUT) != 0 );
+  }
+#else
+  struct pollfd      *pfds = (struct pollfd *)poller->fds;
+  int                Nready;
+
+  if  ( (Nready = poll( pfds, poller->Nfds, ms )) <= 0 )
+    return 0;
+  for  ( i = 0, n = 0 ; i < poller->Nfds && n < max ; i++ )
+    if  ( pfds[i].revents != 0 )  {
+      events[n].data     = poller->data[i];
+      events[n].readable = ( (pfds[i].revents & ~POLLOUT) != 0 );
+      events[n].writable = ( (pfds[i].revents & POLLOUT) != 0 );
+      n++;
+    }
+#endif
+
+  return n;
+}
@@ -0,0 +1,23 @@
+/*	System Information Library
+
+	Queries about the machine the program is running on.
+*/
+
+#include <unistd.h>
+#include "toolkit.h"
+
+
+/*	NUM PROCESSORS -  Returns the number of processors that are online,
+	or 1 if the system will not say.
+*/
+
+int num_processors ( void )
+{
+#ifdef _SC_NPROCESSORS_ONLN
+  long Nprocs = sysconf( _SC_NPROCESSORS_ONLN );
+
+  if  ( Nprocs > 0 )
+    return (int)Nprocs;
+#endif
+  return 1;
+}
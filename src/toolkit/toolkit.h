@@ -38,6 +38,20 @@
 typedef unsigned char boolean;
 typedef unsigned char byte;
 
+typedef struct {		/*  Watches sockets for readiness (socket.c)  */
+  int   fd,			/*  epoll descriptor, or ERROR  */
+        Nfds,			/*  Sockets watched  */
+        maxFds;			/*  Most sockets that may be watched  */
+  void  *fds,			/*  System event or pollfd array  */
+        **data;			/*  Data of each pollfd, with poll()  */
+} poller_t;
+
+typedef struct {		/*  A socket found ready by a poller  */
+  void    *data;		/*  Data given when the socket was added  */
+  boolean readable,		/*  Input, a hang-up or an error waiting  */
+          writable;		/*  Room to write  */
+} poll_event_t;
+
 
 /*	Visible Function Prototypes	*/
 
@@ -65,6 +79,24 @@ boolean  isboolean     ( char * );
 char     *btoa         ( int, boolean );
 boolean  atob          ( char * );
 
+/*  system.c  */
+
+int      num_processors ( void );
+
+/*  socket.c  */
+
+int      sock_listen   ( char * );
+int      sock_accept   ( int );
+int      sock_read     ( int, char *, int );
+int      sock_write    ( int, char *, int );
+void     sock_close    ( int, char * );
+poller_t *new_poller   ( int );
+void     free_poller   ( poller_t ** );
+boolean  poll_add      ( poller_t *, int, void * );
+void     poll_remove   ( poller_t *, int );
+void     poll_output   ( poller_t *, int, void *, boolean );
+int      poll_wait     ( poller_t *, int, poll_event_t *, int );
+
 
 /*  The following are included to help fix brokeness in various vendor
     unices.